@@ -3,17 +3,62 @@
 
 #include <stdio.h>
 #include "ADS111x.hpp"
-#include "esp_log.h"
-#include "esp_err.h"
+#ifndef ESP_PLATFORM
+#include "ADS111x_sim.hpp"
+#endif
 #include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+
+// Savitzky-Golay coefficients (quadratic fit) per filter length, constant data in flash
+static const float s_arr_savgol_5[5] = {-3.F, 12.F, 17.F, 12.F, -3.F};
+static const float s_arr_savgol_7[7] = {-2.F, 3.F, 6.F, 7.F, 6.F, 3.F, -2.F};
+static const float s_arr_savgol_9[9] = {-21.F, 14.F, 39.F, 54.F, 59.F, 54.F, 39.F, 14.F, -21.F};
+static const float s_arr_savgol_11[11] = {-36.F, 9.F, 44.F, 69.F, 84.F, 89.F, 84.F, 69.F, 44.F, 9.F, -36.F};
 
 ADS1115::ADS1115() {
+  // I2C master on target, register emulator on host builds, both without heap allocation
+#ifdef ESP_PLATFORM
+  _init(&_objIdfTransport);
+#else
+  static ADS1115SimTransport s_obj_sim_transport;
+  _init(&s_obj_sim_transport);
+#endif
+}
+
+ADS1115::ADS1115(ADS1115Transport * ptr_transport) {
+  _init(ptr_transport);
+}
+
+void ADS1115::_init(ADS1115Transport * ptr_transport) {
+  _ptrTransport = ptr_transport;
+  _iSdaPin = -1;
+  _iSclPin = -1;
+
   // Initialize Conversion buffer
-  _ptrConvBuff = new int16_t[ADS1115_CONV_BUF_SIZE];
   _iBuffCnt = -1;
   _iBuffMaxFillIndex = 0;
 
-  for (int i_elem=0; i_elem<ADS1115_CONV_BUF_SIZE; i_elem++){_ptrConvBuff[i_elem]=0;}
+  for (int i_elem=0; i_elem<ADS1115_CONV_BUF_SIZE; i_elem++){_arrConvBuff[i_elem]=0;}
+
+  _iSizeConvTable = 0;
+  _ptrFilterCoeff = NULL;
+  _bFilterActive = false;
+  _bSavGolFilterActive = false;
+  bitNumbering = ADS1115_LSB_2P048;
+  _iPga = ADS1115_PGA_2P048;
+  _bAutoRangeActive = false;
+  _iAutoRangeCoarse = ADS1115_PGA_6P144;
+  _iAutoRangeFine = ADS1115_PGA_0P256;
+  _iRangeDiscardCnt = 0;
+  _bRangeSettling = false;
+  _iRangeSwitchCnt = 0;
+  _fLastConvValue = 0.F;
+  _iCorrOffset = 0;
+  _iCorrGain = 1 << ADS1115_CORR_GAIN_FRAC_BITS;
+
+  _bConnectStatus = false;
+  _objI2cStats = {};
 }
 
 void ADS1115::bitWrite(uint16_t * ptr_value, int i_pos, bool b_val){
@@ -30,7 +75,7 @@ void ADS1115::bitWrite(uint16_t * ptr_value, int i_pos, bool b_val){
 bool ADS1115::begin() {
   bool b_success = true;
   _iI2cAddress = ADS1115_I2CADD_DEFAULT;
-  if (i2c_master_init() == ESP_OK){
+  if (_ptrTransport->init(_iSdaPin, _iSclPin) == ESP_OK){
     b_success = true;
   } else{
     b_success = false;
@@ -41,7 +86,7 @@ bool ADS1115::begin() {
 bool ADS1115::begin(uint8_t i_i2c_address) {
   bool b_success = true;
   _iI2cAddress  = i_i2c_address;
-  if (i2c_master_init() == ESP_OK){
+  if (_ptrTransport->init(_iSdaPin, _iSclPin) == ESP_OK){
     b_success = true;
   } else{
     b_success = false;
@@ -54,7 +99,7 @@ bool ADS1115::begin(int i_sda_pin, int i_scl_pin) {
   _iSdaPin = i_sda_pin;
   _iSclPin = i_scl_pin;
   _iI2cAddress = ADS1115_I2CADD_DEFAULT;
-  if (i2c_master_init() == ESP_OK){
+  if (_ptrTransport->init(_iSdaPin, _iSclPin) == ESP_OK){
     b_success = true;
   } else{
     b_success = false;
@@ -67,7 +112,7 @@ bool ADS1115::begin(int i_sda, int i_scl, uint8_t i_i2c_address) {
   _iI2cAddress  = i_i2c_address;
   _iSdaPin = i_sda;
   _iSclPin = i_scl;
-  if (i2c_master_init() == ESP_OK){
+  if (_ptrTransport->init(_iSdaPin, _iSclPin) == ESP_OK){
     b_success = true;
   } else{
     b_success = false;
@@ -118,7 +163,7 @@ bool ADS1115::getOpStatus(void){
 }
 
 
-void ADS1115::setMux(uint8_t b_mux) {
+void ADS1115::setMux(uint8_t b_mux, bool b_settle) {
   /**
    * Set input multiplexer configuration
    * @param b_mux:
@@ -130,6 +175,7 @@ void ADS1115::setMux(uint8_t b_mux) {
    *    ADS1115_MUX_AIN1_GND AINp = AIN1 and AINn = GND
    *    ADS1115_MUX_AIN2_GND AINp = AIN2 and AINn = GND
    *    ADS1115_MUX_AIN3_GND AINp = AIN3 and AINn = GND
+   * @param b_settle: wait ADS1115_DELAY_AFTER_MUX_CHANGE_US, false if the caller drops the next conversion instead
   */ 
   iConfigReg = getRegisterValue(ADS1115_CONFIG_REG);
   bool b2 = readBit(b_mux, 2);
@@ -141,7 +187,9 @@ void ADS1115::setMux(uint8_t b_mux) {
   writeBit(iConfigReg, ADS1115_MUX0, b0);
 
   setRegisterValue(ADS1115_CONFIG_REG, iConfigReg);
-  vTaskDelay(ADS1115_DELAY_AFTER_MUX_CHANGE / portTICK_PERIOD_MS);
+  if (b_settle){
+    _ptrTransport->delayUs(ADS1115_DELAY_AFTER_MUX_CHANGE_US);
+  }
 }
 
 
@@ -187,25 +235,39 @@ void ADS1115::setPGA(uint8_t b_gain) {
 
   setRegisterValue(ADS1115_CONFIG_REG, iConfigReg);
 
+  _iPga = b_gain;
+  bitNumbering = _getLsb(b_gain);
+}
+
+
+float ADS1115::getLsbVolt(uint8_t b_gain) {
+  /**
+   * @brief voltage of one LSB of the conversion register for a PGA setting
+   * 
+   * @param b_gain: ADS1115_PGA_*
+   */
+
+  return _getLsb(b_gain);
+}
+
+
+float ADS1115::_getLsb(uint8_t b_gain) {
+  /**
+   * Weight of one LSB in V for a PGA setting, the three settings above ADS1115_PGA_0P256 select the same range
+  */
   switch (b_gain) {
     case ADS1115_PGA_6P144:
-      bitNumbering = ADS1115_LSB_6P144;
-      break;
+      return ADS1115_LSB_6P144;
     case ADS1115_PGA_4P096:
-      bitNumbering = ADS1115_LSB_4P096;
-      break;
+      return ADS1115_LSB_4P096;
     case ADS1115_PGA_2P048:
-      bitNumbering = ADS1115_LSB_2P048;
-      break;
+      return ADS1115_LSB_2P048;
     case ADS1115_PGA_1P024:
-      bitNumbering = ADS1115_LSB_1P024;
-      break;
+      return ADS1115_LSB_1P024;
     case ADS1115_PGA_0P512:
-      bitNumbering = ADS1115_LSB_0P512;
-      break;
-    case ADS1115_PGA_0P256:
-      bitNumbering = ADS1115_LSB_0P256;
-      break;
+      return ADS1115_LSB_0P512;
+    default:
+      return ADS1115_LSB_0P256;
   }
 }
 
@@ -573,7 +635,7 @@ int ADS1115::getLatestBufVal(){
    * 
    */
   if (_iBuffCnt>=0){
-    return (int)_ptrConvBuff[_iBuffCnt];
+    return (int)_arrConvBuff[_iBuffCnt];
   }
   else{
     return 0;
@@ -589,9 +651,9 @@ void ADS1115::setPhysConv(const float f_x_1, const float f_0) {
   */ 
   initConvTable(1);
   
-  _ptrConvTable[0][0] = 0.0;
-  _ptrConvTable[0][1] = f_x_1;
-  _ptrConvTable[0][2] = f_0;
+  _arrConvTable[0][0] = 0.0;
+  _arrConvTable[0][1] = f_x_1;
+  _arrConvTable[0][2] = f_0;
 
 }
 
@@ -603,9 +665,9 @@ void ADS1115::setPhysConv(const float f_x_2, const float f_x_1, const float f_0)
   */ 
   initConvTable(1);
 
-  _ptrConvTable[0][0] = f_x_2;
-  _ptrConvTable[0][1] = f_x_1;
-  _ptrConvTable[0][2] = f_0;
+  _arrConvTable[0][0] = f_x_2;
+  _arrConvTable[0][1] = f_x_1;
+  _arrConvTable[0][2] = f_0;
 }
 
 void ADS1115::setPhysConv(const float arr_conv_table[][2], size_t i_size_conv) {
@@ -620,23 +682,30 @@ void ADS1115::setPhysConv(const float arr_conv_table[][2], size_t i_size_conv) {
   float f_prev_y;
   float f_act_y;
 
-  // Initialize member _ptrConvTable
-  initConvTable(i_size_conv);
+  // Initialize member _arrConvTable
+  if (!initConvTable(i_size_conv)){
+    return;
+  }
   
   // calculate gradient and offset and write it to array
-  for (int i_row=1; i_row<i_size_conv; i_row++){
+  for (size_t i_row=1; i_row<i_size_conv; i_row++){
     f_prev_x = arr_conv_table[i_row-1][0];
     f_act_x = arr_conv_table[i_row][0];
     f_prev_y = arr_conv_table[i_row-1][1];
     f_act_y = arr_conv_table[i_row][1];
     
     // start range
-    _ptrConvTable[i_row-1][0] = f_prev_x;
+    _arrConvTable[i_row-1][0] = f_prev_x;
     // gradient
-    _ptrConvTable[i_row-1][1] = (f_act_y-f_prev_y)/(f_act_x-f_prev_x);
+    _arrConvTable[i_row-1][1] = (f_act_y-f_prev_y)/(f_act_x-f_prev_x);
     // offset
-    _ptrConvTable[i_row-1][2] = f_prev_y - _ptrConvTable[i_row-1][1]*f_prev_x;
+    _arrConvTable[i_row-1][2] = f_prev_y - _arrConvTable[i_row-1][1]*f_prev_x;
   }
+
+  // last row only marks the end of the last range
+  _arrConvTable[i_size_conv-1][0] = arr_conv_table[i_size_conv-1][0];
+  _arrConvTable[i_size_conv-1][1] = 0.F;
+  _arrConvTable[i_size_conv-1][2] = 0.F;
 }
 
 
@@ -646,23 +715,37 @@ float ADS1115::getPhysVal(void){
    * NOTE: readConversionRegister() must be called before to get adc value from ADS1115 register over I2C
    * @return: physical value based on voltage read out
   */
-  
-  float f_voltage = getVoltVal();
+
+  return convertToPhysVal(getConvVal());
+}
+
+
+float ADS1115::convertToPhysVal(float f_conv_value){
+  /**
+   * calculate physical value of a conversion value with the defined conversion, e.g. for externally filtered values
+   * @param f_conv_value: conversion value in LSB of the actual PGA setting, may have a fractional part
+   * @return: physical value
+  */
+
+  float f_voltage = f_conv_value * bitNumbering;
   float f_physical = 0.F;
 
-  if (_iSizeConvTable==1){
+  if (_iSizeConvTable==0){
+    // no conversion defined, physical value is the voltage
+    f_physical = f_voltage;
+  } else if (_iSizeConvTable==1){
     // polynom or linear regression
-    f_physical = f_voltage * f_voltage * _ptrConvTable[0][0] + f_voltage * _ptrConvTable[0][1] + _ptrConvTable[0][2];
+    f_physical = f_voltage * f_voltage * _arrConvTable[0][0] + f_voltage * _arrConvTable[0][1] + _arrConvTable[0][2];
   } else {
   
-    if (f_voltage < _ptrConvTable[0][0]) {
+    if (f_voltage < _arrConvTable[0][0]) {
       // left outside
 
     } else {
       // lookup table is given
-      for (int i_idx = 1; i_idx < _iSizeConvTable; i_idx++) {    
-        if( (f_voltage >= _ptrConvTable[i_idx-1][0]) && (f_voltage < _ptrConvTable[i_idx][0]) ) {
-          f_physical = f_voltage * _ptrConvTable[i_idx-1][1] + _ptrConvTable[i_idx-1][2];
+      for (size_t i_idx = 1; i_idx < _iSizeConvTable; i_idx++) {    
+        if( (f_voltage >= _arrConvTable[i_idx-1][0]) && (f_voltage < _arrConvTable[i_idx][0]) ) {
+          f_physical = f_voltage * _arrConvTable[i_idx-1][1] + _arrConvTable[i_idx-1][2];
           break;
         } 
       }
@@ -687,12 +770,11 @@ uint16_t ADS1115::getRegisterValue(uint8_t i_reg) {
    * @param i_reg: Register to be readout
    */
 
-  uint8_t ptr_data[2];
   uint16_t i_ret_value;
 
-  i2c_master_write_read_device(ADS1115_I2C_PORT_NUM, _iI2cAddress, &i_reg, 1, ptr_data, 2, 50 / portTICK_RATE_MS);
-
-  i_ret_value = (uint16_t)(ptr_data[0]<<8) | ptr_data[1];
+  int64_t i_start_us = _ptrTransport->getTimeUs();
+  esp_err_t ret = _ptrTransport->readRegister(_iI2cAddress, i_reg, &i_ret_value);
+  _recordI2cTransaction(i_start_us, ret);
 
   return i_ret_value;
 }
@@ -700,91 +782,58 @@ uint16_t ADS1115::getRegisterValue(uint8_t i_reg) {
 
 void ADS1115::setRegisterValue(uint8_t i_reg, uint16_t i_data) {
   /**
-   * @brief Return a specified register value of ADS1115 (only 2 byte register are supported yet.)
+   * @brief Write a specified register value of ADS1115, MSB first (only 2 byte register are supported yet.)
    * 
-   * @param i_reg: Register to be readout
+   * @param i_reg: Register to be written
+   * @param i_data: Register value
    */
 
-  uint8_t * ptr_data = new uint8_t[2];
-  
-  ptr_data[0] = (uint8_t)(i_data & 0x0F); // low byte
-  ptr_data[1] = (uint8_t)(i_data & 0xF0); // high byte
-  i2c_write(i_reg, ptr_data, 2);
-  delete [] ptr_data;
+  int64_t i_start_us = _ptrTransport->getTimeUs();
+  esp_err_t ret = _ptrTransport->writeRegister(_iI2cAddress, i_reg, i_data);
+  _recordI2cTransaction(i_start_us, ret);
 }
 
 
-esp_err_t ADS1115::i2c_master_init(void)
+esp_err_t ADS1115::stop(void)
 {
-  int i2c_master_port = ADS1115_I2C_PORT_NUM;
-  esp_err_t esp_err;
-
-  i2c_config_t conf;
-    
-  conf.mode = I2C_MODE_MASTER;
-  conf.sda_io_num = _iSdaPin;
-  conf.scl_io_num = _iSclPin;
-  conf.sda_pullup_en = GPIO_PULLUP_ENABLE;
-  conf.scl_pullup_en = GPIO_PULLUP_ENABLE;
-  conf.master.clk_speed = 400000;
-  conf.clk_flags = 0;
+  return _ptrTransport->deinit();
+}
 
-  i2c_param_config(i2c_master_port, &conf);
-  esp_err = i2c_driver_install(i2c_master_port, conf.mode, 0, 0, 0);
 
-  return esp_err;
-}
+void ADS1115::_recordI2cTransaction(int64_t i_start_us, esp_err_t esp_ret){
+  /**
+   * @brief Update I2C statistics and connection status after a transaction
+   * 
+   * @param i_start_us: transport time stamp at the start of the transaction
+   * @param esp_ret: result of the transaction
+   */
 
-esp_err_t ADS1115::stop(void)
-{
-  esp_err_t esp_err;
-  esp_err = i2c_driver_delete(ADS1115_I2C_PORT_NUM);
-  
-  return esp_err;
-}
+  uint32_t i_latency_us = (uint32_t)(_ptrTransport->getTimeUs() - i_start_us);
 
+  _objI2cStats.iTransactions++;
+  _objI2cStats.iLatencySumUs += i_latency_us;
+  _objI2cStats.iLatencyMaxUs = std::max(_objI2cStats.iLatencyMaxUs, i_latency_us);
 
-void ADS1115::i2c_write(uint8_t i_reg, uint8_t* data_write, size_t data_len)
-{
-  // Link i2c ressource
-  i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-
-  // Change address register pointer of ADS
-  // Put Start command in queue
-  i2c_master_start(cmd);
-  // Initiate communication with start address and indicating read request, no Acknoledgement
-  i2c_master_write_byte(cmd, (_iI2cAddress<<1) | I2C_MASTER_WRITE, I2C_MASTER_ACK);
-  
-  i2c_master_write_byte(cmd, i_reg, I2C_MASTER_ACK);
-  
-  for (int i_step=data_len; i_step>0; i_step--){
-    // Write MSB from ADS1115 and acknowledge it
-    i2c_master_write_byte(cmd, *(data_write + i_step - 1), I2C_MASTER_ACK);
+  if (esp_ret != ESP_OK){
+    _objI2cStats.iErrors++;
   }
-  // Put Stop command in queue
-  i2c_master_stop(cmd);
-
-  // Execute all queued commands, 100ms timeout
-  esp_err_t ret = i2c_master_cmd_begin(ADS1115_I2C_PORT_NUM, cmd, 100 / portTICK_RATE_MS);
-  i2c_cmd_link_delete(cmd);
+  _bConnectStatus = (esp_ret == ESP_OK);
 }
 
 
-void ADS1115::initConvTable(size_t i_size_conv) {
+bool ADS1115::initConvTable(size_t i_size_conv) {
   /**
-   * Initialize pointer for conversion table
+   * Set the row count of the conversion table, the table is part of the driver object
    * @param i_size_conv: row of the conversion table
+   * @return: false if the table has more than ADS1115_CONV_TABLE_MAX rows, the previous conversion is kept
   */
-  
+
+  if (i_size_conv > ADS1115_CONV_TABLE_MAX){
+    return false;
+  }
   // Make (row) size of conversion table in class available
   _iSizeConvTable=i_size_conv;
-  // assign memory to the pointer, pointer in pointer element
-  _ptrConvTable = new float*[_iSizeConvTable];
-  
-  // assign second pointer in pointer to get a 2dim field
-  for(int i_row=0;i_row<_iSizeConvTable;i_row++) {
-    _ptrConvTable[i_row]=new float[3];
-  }
+  return true;
 }
 
 
@@ -798,51 +847,19 @@ void ADS1115::activateFilter(){
   //_iBuffMaxFillIndex=0;
 
   if (ADS1115_CONV_BUF_SIZE == 5){
-      _ptrFilterCoeff = new float[5];
-      _ptrFilterCoeff[0] = -3.0F;
-      _ptrFilterCoeff[1] = 12.0F;
-      _ptrFilterCoeff[2] = 17.0F;
-      _ptrFilterCoeff[3] = 12.0F;
-      _ptrFilterCoeff[4] = -3.0F;
+      _ptrFilterCoeff = s_arr_savgol_5;
       _fFilterNormCoeff = 35.F;
       _bSavGolFilterActive = true;
   } else if(ADS1115_CONV_BUF_SIZE == 7) {
-      _ptrFilterCoeff = new float[7];
-      _ptrFilterCoeff[0] = -2.0F;
-      _ptrFilterCoeff[1] = 3.0F;
-      _ptrFilterCoeff[2] = 6.0F;
-      _ptrFilterCoeff[3] = 7.0F;
-      _ptrFilterCoeff[4] = 6.0F;
-      _ptrFilterCoeff[5] = 3.0F;
-      _ptrFilterCoeff[6] = -2.0F;
+      _ptrFilterCoeff = s_arr_savgol_7;
       _fFilterNormCoeff = 21.F;
       _bSavGolFilterActive = true;
   } else if(ADS1115_CONV_BUF_SIZE == 9) {
-      _ptrFilterCoeff = new float[9];
-      _ptrFilterCoeff[0] = -21.0F;
-      _ptrFilterCoeff[1] = 14.0F;
-      _ptrFilterCoeff[2] = 39.0F;
-      _ptrFilterCoeff[3] = 54.0F;
-      _ptrFilterCoeff[4] = 59.0F;
-      _ptrFilterCoeff[5] = 54.0F;
-      _ptrFilterCoeff[6] = 39.0F;
-      _ptrFilterCoeff[7] = 14.0F;
-      _ptrFilterCoeff[8] = -21.0F;
+      _ptrFilterCoeff = s_arr_savgol_9;
       _fFilterNormCoeff = 231.F;
       _bSavGolFilterActive = true;
   } else if(ADS1115_CONV_BUF_SIZE == 11) {
-      _ptrFilterCoeff = new float[11];
-      _ptrFilterCoeff[0] = -36.0F;
-      _ptrFilterCoeff[1] = 9.0F;
-      _ptrFilterCoeff[2] = 44.0F;
-      _ptrFilterCoeff[3] = 69.0F;
-      _ptrFilterCoeff[4] = 84.0F;
-      _ptrFilterCoeff[5] = 89.0F;
-      _ptrFilterCoeff[6] = 84.0F;
-      _ptrFilterCoeff[7] = 69.0F;
-      _ptrFilterCoeff[8] = 44.0F;
-      _ptrFilterCoeff[9] = 9.0F;
-      _ptrFilterCoeff[10] = -36.0F;
+      _ptrFilterCoeff = s_arr_savgol_11;
       _fFilterNormCoeff = 429.F;
       _bSavGolFilterActive = true;
   } else {
@@ -861,6 +878,147 @@ void ADS1115::deactivateFilter(){
 }
 
 
+void ADS1115::activateAutoRange(uint8_t b_gain_coarse, uint8_t b_gain_fine){
+  /**
+   * @brief Activate auto ranging: the PGA is switched to the next larger full scale range when a conversion comes close
+   * to full scale, and to the next smaller one when the filter buffer fits into it with margin. The conversion buffer
+   * is rescaled on each switch, so the filter output continues without a step.
+   * 
+   * @param b_gain_coarse: largest allowed full scale range, e.g. ADS1115_PGA_4P096
+   * @param b_gain_fine: smallest allowed full scale range, e.g. ADS1115_PGA_0P256
+   */
+
+  b_gain_fine = std::min(b_gain_fine, (uint8_t)ADS1115_PGA_0P256);
+  _iAutoRangeCoarse = std::min(b_gain_coarse, b_gain_fine);
+  _iAutoRangeFine = b_gain_fine;
+  _iRangeDiscardCnt = 0;
+  _bAutoRangeActive = true;
+
+  if (_iPga < _iAutoRangeCoarse || _iPga > _iAutoRangeFine){
+    setPGA(std::max(_iAutoRangeCoarse, std::min(_iPga, _iAutoRangeFine)));
+  }
+}
+
+
+void ADS1115::deactivateAutoRange(){
+  /**
+   * @brief deactivate auto ranging, the actual PGA setting is kept
+   * 
+   */
+
+  _bAutoRangeActive = false;
+  _iRangeDiscardCnt = 0;
+}
+
+
+bool ADS1115::getAutoRangeStatus(){
+  return _bAutoRangeActive;
+}
+
+
+uint8_t ADS1115::getRange(){
+  /**
+   * @brief get the range tag of the latest conversion value: the PGA setting (ADS1115_PGA_*) whose LSB is the unit of
+   * getConvVal(), getLatestBufVal() and the buffer
+   * 
+   */
+
+  return _iPga;
+}
+
+
+bool ADS1115::isRangeSettling(){
+  /**
+   * @brief true if the latest conversion was dropped after a range switch and getConvVal() held the previous value
+   * 
+   */
+
+  return _bRangeSettling;
+}
+
+
+uint32_t ADS1115::getRangeSwitchCount(){
+  return _iRangeSwitchCnt;
+}
+
+
+bool ADS1115::_updateRange(int16_t i_raw_value){
+  /**
+   * @brief switch the PGA if the conversion is close to full scale or the buffer fits into the next smaller range
+   * 
+   * @param i_raw_value: latest conversion
+   * @return: true if the range was switched
+   */
+
+  uint8_t b_gain = _iPga;
+
+  if (!_bConnectStatus){
+    // value of a failed transaction
+    return false;
+  }
+
+  if (abs(i_raw_value) >= ADS1115_AUTORANGE_HIGH_CODES && _iPga > _iAutoRangeCoarse){
+    b_gain = _iPga - 1;
+  } else if (_iPga < _iAutoRangeFine){
+    int i_max_abs = 0;
+    for (int i_row=0; i_row<=_iBuffMaxFillIndex; i_row++){
+      i_max_abs = std::max(i_max_abs, abs((int)_arrConvBuff[i_row]));
+    }
+    if (i_max_abs * _getLsb(_iPga) / _getLsb(_iPga + 1) < ADS1115_AUTORANGE_LOW_CODES){
+      b_gain = _iPga + 1;
+    }
+  }
+
+  if (b_gain == _iPga){
+    return false;
+  }
+
+  float f_scale = _getLsb(_iPga) / _getLsb(b_gain);
+  setPGA(b_gain);
+
+  for (int i_row=0; i_row<=_iBuffMaxFillIndex; i_row++){
+    float f_value = roundf(_arrConvBuff[i_row] * f_scale);
+    _arrConvBuff[i_row] = (int16_t)std::max(-32768.F, std::min(32767.F, f_value));
+  }
+  _iRangeDiscardCnt = ADS1115_AUTORANGE_DISCARD;
+  _iRangeSwitchCnt++;
+  return true;
+}
+
+
+void ADS1115::setCorrection(int32_t i_offset, int32_t i_gain){
+  /**
+   * @brief Set the offset and gain correction of the raw conversions, e.g. from an online calibration
+   * 
+   * @param i_offset: input offset in 1/2^ADS1115_CORR_OFFSET_FRAC_BITS LSB of the 0.256 V range, independent of the PGA
+   * @param i_gain: gain factor in 1/2^ADS1115_CORR_GAIN_FRAC_BITS, applied after the offset
+   */
+
+  _iCorrOffset = i_offset;
+  _iCorrGain = i_gain;
+}
+
+
+int16_t ADS1115::applyCorrection(int16_t i_raw_value){
+  /**
+   * @brief Correct a raw conversion of the actual PGA setting in fixed point
+   * 
+   * @param i_raw_value: conversion register value
+   * @return: corrected value, saturated to the register range
+   */
+
+  // ratio of the LSB of each PGA setting to the LSB of the 0.256 V range
+  static const int32_t arr_range_div[8] = {24, 16, 8, 4, 2, 1, 1, 1};
+  const int i_shift = ADS1115_CORR_OFFSET_FRAC_BITS + ADS1115_CORR_GAIN_FRAC_BITS;
+
+  int32_t i_offset = _iCorrOffset / arr_range_div[_iPga & 0b111];
+  int64_t i_value = ((((int64_t)i_raw_value << ADS1115_CORR_OFFSET_FRAC_BITS) - i_offset) * _iCorrGain +
+                     ((int64_t)1 << (i_shift - 1))) >> i_shift;
+
+  return (int16_t)std::max((int64_t)-32768, std::min((int64_t)32767, i_value));
+}
+
+
 bool ADS1115::getFilterStatus(){
   /**
    * @brief get actual filter status. True if filter is active
@@ -885,7 +1043,7 @@ int16_t* ADS1115::getBuffer(){
    * 
    */
 
-  return _ptrConvBuff;
+  return _arrConvBuff;
 }
 
 
@@ -900,7 +1058,7 @@ float ADS1115::_getSavGolFilterVal(){
 
   for (int i_row=0; i_row<ADS1115_CONV_BUF_SIZE; i_row++){
     i_index = (_iBuffCnt+i_row) % ADS1115_CONV_BUF_SIZE;
-    f_filter_value += (_ptrConvBuff[i_index]*_ptrFilterCoeff[i_index]);
+    f_filter_value += (_arrConvBuff[i_index]*_ptrFilterCoeff[i_index]);
   }
   f_filter_value /= _fFilterNormCoeff;
   
@@ -918,7 +1076,7 @@ float ADS1115::_getAvgFilterVal(){
 
   // when the filter is fully filled _iBuffMaxFillIndex is 1 below the filter size
   for (int i_row=0; i_row<=_iBuffMaxFillIndex; i_row++){
-    f_filter_value += _ptrConvBuff[i_row];
+    f_filter_value += _arrConvBuff[i_row];
   }
 
   f_filter_value /= (float)(_iBuffMaxFillIndex+1);
@@ -941,18 +1099,18 @@ bool ADS1115::isValueFrozen(){
   if (_iBuffMaxFillIndex>=9){
     // filter is active and filled enough -> check if value is frozen
 
-    int16_t i_last_val = _ptrConvBuff[0];
+    int16_t i_last_val = _arrConvBuff[0];
     b_status = true;
 
     for (int i_row=1; i_row<=_iBuffMaxFillIndex; i_row++){
       // if two values are not the smae break the for loop and return false
       // _iBuffMaxFillIndex is a index not a counter
-      if (_ptrConvBuff[i_row] != i_last_val){
+      if (_arrConvBuff[i_row] != i_last_val){
         // values are different -> found change -> ok
         b_status = false;
         break;
       }
-      i_last_val = _ptrConvBuff[i_row]; // set last value to current value
+      i_last_val = _arrConvBuff[i_row]; // set last value to current value
     }
   }
 
@@ -962,19 +1120,46 @@ bool ADS1115::isValueFrozen(){
 
 float ADS1115::getConvVal(){
   /**
-   * @brief get the filtered conversion value
-   * 
+   * @brief get the filtered conversion value. With auto ranging the value is given in LSB of the range returned by
+   * getRange() afterwards, conversions right after a range switch are dropped and the previous value is held.
    * 
    */
 
-  float f_conversion_value;
+  int16_t i_raw_value = (int16_t)readConversionRegister(); // read the register, also clears a latched ALERT/RDY
+
+  _bRangeSettling = false;
+  if (_iRangeDiscardCnt > 0){
+    // conversion may have started with the previous PGA setting
+    _iRangeDiscardCnt--;
+    _bRangeSettling = true;
+    return _fLastConvValue;
+  }
 
   // fill the filter buffer an increment the ring buffer counter
   _iBuffCnt = (_iBuffCnt+1) % ADS1115_CONV_BUF_SIZE; // ring buffer
   _iBuffMaxFillIndex = std::max(_iBuffMaxFillIndex,_iBuffCnt); // get fill index of filter. Used for error detection or filter selsction
-  _ptrConvBuff[_iBuffCnt] = readConversionRegister(); // read the register
+  _arrConvBuff[_iBuffCnt] = applyCorrection(i_raw_value);
+
+  float f_lsb = bitNumbering;
+  float f_conversion_value = _getFilteredVal();
+
+  if (_bAutoRangeActive && _updateRange(i_raw_value)){
+    // continue in the units of the new range
+    f_conversion_value *= f_lsb / bitNumbering;
+  }
+  _fLastConvValue = f_conversion_value;
+  return f_conversion_value;
+}
+
+
+float ADS1115::_getFilteredVal(){
+  /**
+   * @brief filter the conversion buffer
+   * 
+   */
+
+  float f_conversion_value;
 
-  // Filter
   if (_bFilterActive){
     // if filter is not fully filled for savitzky golay filter use average filter
     if (_bSavGolFilterActive && (_iBuffMaxFillIndex +1) == ADS1115_CONV_BUF_SIZE){
@@ -1001,3 +1186,23 @@ bool ADS1115::getConnectionStatus(){
   return _bConnectStatus;
 }
 
+void ADS1115::getI2cStats(ads1115_i2c_stats * ptr_stats){
+  /**
+   * @brief get statistics of the I2C transactions
+   * 
+   * @param ptr_stats: destination of the copy
+   */
+
+  *ptr_stats = _objI2cStats;
+}
+
+
+ADS1115Transport * ADS1115::getTransport(void){
+  /**
+   * @brief get the transport of the device, e.g. to scan further devices on the same bus
+   * 
+   * @return: transport, initialized by begin()
+   */
+
+  return _ptrTransport;
+}
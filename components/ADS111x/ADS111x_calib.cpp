@@ -0,0 +1,214 @@
+// Online calibration of an ADS1115 input, see ADS111x_calib.hpp
+
+#include <math.h>
+#include "ADS111x_calib.hpp"
+
+ADS1115Calibrator::ADS1115Calibrator() {
+  _ptrAds = NULL;
+  _iMainMux = ADS1115_MUX_AIN0_AIN1;
+  _iZeroMux = ADS1115_MUX_AIN0_AIN1;
+  _iRefMux = ADS1115_MUX_AIN0_AIN1;
+  _fRefVolt = 0.F;
+  _iInterval = 0;
+  _bActive = false;
+  deactivate();
+}
+
+
+void ADS1115Calibrator::setup(ADS1115 * ptr_ads, uint8_t i_main_mux, uint8_t i_zero_mux, uint8_t i_ref_mux,
+                              float f_ref_volt, uint32_t i_interval) {
+  /**
+   * Start the calibration, the driver has to run in continuous mode on the main input
+   * @param ptr_ads: driver of the converter
+   * @param i_main_mux: ADS1115_MUX_* of the main input
+   * @param i_zero_mux: ADS1115_MUX_* of the shorted input, both inputs on the same potential
+   * @param i_ref_mux: ADS1115_MUX_* of the reference divider
+   * @param f_ref_volt: voltage of the reference divider at nominal excitation in V
+   * @param i_interval: main input conversions between two calibration measurements, 0 to only pass the conversions
+  */
+  deactivate();
+  _ptrAds = ptr_ads;
+  if (ptr_ads == NULL || i_interval == 0 || f_ref_volt == 0.F){
+    return;
+  }
+
+  _iMainMux = i_main_mux;
+  _iZeroMux = i_zero_mux;
+  _iRefMux = i_ref_mux;
+  _fRefVolt = f_ref_volt;
+  _iInterval = i_interval;
+  _bActive = true;
+}
+
+
+void ADS1115Calibrator::deactivate(void) {
+  /**
+   * Stop the calibration and clear the correction of the driver, the main input is selected again
+  */
+  if (_bActive && _iState != ADS1115_CAL_MAIN){
+    _ptrAds->setMux(_iMainMux);
+  }
+  if (_ptrAds != NULL){
+    _ptrAds->setCorrection(0, 1 << ADS1115_CORR_GAIN_FRAC_BITS);
+  }
+
+  _bActive = false;
+  _iSampleCnt = 0;
+  _iState = ADS1115_CAL_MAIN;
+  _iInput = ADS1115_CAL_INPUT_ZERO;
+  _bSubstituted = false;
+  _fLastValue = 0.F;
+  _fSlope = 0.F;
+  _bLastValid = false;
+  _iLastRange = 0;
+
+  _objStatus.fOffsetVolt = 0.F;
+  _objStatus.fGain = 1.F;
+  _objStatus.bOffsetValid = false;
+  _objStatus.bGainValid = false;
+  _objStatus.iZeroCnt = 0;
+  _objStatus.iRefCnt = 0;
+  _objStatus.iRejectCnt = 0;
+  _objStatus.iSubstituteCnt = 0;
+}
+
+
+bool ADS1115Calibrator::isActive(void) {
+  return _bActive;
+}
+
+
+float ADS1115Calibrator::process(void) {
+  /**
+   * Handle a finished conversion, replaces ADS1115::getConvVal() in the measurement loop
+   * @return: conversion value of the main input in LSB of the actual range, extrapolated during calibration slots
+  */
+  _bSubstituted = false;
+  if (!_bActive){
+    return _ptrAds != NULL ? _ptrAds->getConvVal() : 0.F;
+  }
+
+  float f_value;
+  int16_t i_raw_value;
+
+  switch (_iState){
+    case ADS1115_CAL_SETTLE:
+      _ptrAds->readConversionRegister();
+      _iState = ADS1115_CAL_MEASURE;
+      return _substitute();
+
+    case ADS1115_CAL_MEASURE:
+      i_raw_value = (int16_t)_ptrAds->readConversionRegister();
+      if (_ptrAds->getConnectionStatus()){
+        _update(i_raw_value);
+      }
+      _ptrAds->setMux(_iMainMux, false);
+      _iState = ADS1115_CAL_RETURN;
+      return _substitute();
+
+    case ADS1115_CAL_RETURN:
+      _ptrAds->readConversionRegister();
+      _iState = ADS1115_CAL_MAIN;
+      return _substitute();
+
+    default:
+      break;
+  }
+
+  f_value = _ptrAds->getConvVal();
+  _trackValue(f_value);
+
+  // the first measurement of both inputs follows right after the start
+  uint32_t i_measured = _objStatus.iZeroCnt + _objStatus.iRefCnt + _objStatus.iRejectCnt;
+  if (++_iSampleCnt >= _iInterval || i_measured < 2){
+    _iSampleCnt = 0;
+    _ptrAds->setMux(_iInput == ADS1115_CAL_INPUT_ZERO ? _iZeroMux : _iRefMux, false);
+    _iState = ADS1115_CAL_SETTLE;
+  }
+  return f_value;
+}
+
+
+bool ADS1115Calibrator::isSubstituted(void) {
+  /**
+   * true if the latest value of process() was extrapolated during a calibration slot
+  */
+  return _bSubstituted;
+}
+
+
+void ADS1115Calibrator::getStatus(ads1115_cal_status * ptr_status) {
+  *ptr_status = _objStatus;
+}
+
+
+void ADS1115Calibrator::_trackValue(float f_value) {
+  /**
+   * Follow the slope of the main input per conversion, restarted after a range switch of the driver
+  */
+  uint8_t i_range = _ptrAds->getRange();
+
+  if (_bLastValid && i_range == _iLastRange){
+    _fSlope += ((f_value - _fLastValue) - _fSlope) / ADS1115_CAL_SLOPE_SMOOTHING;
+  } else {
+    _fSlope = 0.F;
+  }
+  _fLastValue = f_value;
+  _iLastRange = i_range;
+  _bLastValid = true;
+}
+
+
+float ADS1115Calibrator::_substitute(void) {
+  _fLastValue += _fSlope;
+  _bSubstituted = true;
+  _objStatus.iSubstituteCnt++;
+  return _fLastValue;
+}
+
+
+void ADS1115Calibrator::_update(int16_t i_raw_value) {
+  /**
+   * Update the correction terms with a calibration conversion, measured with the actual PGA setting of the driver
+   * @param i_raw_value: uncorrected conversion of the calibration input
+  */
+  float f_lsb = ADS1115::getLsbVolt(_ptrAds->getRange());
+  float f_volt = i_raw_value * f_lsb;
+
+  if (_iInput == ADS1115_CAL_INPUT_ZERO){
+    _iInput = ADS1115_CAL_INPUT_REF;
+    if (fabsf(f_volt) > ADS1115_CAL_MAX_OFFSET_VOLT){
+      _objStatus.iRejectCnt++;
+      return;
+    }
+    _objStatus.fOffsetVolt += _objStatus.bOffsetValid ?
+                              (f_volt - _objStatus.fOffsetVolt) / ADS1115_CAL_SMOOTHING :
+                              f_volt - _objStatus.fOffsetVolt;
+    _objStatus.bOffsetValid = true;
+    _objStatus.iZeroCnt++;
+  } else {
+    _iInput = ADS1115_CAL_INPUT_ZERO;
+    float f_gain = _fRefVolt / (f_volt - _objStatus.fOffsetVolt);
+    if (!(fabsf(f_gain - 1.F) <= ADS1115_CAL_MAX_GAIN_DEV)){
+      _objStatus.iRejectCnt++;
+      return;
+    }
+    _objStatus.fGain += _objStatus.bGainValid ?
+                        (f_gain - _objStatus.fGain) / ADS1115_CAL_SMOOTHING :
+                        f_gain - _objStatus.fGain;
+    _objStatus.bGainValid = true;
+    _objStatus.iRefCnt++;
+  }
+  _applyCorrection();
+}
+
+
+void ADS1115Calibrator::_applyCorrection(void) {
+  /**
+   * Hand the correction terms to the driver in its fixed point format
+  */
+  float f_offset = _objStatus.fOffsetVolt / ADS1115::getLsbVolt(ADS1115_PGA_0P256) * (1 << ADS1115_CORR_OFFSET_FRAC_BITS);
+  float f_gain = _objStatus.fGain * (1 << ADS1115_CORR_GAIN_FRAC_BITS);
+
+  _ptrAds->setCorrection((int32_t)lroundf(f_offset), (int32_t)lroundf(f_gain));
+}
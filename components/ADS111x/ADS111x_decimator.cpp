@@ -0,0 +1,231 @@
+// Decimation filter for oversampled ADS1115 conversions, see ADS111x_decimator.hpp
+
+#include <math.h>
+#include "ADS111x_decimator.hpp"
+
+ADS1115Decimator::ADS1115Decimator() {
+  _iCicRatio = 1;
+  _iFirRatio = 1;
+  _iAvgLen = 1;
+  setup(1, 1, 1);
+}
+
+
+bool ADS1115Decimator::setup(int i_cic_ratio, int i_fir_ratio, int i_avg_len) {
+  /**
+   * Set the decimation ratios and design the compensation filter, the filter state is cleared
+   * @param i_cic_ratio: decimation of the CIC stage R, 1..ADS1115_DECIM_CIC_MAX_RATIO
+   * @param i_fir_ratio: decimation of the FIR stage D, 1..ADS1115_DECIM_FIR_MAX_RATIO
+   * @param i_avg_len: length of the moving average over the FIR output, 1..ADS1115_DECIM_AVG_MAX_LEN, 1: off
+   * @return: false if a ratio or the length is out of range, the previous setup is kept
+  */
+  if (i_cic_ratio < 1 || i_cic_ratio > ADS1115_DECIM_CIC_MAX_RATIO || i_fir_ratio < 1 ||
+      i_fir_ratio > ADS1115_DECIM_FIR_MAX_RATIO || i_avg_len < 1 || i_avg_len > ADS1115_DECIM_AVG_MAX_LEN){
+    return false;
+  }
+
+  _iCicRatio = i_cic_ratio;
+  _iFirRatio = i_fir_ratio;
+  _iAvgLen = i_avg_len;
+  _fCicGain = 1.F / powf((float)_iCicRatio, ADS1115_DECIM_CIC_ORDER);
+  _designFir();
+  reset();
+  return true;
+}
+
+
+void ADS1115Decimator::reset(void) {
+  for (int i_avg=0; i_avg<ADS1115_DECIM_AVG_MAX_LEN; i_avg++){_arrAvgBuf[i_avg]=0.F;}
+  _iAvgPos = 0;
+  _bAvgPrimed = false;
+  _fOutput = 0.F;
+  _iOutputCnt = 0;
+  _clearCicFir();
+}
+
+
+void ADS1115Decimator::restart(float f_scale) {
+  /**
+   * Restart CIC and FIR after a range switch or a dropped conversion. The moving average is rescaled to the new unit
+   * and continues, so the output does not start over from the first new value as after reset().
+   * @param f_scale: LSB of the previous range / LSB of the new range, 1 if the range is unchanged
+  */
+  for (int i_avg=0; i_avg<_iAvgLen; i_avg++){_arrAvgBuf[i_avg]*=f_scale;}
+  _fOutput *= f_scale;
+  _clearCicFir();
+}
+
+
+void ADS1115Decimator::_clearCicFir(void) {
+  for (int i_stage=0; i_stage<ADS1115_DECIM_CIC_ORDER; i_stage++){
+    _arrIntegrators[i_stage] = 0;
+    _arrCombDelays[i_stage] = 0;
+  }
+  for (int i_tap=0; i_tap<ADS1115_DECIM_FIR_TAPS; i_tap++){_arrFirBuf[i_tap]=0.F;}
+
+  _iCicPhase = 0;
+  // the combs need one output per stage until their delays hold valid values
+  _iCicWarmUp = (_iCicRatio > 1) ? ADS1115_DECIM_CIC_ORDER : 0;
+  _iFirPos = 0;
+  _iFirPhase = 0;
+  _bFirPrimed = false;
+}
+
+
+bool ADS1115Decimator::push(int16_t i_value) {
+  /**
+   * Filter one conversion code
+   * @param i_value: raw conversion register value
+   * @return: true if a new output value is available (every R * D inputs after the warm-up)
+  */
+  uint64_t i_acc = (uint64_t)(int64_t)i_value;
+
+  for (int i_stage=0; i_stage<ADS1115_DECIM_CIC_ORDER; i_stage++){
+    _arrIntegrators[i_stage] += i_acc;
+    i_acc = _arrIntegrators[i_stage];
+  }
+  if (++_iCicPhase < _iCicRatio){
+    return false;
+  }
+  _iCicPhase = 0;
+
+  for (int i_stage=0; i_stage<ADS1115_DECIM_CIC_ORDER; i_stage++){
+    uint64_t i_delayed = _arrCombDelays[i_stage];
+    _arrCombDelays[i_stage] = i_acc;
+    i_acc -= i_delayed;
+  }
+  if (_iCicWarmUp > 0){
+    _iCicWarmUp--;
+    return false;
+  }
+
+  float f_cic = (float)(int64_t)i_acc * _fCicGain;
+
+  if (!_bFirPrimed){
+    // start from a settled filter instead of a ramp from zero
+    for (int i_tap=0; i_tap<ADS1115_DECIM_FIR_TAPS; i_tap++){_arrFirBuf[i_tap]=f_cic;}
+    _bFirPrimed = true;
+  }
+  if (!_bAvgPrimed){
+    for (int i_avg=0; i_avg<_iAvgLen; i_avg++){_arrAvgBuf[i_avg]=f_cic;}
+    _bAvgPrimed = true;
+  }
+  _arrFirBuf[_iFirPos] = f_cic;
+  _iFirPos = (_iFirPos + 1) % ADS1115_DECIM_FIR_TAPS;
+
+  if (++_iFirPhase < _iFirRatio){
+    return false;
+  }
+  _iFirPhase = 0;
+
+  // symmetric coefficients, the order of the convolution does not matter
+  float f_output = 0.F;
+  for (int i_tap=0; i_tap<ADS1115_DECIM_FIR_TAPS; i_tap++){
+    f_output += _arrFirCoeff[i_tap] * _arrFirBuf[(_iFirPos + i_tap) % ADS1115_DECIM_FIR_TAPS];
+  }
+
+  if (_iAvgLen > 1){
+    // summed again for every output, a running sum in float would drift
+    _arrAvgBuf[_iAvgPos] = f_output;
+    _iAvgPos = (_iAvgPos + 1) % _iAvgLen;
+    f_output = 0.F;
+    for (int i_avg=0; i_avg<_iAvgLen; i_avg++){f_output += _arrAvgBuf[i_avg];}
+    f_output /= _iAvgLen;
+  }
+  _fOutput = f_output;
+  _iOutputCnt++;
+  return true;
+}
+
+
+float ADS1115Decimator::getOutput(void) {
+  /**
+   * @return: latest output in units of the conversion code, with fractional LSB
+  */
+  return _fOutput;
+}
+
+
+int ADS1115Decimator::getCicRatio(void) {
+  return _iCicRatio;
+}
+
+
+int ADS1115Decimator::getFirRatio(void) {
+  return _iFirRatio;
+}
+
+
+int ADS1115Decimator::getAvgLen(void) {
+  return _iAvgLen;
+}
+
+
+float ADS1115Decimator::getGroupDelay(void) {
+  /**
+   * @return: delay of the output in input samples
+  */
+  return ADS1115_DECIM_CIC_ORDER * (_iCicRatio - 1) / 2.F + (ADS1115_DECIM_FIR_TAPS - 1) / 2.F * _iCicRatio +
+         (_iAvgLen - 1) / 2.F * _iCicRatio * _iFirRatio;
+}
+
+
+float ADS1115Decimator::getFirCoeff(int i_tap) {
+  return (i_tap >= 0 && i_tap < ADS1115_DECIM_FIR_TAPS) ? _arrFirCoeff[i_tap] : 0.F;
+}
+
+
+uint32_t ADS1115Decimator::getOutputCount(void) {
+  return _iOutputCnt;
+}
+
+
+float ADS1115Decimator::_getCicResponse(float f_freq) {
+  /**
+   * Magnitude of the CIC filter normalized to DC
+   * @param f_freq: frequency in cycles per CIC output sample
+  */
+  if (f_freq <= 0.F || _iCicRatio == 1){
+    return 1.F;
+  }
+  float f_num = sinf((float)M_PI * f_freq);
+  float f_den = _iCicRatio * sinf((float)M_PI * f_freq / _iCicRatio);
+  return powf(fabsf(f_num / f_den), ADS1115_DECIM_CIC_ORDER);
+}
+
+
+void ADS1115Decimator::_designFir(void) {
+  /**
+   * Frequency sampling design with a Hamming window. Target is the inverse CIC response in the passband, a cosine
+   * transition band and zero from the output nyquist frequency on. Frequencies in cycles per CIC output sample.
+  */
+  const int i_center = (ADS1115_DECIM_FIR_TAPS - 1) / 2;
+  const float f_pass = 0.3F / _iFirRatio;
+  const float f_stop = 0.5F / _iFirRatio;
+  const float f_step = 0.5F / ADS1115_DECIM_DESIGN_GRID;
+  float f_sum = 0.F;
+
+  for (int i_tap=0; i_tap<ADS1115_DECIM_FIR_TAPS; i_tap++){_arrFirCoeff[i_tap]=0.F;}
+
+  for (int i_freq=0; i_freq<ADS1115_DECIM_DESIGN_GRID; i_freq++){
+    float f_freq = (i_freq + 0.5F) * f_step;
+    float f_target = 0.F;
+
+    if (f_freq <= f_pass){
+      f_target = 1.F / _getCicResponse(f_freq);
+    } else if (f_freq < f_stop){
+      float f_taper = 0.5F + 0.5F * cosf((float)M_PI * (f_freq - f_pass) / (f_stop - f_pass));
+      f_target = f_taper / _getCicResponse(f_freq);
+    }
+    for (int i_tap=0; i_tap<ADS1115_DECIM_FIR_TAPS; i_tap++){
+      _arrFirCoeff[i_tap] += 2.F * f_step * f_target * cosf(2.F * (float)M_PI * f_freq * (i_tap - i_center));
+    }
+  }
+
+  for (int i_tap=0; i_tap<ADS1115_DECIM_FIR_TAPS; i_tap++){
+    _arrFirCoeff[i_tap] *= 0.54F - 0.46F * cosf(2.F * (float)M_PI * i_tap / (ADS1115_DECIM_FIR_TAPS - 1));
+    f_sum += _arrFirCoeff[i_tap];
+  }
+  // unity gain at DC
+  for (int i_tap=0; i_tap<ADS1115_DECIM_FIR_TAPS; i_tap++){_arrFirCoeff[i_tap] /= f_sum;}
+}
@@ -0,0 +1,146 @@
+// ESP-IDF transport of the ADS1115 driver, see ADS111x_transport.hpp
+
+#ifdef ESP_PLATFORM
+
+#include "ADS111x_transport.hpp"
+#include "esp_rom_sys.h"
+
+ADS1115IdfTransport::ADS1115IdfTransport(i2c_port_t i_port) {
+  _iPort = i_port;
+  _hDelayTimer = NULL;
+  _hDelayTask = NULL;
+  _bDelayExpired = false;
+  _bDelayNotified = false;
+}
+
+
+esp_err_t ADS1115IdfTransport::init(int i_sda_pin, int i_scl_pin) {
+  /**
+   * Install the I2C master driver and create the delay timer
+   * @param i_sda_pin: GPIO of SDA
+   * @param i_scl_pin: GPIO of SCL
+   * @return: result of i2c_driver_install
+  */
+  i2c_config_t conf;
+
+  if (_hDelayTimer == NULL){
+    esp_timer_create_args_t obj_timer_args = {};
+    obj_timer_args.callback = delayTimerCallback;
+    obj_timer_args.arg = this;
+    obj_timer_args.dispatch_method = ESP_TIMER_TASK;
+    obj_timer_args.name = "ads_delay";
+    if (esp_timer_create(&obj_timer_args, &_hDelayTimer) != ESP_OK){
+      // delayUs busy waits then
+      _hDelayTimer = NULL;
+    }
+  }
+
+  conf.mode = I2C_MODE_MASTER;
+  conf.sda_io_num = i_sda_pin;
+  conf.scl_io_num = i_scl_pin;
+  conf.sda_pullup_en = GPIO_PULLUP_ENABLE;
+  conf.scl_pullup_en = GPIO_PULLUP_ENABLE;
+  conf.master.clk_speed = ADS1115_I2C_CLK_SPEED;
+  conf.clk_flags = 0;
+
+  i2c_param_config(_iPort, &conf);
+  return i2c_driver_install(_iPort, conf.mode, 0, 0, 0);
+}
+
+
+esp_err_t ADS1115IdfTransport::deinit(void) {
+  if (_hDelayTimer != NULL){
+    esp_timer_delete(_hDelayTimer);
+    _hDelayTimer = NULL;
+  }
+  return i2c_driver_delete(_iPort);
+}
+
+
+esp_err_t ADS1115IdfTransport::readRegister(uint8_t i_address, uint8_t i_reg, uint16_t * ptr_value) {
+  /**
+   * Set the register pointer and read a 16 bit register, MSB first
+   * @param i_address: 7 bit I2C address
+   * @param i_reg: register pointer
+   * @param ptr_value: register content, 0 on error
+   * @return: result of the transaction
+  */
+  uint8_t arr_data[2] = {0, 0};
+
+  esp_err_t esp_ret = i2c_master_write_read_device(_iPort, i_address, &i_reg, 1, arr_data, 2, 50 / portTICK_RATE_MS);
+  *ptr_value = (uint16_t)(arr_data[0]<<8) | arr_data[1];
+
+  return esp_ret;
+}
+
+
+esp_err_t ADS1115IdfTransport::writeRegister(uint8_t i_address, uint8_t i_reg, uint16_t i_value) {
+  /**
+   * Write a 16 bit register, MSB first
+   * @param i_address: 7 bit I2C address
+   * @param i_reg: register pointer
+   * @param i_value: register content
+   * @return: result of the transaction
+  */
+  uint8_t arr_data[3] = {i_reg, (uint8_t)(i_value >> 8), (uint8_t)(i_value & 0xFF)};
+
+  return i2c_master_write_to_device(_iPort, i_address, arr_data, sizeof(arr_data), 100 / portTICK_RATE_MS);
+}
+
+
+void ADS1115IdfTransport::delayMs(uint32_t i_delay_ms) {
+  delayUs(i_delay_ms * 1000);
+}
+
+
+void ADS1115IdfTransport::delayTimerCallback(void * ptr_arg) {
+  ADS1115IdfTransport * ptr_transport = (ADS1115IdfTransport *)ptr_arg;
+
+  ptr_transport->_bDelayExpired = true;
+  xTaskNotifyGive(ptr_transport->_hDelayTask);
+  ptr_transport->_bDelayNotified = true;
+}
+
+
+void ADS1115IdfTransport::delayUs(uint32_t i_delay_us) {
+  /**
+   * Wait at least the given time. Waits shorter than one tick are busy waited. Longer waits block on the one-shot
+   * esp_timer, which wakes the task after the delay independent of the tick rate (a mux settling of 5 ms costs 5 ms,
+   * not the 10 to 20 ms of a tick rounded delay at CONFIG_FREERTOS_HZ=100).
+   * The timer wakes the task with a notification. The measurement task also counts the ALERT/RDY pulses with
+   * notifications, pulses taken during the wait are given back afterwards.
+   * @param i_delay_us: delay in us
+  */
+  const uint32_t i_tick_us = portTICK_PERIOD_MS * 1000;
+  uint32_t i_taken = 0;
+
+  if (i_delay_us < i_tick_us || _hDelayTimer == NULL){
+    esp_rom_delay_us(i_delay_us);
+    return;
+  }
+
+  _hDelayTask = xTaskGetCurrentTaskHandle();
+  _bDelayExpired = false;
+  _bDelayNotified = false;
+  esp_timer_start_once(_hDelayTimer, i_delay_us);
+
+  // the flag is set before the notification, so a notification is still to come while it is clear
+  while (!_bDelayExpired){
+    i_taken += ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  }
+  while (!_bDelayNotified){
+  }
+  i_taken += ulTaskNotifyTake(pdTRUE, 0);
+
+  // one notification was the timer
+  for (; i_taken > 1; i_taken--){
+    xTaskNotifyGive(_hDelayTask);
+  }
+}
+
+
+int64_t ADS1115IdfTransport::getTimeUs(void) {
+  return esp_timer_get_time();
+}
+
+#endif
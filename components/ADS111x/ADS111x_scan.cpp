@@ -0,0 +1,321 @@
+// Scan scheduler for several ADS1115 on one I2C bus, see ADS111x_scan.hpp
+
+#include <stdint.h>
+#include "ADS111x_scan.hpp"
+
+// conversion time in us, index is the DR field of the config register
+static const uint32_t arrScanConvTimeUs[8] = {125000, 62500, 31250, 15625, 7813, 4000, 2106, 1163};
+// LSB in V, index is the PGA field of the config register
+static const float arrScanLsbVolt[8] = {ADS1115_LSB_6P144, ADS1115_LSB_4P096, ADS1115_LSB_2P048, ADS1115_LSB_1P024,
+                                        ADS1115_LSB_0P512, ADS1115_LSB_0P256, ADS1115_LSB_0P256, ADS1115_LSB_0P256};
+
+ADS1115Scanner::ADS1115Scanner() {
+  _ptrTransport = NULL;
+  _iChannelCnt = 0;
+  _iDeviceCnt = 0;
+  _iCyclePeriodUs = 0;
+  _iCycleStartUs = 0;
+  _iCycleCnt = 0;
+  _iCycleTimeUs = 0;
+  _bRunning = false;
+}
+
+
+void ADS1115Scanner::setTransport(ADS1115Transport * ptr_transport) {
+  /**
+   * Set the bus of the devices, it may be shared with ADS1115 instances on other addresses
+   * @param ptr_transport: initialized transport
+  */
+  _ptrTransport = ptr_transport;
+}
+
+
+bool ADS1115Scanner::setChannels(const ads1115_scan_channel * arr_channels, int i_channel_cnt) {
+  /**
+   * Set the channel table, channels are grouped by device and keep their order within a device. Results are cleared
+   * and the scan is stopped.
+   * @param arr_channels: channel table
+   * @param i_channel_cnt: number of channels, 1..ADS1115_SCAN_MAX_CHANNELS
+   * @return: false if the table is too long or uses more than ADS1115_SCAN_MAX_DEVICES addresses
+  */
+  if (i_channel_cnt < 1 || i_channel_cnt > ADS1115_SCAN_MAX_CHANNELS){
+    return false;
+  }
+
+  int i_device_cnt = 0;
+  ads1115_scan_device arr_devices[ADS1115_SCAN_MAX_DEVICES];
+
+  for (int i_ch=0; i_ch<i_channel_cnt; i_ch++){
+    int i_dev = 0;
+    while (i_dev < i_device_cnt && arr_devices[i_dev].iAddress != arr_channels[i_ch].iAddress){
+      i_dev++;
+    }
+    if (i_dev == i_device_cnt){
+      if (i_device_cnt == ADS1115_SCAN_MAX_DEVICES){
+        return false;
+      }
+      arr_devices[i_dev] = {};
+      arr_devices[i_dev].iAddress = arr_channels[i_ch].iAddress;
+      i_device_cnt++;
+    }
+    arr_devices[i_dev].arrChannels[arr_devices[i_dev].iChannelCnt++] = i_ch;
+  }
+
+  for (int i_ch=0; i_ch<i_channel_cnt; i_ch++){
+    _arrChannels[i_ch] = arr_channels[i_ch];
+    _arrResults[i_ch] = {};
+  }
+  for (int i_dev=0; i_dev<i_device_cnt; i_dev++){
+    _arrDevices[i_dev] = arr_devices[i_dev];
+  }
+  _iChannelCnt = i_channel_cnt;
+  _iDeviceCnt = i_device_cnt;
+  _iCycleCnt = 0;
+  _iCycleTimeUs = 0;
+  _bRunning = false;
+  return true;
+}
+
+
+void ADS1115Scanner::setCyclePeriodUs(uint32_t i_period_us) {
+  /**
+   * Set the period of the scan cycles
+   * @param i_period_us: time between the starts of two cycles, 0 to start the next cycle as soon as all devices are
+   *                     done. A cycle which takes longer than the period delays the next one.
+  */
+  _iCyclePeriodUs = i_period_us;
+}
+
+
+void ADS1115Scanner::start(void) {
+  /**
+   * Start the first cycle now, service() has to be called from then on
+  */
+  if (!_ptrTransport || _iChannelCnt == 0){
+    return;
+  }
+  for (int i_dev=0; i_dev<_iDeviceCnt; i_dev++){
+    // the configuration of the device is unknown, the first channel waits for its settling time
+    _arrDevices[i_dev].bConfigValid = false;
+  }
+  _bRunning = true;
+  _startCycle(_ptrTransport->getTimeUs());
+}
+
+
+void ADS1115Scanner::_startCycle(int64_t i_now_us) {
+  for (int i_dev=0; i_dev<_iDeviceCnt; i_dev++){
+    _arrDevices[i_dev].iPos = 0;
+    _arrDevices[i_dev].iState = ADS1115_SCAN_IDLE;
+    _arrDevices[i_dev].iDeadlineUs = i_now_us;
+  }
+  _iCycleStartUs = i_now_us;
+}
+
+
+int64_t ADS1115Scanner::service(void) {
+  /**
+   * Process all devices whose deadline is reached. Each device has one conversion in flight, the I2C accesses of the
+   * devices are interleaved in deadline order.
+   * @return: time of the next deadline in us of the transport time base, the caller sleeps until then
+  */
+  if (!_bRunning){
+    return INT64_MAX;
+  }
+
+  for (;;){
+    int64_t i_now_us = _ptrTransport->getTimeUs();
+    ads1115_scan_device * ptr_next = NULL;
+    bool b_cycle_done = true;
+
+    for (int i_dev=0; i_dev<_iDeviceCnt; i_dev++){
+      ads1115_scan_device * ptr_dev = &_arrDevices[i_dev];
+      if (ptr_dev->iState == ADS1115_SCAN_DONE){
+        continue;
+      }
+      b_cycle_done = false;
+      if (!ptr_next || ptr_dev->iDeadlineUs < ptr_next->iDeadlineUs){
+        ptr_next = ptr_dev;
+      }
+    }
+
+    if (b_cycle_done){
+      int64_t i_next_cycle_us = _iCycleStartUs + _iCyclePeriodUs;
+      if (i_next_cycle_us > i_now_us){
+        return i_next_cycle_us;
+      }
+      _startCycle(i_now_us);
+      continue;
+    }
+
+    if (ptr_next->iDeadlineUs > i_now_us){
+      return ptr_next->iDeadlineUs;
+    }
+    _stepDevice(ptr_next, i_now_us);
+  }
+}
+
+
+uint16_t ADS1115Scanner::_getConfigReg(const ads1115_scan_channel & obj_channel) {
+  /**
+   * Single-shot configuration of a channel, comparator disabled, without the OS bit
+  */
+  return (uint16_t)(((obj_channel.iMux & 0b111) << ADS1115_MUX0) | ((obj_channel.iPga & 0b111) << ADS1115_PGA0) |
+                    (1 << ADS1115_MODE) | ((obj_channel.iRate & 0b111) << ADS1115_DR0) | ADS1115_CMP_DISABLE);
+}
+
+
+void ADS1115Scanner::_stepDevice(ads1115_scan_device * ptr_dev, int64_t i_now_us) {
+  /**
+   * Next action of a device: switch the mux, start the conversion or read it out
+  */
+  int i_ch = ptr_dev->arrChannels[ptr_dev->iPos];
+  const ads1115_scan_channel & obj_channel = _arrChannels[i_ch];
+  uint16_t i_config = _getConfigReg(obj_channel);
+  uint32_t i_conv_us = getConvTimeUs(obj_channel.iRate);
+  uint16_t i_value;
+
+  switch (ptr_dev->iState){
+    case ADS1115_SCAN_IDLE:
+      if (obj_channel.iSettleUs > 0 && !(ptr_dev->bConfigValid && ptr_dev->iConfigReg == i_config)){
+        // switch the mux without starting a conversion, the input settles in the meantime
+        if (_ptrTransport->writeRegister(ptr_dev->iAddress, ADS1115_CONFIG_REG, i_config) != ESP_OK){
+          _recordError(ptr_dev);
+          return;
+        }
+        ptr_dev->iConfigReg = i_config;
+        ptr_dev->bConfigValid = true;
+        ptr_dev->iState = ADS1115_SCAN_SETTLING;
+        ptr_dev->iDeadlineUs = _ptrTransport->getTimeUs() + obj_channel.iSettleUs;
+        return;
+      }
+      // no settling required: configuration and start in one write
+    // fall through
+    case ADS1115_SCAN_SETTLING:
+      if (_ptrTransport->writeRegister(ptr_dev->iAddress, ADS1115_CONFIG_REG, i_config | (1 << ADS1115_OS)) != ESP_OK){
+        _recordError(ptr_dev);
+        return;
+      }
+      ptr_dev->iConfigReg = i_config;
+      ptr_dev->bConfigValid = true;
+      ptr_dev->iConvStartUs = _ptrTransport->getTimeUs();
+      ptr_dev->iState = ADS1115_SCAN_CONVERTING;
+      ptr_dev->iDeadlineUs = ptr_dev->iConvStartUs + i_conv_us + i_conv_us * ADS1115_SCAN_CONV_MARGIN_PERCENT / 100;
+      return;
+
+    case ADS1115_SCAN_CONVERTING:
+      if (_ptrTransport->readRegister(ptr_dev->iAddress, ADS1115_CONFIG_REG, &i_value) != ESP_OK){
+        _recordError(ptr_dev);
+        return;
+      }
+      if (!(i_value & (1 << ADS1115_OS))){
+        // still converting, the oscillator is slower than the margin
+        if (i_now_us - ptr_dev->iConvStartUs > (int64_t)i_conv_us * ADS1115_SCAN_TIMEOUT_FACTOR){
+          _recordError(ptr_dev);
+        } else {
+          ptr_dev->iDeadlineUs = _ptrTransport->getTimeUs() + ADS1115_SCAN_POLL_US;
+        }
+        return;
+      }
+      if (_ptrTransport->readRegister(ptr_dev->iAddress, ADS1115_CONVERSION_REG, &i_value) != ESP_OK){
+        _recordError(ptr_dev);
+        return;
+      }
+      _arrResults[i_ch].iRawValue = (int16_t)i_value;
+      _arrResults[i_ch].fVoltage = (int16_t)i_value * getLsbVolt(obj_channel.iPga);
+      _arrResults[i_ch].iTimeUs = _ptrTransport->getTimeUs();
+      _arrResults[i_ch].iCount++;
+      _arrResults[i_ch].bValid = true;
+      _nextChannel(ptr_dev, _arrResults[i_ch].iTimeUs);
+      return;
+  }
+}
+
+
+void ADS1115Scanner::_nextChannel(ads1115_scan_device * ptr_dev, int64_t i_now_us) {
+  ptr_dev->iPos++;
+  if (ptr_dev->iPos < ptr_dev->iChannelCnt){
+    ptr_dev->iState = ADS1115_SCAN_IDLE;
+    ptr_dev->iDeadlineUs = i_now_us;
+    return;
+  }
+
+  ptr_dev->iState = ADS1115_SCAN_DONE;
+  for (int i_dev=0; i_dev<_iDeviceCnt; i_dev++){
+    if (_arrDevices[i_dev].iState != ADS1115_SCAN_DONE){
+      return;
+    }
+  }
+  // the last device finished the cycle
+  _iCycleTimeUs = (uint32_t)(i_now_us - _iCycleStartUs);
+  _iCycleCnt++;
+}
+
+
+void ADS1115Scanner::_recordError(ads1115_scan_device * ptr_dev) {
+  /**
+   * Give up the current channel of a device, the device state is unknown afterwards
+  */
+  int i_ch = ptr_dev->arrChannels[ptr_dev->iPos];
+
+  _arrResults[i_ch].iErrors++;
+  _arrResults[i_ch].bValid = false;
+  ptr_dev->bConfigValid = false;
+  _nextChannel(ptr_dev, _ptrTransport->getTimeUs());
+}
+
+
+int ADS1115Scanner::getChannelCount(void) {
+  return _iChannelCnt;
+}
+
+
+int ADS1115Scanner::getDeviceCount(void) {
+  return _iDeviceCnt;
+}
+
+
+bool ADS1115Scanner::getResult(int i_channel, ads1115_scan_result * ptr_result) {
+  /**
+   * Latest conversion of a channel
+   * @param i_channel: index in the channel table
+   * @param ptr_result: result
+   * @return: false if the index is out of range
+  */
+  if (i_channel < 0 || i_channel >= _iChannelCnt){
+    return false;
+  }
+  *ptr_result = _arrResults[i_channel];
+  return true;
+}
+
+
+uint32_t ADS1115Scanner::getCycleCount(void) {
+  return _iCycleCnt;
+}
+
+
+uint32_t ADS1115Scanner::getCycleTimeUs(void) {
+  /**
+   * Duration of the latest complete cycle from its start until the last read-out
+  */
+  return _iCycleTimeUs;
+}
+
+
+uint32_t ADS1115Scanner::getConvTimeUs(uint8_t i_rate) {
+  /**
+   * Nominal conversion time
+   * @param i_rate: ADS1115_RATE_*
+  */
+  return arrScanConvTimeUs[i_rate & 0b111];
+}
+
+
+float ADS1115Scanner::getLsbVolt(uint8_t i_pga) {
+  /**
+   * Weight of one LSB
+   * @param i_pga: ADS1115_PGA_*
+  */
+  return arrScanLsbVolt[i_pga & 0b111];
+}
@@ -0,0 +1,447 @@
+// Register level emulator of the ADS1115, see ADS111x_sim.hpp
+
+#include <math.h>
+#include "ADS111x_sim.hpp"
+
+// data rates in samples per second, index is the DR field of the config register
+static const float arrSimDataRates[8] = {8.F, 16.F, 32.F, 64.F, 128.F, 250.F, 475.F, 860.F};
+// full scale range in V, index is the PGA field of the config register
+static const float arrSimFullScale[8] = {6.144F, 4.096F, 2.048F, 1.024F, 0.512F, 0.256F, 0.256F, 0.256F};
+
+ADS1115SimTransport::ADS1115SimTransport(uint8_t i_address) {
+  _iAddress = i_address;
+  _iTimeUs = 0;
+  _iConvDoneUs = -1;
+  _arrRegisters[ADS1115_CONVERSION_REG] = 0x0000;
+  _arrRegisters[ADS1115_CONFIG_REG] = ADS1115_SIM_CONFIG_RESET;
+  _arrRegisters[ADS1115_LOW_THRESH_REG] = 0x8000;
+  _arrRegisters[ADS1115_HIGH_THRESH_REG] = 0x7FFF;
+
+  for (int i_mux=0; i_mux<ADS1115_SIM_MUX_CNT; i_mux++){_arrInputVolt[i_mux]=0.F;}
+
+  _fnInput = NULL;
+  _ptrInputCtx = NULL;
+  _fnRdy = NULL;
+  _ptrRdyCtx = NULL;
+  _fNoiseSigma = 0.F;
+  _fClockError = 0.F;
+  _iRandState = 1;
+  _iFaults = 0;
+  _iTransactionUs = ADS1115_SIM_TRANSACTION_US;
+  _iConvCnt = 0;
+  _iRdyPulseCnt = 0;
+}
+
+
+uint8_t ADS1115SimTransport::getAddress(void) {
+  return _iAddress;
+}
+
+
+esp_err_t ADS1115SimTransport::init(int i_sda_pin, int i_scl_pin) {
+  return ESP_OK;
+}
+
+
+esp_err_t ADS1115SimTransport::deinit(void) {
+  return ESP_OK;
+}
+
+
+esp_err_t ADS1115SimTransport::_beginTransaction(uint8_t i_address) {
+  /**
+   * Advance virtual time by the duration of a transaction and apply bus faults
+   * @param i_address: addressed device
+   * @return: ESP_OK if the device acknowledges
+  */
+  if (_iFaults & ADS1115_SIM_FAULT_TIMEOUT){
+    _runUntil(_iTimeUs + ADS1115_SIM_TIMEOUT_US);
+    return ESP_ERR_TIMEOUT;
+  }
+
+  _runUntil(_iTimeUs + _iTransactionUs);
+
+  if ((_iFaults & ADS1115_SIM_FAULT_NACK) || i_address != _iAddress){
+    return ESP_FAIL;
+  }
+  return ESP_OK;
+}
+
+
+esp_err_t ADS1115SimTransport::readRegister(uint8_t i_address, uint8_t i_reg, uint16_t * ptr_value) {
+  /**
+   * Read a register. The OS bit of the config register reads 0 while a conversion is ongoing.
+   * @param i_address: 7 bit I2C address
+   * @param i_reg: register pointer
+   * @param ptr_value: register content, 0 on error
+   * @return: result of the transaction
+  */
+  esp_err_t esp_ret = _beginTransaction(i_address);
+
+  *ptr_value = 0;
+  if (esp_ret != ESP_OK){
+    return esp_ret;
+  }
+
+  *ptr_value = _arrRegisters[i_reg & 0x03];
+  if ((i_reg & 0x03) == ADS1115_CONFIG_REG && _iConvDoneUs >= 0){
+    *ptr_value &= ~(1<<ADS1115_OS);
+  }
+  return ESP_OK;
+}
+
+
+esp_err_t ADS1115SimTransport::writeRegister(uint8_t i_address, uint8_t i_reg, uint16_t i_value) {
+  /**
+   * Write a register. Writing the config register starts a conversion in continuous mode, or in single-shot mode if the
+   * OS bit is set and the device is idle. The conversion register is read only.
+   * @param i_address: 7 bit I2C address
+   * @param i_reg: register pointer
+   * @param i_value: register content
+   * @return: result of the transaction
+  */
+  esp_err_t esp_ret = _beginTransaction(i_address);
+
+  if (esp_ret != ESP_OK){
+    return esp_ret;
+  }
+
+  i_reg &= 0x03;
+  if (i_reg == ADS1115_CONVERSION_REG){
+    return ESP_OK;
+  }
+
+  if (i_reg != ADS1115_CONFIG_REG){
+    _arrRegisters[i_reg] = i_value;
+    return ESP_OK;
+  }
+
+  bool b_start_single = (i_value & (1<<ADS1115_OS)) && _iConvDoneUs < 0;
+  // OS is a command bit, it is not stored
+  _arrRegisters[ADS1115_CONFIG_REG] = i_value | (1<<ADS1115_OS);
+
+  if (!(i_value & (1<<ADS1115_MODE))){
+    // continuous mode, the ongoing conversion is restarted with the new configuration
+    _iConvDoneUs = _iTimeUs + _getConvTimeUs();
+  } else if (b_start_single){
+    _iConvDoneUs = _iTimeUs + _getConvTimeUs();
+  }
+  return ESP_OK;
+}
+
+
+void ADS1115SimTransport::delayMs(uint32_t i_delay_ms) {
+  _runUntil(_iTimeUs + (int64_t)i_delay_ms * 1000);
+}
+
+
+void ADS1115SimTransport::delayUs(uint32_t i_delay_us) {
+  _runUntil(_iTimeUs + i_delay_us);
+}
+
+
+int64_t ADS1115SimTransport::getTimeUs(void) {
+  return _iTimeUs;
+}
+
+
+void ADS1115SimTransport::advanceTimeUs(int64_t i_delta_us) {
+  /**
+   * Run the emulation for a time span, conversions and RDY pulses in between are processed in order
+   * @param i_delta_us: time span in us
+  */
+  _runUntil(_iTimeUs + i_delta_us);
+}
+
+
+void ADS1115SimTransport::_runUntil(int64_t i_time_us) {
+  while (_iConvDoneUs >= 0 && _iConvDoneUs <= i_time_us){
+    _completeConversion(_iConvDoneUs);
+  }
+  _iTimeUs = i_time_us;
+}
+
+
+void ADS1115SimTransport::_completeConversion(int64_t i_done_us) {
+  /**
+   * Finish the ongoing conversion: sample and quantize the input, pulse ALERT/RDY and schedule the next conversion
+   * @param i_done_us: end of the conversion
+  */
+  uint8_t i_mux = (_arrRegisters[ADS1115_CONFIG_REG] >> ADS1115_MUX0) & 0b111;
+  float f_lsb = _getLsbVolt();
+  float f_volt;
+
+  if (_iFaults & ADS1115_SIM_FAULT_OPEN_INPUT){
+    f_volt = 2.F * f_lsb * 32768.F;
+  } else if (_fnInput){
+    f_volt = _fnInput(i_done_us, i_mux, _ptrInputCtx);
+  } else {
+    f_volt = _arrInputVolt[i_mux];
+  }
+  f_volt += _fNoiseSigma * _getRandGauss();
+
+  if (!(_iFaults & ADS1115_SIM_FAULT_FROZEN)){
+    float f_code = roundf(f_volt / f_lsb);
+    f_code = (f_code > 32767.F) ? 32767.F : ((f_code < -32768.F) ? -32768.F : f_code);
+    _arrRegisters[ADS1115_CONVERSION_REG] = (uint16_t)(int16_t)f_code;
+  }
+  _iConvCnt++;
+
+  if (_arrRegisters[ADS1115_CONFIG_REG] & (1<<ADS1115_MODE)){
+    // single-shot, back to power-down
+    _iConvDoneUs = -1;
+  } else {
+    _iConvDoneUs = i_done_us + _getConvTimeUs();
+  }
+
+  if (_isRdyModeActive()){
+    _iRdyPulseCnt++;
+    if (_fnRdy){
+      _fnRdy(i_done_us, _ptrRdyCtx);
+    }
+  }
+}
+
+
+int64_t ADS1115SimTransport::_getConvTimeUs(void) {
+  uint8_t i_rate = (_arrRegisters[ADS1115_CONFIG_REG] >> ADS1115_DR0) & 0b111;
+  return (int64_t)(1000000.F / (arrSimDataRates[i_rate] * (1.F + _fClockError)));
+}
+
+
+float ADS1115SimTransport::_getLsbVolt(void) {
+  uint8_t i_pga = (_arrRegisters[ADS1115_CONFIG_REG] >> ADS1115_PGA0) & 0b111;
+  return arrSimFullScale[i_pga] / 32768.F;
+}
+
+
+bool ADS1115SimTransport::_isRdyModeActive(void) {
+  /**
+   * Conversion ready function of ALERT/RDY: MSB of high threshold set, MSB of low threshold cleared, comparator enabled
+  */
+  return (_arrRegisters[ADS1115_HIGH_THRESH_REG] & 0x8000) && !(_arrRegisters[ADS1115_LOW_THRESH_REG] & 0x8000) &&
+         ((_arrRegisters[ADS1115_CONFIG_REG] & 0b11) != ADS1115_CMP_DISABLE);
+}
+
+
+float ADS1115SimTransport::_getRandGauss(void) {
+  /**
+   * Standard normal distributed random number, xorshift32 with Box-Muller transform (reproducible with setNoise seed)
+  */
+  float arr_uniform[2];
+
+  for (int i_idx=0; i_idx<2; i_idx++){
+    _iRandState ^= _iRandState << 13;
+    _iRandState ^= _iRandState >> 17;
+    _iRandState ^= _iRandState << 5;
+    arr_uniform[i_idx] = ((float)(_iRandState >> 8) + 1.F) / 16777217.F;
+  }
+  return sqrtf(-2.F * logf(arr_uniform[0])) * cosf(6.2831853F * arr_uniform[1]);
+}
+
+
+void ADS1115SimTransport::setInputVoltage(uint8_t i_mux, float f_volt) {
+  /**
+   * Set a constant input voltage
+   * @param i_mux: multiplexer setting, see ADS1115_MUX_*
+   * @param f_volt: voltage between the selected inputs
+  */
+  _arrInputVolt[i_mux & 0b111] = f_volt;
+}
+
+
+void ADS1115SimTransport::setInputFunction(ads1115_sim_input_fn fn_input, void * ptr_ctx) {
+  /**
+   * Set a time dependent input, e.g. the sensor voltage of a plant model. Replaces the constant input voltages.
+   * @param fn_input: input function, NULL to use the constant voltages again
+   * @param ptr_ctx: context passed to the function
+  */
+  _fnInput = fn_input;
+  _ptrInputCtx = ptr_ctx;
+}
+
+
+void ADS1115SimTransport::setNoise(float f_sigma_volt, uint32_t i_seed) {
+  /**
+   * Add gaussian noise to the input
+   * @param f_sigma_volt: standard deviation in V
+   * @param i_seed: seed of the random generator, must not be 0
+  */
+  _fNoiseSigma = f_sigma_volt;
+  _iRandState = (i_seed == 0) ? 1 : i_seed;
+}
+
+
+void ADS1115SimTransport::setClockError(float f_rel_error) {
+  /**
+   * Deviation of the internal oscillator, the data rate of all settings changes by the same factor
+   * @param f_rel_error: relative deviation, the datasheet allows -0.1..0.1
+  */
+  _fClockError = f_rel_error;
+}
+
+
+void ADS1115SimTransport::setFaults(uint32_t i_faults) {
+  /**
+   * Inject faults
+   * @param i_faults: combination of ADS1115_SIM_FAULT_*, 0 to clear all faults
+  */
+  _iFaults = i_faults;
+}
+
+
+uint32_t ADS1115SimTransport::getFaults(void) {
+  return _iFaults;
+}
+
+
+void ADS1115SimTransport::setRdyCallback(ads1115_sim_rdy_fn fn_rdy, void * ptr_ctx) {
+  /**
+   * Register a callback for the conversion ready pulse, the emulated equivalent of the GPIO interrupt
+   * @param fn_rdy: callback, called from within transactions and advanceTimeUs()
+   * @param ptr_ctx: context passed to the callback
+  */
+  _fnRdy = fn_rdy;
+  _ptrRdyCtx = ptr_ctx;
+}
+
+
+void ADS1115SimTransport::setTransactionTimeUs(uint32_t i_transaction_us) {
+  _iTransactionUs = i_transaction_us;
+}
+
+
+uint32_t ADS1115SimTransport::getConversionCount(void) {
+  return _iConvCnt;
+}
+
+
+uint32_t ADS1115SimTransport::getRdyPulseCount(void) {
+  return _iRdyPulseCnt;
+}
+
+
+uint16_t ADS1115SimTransport::peekRegister(uint8_t i_reg) {
+  /**
+   * Register content without a bus transaction, for assertions in tests
+  */
+  return _arrRegisters[i_reg & 0x03];
+}
+
+
+ADS1115SimBus::ADS1115SimBus() {
+  _iDeviceCnt = 0;
+  _iTimeUs = 0;
+  _iTransactionCnt = 0;
+}
+
+
+bool ADS1115SimBus::addDevice(ADS1115SimTransport * ptr_device) {
+  /**
+   * Connect a device to the bus, its virtual time is taken over by the bus
+   * @param ptr_device: emulated device, the address is set in its constructor
+   * @return: false if the bus is full or the address is already used
+  */
+  if (_iDeviceCnt >= ADS1115_SIM_BUS_MAX_DEVICES || _getDevice(ptr_device->getAddress())){
+    return false;
+  }
+  _arrDevices[_iDeviceCnt] = ptr_device;
+  _arrAddresses[_iDeviceCnt] = ptr_device->getAddress();
+  _iDeviceCnt++;
+  _syncDevices();
+  return true;
+}
+
+
+esp_err_t ADS1115SimBus::init(int i_sda_pin, int i_scl_pin) {
+  return ESP_OK;
+}
+
+
+esp_err_t ADS1115SimBus::deinit(void) {
+  return ESP_OK;
+}
+
+
+ADS1115SimTransport * ADS1115SimBus::_getDevice(uint8_t i_address) {
+  for (int i_dev=0; i_dev<_iDeviceCnt; i_dev++){
+    if (_arrAddresses[i_dev] == i_address){
+      return _arrDevices[i_dev];
+    }
+  }
+  return NULL;
+}
+
+
+void ADS1115SimBus::_syncDevices(void) {
+  /**
+   * Run all devices up to the time of the bus, conversions complete in the background
+  */
+  for (int i_dev=0; i_dev<_iDeviceCnt; i_dev++){
+    int64_t i_delta_us = _iTimeUs - _arrDevices[i_dev]->getTimeUs();
+    if (i_delta_us > 0){
+      _arrDevices[i_dev]->advanceTimeUs(i_delta_us);
+    }
+  }
+}
+
+
+esp_err_t ADS1115SimBus::readRegister(uint8_t i_address, uint8_t i_reg, uint16_t * ptr_value) {
+  /**
+   * Read a register of the addressed device, the bus is busy for the duration of the transaction
+   * @return: ESP_FAIL if no device acknowledges the address
+  */
+  ADS1115SimTransport * ptr_device = _getDevice(i_address);
+
+  _iTransactionCnt++;
+  _syncDevices();
+  if (!ptr_device){
+    *ptr_value = 0;
+    _iTimeUs += ADS1115_SIM_TRANSACTION_US;
+    return ESP_FAIL;
+  }
+  esp_err_t esp_ret = ptr_device->readRegister(i_address, i_reg, ptr_value);
+  _iTimeUs = ptr_device->getTimeUs();
+  return esp_ret;
+}
+
+
+esp_err_t ADS1115SimBus::writeRegister(uint8_t i_address, uint8_t i_reg, uint16_t i_value) {
+  ADS1115SimTransport * ptr_device = _getDevice(i_address);
+
+  _iTransactionCnt++;
+  _syncDevices();
+  if (!ptr_device){
+    _iTimeUs += ADS1115_SIM_TRANSACTION_US;
+    return ESP_FAIL;
+  }
+  esp_err_t esp_ret = ptr_device->writeRegister(i_address, i_reg, i_value);
+  _iTimeUs = ptr_device->getTimeUs();
+  return esp_ret;
+}
+
+
+void ADS1115SimBus::delayMs(uint32_t i_delay_ms) {
+  advanceTimeUs((int64_t)i_delay_ms * 1000);
+}
+
+
+void ADS1115SimBus::delayUs(uint32_t i_delay_us) {
+  advanceTimeUs(i_delay_us);
+}
+
+
+int64_t ADS1115SimBus::getTimeUs(void) {
+  return _iTimeUs;
+}
+
+
+void ADS1115SimBus::advanceTimeUs(int64_t i_delta_us) {
+  _iTimeUs += i_delta_us;
+  _syncDevices();
+}
+
+
+uint32_t ADS1115SimBus::getTransactionCount(void) {
+  return _iTransactionCnt;
+}
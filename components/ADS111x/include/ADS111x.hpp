@@ -4,9 +4,9 @@
 #ifndef ADS1115_h
 #define ADS1115_h
 
-#include "driver/i2c.h"
-
-#define ADS1115_I2C_PORT_NUM I2C_NUM_1 // I2C port number
+#include <stdint.h>
+#include <stddef.h>
+#include "ADS111x_transport.hpp"
 
 #define ADS1115_I2CADD_DEFAULT  0x48 //ADDR-Pin on GND
 #define ADS1115_I2CADD_ADDR_VDD 0x49 //ADDR-Pin on VDD
@@ -100,16 +100,32 @@
 #define ADS1115_CONV_READY_ACTIVE 0b001
 
 #define ADS1115_CONV_BUF_SIZE 12
+#define ADS1115_CONV_TABLE_MAX 32 // rows of the physical conversion table, allocated with the driver object
+
+#define ADS1115_DELAY_AFTER_MUX_CHANGE_US 5000 // settling after a mux change in us
 
-#define ADS1115_DELAY_AFTER_MUX_CHANGE 5 //5 ms
+// auto ranging of the PGA
+#define ADS1115_AUTORANGE_HIGH_CODES 31130  // 95 % of full scale, switch to the next larger full scale range
+#define ADS1115_AUTORANGE_LOW_CODES 24576   // 75 % of the next smaller range, switch to it below
+#define ADS1115_AUTORANGE_DISCARD 1         // conversions dropped after a switch, the output is held meanwhile
 
-#include <stdio.h>
-#include "freertos/FreeRTOS.h"
+// fixed point correction of the raw conversions (setCorrection)
+#define ADS1115_CORR_OFFSET_FRAC_BITS 4     // offset in 1/16 LSB of the 0.256 V range
+#define ADS1115_CORR_GAIN_FRAC_BITS 16      // gain 1.0 = 65536
+
+// statistics of the I2C transactions with the ADS1115
+struct ads1115_i2c_stats {
+  uint32_t iTransactions; // number of I2C transactions
+  uint32_t iErrors;       // number of failed I2C transactions
+  uint64_t iLatencySumUs; // sum of the transaction durations in us
+  uint32_t iLatencyMaxUs; // longest transaction duration in us
+};
 
 class ADS1115
 {
   public:
     ADS1115();
+    ADS1115(ADS1115Transport *);
     bool begin(void);
     bool begin(uint8_t);
     bool begin(int, int);
@@ -118,7 +134,7 @@ class ADS1115
     void setDefault(void);
     void startSingleShotMeas(bool);
     bool getOpStatus(void);
-    void setMux(uint8_t);
+    void setMux(uint8_t, bool b_settle = true);
     uint8_t getMux(void);
     void setPGA(uint8_t);
     uint8_t getPGA(void);
@@ -146,6 +162,7 @@ class ADS1115
     float getConvVal(void);
     float getVoltVal(void);
     float getPhysVal(void);
+    float convertToPhysVal(float);
     int getLatestBufVal(void);
     void printConfigReg(void);
     uint16_t getRegisterValue(uint8_t);
@@ -154,41 +171,69 @@ class ADS1115
     void setPhysConv(const float, const float, const float);
     void setPhysConv(const float[][2], size_t);
     void activateFilter();
+    void activateAutoRange(uint8_t, uint8_t);
+    void deactivateAutoRange(void);
+    bool getAutoRangeStatus(void);
+    uint8_t getRange(void);
+    bool isRangeSettling(void);
+    uint32_t getRangeSwitchCount(void);
+    void setCorrection(int32_t, int32_t);
+    int16_t applyCorrection(int16_t);
+    static float getLsbVolt(uint8_t);
     void deactivateFilter();
     bool getFilterStatus(void);
     int getAbsBufSize(void);
     int16_t* getBuffer(void);
     bool getConnectionStatus(void);
+    void getI2cStats(ads1115_i2c_stats *);
+    ADS1115Transport * getTransport(void);
     uint16_t iConfigReg;
     void bitWrite(uint16_t *, int, bool);
 
   private:
+    ADS1115Transport * _ptrTransport;
+#ifdef ESP_PLATFORM
+    ADS1115IdfTransport _objIdfTransport;   // transport of the default constructor
+#endif
     int _iSdaPin;
     int _iSclPin;
     uint8_t _iI2cAddress;
     uint8_t _iI2cRegPointer;
-    float ** _ptrConvTable;
+    float _arrConvTable[ADS1115_CONV_TABLE_MAX][3];
     size_t _iSizeConvTable;
     int _iConvMethod;
     float bitNumbering;
+    uint8_t _iPga;
+    bool _bAutoRangeActive;
+    uint8_t _iAutoRangeCoarse;
+    uint8_t _iAutoRangeFine;
+    int _iRangeDiscardCnt;
+    bool _bRangeSettling;
+    uint32_t _iRangeSwitchCnt;
+    float _fLastConvValue;
+    int32_t _iCorrOffset;
+    int32_t _iCorrGain;
     uint16_t iLowThreshReg;
     uint16_t iHighThreshReg;
-    esp_err_t i2c_master_init();
-    void i2c_write(uint8_t, uint8_t*, size_t);
-    void i2c_read(uint8_t, uint8_t*, size_t);
-    void initConvTable(size_t);
+    bool initConvTable(size_t);
     void writeBit(uint16_t &, int, bool);
     bool readBit(uint16_t, int);
     int _iBuffCnt;
     int _iBuffMaxFillIndex;
-    int16_t * _ptrConvBuff;
-    float * _ptrFilterCoeff;
+    int16_t _arrConvBuff[ADS1115_CONV_BUF_SIZE];
+    const float * _ptrFilterCoeff;
     float _fFilterNormCoeff;
     bool _bFilterActive;
     bool _bSavGolFilterActive;
     bool _bConnectStatus;
+    ads1115_i2c_stats _objI2cStats;
+    void _init(ADS1115Transport *);
+    void _recordI2cTransaction(int64_t, esp_err_t);
     float _getAvgFilterVal();
     float _getSavGolFilterVal();
+    float _getFilteredVal(void);
+    bool _updateRange(int16_t);
+    static float _getLsb(uint8_t);
     
 };
 
@@ -0,0 +1,76 @@
+// Online calibration of an ADS1115 input in continuous mode. At a fixed interval the multiplexer is switched from the
+// main input to a shorted input (offset) or to a reference divider with a known voltage (gain), alternately. A
+// calibration takes three conversion slots: the slot after each mux switch is dropped, because the conversion may have
+// started with the previous input. The output keeps the data rate of the main input, during the three slots it is
+// extrapolated from the recent slope. The corrections are applied by the driver in fixed point on every conversion.
+// As the reference divider is supplied by the bridge excitation, the gain term also removes excitation drift.
+
+#ifndef ADS1115_CALIB_h
+#define ADS1115_CALIB_h
+
+#include <stdint.h>
+#include "ADS111x.hpp"
+
+#define ADS1115_CAL_SMOOTHING 4             // a new measurement enters the correction with weight 1/n
+#define ADS1115_CAL_SLOPE_SMOOTHING 8       // slope estimate of the main input for the extrapolation
+#define ADS1115_CAL_MAX_OFFSET_VOLT 0.002F  // measurements beyond these limits are rejected
+#define ADS1115_CAL_MAX_GAIN_DEV 0.1F
+
+enum eAds1115CalState {
+  ADS1115_CAL_MAIN,     // main input is converted
+  ADS1115_CAL_SETTLE,   // first conversion after the switch to the calibration input, dropped
+  ADS1115_CAL_MEASURE,  // calibration conversion
+  ADS1115_CAL_RETURN    // first conversion after the switch back to the main input, dropped
+};
+
+enum eAds1115CalInput {
+  ADS1115_CAL_INPUT_ZERO,
+  ADS1115_CAL_INPUT_REF
+};
+
+struct ads1115_cal_status {
+  float fOffsetVolt;        // input referred offset
+  float fGain;              // gain correction factor
+  bool bOffsetValid;
+  bool bGainValid;
+  uint32_t iZeroCnt;        // accepted measurements
+  uint32_t iRefCnt;
+  uint32_t iRejectCnt;      // implausible measurements
+  uint32_t iSubstituteCnt;  // output values extrapolated during calibration slots
+};
+
+class ADS1115Calibrator
+{
+  public:
+    ADS1115Calibrator();
+    void setup(ADS1115 *, uint8_t, uint8_t, uint8_t, float, uint32_t);
+    void deactivate(void);
+    bool isActive(void);
+    float process(void);
+    bool isSubstituted(void);
+    void getStatus(ads1115_cal_status *);
+
+  private:
+    ADS1115 * _ptrAds;
+    uint8_t _iMainMux;
+    uint8_t _iZeroMux;
+    uint8_t _iRefMux;
+    float _fRefVolt;
+    uint32_t _iInterval;
+    uint32_t _iSampleCnt;
+    int _iState;
+    int _iInput;
+    bool _bActive;
+    bool _bSubstituted;
+    float _fLastValue;
+    float _fSlope;
+    bool _bLastValid;
+    uint8_t _iLastRange;
+    ads1115_cal_status _objStatus;
+    float _substitute(void);
+    void _trackValue(float);
+    void _update(int16_t);
+    void _applyCorrection(void);
+};
+
+#endif
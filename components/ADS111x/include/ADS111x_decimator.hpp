@@ -0,0 +1,61 @@
+// Decimation filter for oversampled ADS1115 conversions. A CIC filter of third order decimates the raw conversion
+// codes by R, a compensating FIR filter flattens the passband droop of the CIC and decimates by D. The CIC nulls at
+// multiples of the CIC output rate (data rate / R) can be placed on the mains frequency and its harmonics to reject
+// hum. Integer arithmetic in the CIC relies on two's complement wrap-around, the FIR runs in float at the low rate.
+// An optional moving average over the last N outputs of the FIR sets the noise bandwidth independently of the data
+// rate, it does not decimate further. It also damps hum which the CIC nulls miss when the oscillator of the ADS1115
+// (+-10 %) shifts them away from the mains frequency and its harmonics.
+
+#ifndef ADS1115_DECIMATOR_h
+#define ADS1115_DECIMATOR_h
+
+#include <stdint.h>
+
+#define ADS1115_DECIM_CIC_ORDER 3         // number of integrator/comb stages
+#define ADS1115_DECIM_CIC_MAX_RATIO 128   // output stays below 2^16 * 128^3
+#define ADS1115_DECIM_FIR_TAPS 21         // odd, linear phase
+#define ADS1115_DECIM_FIR_MAX_RATIO 4
+#define ADS1115_DECIM_DESIGN_GRID 256     // frequency points of the FIR design
+#define ADS1115_DECIM_AVG_MAX_LEN 32      // length of the moving average behind the FIR
+
+class ADS1115Decimator
+{
+  public:
+    ADS1115Decimator();
+    bool setup(int, int, int i_avg_len = 1);
+    void reset(void);
+    void restart(float);
+    bool push(int16_t);
+    float getOutput(void);
+    int getCicRatio(void);
+    int getFirRatio(void);
+    int getAvgLen(void);
+    float getGroupDelay(void);
+    float getFirCoeff(int);
+    uint32_t getOutputCount(void);
+
+  private:
+    int _iCicRatio;
+    int _iFirRatio;
+    float _fCicGain;
+    uint64_t _arrIntegrators[ADS1115_DECIM_CIC_ORDER];
+    uint64_t _arrCombDelays[ADS1115_DECIM_CIC_ORDER];
+    int _iCicPhase;
+    int _iCicWarmUp;
+    float _arrFirCoeff[ADS1115_DECIM_FIR_TAPS];
+    float _arrFirBuf[ADS1115_DECIM_FIR_TAPS];
+    int _iFirPos;
+    int _iFirPhase;
+    bool _bFirPrimed;
+    int _iAvgLen;
+    float _arrAvgBuf[ADS1115_DECIM_AVG_MAX_LEN];
+    int _iAvgPos;
+    bool _bAvgPrimed;
+    float _fOutput;
+    uint32_t _iOutputCnt;
+    float _getCicResponse(float);
+    void _designFir(void);
+    void _clearCicFir(void);
+};
+
+#endif
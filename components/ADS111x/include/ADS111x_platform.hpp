@@ -0,0 +1,33 @@
+// Platform abstraction of the ADS1115 driver. On ESP-IDF the native headers are used, host builds (Linux) get minimal
+// replacements for the few ESP-IDF definitions the driver and the metric registry of main depend on.
+
+#ifndef ADS1115_PLATFORM_h
+#define ADS1115_PLATFORM_h
+
+#ifdef ESP_PLATFORM
+
+#include "esp_err.h"
+#include "esp_log.h"
+
+#else
+
+#include <stdio.h>
+#include <stdint.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_INVALID_SIZE 0x104
+#define ESP_ERR_TIMEOUT 0x107
+
+#define ESP_LOGE(tag, format, ...) printf("E (%s) " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) printf("W (%s) " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) printf("I (%s) " format "\n", tag, ##__VA_ARGS__)
+
+#endif
+
+#endif
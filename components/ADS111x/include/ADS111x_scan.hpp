@@ -0,0 +1,91 @@
+// Scan scheduler for several ADS1115 on one I2C bus. A channel is a combination of device, input multiplexer, PGA and
+// data rate. The channels of a device are converted round-robin in single-shot mode, different devices convert in
+// parallel: while one device converts, the others are configured or read out. A scan cycle therefore takes about as
+// long as the device with the most conversion time, not the sum over all channels. All waiting is done against
+// microsecond deadlines of the transport time base, service() never blocks but returns the time of the next action.
+
+#ifndef ADS1115_SCAN_h
+#define ADS1115_SCAN_h
+
+#include <stdint.h>
+#include "ADS111x.hpp"
+
+#define ADS1115_SCAN_MAX_CHANNELS 8
+#define ADS1115_SCAN_MAX_DEVICES 4
+#define ADS1115_SCAN_CONV_MARGIN_PERCENT 10  // tolerance of the internal oscillator
+#define ADS1115_SCAN_POLL_US 100             // retry interval while a conversion is not finished
+#define ADS1115_SCAN_TIMEOUT_FACTOR 3        // a conversion is given up after this multiple of its nominal time
+
+struct ads1115_scan_channel {
+  uint8_t iAddress;     // ADS1115_I2CADD_*
+  uint8_t iMux;         // ADS1115_MUX_*
+  uint8_t iPga;         // ADS1115_PGA_*
+  uint8_t iRate;        // ADS1115_RATE_*
+  uint32_t iSettleUs;   // time between the mux change and the start of the conversion, e.g. for an input RC filter
+};
+
+struct ads1115_scan_result {
+  int16_t iRawValue;    // conversion register
+  float fVoltage;       // input voltage in V
+  int64_t iTimeUs;      // read-out time of the conversion
+  uint32_t iCount;      // successful conversions
+  uint32_t iErrors;     // failed I2C transactions and timed out conversions
+  bool bValid;          // latest conversion succeeded
+};
+
+enum eAds1115ScanState {
+  ADS1115_SCAN_IDLE,        // next channel is configured at the deadline
+  ADS1115_SCAN_SETTLING,    // mux is switched, conversion starts at the deadline
+  ADS1115_SCAN_CONVERTING,  // conversion is read out at the deadline
+  ADS1115_SCAN_DONE         // all channels of the cycle converted
+};
+
+struct ads1115_scan_device {
+  uint8_t iAddress;
+  int arrChannels[ADS1115_SCAN_MAX_CHANNELS];  // channel indices in scan order
+  int iChannelCnt;
+  int iPos;                                    // position in arrChannels
+  int iState;                                  // eAds1115ScanState
+  int64_t iDeadlineUs;
+  int64_t iConvStartUs;
+  uint16_t iConfigReg;                         // latest written configuration without OS bit
+  bool bConfigValid;
+};
+
+class ADS1115Scanner
+{
+  public:
+    ADS1115Scanner();
+    void setTransport(ADS1115Transport *);
+    bool setChannels(const ads1115_scan_channel *, int);
+    void setCyclePeriodUs(uint32_t);
+    void start(void);
+    int64_t service(void);
+    int getChannelCount(void);
+    int getDeviceCount(void);
+    bool getResult(int, ads1115_scan_result *);
+    uint32_t getCycleCount(void);
+    uint32_t getCycleTimeUs(void);
+    static uint32_t getConvTimeUs(uint8_t);
+    static float getLsbVolt(uint8_t);
+
+  private:
+    ADS1115Transport * _ptrTransport;
+    ads1115_scan_channel _arrChannels[ADS1115_SCAN_MAX_CHANNELS];
+    ads1115_scan_result _arrResults[ADS1115_SCAN_MAX_CHANNELS];
+    int _iChannelCnt;
+    ads1115_scan_device _arrDevices[ADS1115_SCAN_MAX_DEVICES];
+    int _iDeviceCnt;
+    uint32_t _iCyclePeriodUs;
+    int64_t _iCycleStartUs;
+    uint32_t _iCycleCnt;
+    uint32_t _iCycleTimeUs;
+    bool _bRunning;
+    void _startCycle(int64_t);
+    void _stepDevice(ads1115_scan_device *, int64_t);
+    void _nextChannel(ads1115_scan_device *, int64_t);
+    void _recordError(ads1115_scan_device *);
+    uint16_t _getConfigReg(const ads1115_scan_channel &);
+};
+
+#endif
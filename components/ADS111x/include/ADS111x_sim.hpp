@@ -0,0 +1,107 @@
+// Register level emulator of the ADS1115 for host builds. It implements the transport interface of the driver and
+// models the config register, PGA/LSB scaling, single-shot and continuous conversions with data rate timing, the
+// ALERT/RDY conversion ready pulse, gaussian input noise, a deviation of the internal oscillator and injected bus or
+// signal faults. Time is virtual: it advances with every I2C transaction, every delay and explicitly with
+// advanceTimeUs().
+
+#ifndef ADS1115_SIM_h
+#define ADS1115_SIM_h
+
+#include "ADS111x.hpp"
+
+#define ADS1115_SIM_TRANSACTION_US 100   // duration of one register access at 400 kHz
+#define ADS1115_SIM_TIMEOUT_US 50000     // duration of a transaction which runs into the bus timeout
+#define ADS1115_SIM_CONFIG_RESET 0x8583  // config register after power-up
+#define ADS1115_SIM_MUX_CNT 8            // number of input multiplexer settings
+#define ADS1115_SIM_BUS_MAX_DEVICES 4    // one device per address pin setting
+
+// injected faults, can be combined
+#define ADS1115_SIM_FAULT_NACK (1<<0)       // device does not acknowledge its address
+#define ADS1115_SIM_FAULT_TIMEOUT (1<<1)    // bus is stuck, transactions run into the timeout
+#define ADS1115_SIM_FAULT_FROZEN (1<<2)     // conversion register is no longer updated, RDY pulses continue
+#define ADS1115_SIM_FAULT_OPEN_INPUT (1<<3) // sensor wire is broken, input is driven to positive full scale
+
+// input voltage at the multiplexer output, time in us of the virtual time base
+typedef float (*ads1115_sim_input_fn)(int64_t i_time_us, uint8_t i_mux, void * ptr_ctx);
+// conversion ready pulse of the ALERT/RDY pin at the end of a conversion
+typedef void (*ads1115_sim_rdy_fn)(int64_t i_time_us, void * ptr_ctx);
+
+class ADS1115SimTransport : public ADS1115Transport
+{
+  public:
+    ADS1115SimTransport(uint8_t i_address = ADS1115_I2CADD_DEFAULT);
+    uint8_t getAddress(void);
+    esp_err_t init(int, int) override;
+    esp_err_t deinit(void) override;
+    esp_err_t readRegister(uint8_t, uint8_t, uint16_t *) override;
+    esp_err_t writeRegister(uint8_t, uint8_t, uint16_t) override;
+    void delayMs(uint32_t) override;
+    void delayUs(uint32_t) override;
+    int64_t getTimeUs(void) override;
+    void advanceTimeUs(int64_t);
+    void setInputVoltage(uint8_t, float);
+    void setInputFunction(ads1115_sim_input_fn, void *);
+    void setNoise(float, uint32_t);
+    void setClockError(float);
+    void setFaults(uint32_t);
+    uint32_t getFaults(void);
+    void setRdyCallback(ads1115_sim_rdy_fn, void *);
+    void setTransactionTimeUs(uint32_t);
+    uint32_t getConversionCount(void);
+    uint32_t getRdyPulseCount(void);
+    uint16_t peekRegister(uint8_t);
+
+  private:
+    uint8_t _iAddress;
+    int64_t _iTimeUs;
+    int64_t _iConvDoneUs;
+    uint16_t _arrRegisters[4];
+    float _arrInputVolt[ADS1115_SIM_MUX_CNT];
+    ads1115_sim_input_fn _fnInput;
+    void * _ptrInputCtx;
+    ads1115_sim_rdy_fn _fnRdy;
+    void * _ptrRdyCtx;
+    float _fNoiseSigma;
+    float _fClockError;
+    uint32_t _iRandState;
+    uint32_t _iFaults;
+    uint32_t _iTransactionUs;
+    uint32_t _iConvCnt;
+    uint32_t _iRdyPulseCnt;
+    void _runUntil(int64_t);
+    void _completeConversion(int64_t);
+    int64_t _getConvTimeUs(void);
+    float _getLsbVolt(void);
+    bool _isRdyModeActive(void);
+    float _getRandGauss(void);
+    esp_err_t _beginTransaction(uint8_t);
+};
+
+// Several emulated devices on one I2C bus with a common virtual time base. Transactions are dispatched by address,
+// all devices keep converting while another one is accessed. Addresses without a device are not acknowledged.
+class ADS1115SimBus : public ADS1115Transport
+{
+  public:
+    ADS1115SimBus();
+    bool addDevice(ADS1115SimTransport *);
+    esp_err_t init(int, int) override;
+    esp_err_t deinit(void) override;
+    esp_err_t readRegister(uint8_t, uint8_t, uint16_t *) override;
+    esp_err_t writeRegister(uint8_t, uint8_t, uint16_t) override;
+    void delayMs(uint32_t) override;
+    void delayUs(uint32_t) override;
+    int64_t getTimeUs(void) override;
+    void advanceTimeUs(int64_t);
+    uint32_t getTransactionCount(void);
+
+  private:
+    ADS1115SimTransport * _arrDevices[ADS1115_SIM_BUS_MAX_DEVICES];
+    uint8_t _arrAddresses[ADS1115_SIM_BUS_MAX_DEVICES];
+    int _iDeviceCnt;
+    int64_t _iTimeUs;
+    uint32_t _iTransactionCnt;
+    ADS1115SimTransport * _getDevice(uint8_t);
+    void _syncDevices(void);
+};
+
+#endif
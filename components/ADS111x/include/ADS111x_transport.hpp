@@ -0,0 +1,59 @@
+// Transport interface of the ADS1115 driver. All register access, delays and time stamps of the driver go through
+// a transport, so the driver, its filters and the physical conversion can run on ESP-IDF (I2C master) as well as on a
+// Linux host against the register emulator in ADS111x_sim.hpp.
+
+#ifndef ADS1115_TRANSPORT_h
+#define ADS1115_TRANSPORT_h
+
+#include <stdint.h>
+#include "ADS111x_platform.hpp"
+
+#ifdef ESP_PLATFORM
+#include "driver/i2c.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define ADS1115_I2C_PORT_NUM I2C_NUM_1 // I2C port number
+#define ADS1115_I2C_CLK_SPEED 400000   // I2C clock in Hz
+#endif
+
+class ADS1115Transport
+{
+  public:
+    virtual ~ADS1115Transport() {}
+    virtual esp_err_t init(int, int) = 0;
+    virtual esp_err_t deinit(void) = 0;
+    virtual esp_err_t readRegister(uint8_t, uint8_t, uint16_t *) = 0;
+    virtual esp_err_t writeRegister(uint8_t, uint8_t, uint16_t) = 0;
+    virtual void delayMs(uint32_t) = 0;
+    virtual void delayUs(uint32_t) = 0;
+    virtual int64_t getTimeUs(void) = 0;
+};
+
+#ifdef ESP_PLATFORM
+// ESP-IDF backend on the legacy I2C master driver
+class ADS1115IdfTransport : public ADS1115Transport
+{
+  public:
+    ADS1115IdfTransport(i2c_port_t i_port = ADS1115_I2C_PORT_NUM);
+    esp_err_t init(int, int) override;
+    esp_err_t deinit(void) override;
+    esp_err_t readRegister(uint8_t, uint8_t, uint16_t *) override;
+    esp_err_t writeRegister(uint8_t, uint8_t, uint16_t) override;
+    void delayMs(uint32_t) override;
+    void delayUs(uint32_t) override;
+    int64_t getTimeUs(void) override;
+
+  private:
+    static void delayTimerCallback(void *);
+
+    i2c_port_t _iPort;
+    esp_timer_handle_t _hDelayTimer;  // one-shot timer of delayUs, wakes the waiting task
+    TaskHandle_t _hDelayTask;         // task waiting in delayUs
+    volatile bool _bDelayExpired;     // set by the timer callback before the notification
+    volatile bool _bDelayNotified;    // set by the timer callback after the notification
+};
+#endif
+
+#endif
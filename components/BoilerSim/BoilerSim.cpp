@@ -0,0 +1,200 @@
+// Lumped thermal model of the espresso machine boiler, see BoilerSim.hpp
+
+#include <math.h>
+#include "BoilerSim.hpp"
+
+BoilerSim::BoilerSim() {
+  _objParams = getDefaultParams();
+  _fPwmDuty = 0.F;
+  _fPwmFreqHz = 15.F;
+  _fnGate = NULL;
+  _ptrGateCtx = NULL;
+  reset(_objParams.fAmbientTemp);
+}
+
+
+boiler_sim_params BoilerSim::getDefaultParams(void) {
+  /**
+   * Parameters of a Rancilio Silvia like single boiler machine (about 300 ml boiler, 1 kW heater)
+  */
+  boiler_sim_params obj_params;
+
+  obj_params.fHeaterPowerW = 1000.F;
+  obj_params.fHeaterCapJK = 150.F;
+  obj_params.fHeaterToWaterWK = 60.F;
+  obj_params.fWaterCapJK = 3000.F;
+  obj_params.fLossWK = 0.5F;
+  obj_params.fAmbientTemp = 20.F;
+  obj_params.fInletTemp = 20.F;
+  obj_params.fSensorTauS = 4.F;
+  obj_params.fMainsFreqHz = 50.F;
+  obj_params.fBridgeVoltage = 2.5F;
+
+  return obj_params;
+}
+
+
+void BoilerSim::setParams(const boiler_sim_params & obj_params) {
+  _objParams = obj_params;
+}
+
+
+void BoilerSim::reset(float f_temp) {
+  /**
+   * Restart the simulation with all heat capacities at the same temperature
+   * @param f_temp: start temperature in °C
+  */
+  _fTimeS = 0.;
+  _fNextZeroCrossS = 0.;
+  _fHeaterTemp = f_temp;
+  _fWaterTemp = f_temp;
+  _fSensorTemp = f_temp;
+  _bSsrOn = false;
+  _iSsrSwitchCnt = 0;
+  _fHeaterEnergyJ = 0.;
+  _fBrewFlowMlS = 0.F;
+  _fBrewEndS = 0.;
+}
+
+
+void BoilerSim::setSsrPwm(float f_duty, float f_freq_hz) {
+  /**
+   * Drive the SSR with a PWM signal, like the LEDC output of the controller
+   * @param f_duty: duty cycle 0..1
+   * @param f_freq_hz: PWM frequency (SsrFreq)
+  */
+  _fPwmDuty = (f_duty < 0.F) ? 0.F : ((f_duty > 1.F) ? 1.F : f_duty);
+  _fPwmFreqHz = f_freq_hz;
+}
+
+
+void BoilerSim::setGateFunction(boiler_sim_gate_fn fn_gate, void * ptr_ctx) {
+  /**
+   * Drive the SSR with a custom gate signal instead of the PWM, e.g. a burst fire driver
+   * @param fn_gate: gate function, called at every zero crossing, NULL to use the PWM again
+   * @param ptr_ctx: context passed to the function
+  */
+  _fnGate = fn_gate;
+  _ptrGateCtx = ptr_ctx;
+}
+
+
+void BoilerSim::startBrew(float f_flow_ml_s, float f_duration_s) {
+  /**
+   * Start a shot: cold water replaces hot water in the boiler
+   * @param f_flow_ml_s: water flow in ml/s
+   * @param f_duration_s: shot duration in s
+  */
+  _fBrewFlowMlS = f_flow_ml_s;
+  _fBrewEndS = _fTimeS + f_duration_s;
+}
+
+
+bool BoilerSim::isBrewing(void) {
+  return _fTimeS < _fBrewEndS;
+}
+
+
+bool BoilerSim::_getPwmGate(double f_time_s) {
+  double f_period_s = 1. / _fPwmFreqHz;
+  double f_phase_s = fmod(f_time_s, f_period_s);
+  return f_phase_s < _fPwmDuty * f_period_s;
+}
+
+
+void BoilerSim::step(double f_dt_s) {
+  /**
+   * Advance the simulation. The SSR state is latched at every zero crossing of the mains voltage and kept for the
+   * half wave, as a zero crossing SSR does.
+   * @param f_dt_s: time step in s
+  */
+  double f_end_s = _fTimeS + f_dt_s;
+  double f_half_wave_s = 0.5 / _objParams.fMainsFreqHz;
+
+  while (_fTimeS < f_end_s){
+    if (_fTimeS >= _fNextZeroCrossS){
+      bool b_gate = _fnGate ? _fnGate(_fTimeS, _ptrGateCtx) : _getPwmGate(_fTimeS);
+      if (b_gate != _bSsrOn){
+        _iSsrSwitchCnt++;
+      }
+      _bSsrOn = b_gate;
+      _fNextZeroCrossS += f_half_wave_s;
+    }
+
+    double f_sub_s = ((_fNextZeroCrossS < f_end_s) ? _fNextZeroCrossS : f_end_s) - _fTimeS;
+    _integrate((float)f_sub_s);
+    _fTimeS += f_sub_s;
+  }
+}
+
+
+void BoilerSim::_integrate(float f_dt_s) {
+  /**
+   * Explicit euler step of the heat balance, time steps are at most one half wave
+  */
+  float f_heater_w = _bSsrOn ? _objParams.fHeaterPowerW : 0.F;
+  float f_to_water_w = _objParams.fHeaterToWaterWK * (_fHeaterTemp - _fWaterTemp);
+  float f_loss_w = _objParams.fLossWK * (_fWaterTemp - _objParams.fAmbientTemp);
+  float f_brew_w = 0.F;
+
+  if (isBrewing()){
+    f_brew_w = _fBrewFlowMlS * BOILERSIM_WATER_HEAT_CAP * (_fWaterTemp - _objParams.fInletTemp);
+  }
+
+  _fHeaterTemp += (f_heater_w - f_to_water_w) / _objParams.fHeaterCapJK * f_dt_s;
+  _fWaterTemp += (f_to_water_w - f_loss_w - f_brew_w) / _objParams.fWaterCapJK * f_dt_s;
+  _fSensorTemp += (_fWaterTemp - _fSensorTemp) / _objParams.fSensorTauS * f_dt_s;
+  _fHeaterEnergyJ += f_heater_w * f_dt_s;
+}
+
+
+double BoilerSim::getTimeS(void) {
+  return _fTimeS;
+}
+
+
+float BoilerSim::getWaterTemp(void) {
+  return _fWaterTemp;
+}
+
+
+float BoilerSim::getHeaterTemp(void) {
+  return _fHeaterTemp;
+}
+
+
+float BoilerSim::getSensorTemp(void) {
+  return _fSensorTemp;
+}
+
+
+float BoilerSim::getSensorVoltage(void) {
+  return getBridgeVoltage(_fSensorTemp, _objParams.fBridgeVoltage);
+}
+
+
+double BoilerSim::getHeaterEnergyJ(void) {
+  return _fHeaterEnergyJ;
+}
+
+
+uint32_t BoilerSim::getSsrSwitchCount(void) {
+  return _iSsrSwitchCnt;
+}
+
+
+float BoilerSim::getPt1000Resistance(float f_temp) {
+  /**
+   * Callendar-Van Dusen equation for temperatures above 0 °C
+  */
+  return BOILERSIM_PT1000_R0 * (1.F + BOILERSIM_PT1000_A * f_temp + BOILERSIM_PT1000_B * f_temp * f_temp);
+}
+
+
+float BoilerSim::getBridgeVoltage(float f_temp, float f_excitation) {
+  /**
+   * Differential output of a quarter bridge with the Pt1000 and three R0 resistors
+  */
+  float f_resistance = getPt1000Resistance(f_temp);
+  return f_excitation * (f_resistance / (f_resistance + BOILERSIM_PT1000_R0) - 0.5F);
+}
@@ -0,0 +1,74 @@
+// Lumped thermal model of the espresso machine boiler for closed loop simulations. Two heat capacities (heater
+// element, water with boiler body) with losses to ambient, an SSR which switches at mains zero crossings, a first
+// order sensor lag and cold water inflow while a shot is pulled. The sensor is a Pt1000 in a quarter bridge, its
+// output voltage feeds the ADS1115 emulator.
+
+#ifndef BOILERSIM_h
+#define BOILERSIM_h
+
+#include <stdint.h>
+
+#define BOILERSIM_PT1000_R0 1000.F   // Pt1000 resistance at 0 °C and bridge resistors in Ohm
+#define BOILERSIM_PT1000_A 3.9083e-3F
+#define BOILERSIM_PT1000_B -5.775e-7F
+#define BOILERSIM_WATER_HEAT_CAP 4.186F // J/(g K)
+
+struct boiler_sim_params {
+  float fHeaterPowerW;      // heater power at full conduction
+  float fHeaterCapJK;       // heat capacity of the heater element
+  float fHeaterToWaterWK;   // thermal conductance heater -> water
+  float fWaterCapJK;        // heat capacity of water and boiler body
+  float fLossWK;            // thermal conductance boiler -> ambient
+  float fAmbientTemp;       // ambient temperature in °C
+  float fInletTemp;         // temperature of the water drawn into the boiler during a shot
+  float fSensorTauS;        // time constant of the sensor in its thermowell
+  float fMainsFreqHz;       // mains frequency, the SSR switches at zero crossings
+  float fBridgeVoltage;     // excitation voltage of the sensor bridge
+};
+
+// gate signal of the SSR at a zero crossing, t in s of simulation time
+typedef bool (*boiler_sim_gate_fn)(double f_time_s, void * ptr_ctx);
+
+class BoilerSim
+{
+  public:
+    BoilerSim();
+    static boiler_sim_params getDefaultParams(void);
+    void setParams(const boiler_sim_params &);
+    void reset(float);
+    void setSsrPwm(float, float);
+    void setGateFunction(boiler_sim_gate_fn, void *);
+    void startBrew(float, float);
+    bool isBrewing(void);
+    void step(double);
+    double getTimeS(void);
+    float getWaterTemp(void);
+    float getHeaterTemp(void);
+    float getSensorTemp(void);
+    float getSensorVoltage(void);
+    double getHeaterEnergyJ(void);
+    uint32_t getSsrSwitchCount(void);
+    static float getPt1000Resistance(float);
+    static float getBridgeVoltage(float, float);
+
+  private:
+    boiler_sim_params _objParams;
+    double _fTimeS;
+    double _fNextZeroCrossS;
+    float _fHeaterTemp;
+    float _fWaterTemp;
+    float _fSensorTemp;
+    float _fPwmDuty;
+    float _fPwmFreqHz;
+    boiler_sim_gate_fn _fnGate;
+    void * _ptrGateCtx;
+    bool _bSsrOn;
+    uint32_t _iSsrSwitchCnt;
+    double _fHeaterEnergyJ;
+    float _fBrewFlowMlS;
+    double _fBrewEndS;
+    bool _getPwmGate(double);
+    void _integrate(float);
+};
+
+#endif
@@ -0,0 +1,100 @@
+// Burst fire distribution of SSR half-waves, see BurstFire.hpp
+
+#include "BurstFire.hpp"
+
+BurstFire::BurstFire() {
+  _iLevel = 0;
+  _iResolution = 255;
+  _bDcBalance = true;
+  reset();
+}
+
+
+void BurstFire::setResolution(uint32_t i_steps) {
+  /**
+   * Set the number of half-waves M of a burst period
+   * @param i_steps: full power level, e.g. 255 to keep the scale of an 8 bit PWM duty
+  */
+  _iResolution = (i_steps > 0) ? i_steps : 1;
+  _iLevel = (_iLevel > _iResolution) ? _iResolution : _iLevel;
+}
+
+
+void BurstFire::setLevel(uint32_t i_level) {
+  /**
+   * Set the number of on half-waves N per M half-waves, takes effect with the next half-wave
+   * @param i_level: 0 (off) .. resolution (full power)
+  */
+  _iLevel = (i_level > _iResolution) ? _iResolution : i_level;
+}
+
+
+void BurstFire::setDcBalance(bool b_enable) {
+  /**
+   * Enable the deferral of on half-waves which would add DC, only meaningful if nextHalfWave() is called in step
+   * with the mains half-waves
+   * @param b_enable: true if the calls of nextHalfWave() alternate with the mains polarity
+  */
+  _bDcBalance = b_enable;
+  _iDcBalance = 0;
+}
+
+
+uint32_t BurstFire::getLevel(void) {
+  return _iLevel;
+}
+
+
+uint32_t BurstFire::getResolution(void) {
+  return _iResolution;
+}
+
+
+void BurstFire::reset(void) {
+  _iAccumulator = 0;
+  _bPositive = true;
+  _iDcBalance = 0;
+  _iHalfWaveCnt = 0;
+  _iOnCnt = 0;
+}
+
+
+bool BurstFire::nextHalfWave(void) {
+  /**
+   * Decide the gate of the next half-wave, called once per half-wave (at the zero crossing or by a timer with the
+   * period of a half-wave). Runs in interrupt context, no floating point.
+   * @return: true if the SSR conducts during the next half-wave
+  */
+  uint32_t i_level = _iLevel;
+  uint32_t i_resolution = _iResolution;
+  int i_polarity = _bPositive ? 1 : -1;
+  bool b_gate = false;
+
+  _bPositive = !_bPositive;
+  _iHalfWaveCnt++;
+
+  _iAccumulator += i_level;
+  if (_iAccumulator >= i_resolution){
+    if (!_bDcBalance || i_level >= i_resolution || (_iDcBalance + i_polarity) * i_polarity <= 1){
+      // full power is DC free anyway
+      _iAccumulator -= i_resolution;
+      _iDcBalance = (!_bDcBalance || i_level >= i_resolution) ? 0 : _iDcBalance + i_polarity;
+      b_gate = true;
+      _iOnCnt++;
+    } else {
+      // same polarity as the previous on half-wave, switched with the next one
+      _iAccumulator = (_iAccumulator > 2 * i_resolution) ? 2 * i_resolution : _iAccumulator;
+    }
+  }
+  return b_gate;
+}
+
+
+uint32_t BurstFire::getHalfWaveCount(void) {
+  return _iHalfWaveCnt;
+}
+
+
+uint32_t BurstFire::getOnCount(void) {
+  return _iOnCnt;
+}
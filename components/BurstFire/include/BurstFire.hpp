@@ -0,0 +1,37 @@
+// Burst fire (cycle skipping) distribution of SSR half-waves. N out of M mains half-waves are switched on, spread
+// evenly with a Bresenham accumulator, so the delivered heater energy is linear in N with a resolution of 1/M. An
+// on half-wave is deferred by one half-wave if it would make the sum of switched polarities exceed one, which keeps
+// the heater current free of DC. The balance needs half-wave steps locked to the mains; a free-running half-wave
+// clock has no known polarity and disables it with setDcBalance(false).
+
+#ifndef BURSTFIRE_h
+#define BURSTFIRE_h
+
+#include <stdint.h>
+
+class BurstFire
+{
+  public:
+    BurstFire();
+    void setResolution(uint32_t);
+    void setLevel(uint32_t);
+    void setDcBalance(bool);
+    uint32_t getLevel(void);
+    uint32_t getResolution(void);
+    void reset(void);
+    bool nextHalfWave(void);
+    uint32_t getHalfWaveCount(void);
+    uint32_t getOnCount(void);
+
+  private:
+    volatile uint32_t _iLevel;
+    volatile uint32_t _iResolution;
+    uint32_t _iAccumulator;
+    bool _bPositive;
+    int _iDcBalance;
+    volatile bool _bDcBalance;
+    uint32_t _iHalfWaveCnt;
+    uint32_t _iOnCnt;
+};
+
+#endif
@@ -0,0 +1,327 @@
+// Brew shot detection and feed-forward heater boost, see BrewDetector.hpp
+
+#include <string.h>
+#include "BrewDetector.hpp"
+
+BrewDetector::BrewDetector() {
+  _objParams = getDefaultParams();
+  _fTarget = 0.F;
+  reset();
+}
+
+
+brew_params BrewDetector::getDefaultParams(void) {
+  /**
+   * Parameters for a single boiler machine with about 2 ml/s shot flow, the boost covers most of the heat taken by
+   * the inflowing cold water (about 600 W for 25 s) at 255 full scale output.
+  */
+  brew_params obj_params;
+
+  obj_params.bSlopeDetect = true;
+  obj_params.fSlopeThresh = 0.1F;
+  obj_params.fDropThresh = 0.3F;
+  obj_params.fSlopeBand = 3.F;
+  obj_params.bSwitchDetect = false;
+  obj_params.fShotDurationS = 25.F;
+  obj_params.fBoost = 150.F;
+  obj_params.fBoostHoldS = 15.F;
+  obj_params.fBoostRampS = 10.F;
+  obj_params.fRecoveryBand = 0.5F;
+  obj_params.fMaxRecoveryS = 300.F;
+  obj_params.fHoldoffS = 30.F;
+  obj_params.fTraceIntervalS = 1.F;
+
+  return obj_params;
+}
+
+
+void BrewDetector::setParams(const brew_params & obj_params) {
+  _objParams = obj_params;
+}
+
+
+void BrewDetector::setTarget(float f_target) {
+  /**
+   * Set target temperature of the controller, reference of detection band, dip and recovery
+  */
+  _fTarget = f_target;
+}
+
+
+void BrewDetector::reset(void) {
+  /**
+   * Clear detection state, shot statistics and traces
+  */
+  _iState = BREW_STATE_IDLE;
+  _iSlopeIdx = 0;
+  _iSlopeCnt = 0;
+  _fSlope = 0.F;
+  _iDropIdx = 0;
+  _iDropCnt = 0;
+  _fDrop = 0.F;
+  _bPrevSwitch = false;
+  _fPrevTimeS = -1.;
+  _fRecoveredS = -1e9;
+  _fFeedForward = 0.F;
+  _objShot = {};
+  _fShotEndS = 0.;
+  _iShotCnt = 0;
+  _iPreTraceIdx = 0;
+  _iPreTraceCnt = 0;
+  _iTraceCnt = 0;
+  _iTracePreCnt = 0;
+  _iTraceShot = 0;
+  _fNextTraceS = 0.;
+}
+
+
+float BrewDetector::update(double f_time_s, float f_actual, bool b_switch) {
+  /**
+   * Process a sample
+   * @param f_time_s: monotonic sample time in s
+   * @param f_actual: filtered temperature in °C
+   * @param b_switch: state of the pump/brew switch, ignored if switch detection is deactivated
+   * @return: feed-forward part which is added to the controller output
+  */
+  float f_dt_s = (_fPrevTimeS < 0.) ? 0.F : (float)(f_time_s - _fPrevTimeS);
+  bool b_switch_on = _objParams.bSwitchDetect && b_switch && !_bPrevSwitch;
+  bool b_switch_off = _objParams.bSwitchDetect && !b_switch && _bPrevSwitch;
+
+  _fPrevTimeS = f_time_s;
+  _bPrevSwitch = b_switch;
+  _updateSlope(f_time_s, f_actual);
+  _updateDrop(f_actual);
+
+  switch (_iState){
+    case BREW_STATE_IDLE:
+    {
+      bool b_fast_drop = _iSlopeCnt == BREW_SLOPE_WINDOW && _fSlope < -_objParams.fSlopeThresh;
+      bool b_deep_drop = _objParams.fDropThresh > 0.F && _iDropCnt == BREW_DROP_WINDOW &&
+                         _fDrop > _objParams.fDropThresh;
+      if (b_switch_on){
+        _startShot(f_time_s, f_actual, true);
+      } else if (_objParams.bSlopeDetect && (b_fast_drop || b_deep_drop) &&
+                 f_actual > _fTarget - _objParams.fSlopeBand && f_time_s - _fRecoveredS >= _objParams.fHoldoffS){
+        _startShot(f_time_s, f_actual, false);
+      }
+      break;
+    }
+
+    case BREW_STATE_BREWING:
+      if (_objShot.bSwitchTriggered ? b_switch_off : (f_time_s - _objShot.fStartS >= _objParams.fShotDurationS)){
+        _objShot.fDurationS = (float)(f_time_s - _objShot.fStartS);
+        _fShotEndS = f_time_s;
+        _iState = BREW_STATE_RECOVERING;
+      }
+      break;
+
+    case BREW_STATE_RECOVERING:
+      if (b_switch_on){
+        // next shot before the recovery of the previous one
+        _finishShot(-1.F);
+        _startShot(f_time_s, f_actual, true);
+      } else if (f_actual >= _fTarget - _objParams.fRecoveryBand){
+        _finishShot((float)(f_time_s - _objShot.fStartS));
+        _fRecoveredS = f_time_s;
+      } else if (f_time_s - _objShot.fStartS > _objParams.fMaxRecoveryS){
+        _finishShot(-1.F);
+        _fRecoveredS = f_time_s;
+      }
+      break;
+  }
+
+  // the boost profile runs from the detection until the temperature is recovered
+  _fFeedForward = 0.F;
+  if (_iState != BREW_STATE_IDLE){
+    _objShot.fMinTemp = (f_actual < _objShot.fMinTemp) ? f_actual : _objShot.fMinTemp;
+    _fFeedForward = _getBoost(f_time_s - _objShot.fStartS);
+    _objShot.fBoostIntegral += _fFeedForward * f_dt_s;
+  }
+
+  _updateTrace(f_time_s, f_actual);
+  return _fFeedForward;
+}
+
+
+void BrewDetector::_updateSlope(double f_time_s, float f_actual) {
+  /**
+   * Least squares slope over the latest samples, times are relative to the newest sample for float precision
+  */
+  _arrSlopeTime[_iSlopeIdx] = f_time_s;
+  _arrSlopeValue[_iSlopeIdx] = f_actual;
+  _iSlopeIdx = (_iSlopeIdx + 1) % BREW_SLOPE_WINDOW;
+  _iSlopeCnt = (_iSlopeCnt < BREW_SLOPE_WINDOW) ? _iSlopeCnt + 1 : BREW_SLOPE_WINDOW;
+
+  if (_iSlopeCnt < 2){
+    _fSlope = 0.F;
+    return;
+  }
+
+  float f_sum_t = 0.F;
+  float f_sum_x = 0.F;
+  float f_sum_tt = 0.F;
+  float f_sum_tx = 0.F;
+
+  for (int i_idx=0; i_idx<_iSlopeCnt; i_idx++){
+    float f_t = (float)(_arrSlopeTime[i_idx] - f_time_s);
+    f_sum_t += f_t;
+    f_sum_x += _arrSlopeValue[i_idx];
+    f_sum_tt += f_t * f_t;
+    f_sum_tx += f_t * _arrSlopeValue[i_idx];
+  }
+
+  float f_denom = _iSlopeCnt * f_sum_tt - f_sum_t * f_sum_t;
+  _fSlope = (f_denom > 0.F) ? (_iSlopeCnt * f_sum_tx - f_sum_t * f_sum_x) / f_denom : 0.F;
+}
+
+
+void BrewDetector::_updateDrop(float f_actual) {
+  /**
+   * Depth of the actual value below the maximum of the latest samples
+  */
+  _arrDropValue[_iDropIdx] = f_actual;
+  _iDropIdx = (_iDropIdx + 1) % BREW_DROP_WINDOW;
+  _iDropCnt = (_iDropCnt < BREW_DROP_WINDOW) ? _iDropCnt + 1 : BREW_DROP_WINDOW;
+
+  float f_max = f_actual;
+  for (int i_idx=0; i_idx<_iDropCnt; i_idx++){
+    f_max = (_arrDropValue[i_idx] > f_max) ? _arrDropValue[i_idx] : f_max;
+  }
+  _fDrop = f_max - f_actual;
+}
+
+
+void BrewDetector::_updateTrace(double f_time_s, float f_actual) {
+  /**
+   * Decimate the signal to the trace interval. Between shots the samples go to the pre-trigger ring, after a
+   * detection to the trace until it is full.
+  */
+  if (f_time_s < _fNextTraceS){
+    return;
+  }
+  _fNextTraceS = f_time_s + _objParams.fTraceIntervalS;
+
+  if (_iTraceShot == _objShot.iShotNumber && _iTraceCnt > 0 && _iTraceCnt < BREW_TRACE_LEN){
+    _arrTrace[_iTraceCnt++] = f_actual;
+    return;
+  }
+
+  _arrPreTrace[_iPreTraceIdx] = f_actual;
+  _iPreTraceIdx = (_iPreTraceIdx + 1) % BREW_TRACE_PRE_CNT;
+  _iPreTraceCnt = (_iPreTraceCnt < BREW_TRACE_PRE_CNT) ? _iPreTraceCnt + 1 : BREW_TRACE_PRE_CNT;
+}
+
+
+void BrewDetector::_startShot(double f_time_s, float f_actual, bool b_switch) {
+  _objShot = {};
+  _objShot.iShotNumber = _iShotCnt + 1;
+  _objShot.fStartS = f_time_s;
+  _objShot.bSwitchTriggered = b_switch;
+  _objShot.fStartTemp = f_actual;
+  _objShot.fMinTemp = f_actual;
+  _objShot.fRecoveryS = -1.F;
+  _iState = BREW_STATE_BREWING;
+
+  // the trace starts with the pre-trigger samples in chronological order
+  _iTraceCnt = 0;
+  for (int i_idx=0; i_idx<_iPreTraceCnt; i_idx++){
+    _arrTrace[_iTraceCnt++] = _arrPreTrace[(_iPreTraceIdx - _iPreTraceCnt + i_idx + BREW_TRACE_PRE_CNT) %
+                                           BREW_TRACE_PRE_CNT];
+  }
+  _iTracePreCnt = _iTraceCnt;
+  _arrTrace[_iTraceCnt++] = f_actual;
+  _iTraceShot = _objShot.iShotNumber;
+  _iPreTraceCnt = 0;
+  _fNextTraceS = f_time_s + _objParams.fTraceIntervalS;
+}
+
+
+void BrewDetector::_finishShot(float f_recovery_s) {
+  /**
+   * Store the statistics of the current shot in the history
+   * @param f_recovery_s: recovery time, -1 if not recovered
+  */
+  if (_iState == BREW_STATE_BREWING){
+    _objShot.fDurationS = (float)(_fPrevTimeS - _objShot.fStartS);
+  }
+  _objShot.fDip = _fTarget - _objShot.fMinTemp;
+  _objShot.fRecoveryS = f_recovery_s;
+  _arrShots[_iShotCnt % BREW_SHOT_HISTORY] = _objShot;
+  _iShotCnt++;
+  _iState = BREW_STATE_IDLE;
+}
+
+
+float BrewDetector::_getBoost(double f_shot_time_s) {
+  /**
+   * Boost profile: constant during the hold time, then a linear ramp down to 0
+  */
+  if (f_shot_time_s < _objParams.fBoostHoldS){
+    return _objParams.fBoost;
+  }
+  if (f_shot_time_s < _objParams.fBoostHoldS + _objParams.fBoostRampS){
+    return _objParams.fBoost * (1.F - (float)(f_shot_time_s - _objParams.fBoostHoldS) / _objParams.fBoostRampS);
+  }
+  return 0.F;
+}
+
+
+int BrewDetector::getState(void) {
+  return _iState;
+}
+
+
+float BrewDetector::getSlope(void) {
+  return _fSlope;
+}
+
+
+float BrewDetector::getFeedForward(void) {
+  return _fFeedForward;
+}
+
+
+uint32_t BrewDetector::getShotCount(void) {
+  return _iShotCnt;
+}
+
+
+bool BrewDetector::getShot(int i_idx, brew_shot * ptr_shot) {
+  /**
+   * Get the statistics of a finished shot
+   * @param i_idx: 0 for the latest shot, up to BREW_SHOT_HISTORY - 1
+   * @param ptr_shot: shot statistics
+   * @return: false if the shot is not in the history
+  */
+  if (i_idx < 0 || i_idx >= BREW_SHOT_HISTORY || (uint32_t)i_idx >= _iShotCnt){
+    return false;
+  }
+  *ptr_shot = _arrShots[(_iShotCnt - 1 - i_idx) % BREW_SHOT_HISTORY];
+  return true;
+}
+
+
+int BrewDetector::getTrace(float * arr_trace, int i_max_cnt, float * ptr_interval_s, uint32_t * ptr_shot_number) {
+  /**
+   * Get the temperature trace of the latest shot, it starts BREW_TRACE_PRE_CNT samples before the detection
+   * @param arr_trace: trace samples
+   * @param i_max_cnt: size of arr_trace
+   * @param ptr_interval_s: sample interval in s
+   * @param ptr_shot_number: number of the traced shot, 0 if no shot is recorded yet
+   * @return: number of samples
+  */
+  int i_cnt = (_iTraceCnt < i_max_cnt) ? _iTraceCnt : i_max_cnt;
+
+  memcpy(arr_trace, _arrTrace, i_cnt * sizeof(float));
+  *ptr_interval_s = _objParams.fTraceIntervalS;
+  *ptr_shot_number = _iTraceShot;
+  return i_cnt;
+}
+
+
+int BrewDetector::getTracePreCount(void) {
+  /**
+   * Number of trace samples before the detection, the following sample is taken at the detection
+  */
+  return _iTracePreCnt;
+}
@@ -0,0 +1,349 @@
+// Sensor fault manager of the heater control, see FaultManager.hpp
+
+#include <math.h>
+#include "FaultManager.hpp"
+
+FaultManager::FaultManager() {
+  _objParams = getDefaultParams();
+  reset();
+}
+
+
+fault_params FaultManager::getDefaultParams(void) {
+  /**
+   * Limits of a single boiler machine with 8 bit heater output
+  */
+  fault_params obj_params;
+
+  obj_params.fOutputMax = 255.F;
+  obj_params.fTempMin = 5.F;
+  obj_params.fTempMax = 160.F;
+  obj_params.fOverTemp = 140.F;
+  obj_params.fOverTempHyst = 5.F;
+  obj_params.fFrozenS = 60.F;
+  obj_params.fFrozenBand = 0.F;
+  obj_params.fSignalLimpS = 2.F;
+  obj_params.fCapOutput = 0.5F;
+  obj_params.fLimpMaxS = 600.F;
+  obj_params.fLimpMaxOutput = 0.15F;
+  obj_params.fHoldBand = 1.F;
+  obj_params.fHoldTauS = 120.F;
+  obj_params.fPlausWindowS = 60.F;
+  obj_params.fPlausOnOutput = 0.9F;
+  obj_params.fPlausMinMove = 1.F;
+  obj_params.fPlausOffOutput = 0.02F;
+  obj_params.fPlausMaxRise = 3.F;
+  obj_params.fRecoveryS = 5.F;
+
+  return obj_params;
+}
+
+
+const char * FaultManager::getFaultName(int i_code) {
+  static const char * arr_names[FAULT_CNT] = {"i2c_error", "no_sample", "value_frozen", "temp_range", "over_temp",
+                                              "no_heat_response", "uncommanded_heat", "limp_timeout"};
+  return (i_code >= 0 && i_code < FAULT_CNT) ? arr_names[i_code] : NULL;
+}
+
+
+const char * FaultManager::getActionName(int i_action) {
+  static const char * arr_names[] = {"none", "cap", "limp", "off"};
+  return (i_action >= FAULT_ACTION_NONE && i_action <= FAULT_ACTION_OFF) ? arr_names[i_action] : NULL;
+}
+
+
+void FaultManager::setParams(const fault_params & obj_params) {
+  _objParams = obj_params;
+}
+
+
+void FaultManager::reset(void) {
+  /**
+   * Clear all faults, the latched codes and the learned holding output
+  */
+  _iActiveMask = 0;
+  _iLatchedMask = 0;
+  for (int i_code = 0; i_code < FAULT_CNT; i_code++){
+    _arrEntries[i_code].iCount = 0;
+    _arrEntries[i_code].fFirstS = 0.;
+    _arrEntries[i_code].fLastS = 0.;
+    _arrSeenS[i_code] = 0.;
+  }
+  _iAction = FAULT_ACTION_NONE;
+  _bSampleUsable = false;
+  _fPrevTimeS = 0.;
+  _bPrevValid = false;
+  _bFlatValid = false;
+  _bWinValid = false;
+  _fLimpStartS = -1.;
+  _fHoldOutput = 0.F;
+  _bHoldValid = false;
+  _fBandStartS = -1.;
+}
+
+
+int FaultManager::update(const fault_input & obj_input) {
+  /**
+   * Check a control cycle, called for every sample and for every sample timeout
+   * @param obj_input: sample and heater output of the cycle
+   * @return: safe-state action, eFaultAction
+  */
+  double f_time_s = obj_input.fTimeS;
+  float f_dt_s = _bPrevValid ? (float)(f_time_s - _fPrevTimeS) : 0.F;
+  uint32_t i_conditions = 0;
+  bool b_temp_valid = obj_input.bSample && !obj_input.bI2cError;
+  float f_temp = obj_input.fTemperature;
+
+  _fPrevTimeS = f_time_s;
+  _bPrevValid = true;
+
+  if (!obj_input.bSample){
+    i_conditions |= FAULT_BIT(FAULT_NO_SAMPLE);
+  } else if (obj_input.bI2cError){
+    i_conditions |= FAULT_BIT(FAULT_I2C_ERROR);
+  }
+
+  if (b_temp_valid){
+    if (!(f_temp >= _objParams.fTempMin && f_temp <= _objParams.fTempMax)){
+      i_conditions |= FAULT_BIT(FAULT_TEMP_RANGE);
+    } else {
+      float f_over_temp = (_iActiveMask & FAULT_BIT(FAULT_OVER_TEMP)) ?
+                          _objParams.fOverTemp - _objParams.fOverTempHyst : _objParams.fOverTemp;
+      if (f_temp > f_over_temp){
+        i_conditions |= FAULT_BIT(FAULT_OVER_TEMP);
+      }
+      if (_checkFlatline(f_time_s, f_temp) || obj_input.bFrozen){
+        i_conditions |= FAULT_BIT(FAULT_VALUE_FROZEN);
+      }
+    }
+  }
+  // the filter of the driver still holds faulty conversions until the signal faults are recovered
+  _bSampleUsable = b_temp_valid && !((i_conditions | _iActiveMask) & FAULT_SIGNAL_MASK);
+  if (!b_temp_valid){
+    // the flatline window restarts after a dropout
+    _bFlatValid = false;
+  }
+  i_conditions |= _checkPlausibility(obj_input, f_dt_s);
+
+  // raise new faults, signal faults clear after the recovery time without the condition
+  for (int i_code = 0; i_code < FAULT_CNT; i_code++){
+    if (i_conditions & FAULT_BIT(i_code)){
+      if (!(_iActiveMask & FAULT_BIT(i_code))){
+        _activate(i_code, f_time_s);
+      }
+      _arrSeenS[i_code] = f_time_s;
+    } else if ((_iActiveMask & FAULT_BIT(i_code)) && !_isSticky(i_code) &&
+               f_time_s - _arrSeenS[i_code] >= _objParams.fRecoveryS){
+      _iActiveMask &= ~FAULT_BIT(i_code);
+    }
+  }
+
+  int i_action = FAULT_ACTION_NONE;
+  for (int i_code = 0; i_code < FAULT_CNT; i_code++){
+    if (_iActiveMask & FAULT_BIT(i_code)){
+      int i_code_action = _getCodeAction(i_code);
+      i_action = (i_code_action > i_action) ? i_code_action : i_action;
+    }
+  }
+
+  // limp mode runs open loop and is therefore limited in time
+  if (i_action == FAULT_ACTION_LIMP){
+    if (_fLimpStartS < 0.){
+      _fLimpStartS = f_time_s;
+    } else if (f_time_s - _fLimpStartS > _objParams.fLimpMaxS){
+      _activate(FAULT_LIMP_TIMEOUT, f_time_s);
+      i_action = FAULT_ACTION_OFF;
+    }
+  } else if (i_action < FAULT_ACTION_LIMP){
+    _fLimpStartS = -1.;
+  }
+
+  // holding output of fault-free operation for the limp mode, learned once the temperature settled around the target
+  if (_iActiveMask == 0 && _bSampleUsable && !obj_input.bBrewing && fabsf(f_temp - obj_input.fTarget) < _objParams.fHoldBand){
+    if (_fBandStartS < 0.){
+      _fBandStartS = f_time_s;
+    }
+  } else {
+    _fBandStartS = -1.;
+  }
+  if (_fBandStartS >= 0. && f_time_s - _fBandStartS >= _objParams.fHoldTauS && f_dt_s > 0.F){
+    float f_output = obj_input.fOutput / _objParams.fOutputMax;
+    _fHoldOutput = _bHoldValid ? _fHoldOutput + (f_output - _fHoldOutput) * fminf(f_dt_s / _objParams.fHoldTauS, 1.F) :
+                   f_output;
+    _bHoldValid = true;
+  }
+
+  _iAction = i_action;
+  return i_action;
+}
+
+
+bool FaultManager::isSampleUsable(void) {
+  /**
+   * true if the temperature of the latest cycle may be fed to the controller
+  */
+  return _bSampleUsable;
+}
+
+
+float FaultManager::limitOutput(float f_output) {
+  /**
+   * Apply the safe-state action of the latest cycle
+   * @param f_output: controller output, or the previous output if the sample is not usable
+   * @return: heater output
+  */
+  switch (_iAction){
+    case FAULT_ACTION_CAP:
+      return fminf(f_output, _objParams.fCapOutput * _objParams.fOutputMax);
+    case FAULT_ACTION_LIMP:
+      return fminf(_fHoldOutput, _objParams.fLimpMaxOutput) * _objParams.fOutputMax;
+    case FAULT_ACTION_OFF:
+      return 0.F;
+    default:
+      return f_output;
+  }
+}
+
+
+int FaultManager::getAction(void) {
+  return _iAction;
+}
+
+
+uint32_t FaultManager::getActiveMask(void) {
+  return _iActiveMask;
+}
+
+
+uint32_t FaultManager::getLatchedMask(void) {
+  return _iLatchedMask;
+}
+
+
+bool FaultManager::getEntry(int i_code, fault_entry * ptr_entry) {
+  if (i_code < 0 || i_code >= FAULT_CNT){
+    return false;
+  }
+  *ptr_entry = _arrEntries[i_code];
+  return true;
+}
+
+
+float FaultManager::getHoldOutput(void) {
+  /**
+   * Learned holding output as fraction of the output range, 0 if not yet learned
+  */
+  return _fHoldOutput;
+}
+
+
+void FaultManager::clear(void) {
+  /**
+   * Acknowledge the faults: sticky faults are cleared, the latched codes are reduced to the active faults. Counts and
+   * times of the entries are kept.
+  */
+  for (int i_code = 0; i_code < FAULT_CNT; i_code++){
+    if (_isSticky(i_code)){
+      _iActiveMask &= ~FAULT_BIT(i_code);
+    }
+  }
+  _iLatchedMask = _iActiveMask;
+  _bWinValid = false;
+  _fLimpStartS = -1.;
+}
+
+
+bool FaultManager::_checkFlatline(double f_time_s, float f_temp) {
+  /**
+   * Track the temperature span since the latest change beyond the band
+   * @return: true if the temperature stayed within the band for fFrozenS
+  */
+  if (_bFlatValid){
+    _fFlatMin = fminf(_fFlatMin, f_temp);
+    _fFlatMax = fmaxf(_fFlatMax, f_temp);
+  }
+  if (!_bFlatValid || _fFlatMax - _fFlatMin > _objParams.fFrozenBand){
+    _fFlatStartS = f_time_s;
+    _fFlatMin = f_temp;
+    _fFlatMax = f_temp;
+    _bFlatValid = true;
+  }
+  return f_time_s - _fFlatStartS >= _objParams.fFrozenS;
+}
+
+
+uint32_t FaultManager::_checkPlausibility(const fault_input & obj_input, float f_dt_s) {
+  /**
+   * Compare the temperature course with the mean heater output over a window. The window restarts on unusable
+   * samples and during shots, when cold water inflow dominates the temperature course.
+   * @return: plausibility fault conditions at the end of a window
+  */
+  uint32_t i_conditions = 0;
+
+  if (!_bSampleUsable || obj_input.bBrewing){
+    _bWinValid = false;
+    return 0;
+  }
+  if (!_bWinValid){
+    _fWinTimeS = 0.;
+    _fWinOutput = 0.;
+    _fWinStartTemp = obj_input.fTemperature;
+    _bWinValid = true;
+    return 0;
+  }
+
+  _fWinTimeS += f_dt_s;
+  _fWinOutput += obj_input.fOutput * f_dt_s;
+  if (_fWinTimeS < _objParams.fPlausWindowS){
+    return 0;
+  }
+
+  float f_mean_output = (float)(_fWinOutput / _fWinTimeS) / _objParams.fOutputMax;
+  float f_move = obj_input.fTemperature - _fWinStartTemp;
+
+  // a falling temperature at high output is real cooling, e.g. hot water drawn, a flat one is not
+  if (f_mean_output >= _objParams.fPlausOnOutput && fabsf(f_move) < _objParams.fPlausMinMove){
+    i_conditions |= FAULT_BIT(FAULT_NO_HEAT_RESPONSE);
+  }
+  if (f_mean_output <= _objParams.fPlausOffOutput && f_move > _objParams.fPlausMaxRise){
+    i_conditions |= FAULT_BIT(FAULT_UNCOMMANDED_HEAT);
+  }
+  _bWinValid = false;
+  return i_conditions;
+}
+
+
+void FaultManager::_activate(int i_code, double f_time_s) {
+  if (_arrEntries[i_code].iCount == 0){
+    _arrEntries[i_code].fFirstS = f_time_s;
+  }
+  _arrEntries[i_code].iCount++;
+  _arrEntries[i_code].fLastS = f_time_s;
+  _arrSeenS[i_code] = f_time_s;
+  _iActiveMask |= FAULT_BIT(i_code);
+  _iLatchedMask |= FAULT_BIT(i_code);
+}
+
+
+int FaultManager::_getCodeAction(int i_code) {
+  /**
+   * Safe-state policy per fault
+  */
+  switch (i_code){
+    case FAULT_I2C_ERROR:
+    case FAULT_NO_SAMPLE:
+      // short dropouts hold the output, persistent ones lose the feedback
+      return (_arrSeenS[i_code] - _arrEntries[i_code].fLastS < _objParams.fSignalLimpS) ? FAULT_ACTION_CAP :
+             FAULT_ACTION_LIMP;
+    case FAULT_VALUE_FROZEN:
+    case FAULT_TEMP_RANGE:
+      return FAULT_ACTION_LIMP;
+    default:
+      return FAULT_ACTION_OFF;
+  }
+}
+
+
+bool FaultManager::_isSticky(int i_code) {
+  return i_code == FAULT_NO_HEAT_RESPONSE || i_code == FAULT_UNCOMMANDED_HEAT || i_code == FAULT_LIMP_TIMEOUT;
+}
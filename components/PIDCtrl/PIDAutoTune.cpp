@@ -0,0 +1,254 @@
+// Relay feedback auto tuner, see PIDAutoTune.hpp
+
+#include <math.h>
+#include <stddef.h>
+#include "PIDAutoTune.hpp"
+
+PIDAutoTune::PIDAutoTune() {
+  _iState = AUTOTUNE_STATE_IDLE;
+  _iError = AUTOTUNE_ERROR_NONE;
+  _iRule = AUTOTUNE_RULE_ZN_PID;
+  _fTarget = 0.F;
+  _fOutLow = 0.F;
+  _fOutHigh = 0.F;
+  _fHysteresis = 0.F;
+  _fMaxValue = 0.F;
+  _fTimeoutS = 0.F;
+  _iCyclesRequired = 0;
+  _fElapsedS = 0.F;
+  _bOutputHigh = false;
+  _iSwitchCnt = 0;
+  _fCycleStartS = 0.F;
+  _fCycleMax = 0.F;
+  _fCycleMin = 0.F;
+  _iCycleCnt = 0;
+  _objResult = {};
+}
+
+
+void PIDAutoTune::start(float f_target, float f_out_low, float f_out_high, float f_hysteresis, int i_cycles,
+                        int i_rule, float f_timeout_s, float f_max_value) {
+  /**
+   * Start the relay experiment
+   * @param f_target: target value the plant oscillates around, e.g. boiler temperature in °C
+   * @param f_out_low: relay output below the switching point, e.g. 0 for heater off
+   * @param f_out_high: relay output above the switching point, e.g. full heater power
+   * @param f_hysteresis: relay switches on at target - hysteresis and off at target + hysteresis, must exceed the noise
+   * @param i_cycles: number of evaluated cycles, the heat-up and the first relay cycle are discarded additionally
+   * @param i_rule: tuning rule, see eAutoTuneRule
+   * @param f_timeout_s: experiment fails if the cycles are not completed within this time
+   * @param f_max_value: experiment fails if the actual value exceeds this safety limit
+  */
+  _fTarget = f_target;
+  _fOutLow = f_out_low;
+  _fOutHigh = f_out_high;
+  _fHysteresis = (f_hysteresis > 0.F) ? f_hysteresis : 0.F;
+  _iCyclesRequired = (i_cycles < 1) ? 1 : ((i_cycles > AUTOTUNE_MAX_CYCLES) ? AUTOTUNE_MAX_CYCLES : i_cycles);
+  _iRule = (i_rule >= 0 && i_rule < AUTOTUNE_RULE_CNT) ? i_rule : AUTOTUNE_RULE_ZN_PID;
+  _fTimeoutS = f_timeout_s;
+  _fMaxValue = f_max_value;
+
+  _fElapsedS = 0.F;
+  _bOutputHigh = true;
+  _iSwitchCnt = 0;
+  _fCycleStartS = 0.F;
+  _fCycleMax = -INFINITY;
+  _fCycleMin = INFINITY;
+  _iCycleCnt = 0;
+  _objResult = {};
+  _iError = AUTOTUNE_ERROR_NONE;
+  _iState = AUTOTUNE_STATE_RUNNING;
+}
+
+
+void PIDAutoTune::abort(void) {
+  if (_iState == AUTOTUNE_STATE_RUNNING){
+    _fail(AUTOTUNE_ERROR_ABORTED);
+  }
+}
+
+
+float PIDAutoTune::update(float f_actual, float f_dt_s) {
+  /**
+   * Run one step of the relay experiment
+   * @param f_actual: actual value, should be the filtered signal
+   * @param f_dt_s: time since the last update in s
+   * @return: manipulated variable, the lower output if the experiment is not running
+  */
+  if (_iState != AUTOTUNE_STATE_RUNNING){
+    return _fOutLow;
+  }
+
+  _fElapsedS += (f_dt_s > 0.F) ? f_dt_s : 0.F;
+
+  if (f_actual > _fMaxValue){
+    _fail(AUTOTUNE_ERROR_OVERTEMP);
+    return _fOutLow;
+  }
+  if (_fElapsedS > _fTimeoutS){
+    _fail(AUTOTUNE_ERROR_TIMEOUT);
+    return _fOutLow;
+  }
+
+  _fCycleMax = (f_actual > _fCycleMax) ? f_actual : _fCycleMax;
+  _fCycleMin = (f_actual < _fCycleMin) ? f_actual : _fCycleMin;
+
+  if (_bOutputHigh && f_actual > _fTarget + _fHysteresis){
+    _bOutputHigh = false;
+  } else if (!_bOutputHigh && f_actual < _fTarget - _fHysteresis){
+    // a cycle lasts from one switch on to the next. The heat-up before the first switch on is discarded, and so is the
+    // first relay cycle: it starts from the overshoot of the heat-up and is not yet symmetric.
+    _bOutputHigh = true;
+    _iSwitchCnt++;
+
+    if (_iSwitchCnt > 2){
+      _arrPeriodS[_iCycleCnt] = _fElapsedS - _fCycleStartS;
+      _arrAmplitude[_iCycleCnt] = 0.5F * (_fCycleMax - _fCycleMin);
+      _iCycleCnt++;
+    }
+    _fCycleStartS = _fElapsedS;
+    _fCycleMax = f_actual;
+    _fCycleMin = f_actual;
+
+    if (_iCycleCnt >= _iCyclesRequired){
+      _finish();
+      return _fOutLow;
+    }
+  }
+
+  return _bOutputHigh ? _fOutHigh : _fOutLow;
+}
+
+
+void PIDAutoTune::_finish(void) {
+  /**
+   * Evaluate the recorded cycles: describing function of the relay with hysteresis gives the ultimate gain
+  */
+  float f_period_s = 0.F;
+  float f_amplitude = 0.F;
+
+  for (int i_cycle=0; i_cycle<_iCycleCnt; i_cycle++){
+    f_period_s += _arrPeriodS[i_cycle];
+    f_amplitude += _arrAmplitude[i_cycle];
+  }
+  f_period_s /= (float)_iCycleCnt;
+  f_amplitude /= (float)_iCycleCnt;
+
+  if (f_amplitude <= _fHysteresis){
+    _fail(AUTOTUNE_ERROR_NO_OSCILLATION);
+    return;
+  }
+
+  float f_relay_amplitude = 0.5F * (_fOutHigh - _fOutLow);
+
+  _objResult.fUltimateGain = 4.F * f_relay_amplitude /
+                             ((float)M_PI * sqrtf(f_amplitude * f_amplitude - _fHysteresis * _fHysteresis));
+  _objResult.fUltimatePeriodS = f_period_s;
+  _objResult.fAmplitude = f_amplitude;
+  _objResult.iCycles = _iCycleCnt;
+  _objResult.iRule = _iRule;
+  applyRule(_iRule, _objResult.fUltimateGain, f_period_s, &_objResult.fPropFactor, &_objResult.fIntTimeS,
+            &_objResult.fDifTimeS);
+  _iState = AUTOTUNE_STATE_DONE;
+}
+
+
+void PIDAutoTune::_fail(int i_error) {
+  _iError = i_error;
+  _iState = AUTOTUNE_STATE_FAILED;
+}
+
+
+int PIDAutoTune::getState(void) {
+  return _iState;
+}
+
+
+int PIDAutoTune::getError(void) {
+  return _iError;
+}
+
+
+int PIDAutoTune::getRule(void) {
+  return _iRule;
+}
+
+
+int PIDAutoTune::getCycleCount(void) {
+  return _iCycleCnt;
+}
+
+
+float PIDAutoTune::getElapsedS(void) {
+  return _fElapsedS;
+}
+
+
+bool PIDAutoTune::getResult(autotune_result * ptr_result) {
+  /**
+   * Get the result of the experiment
+   * @param ptr_result: result, only written if the experiment is done
+   * @return: true if a result is available
+  */
+  if (_iState != AUTOTUNE_STATE_DONE){
+    return false;
+  }
+  *ptr_result = _objResult;
+  return true;
+}
+
+
+void PIDAutoTune::applyRule(int i_rule, float f_ku, float f_pu_s, float * ptr_prop, float * ptr_int_s,
+                            float * ptr_dif_s) {
+  /**
+   * Calculate controller parameters in the time constant form of PIDCtrl::setParameters()
+   * @param i_rule: tuning rule, see eAutoTuneRule
+   * @param f_ku: ultimate gain
+   * @param f_pu_s: ultimate period in s
+   * @param ptr_prop: proportional gain Kp
+   * @param ptr_int_s: reset time Tn in s
+   * @param ptr_dif_s: derivative time Tv in s, 0 for PI rules
+  */
+  switch (i_rule){
+    case AUTOTUNE_RULE_ZN_PI:
+      *ptr_prop = 0.45F * f_ku;
+      *ptr_int_s = f_pu_s / 1.2F;
+      *ptr_dif_s = 0.F;
+      break;
+    case AUTOTUNE_RULE_TL_PID:
+      *ptr_prop = f_ku / 2.2F;
+      *ptr_int_s = 2.2F * f_pu_s;
+      *ptr_dif_s = f_pu_s / 6.3F;
+      break;
+    case AUTOTUNE_RULE_TL_PI:
+      *ptr_prop = f_ku / 3.2F;
+      *ptr_int_s = 2.2F * f_pu_s;
+      *ptr_dif_s = 0.F;
+      break;
+    case AUTOTUNE_RULE_SOME_OVERSHOOT:
+      *ptr_prop = 0.33F * f_ku;
+      *ptr_int_s = 0.5F * f_pu_s;
+      *ptr_dif_s = 0.33F * f_pu_s;
+      break;
+    case AUTOTUNE_RULE_NO_OVERSHOOT:
+      *ptr_prop = 0.2F * f_ku;
+      *ptr_int_s = 0.5F * f_pu_s;
+      *ptr_dif_s = 0.33F * f_pu_s;
+      break;
+    default:
+      *ptr_prop = 0.6F * f_ku;
+      *ptr_int_s = 0.5F * f_pu_s;
+      *ptr_dif_s = 0.125F * f_pu_s;
+      break;
+  }
+}
+
+
+const char * PIDAutoTune::getRuleName(int i_rule) {
+  /**
+   * Short name of a rule, used in the configuration and the web interface
+  */
+  static const char * arr_names[AUTOTUNE_RULE_CNT] = {"zn_pid", "zn_pi", "tl_pid", "tl_pi", "some_overshoot",
+                                                       "no_overshoot"};
+  return (i_rule >= 0 && i_rule < AUTOTUNE_RULE_CNT) ? arr_names[i_rule] : NULL;
+}
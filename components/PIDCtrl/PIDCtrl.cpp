@@ -0,0 +1,198 @@
+// PID controller for the boiler temperature, see PIDCtrl.hpp
+
+#include "PIDCtrl.hpp"
+
+PIDCtrl::PIDCtrl() {
+  _fTarget = 0.F;
+  _fPropFactor = 0.F;
+  _fIntFactor = 0.F;
+  _fDifFactor = 0.F;
+  _bTimeFactor = true;
+  _bPropActive = false;
+  _bIntActive = false;
+  _bDifActive = false;
+  _fLowLimit = 0.F;
+  _fHighLimit = 255.F;
+  _bLowThreshActive = false;
+  _fLowThresh = 0.F;
+  _bHighThreshActive = false;
+  _fHighThresh = 0.F;
+  reset();
+}
+
+
+void PIDCtrl::setTarget(float f_target) {
+  /**
+   * Set target value
+   * @param f_target: target value, e.g. boiler temperature in °C
+  */
+  _fTarget = f_target;
+}
+
+
+float PIDCtrl::getTarget(void) {
+  return _fTarget;
+}
+
+
+void PIDCtrl::setParameters(float f_prop, float f_int, float f_dif, bool b_time_factor) {
+  /**
+   * Set controller parameters
+   * @param f_prop: proportional gain Kp
+   * @param f_int: reset time Tn in s if b_time_factor is set, otherwise integral gain Ki
+   * @param f_dif: derivative time Tv in s if b_time_factor is set, otherwise derivative gain Kd
+   * @param b_time_factor: integral and derivative factors are time constants
+  */
+  _fPropFactor = f_prop;
+  _fIntFactor = f_int;
+  _fDifFactor = f_dif;
+  _bTimeFactor = b_time_factor;
+}
+
+
+void PIDCtrl::activate(bool b_prop, bool b_int, bool b_dif) {
+  /**
+   * Activate the single parts of the controller. A deactivated integral part is cleared.
+  */
+  _bPropActive = b_prop;
+  _bIntActive = b_int;
+  _bDifActive = b_dif;
+
+  if (!_bIntActive){
+    _fIntegral = 0.F;
+  }
+}
+
+
+void PIDCtrl::setLimits(float f_low, float f_high) {
+  /**
+   * Set limits of the manipulated variable
+   * @param f_low: lower limit, e.g. 0 for heater off
+   * @param f_high: upper limit, e.g. 255 for full heater power at 8 bit PWM resolution
+  */
+  _fLowLimit = f_low;
+  _fHighLimit = f_high;
+}
+
+
+void PIDCtrl::setThresholds(bool b_low_active, float f_low, bool b_high_active, float f_high) {
+  /**
+   * Set thresholds around the target, outside of them the controller is bypassed and the output is set to a limit.
+   * @param b_low_active: activate lower threshold
+   * @param f_low: below target - f_low the output is the upper limit (full power heat-up)
+   * @param b_high_active: activate upper threshold
+   * @param f_high: above target + f_high the output is the lower limit
+  */
+  _bLowThreshActive = b_low_active;
+  _fLowThresh = f_low;
+  _bHighThreshActive = b_high_active;
+  _fHighThresh = f_high;
+}
+
+
+void PIDCtrl::reset(void) {
+  /**
+   * Clear integral and derivative state, e.g. after a sensor fault
+  */
+  _fIntegral = 0.F;
+  _fPrevActual = 0.F;
+  _bPrevValid = false;
+  _fOutput = 0.F;
+  _fPropPart = 0.F;
+  _fIntPart = 0.F;
+  _fDifPart = 0.F;
+}
+
+
+float PIDCtrl::update(float f_actual, float f_dt_s) {
+  /**
+   * Calculate the manipulated variable
+   * @param f_actual: actual value
+   * @param f_dt_s: time since the last update in s, integral and derivative part are skipped if not positive
+   * @return: manipulated variable within the limits
+  */
+  float f_error = _fTarget - f_actual;
+
+  if (_bLowThreshActive && f_error > _fLowThresh){
+    _fIntegral = 0.F;
+    _bPrevValid = false;
+    _fOutput = _fHighLimit;
+    return _fOutput;
+  }
+  if (_bHighThreshActive && -f_error > _fHighThresh){
+    _fIntegral = 0.F;
+    _bPrevValid = false;
+    _fOutput = _fLowLimit;
+    return _fOutput;
+  }
+
+  _fPropPart = _bPropActive ? _fPropFactor * f_error : 0.F;
+
+  _fDifPart = 0.F;
+  if (_bDifActive && _bPrevValid && f_dt_s > 0.F){
+    // derivative on measurement
+    _fDifPart = -_getDifGain() * (f_actual - _fPrevActual) / f_dt_s;
+  }
+
+  if (_bIntActive && f_dt_s > 0.F){
+    float f_integral = _fIntegral + _getIntGain() * f_error * f_dt_s;
+    float f_unsaturated = _fPropPart + f_integral + _fDifPart;
+
+    // anti windup: only integrate if the output is not saturated in the direction of the error
+    if ((f_unsaturated < _fHighLimit || f_error < 0.F) && (f_unsaturated > _fLowLimit || f_error > 0.F)){
+      _fIntegral = f_integral;
+    }
+  }
+  _fIntPart = _bIntActive ? _fIntegral : 0.F;
+
+  _fPrevActual = f_actual;
+  _bPrevValid = true;
+
+  _fOutput = _saturate(_fPropPart + _fIntPart + _fDifPart);
+  return _fOutput;
+}
+
+
+float PIDCtrl::getOutput(void) {
+  return _fOutput;
+}
+
+
+float PIDCtrl::getPropPart(void) {
+  return _fPropPart;
+}
+
+
+float PIDCtrl::getIntPart(void) {
+  return _fIntPart;
+}
+
+
+float PIDCtrl::getDifPart(void) {
+  return _fDifPart;
+}
+
+
+float PIDCtrl::_getIntGain(void) {
+  if (_bTimeFactor){
+    // Ki = Kp / Tn
+    return (_fIntFactor > 0.F) ? _fPropFactor / _fIntFactor : 0.F;
+  }
+  return _fIntFactor;
+}
+
+
+float PIDCtrl::_getDifGain(void) {
+  if (_bTimeFactor){
+    // Kd = Kp * Tv
+    return _fPropFactor * _fDifFactor;
+  }
+  return _fDifFactor;
+}
+
+
+float PIDCtrl::_saturate(float f_value) {
+  f_value = (f_value > _fHighLimit) ? _fHighLimit : f_value;
+  f_value = (f_value < _fLowLimit) ? _fLowLimit : f_value;
+  return f_value;
+}
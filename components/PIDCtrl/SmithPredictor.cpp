@@ -0,0 +1,170 @@
+// Smith predictor for the boiler temperature, see SmithPredictor.hpp
+
+#include <math.h>
+#include "SmithPredictor.hpp"
+
+SmithPredictor::SmithPredictor() {
+  _objModel.fGain = 0.F;
+  _objModel.fTimeConstS = 1.F;
+  _objModel.fDeadTimeS = 0.F;
+  _fSamplePeriodS = 1.F;
+  _iDelaySamples = 0;
+  reset();
+}
+
+
+bool SmithPredictor::setModel(const fopdt_model & obj_model, float f_sample_period_s) {
+  /**
+   * Set the plant model
+   * @param obj_model: FOPDT model of the plant
+   * @param f_sample_period_s: nominal sample period, the delay line holds one model output per sample
+   * @return: false if the dead time exceeds the delay line, it is limited then
+  */
+  _objModel = obj_model;
+  _objModel.fTimeConstS = (_objModel.fTimeConstS > 0.F) ? _objModel.fTimeConstS : 1.F;
+  _fSamplePeriodS = f_sample_period_s;
+  _iDelaySamples = (int)(obj_model.fDeadTimeS / f_sample_period_s + 0.5F);
+
+  if (_iDelaySamples < 0 || _iDelaySamples >= SMITH_DELAY_SLOTS){
+    _iDelaySamples = (_iDelaySamples < 0) ? 0 : SMITH_DELAY_SLOTS - 1;
+    reset();
+    return false;
+  }
+  reset();
+  return true;
+}
+
+
+void SmithPredictor::reset(void) {
+  /**
+   * Clear the model state, e.g. together with the PID controller after a sensor fault
+  */
+  _fState = 0.F;
+  _iDelayIdx = 0;
+  for (int i_idx=0; i_idx<SMITH_DELAY_SLOTS; i_idx++){_arrDelayLine[i_idx]=0.F;}
+}
+
+
+float SmithPredictor::getFeedback(float f_actual) {
+  /**
+   * Feedback for the controller: measurement plus the model response which is not yet visible in the measurement.
+   * The model runs in deviations, the operating point cancels out.
+   * @param f_actual: measured temperature
+   * @return: predicted undelayed temperature
+  */
+  return f_actual + _fState - getDelayedPrediction();
+}
+
+
+void SmithPredictor::update(float f_output, float f_dt_s) {
+  /**
+   * Advance the model by one sample, called before getFeedback() with each new sample
+   * @param f_output: manipulated variable applied to the heater since the last sample, including saturation and
+   *                  feed-forward
+   * @param f_dt_s: time since the last sample in s
+  */
+  float f_decay = expf(-f_dt_s / _objModel.fTimeConstS);
+
+  // exact discretization for a constant input over the step
+  _fState = f_decay * _fState + _objModel.fGain * (1.F - f_decay) * f_output;
+
+  _arrDelayLine[_iDelayIdx] = _fState;
+  _iDelayIdx = (_iDelayIdx + 1) % SMITH_DELAY_SLOTS;
+}
+
+
+float SmithPredictor::getPrediction(void) {
+  return _fState;
+}
+
+
+float SmithPredictor::getDelayedPrediction(void) {
+  /**
+   * Model output of _iDelaySamples updates ago
+  */
+  return _arrDelayLine[(_iDelayIdx - 1 - _iDelaySamples + 2 * SMITH_DELAY_SLOTS) % SMITH_DELAY_SLOTS];
+}
+
+
+int SmithPredictor::getDelaySamples(void) {
+  return _iDelaySamples;
+}
+
+
+float SmithPredictor::_getSlope(const float * arr_values, int i_start, int i_cnt, float f_sample_period_s) {
+  /**
+   * Least squares slope of a section of equidistant samples
+  */
+  float f_mean_t = 0.5F * (i_cnt - 1);
+  float f_mean_x = 0.F;
+  float f_sum_tx = 0.F;
+  float f_sum_tt = 0.F;
+
+  for (int i_idx=0; i_idx<i_cnt; i_idx++){f_mean_x += arr_values[i_start + i_idx];}
+  f_mean_x /= (float)i_cnt;
+
+  for (int i_idx=0; i_idx<i_cnt; i_idx++){
+    f_sum_tx += (i_idx - f_mean_t) * (arr_values[i_start + i_idx] - f_mean_x);
+    f_sum_tt += (i_idx - f_mean_t) * (i_idx - f_mean_t);
+  }
+  return f_sum_tx / f_sum_tt / f_sample_period_s;
+}
+
+
+bool SmithPredictor::identifyStep(const float * arr_response, int i_cnt, float f_sample_period_s, float f_step,
+                                  fopdt_model * ptr_model) {
+  /**
+   * Fit a FOPDT model to an open loop step response. The boiler is lag dominant and does not settle within the
+   * sensor range, so the fit uses the slope instead of the final value: the tangent at the steepest point gives the
+   * dead time, the decay of the slope towards the end of the record gives the time constant,
+   * slope(t) = K * step / T * exp(-(t - L) / T).
+   * @param arr_response: temperature samples from the step on, at least 20 * SMITH_IDENT_MIN_WINDOW samples
+   * @param i_cnt: number of samples
+   * @param f_sample_period_s: sample period of arr_response
+   * @param f_step: step of the manipulated variable
+   * @param ptr_model: identified model
+   * @return: false if the response does not rise
+  */
+  int i_window = i_cnt / SMITH_IDENT_WINDOW_DIV;
+  float f_max_slope = 0.F;
+  int i_max_start = 0;
+
+  if (i_window < SMITH_IDENT_MIN_WINDOW || f_step <= 0.F){
+    return false;
+  }
+
+  // steepest section of the response
+  for (int i_start=0; i_start + i_window <= i_cnt; i_start += i_window / 2){
+    float f_slope = _getSlope(arr_response, i_start, i_window, f_sample_period_s);
+    if (f_slope > f_max_slope){
+      f_max_slope = f_slope;
+      i_max_start = i_start;
+    }
+  }
+  if (f_max_slope <= 0.F){
+    return false;
+  }
+
+  float f_max_time_s = f_sample_period_s * (i_max_start + 0.5F * (i_window - 1));
+  float f_max_value = 0.F;
+  for (int i_idx=0; i_idx<i_window; i_idx++){f_max_value += arr_response[i_max_start + i_idx];}
+  f_max_value /= (float)i_window;
+
+  float f_end_slope = _getSlope(arr_response, i_cnt - i_window, i_window, f_sample_period_s);
+  float f_end_time_s = f_sample_period_s * (i_cnt - 0.5F * (i_window + 1));
+
+  // tangent crosses the initial value after the dead time
+  ptr_model->fDeadTimeS = f_max_time_s - (f_max_value - arr_response[0]) / f_max_slope;
+  ptr_model->fDeadTimeS = (ptr_model->fDeadTimeS > 0.F) ? ptr_model->fDeadTimeS : 0.F;
+
+  if (f_end_slope > 0.F && f_end_slope < f_max_slope && f_end_time_s > f_max_time_s){
+    ptr_model->fTimeConstS = (f_end_time_s - f_max_time_s) / logf(f_max_slope / f_end_slope);
+  } else {
+    // no visible decay, integrating within the record
+    ptr_model->fTimeConstS = SMITH_IDENT_MAX_TIME_CONST_S;
+  }
+  ptr_model->fTimeConstS = (ptr_model->fTimeConstS < SMITH_IDENT_MAX_TIME_CONST_S) ? ptr_model->fTimeConstS :
+                           SMITH_IDENT_MAX_TIME_CONST_S;
+  ptr_model->fGain = f_max_slope * ptr_model->fTimeConstS / f_step;
+  return true;
+}
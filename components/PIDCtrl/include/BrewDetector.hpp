@@ -0,0 +1,107 @@
+// Brew shot detection and feed-forward heater boost. A shot is detected by a fast temperature drop of the filtered
+// signal (cold water enters the boiler) or by a pump/brew switch input. The drop is detected by its slope or by its
+// depth below the maximum of the last seconds: a controller with a long derivative time counters the drop at once
+// and keeps the slope below the threshold, the depth still grows with the inflowing water. With the detection a heater
+// boost profile is added to the controller output, the temperature course of the shot is recorded for shot statistics.
+
+#ifndef BREWDETECTOR_h
+#define BREWDETECTOR_h
+
+#include <stdint.h>
+
+#define BREW_SLOPE_WINDOW 16   // samples of the slope regression, 2 s at 8 SPS
+#define BREW_DROP_WINDOW 48    // samples of the drop detection, 6 s at 8 SPS
+#define BREW_TRACE_LEN 120     // samples of the shot trace
+#define BREW_TRACE_PRE_CNT 10  // trace samples before the detection
+#define BREW_SHOT_HISTORY 8    // statistics of the latest shots
+
+enum eBrewState{
+  BREW_STATE_IDLE,
+  BREW_STATE_BREWING,    // shot is running
+  BREW_STATE_RECOVERING  // shot is finished, temperature is not yet back within the recovery band
+};
+
+struct brew_params {
+  bool bSlopeDetect;        // detect shots by the temperature slope
+  float fSlopeThresh;       // detection if the temperature drops faster than this in K/s
+  float fDropThresh;        // detection if the temperature is this far below the maximum of the drop window in K,
+                            // 0 to detect by the slope only
+  float fSlopeBand;         // slope detection only above target - band in K, not during heat-up
+  bool bSwitchDetect;       // detect shots by the pump/brew switch input
+  float fShotDurationS;     // assumed shot duration of slope detected shots
+  float fBoost;             // feed-forward heater boost in units of the controller output
+  float fBoostHoldS;        // boost is held for this time after the detection
+  float fBoostRampS;        // afterwards the boost ramps down to 0 within this time
+  float fRecoveryBand;      // shot is recovered if the temperature is back above target - band in K
+  float fMaxRecoveryS;      // recovery is aborted after this time
+  float fHoldoffS;          // no slope detection within this time after a recovered shot
+  float fTraceIntervalS;    // sample interval of the shot trace
+};
+
+struct brew_shot {
+  uint32_t iShotNumber;     // counts from 1 since start
+  double fStartS;           // detection time
+  bool bSwitchTriggered;    // detected by the switch input, otherwise by the slope
+  float fDurationS;         // shot duration, switch on time or fShotDurationS
+  float fStartTemp;         // temperature at the detection
+  float fMinTemp;           // minimum temperature during shot and recovery
+  float fDip;               // target - minimum temperature
+  float fRecoveryS;         // time from detection until the temperature is back in the band, -1 if not recovered
+  float fBoostIntegral;     // integral of the feed-forward boost in output units * s
+};
+
+class BrewDetector
+{
+  public:
+    BrewDetector();
+    static brew_params getDefaultParams(void);
+    void setParams(const brew_params &);
+    void setTarget(float);
+    void reset(void);
+    float update(double, float, bool);
+    int getState(void);
+    float getSlope(void);
+    float getFeedForward(void);
+    uint32_t getShotCount(void);
+    bool getShot(int, brew_shot *);
+    int getTrace(float *, int, float *, uint32_t *);
+    int getTracePreCount(void);
+
+  private:
+    brew_params _objParams;
+    float _fTarget;
+    int _iState;
+    double _arrSlopeTime[BREW_SLOPE_WINDOW];
+    float _arrSlopeValue[BREW_SLOPE_WINDOW];
+    int _iSlopeIdx;
+    int _iSlopeCnt;
+    float _fSlope;
+    float _arrDropValue[BREW_DROP_WINDOW];
+    int _iDropIdx;
+    int _iDropCnt;
+    float _fDrop;
+    bool _bPrevSwitch;
+    double _fPrevTimeS;
+    double _fRecoveredS;
+    float _fFeedForward;
+    brew_shot _objShot;
+    double _fShotEndS;
+    brew_shot _arrShots[BREW_SHOT_HISTORY];
+    uint32_t _iShotCnt;
+    float _arrPreTrace[BREW_TRACE_PRE_CNT];
+    int _iPreTraceIdx;
+    int _iPreTraceCnt;
+    float _arrTrace[BREW_TRACE_LEN];
+    int _iTraceCnt;
+    int _iTracePreCnt;
+    uint32_t _iTraceShot;
+    double _fNextTraceS;
+    void _updateSlope(double, float);
+    void _updateDrop(float);
+    void _updateTrace(double, float);
+    void _startShot(double, float, bool);
+    void _finishShot(float);
+    float _getBoost(double);
+};
+
+#endif
@@ -0,0 +1,127 @@
+// Sensor fault manager of the heater control. Every control cycle the latest sample and the heater output are checked
+// for signal faults (I2C errors, missing or frozen conversions, temperatures outside the sensor range) and for
+// implausible heater responses (temperature does not move at high output or rises without output). Each fault maps to
+// a safe-state action, the most restrictive action of the active faults limits the heater output:
+//   cap  - the controller runs on valid samples, while samples are missing the previous output is held, both capped
+//   limp - open loop at the holding output learned in fault-free operation, for a limited time
+//   off  - heater off
+// Signal faults clear after a fault-free recovery time, heater plausibility faults and the limp timeout stay active
+// until they are cleared. Every activation is latched with count and time for the diagnosis. The cost per cycle is
+// constant: the flatline and plausibility windows are evaluated from running values, not from sample buffers.
+
+#ifndef FAULTMANAGER_h
+#define FAULTMANAGER_h
+
+#include <stdint.h>
+
+enum eFaultCode {
+  FAULT_I2C_ERROR,          // readout of the converter failed
+  FAULT_NO_SAMPLE,          // no conversion within the timeout
+  FAULT_VALUE_FROZEN,       // conversion or temperature did not change
+  FAULT_TEMP_RANGE,         // temperature outside the sensor range, open or shorted wire
+  FAULT_OVER_TEMP,          // temperature above the safety limit
+  FAULT_NO_HEAT_RESPONSE,   // temperature does not move at high output, heater or sensor detached
+  FAULT_UNCOMMANDED_HEAT,   // temperature rises without output, SSR stuck on
+  FAULT_LIMP_TIMEOUT,       // limp mode lasted too long
+  FAULT_CNT
+};
+
+#define FAULT_BIT(code) (1u << (code))
+#define FAULT_SIGNAL_MASK (FAULT_BIT(FAULT_I2C_ERROR) | FAULT_BIT(FAULT_NO_SAMPLE) | FAULT_BIT(FAULT_VALUE_FROZEN) | \
+                           FAULT_BIT(FAULT_TEMP_RANGE))
+
+enum eFaultAction {
+  FAULT_ACTION_NONE,
+  FAULT_ACTION_CAP,
+  FAULT_ACTION_LIMP,
+  FAULT_ACTION_OFF
+};
+
+struct fault_params {
+  float fOutputMax;         // output range of the controller, the output fractions below refer to it
+  float fTempMin;           // sensor range in °C
+  float fTempMax;
+  float fOverTemp;          // safety limit in °C
+  float fOverTempHyst;      // over temperature clears below limit - hysteresis
+  float fFrozenS;           // temperature within fFrozenBand over this time is frozen
+  float fFrozenBand;        // K
+  float fSignalLimpS;       // I2C errors and missing samples lasting longer than this turn from cap into limp mode
+  float fCapOutput;         // fraction of fOutputMax
+  float fLimpMaxS;          // limp mode turns into off after this time
+  float fLimpMaxOutput;     // fraction, upper limit of the learned holding output
+  float fHoldBand;          // holding output is learned within target +- band in K
+  float fHoldTauS;          // time constant of the holding output, also the settling time within the band
+  float fPlausWindowS;      // window of the heater plausibility checks
+  float fPlausOnOutput;     // fraction, mean output above which the temperature has to move
+  float fPlausMinMove;      // K per window
+  float fPlausOffOutput;    // fraction, mean output below which the temperature must not rise
+  float fPlausMaxRise;      // K per window
+  float fRecoveryS;         // signal faults clear after this fault-free time
+};
+
+struct fault_input {
+  double fTimeS;            // monotonic time
+  bool bSample;             // a conversion was read, false on timeout
+  bool bI2cError;           // readout failed
+  bool bFrozen;             // frozen detection of the driver
+  float fTemperature;       // filtered temperature in °C
+  float fTarget;            // target of the controller
+  float fOutput;            // heater output applied since the previous cycle
+  bool bBrewing;            // shot running, the temperature course is not checked against the output
+};
+
+struct fault_entry {
+  uint32_t iCount;          // activations
+  double fFirstS;           // time of the first activation
+  double fLastS;            // time of the latest activation
+};
+
+class FaultManager
+{
+  public:
+    FaultManager();
+    static fault_params getDefaultParams(void);
+    static const char * getFaultName(int);
+    static const char * getActionName(int);
+    void setParams(const fault_params &);
+    void reset(void);
+    int update(const fault_input &);
+    bool isSampleUsable(void);
+    float limitOutput(float);
+    int getAction(void);
+    uint32_t getActiveMask(void);
+    uint32_t getLatchedMask(void);
+    bool getEntry(int, fault_entry *);
+    float getHoldOutput(void);
+    void clear(void);
+
+  private:
+    fault_params _objParams;
+    uint32_t _iActiveMask;
+    uint32_t _iLatchedMask;
+    fault_entry _arrEntries[FAULT_CNT];
+    double _arrSeenS[FAULT_CNT];      // latest time the condition was present
+    int _iAction;
+    bool _bSampleUsable;
+    double _fPrevTimeS;
+    bool _bPrevValid;
+    double _fFlatStartS;
+    float _fFlatMin;
+    float _fFlatMax;
+    bool _bFlatValid;
+    double _fWinTimeS;
+    double _fWinOutput;
+    float _fWinStartTemp;
+    bool _bWinValid;
+    double _fLimpStartS;
+    float _fHoldOutput;
+    bool _bHoldValid;
+    double _fBandStartS;
+    bool _checkFlatline(double, float);
+    uint32_t _checkPlausibility(const fault_input &, float);
+    void _activate(int, double);
+    int _getCodeAction(int);
+    static bool _isSticky(int);
+};
+
+#endif
@@ -0,0 +1,89 @@
+// Relay feedback auto tuner (Astrom-Hagglund). The heater is switched between two output levels with a hysteresis
+// around the target, the plant oscillates in a limit cycle. Its amplitude and period give the ultimate gain and
+// period, the PID parameters are derived from them with a selectable tuning rule.
+
+#ifndef PIDAUTOTUNE_h
+#define PIDAUTOTUNE_h
+
+#include <stdint.h>
+
+#define AUTOTUNE_MAX_CYCLES 8 // maximum number of evaluated limit cycles
+
+enum eAutoTuneRule{
+  AUTOTUNE_RULE_ZN_PID,         // Ziegler-Nichols PID
+  AUTOTUNE_RULE_ZN_PI,          // Ziegler-Nichols PI
+  AUTOTUNE_RULE_TL_PID,         // Tyreus-Luyben PID, less aggressive, for lag dominant plants
+  AUTOTUNE_RULE_TL_PI,          // Tyreus-Luyben PI
+  AUTOTUNE_RULE_SOME_OVERSHOOT, // Ziegler-Nichols variant with some overshoot
+  AUTOTUNE_RULE_NO_OVERSHOOT,   // Ziegler-Nichols variant without overshoot
+  AUTOTUNE_RULE_CNT
+};
+
+enum eAutoTuneState{
+  AUTOTUNE_STATE_IDLE,
+  AUTOTUNE_STATE_RUNNING,
+  AUTOTUNE_STATE_DONE,
+  AUTOTUNE_STATE_FAILED
+};
+
+enum eAutoTuneError{
+  AUTOTUNE_ERROR_NONE,
+  AUTOTUNE_ERROR_ABORTED,       // aborted by the user
+  AUTOTUNE_ERROR_TIMEOUT,       // not enough cycles within the timeout
+  AUTOTUNE_ERROR_OVERTEMP,      // actual value exceeded the safety limit
+  AUTOTUNE_ERROR_NO_OSCILLATION // amplitude within the hysteresis, ultimate gain cannot be calculated
+};
+
+struct autotune_result {
+  float fUltimateGain;     // Ku = 4 d / (pi sqrt(a^2 - h^2))
+  float fUltimatePeriodS;  // Pu, average period of the evaluated cycles
+  float fAmplitude;        // a, average half peak to peak amplitude
+  int iCycles;             // number of evaluated cycles
+  int iRule;               // applied rule, see eAutoTuneRule
+  float fPropFactor;       // Kp
+  float fIntTimeS;         // Tn, 0 if no integral part
+  float fDifTimeS;         // Tv, 0 if no derivative part
+};
+
+class PIDAutoTune
+{
+  public:
+    PIDAutoTune();
+    void start(float, float, float, float, int, int, float, float);
+    void abort(void);
+    float update(float, float);
+    int getState(void);
+    int getError(void);
+    int getRule(void);
+    int getCycleCount(void);
+    float getElapsedS(void);
+    bool getResult(autotune_result *);
+    static void applyRule(int, float, float, float *, float *, float *);
+    static const char * getRuleName(int);
+
+  private:
+    int _iState;
+    int _iError;
+    int _iRule;
+    float _fTarget;
+    float _fOutLow;
+    float _fOutHigh;
+    float _fHysteresis;
+    float _fMaxValue;
+    float _fTimeoutS;
+    int _iCyclesRequired;
+    float _fElapsedS;
+    bool _bOutputHigh;
+    int _iSwitchCnt;
+    float _fCycleStartS;
+    float _fCycleMax;
+    float _fCycleMin;
+    int _iCycleCnt;
+    float _arrPeriodS[AUTOTUNE_MAX_CYCLES];
+    float _arrAmplitude[AUTOTUNE_MAX_CYCLES];
+    autotune_result _objResult;
+    void _finish(void);
+    void _fail(int);
+};
+
+#endif
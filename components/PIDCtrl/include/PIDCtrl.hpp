@@ -0,0 +1,54 @@
+// PID controller for the boiler temperature. The integral and derivative factors are either time constants
+// (reset time Tn and derivative time Tv in seconds, "time factor" form) or plain gains. The derivative acts on the
+// measurement to avoid a kick on target changes, the integral is frozen while the output saturates.
+
+#ifndef PIDCTRL_h
+#define PIDCTRL_h
+
+#include <stdint.h>
+
+class PIDCtrl
+{
+  public:
+    PIDCtrl();
+    void setTarget(float);
+    float getTarget(void);
+    void setParameters(float, float, float, bool);
+    void activate(bool, bool, bool);
+    void setLimits(float, float);
+    void setThresholds(bool, float, bool, float);
+    void reset(void);
+    float update(float, float);
+    float getOutput(void);
+    float getPropPart(void);
+    float getIntPart(void);
+    float getDifPart(void);
+
+  private:
+    float _fTarget;
+    float _fPropFactor;
+    float _fIntFactor;
+    float _fDifFactor;
+    bool _bTimeFactor;
+    bool _bPropActive;
+    bool _bIntActive;
+    bool _bDifActive;
+    float _fLowLimit;
+    float _fHighLimit;
+    bool _bLowThreshActive;
+    float _fLowThresh;
+    bool _bHighThreshActive;
+    float _fHighThresh;
+    float _fIntegral;
+    float _fPrevActual;
+    bool _bPrevValid;
+    float _fOutput;
+    float _fPropPart;
+    float _fIntPart;
+    float _fDifPart;
+    float _getIntGain(void);
+    float _getDifGain(void);
+    float _saturate(float);
+};
+
+#endif
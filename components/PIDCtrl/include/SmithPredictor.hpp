@@ -0,0 +1,51 @@
+// Smith predictor for the boiler temperature. A first-order-plus-dead-time (FOPDT) model of the plant is simulated
+// alongside the real loop; the feedback of the PID controller is the measurement corrected by the difference of the
+// undelayed and the delayed model output, which removes the dead time from the loop. All state is in fixed-size
+// arrays, an update costs one expf() and a few multiplications.
+
+#ifndef SMITHPREDICTOR_h
+#define SMITHPREDICTOR_h
+
+#include <stdint.h>
+
+#define SMITH_DELAY_SLOTS 256   // length of the delay line in samples, 32 s dead time at 8 SPS
+#define SMITH_IDENT_WINDOW_DIV 20             // slope window of the identification is 1/20 of the record
+#define SMITH_IDENT_MIN_WINDOW 5              // minimum samples per slope window
+#define SMITH_IDENT_MAX_TIME_CONST_S 100000.F // limit of the identified time constant
+
+enum eCtrlMode{
+  CTRL_MODE_PID,              // PID on the measured temperature
+  CTRL_MODE_SMITH,            // PID on the Smith predictor feedback
+  CTRL_MODE_CNT
+};
+
+struct fopdt_model {
+  float fGain;                // steady state temperature rise per unit of the manipulated variable in K
+  float fTimeConstS;          // time constant in s
+  float fDeadTimeS;           // dead time in s
+};
+
+class SmithPredictor
+{
+  public:
+    SmithPredictor();
+    bool setModel(const fopdt_model &, float);
+    void reset(void);
+    float getFeedback(float);
+    void update(float, float);
+    float getPrediction(void);
+    float getDelayedPrediction(void);
+    int getDelaySamples(void);
+    static bool identifyStep(const float *, int, float, float, fopdt_model *);
+
+  private:
+    fopdt_model _objModel;
+    float _fSamplePeriodS;
+    int _iDelaySamples;
+    float _fState;
+    float _arrDelayLine[SMITH_DELAY_SLOTS];
+    int _iDelayIdx;
+    static float _getSlope(const float *, int, int, float);
+};
+
+#endif
@@ -0,0 +1,266 @@
+// Host check of the ADS1115 driver chain against the register emulator: transport and emulator timing, injected
+// faults, the conversion filter, the physical conversion (getPhysVal) and the decimator of the oversampling modes.
+// Every check compares against a limit, a passing run prints nothing. Exit code 0 on success.
+//   ./build-host/coffee_ads_check
+
+#include <stdio.h>
+#include <math.h>
+#include "ADS111x_sim.hpp"
+#include "ADS111x_decimator.hpp"
+
+#define CHECK_LSB_0P256 (0.256F / 32768.F)   // LSB of the 0.256 V range in V
+
+static int s_i_failures = 0;
+
+static void check(bool b_condition, const char * str_what){
+  if (!b_condition){
+    printf("FAIL: %s\n", str_what);
+    s_i_failures++;
+  }
+}
+
+
+static void checkNear(float f_value, float f_expected, float f_tolerance, const char * str_what){
+  if (!(fabsf(f_value - f_expected) <= f_tolerance)){
+    printf("FAIL: %s: %g, expected %g +- %g\n", str_what, f_value, f_expected, f_tolerance);
+    s_i_failures++;
+  }
+}
+
+
+static void setupContinuous(ADS1115 * ptr_ads, uint8_t i_rate){
+  /**
+   * Continuous conversions of AIN0-AIN1 in the 0.256 V range with the conversion ready pulse, as the firmware
+   */
+  ptr_ads->begin(0, 0, ADS1115_I2CADD_DEFAULT);
+  ptr_ads->setCompPolarity(ADS1115_CMP_POL_ACTIVE_HIGH);
+  ptr_ads->setMux(ADS1115_MUX_AIN0_AIN1, false);
+  ptr_ads->setPGA(ADS1115_PGA_0P256);
+  ptr_ads->setRate(i_rate);
+  ptr_ads->setCompLatchingMode(ADS1115_CMP_LAT_ACTIVE);
+  ptr_ads->setPinRdyMode(ADS1115_CONV_READY_ACTIVE, ADS1115_CMP_QUE_ASSERT_1_CONV);
+  ptr_ads->setOpMode(ADS1115_MODE_CONTINUOUS);
+}
+
+
+static void checkTransport(){
+  ADS1115SimTransport obj_sim;
+  ADS1115 obj_ads(&obj_sim);
+  ads1115_i2c_stats obj_stats;
+  uint16_t i_value;
+
+  // register access through the driver
+  setupContinuous(&obj_ads, ADS1115_RATE_860);
+  check(obj_ads.getRate() == ADS1115_RATE_860, "data rate reads back");
+  check(obj_ads.getPGA() == ADS1115_PGA_0P256, "PGA reads back");
+  check(((obj_sim.peekRegister(ADS1115_CONFIG_REG) >> ADS1115_MODE) & 1) == ADS1115_MODE_CONTINUOUS,
+        "continuous mode is in the config register");
+  check(obj_ads.getConnectionStatus(), "device acknowledges");
+
+  // a transaction takes its bus time
+  int64_t i_start_us = obj_sim.getTimeUs();
+  obj_ads.readConversionRegister();
+  check(obj_sim.getTimeUs() - i_start_us == ADS1115_SIM_TRANSACTION_US, "transaction advances the time");
+
+  // data rate and conversion ready pulses
+  uint32_t i_conv_start = obj_sim.getConversionCount();
+  uint32_t i_rdy_start = obj_sim.getRdyPulseCount();
+  obj_sim.advanceTimeUs(1000000);
+  int i_conv_cnt = (int)(obj_sim.getConversionCount() - i_conv_start);
+  check(i_conv_cnt >= 859 && i_conv_cnt <= 861, "860 conversions per second");
+  check(obj_sim.getRdyPulseCount() - i_rdy_start == (uint32_t)i_conv_cnt, "one ready pulse per conversion");
+
+  obj_sim.setClockError(-0.1F);
+  i_conv_start = obj_sim.getConversionCount();
+  obj_sim.advanceTimeUs(1000000);
+  i_conv_cnt = (int)(obj_sim.getConversionCount() - i_conv_start);
+  check(i_conv_cnt >= 773 && i_conv_cnt <= 775, "slow oscillator converts 10 % less");
+  obj_sim.setClockError(0.F);
+
+  // quantization of the input
+  obj_sim.setInputVoltage(ADS1115_MUX_AIN0_AIN1, 0.1F);
+  obj_sim.advanceTimeUs(2000);
+  check((int16_t)obj_ads.readConversionRegister() == 12800, "0.1 V is code 12800 in the 0.256 V range");
+  checkNear(obj_ads.getVoltVal(), 0.1F, 2.F * CHECK_LSB_0P256, "voltage of a conversion");
+  obj_sim.setInputVoltage(ADS1115_MUX_AIN0_AIN1, 1.F);
+  obj_sim.advanceTimeUs(2000);
+  check((int16_t)obj_ads.readConversionRegister() == 32767, "input above full scale is clipped");
+
+  // faults: the driver reports them, the emulator recovers once they are cleared
+  obj_ads.getI2cStats(&obj_stats);
+  uint32_t i_errors = obj_stats.iErrors;
+  obj_sim.setFaults(ADS1115_SIM_FAULT_NACK);
+  obj_ads.getConvVal();
+  check(!obj_ads.getConnectionStatus(), "missing acknowledge is a connection error");
+  obj_ads.getI2cStats(&obj_stats);
+  check(obj_stats.iErrors == i_errors + 1, "missing acknowledge is counted");
+
+  obj_sim.setFaults(ADS1115_SIM_FAULT_TIMEOUT);
+  i_start_us = obj_sim.getTimeUs();
+  check(obj_sim.readRegister(ADS1115_I2CADD_DEFAULT, ADS1115_CONVERSION_REG, &i_value) == ESP_ERR_TIMEOUT,
+        "stuck bus times out");
+  check(obj_sim.getTimeUs() - i_start_us == ADS1115_SIM_TIMEOUT_US, "timeout takes the bus timeout");
+
+  obj_sim.setFaults(0);
+  obj_ads.getConvVal();
+  check(obj_ads.getConnectionStatus(), "connection recovers");
+  check(obj_sim.readRegister(0x49, ADS1115_CONVERSION_REG, &i_value) == ESP_FAIL, "other address is not acknowledged");
+
+  obj_sim.setInputVoltage(ADS1115_MUX_AIN0_AIN1, 0.05F);
+  obj_sim.setFaults(ADS1115_SIM_FAULT_FROZEN);
+  obj_sim.advanceTimeUs(10000);
+  check((int16_t)obj_ads.readConversionRegister() == 32767, "frozen conversion register keeps its value");
+  obj_sim.setFaults(ADS1115_SIM_FAULT_OPEN_INPUT);
+  obj_sim.advanceTimeUs(2000);
+  check(obj_sim.getFaults() == ADS1115_SIM_FAULT_OPEN_INPUT, "fault setting reads back");
+  check((int16_t)obj_ads.readConversionRegister() == 32767, "broken wire drives the input to full scale");
+  obj_sim.setFaults(0);
+  obj_sim.advanceTimeUs(2000);
+  check((int16_t)obj_ads.readConversionRegister() == 6400, "conversions continue after the faults");
+}
+
+
+static void checkFilter(){
+  ADS1115SimTransport obj_sim;
+  ADS1115 obj_raw(&obj_sim);
+  ADS1115SimTransport obj_sim_filter;
+  ADS1115 obj_filter(&obj_sim_filter);
+  double f_raw_sq_sum = 0.;
+  double f_filter_sq_sum = 0.;
+  const int i_samples = 2000;
+
+  setupContinuous(&obj_raw, ADS1115_RATE_8);
+  setupContinuous(&obj_filter, ADS1115_RATE_8);
+  obj_filter.activateFilter();
+  check(obj_filter.getFilterStatus(), "filter is active");
+
+  // constant input: the filter output is the conversion
+  obj_sim_filter.setInputVoltage(ADS1115_MUX_AIN0_AIN1, 0.05F);
+  for (int i_conv = 0; i_conv < ADS1115_CONV_BUF_SIZE + 2; i_conv++){
+    obj_sim_filter.advanceTimeUs(125000);
+    obj_filter.getConvVal();
+  }
+  checkNear(obj_filter.getConvVal(), 6400.F, 0.01F, "filter passes a constant input");
+  check(obj_filter.isValueFrozen(), "constant codes look frozen");
+
+  // gaussian noise of 20 LSB: the average of the buffer reduces it by the square root of its length
+  obj_sim.setInputVoltage(ADS1115_MUX_AIN0_AIN1, 0.05F);
+  obj_sim.setNoise(20.F * CHECK_LSB_0P256, 7);
+  obj_sim_filter.setNoise(20.F * CHECK_LSB_0P256, 7);
+  for (int i_conv = 0; i_conv < ADS1115_CONV_BUF_SIZE + i_samples; i_conv++){
+    obj_sim.advanceTimeUs(125000);
+    obj_sim_filter.advanceTimeUs(125000);
+    float f_raw = obj_raw.getConvVal() - 6400.F;
+    float f_filter = obj_filter.getConvVal() - 6400.F;
+    if (i_conv >= ADS1115_CONV_BUF_SIZE){
+      f_raw_sq_sum += f_raw * f_raw;
+      f_filter_sq_sum += f_filter * f_filter;
+    }
+  }
+  float f_raw_rms = (float)sqrt(f_raw_sq_sum / i_samples);
+  float f_filter_rms = (float)sqrt(f_filter_sq_sum / i_samples);
+  checkNear(f_raw_rms, 20.F, 2.F, "noise of the emulator");
+  check(f_filter_rms < f_raw_rms * 1.3F / sqrtf(ADS1115_CONV_BUF_SIZE), "filter reduces the noise");
+  check(!obj_filter.isValueFrozen(), "noisy codes are not frozen");
+}
+
+
+static void checkPhysVal(){
+  ADS1115SimTransport obj_sim;
+  ADS1115 obj_ads(&obj_sim);
+  static float arr_table[3][2] = {{0.F, 0.F}, {0.1F, 50.F}, {0.2F, 150.F}};
+  static float arr_too_large[ADS1115_CONV_TABLE_MAX + 1][2];
+
+  setupContinuous(&obj_ads, ADS1115_RATE_860);
+  // the driver weighs the codes with its own LSB constant
+  const float f_volt = 6400.F * ADS1115_LSB_0P256;
+
+  // without a conversion the physical value is the voltage
+  checkNear(obj_ads.convertToPhysVal(6400.F), f_volt, 1e-7F, "no conversion gives the voltage");
+
+  obj_ads.setPhysConv(200.F, -5.F);
+  checkNear(obj_ads.convertToPhysVal(6400.F), 200.F * f_volt - 5.F, 1e-4F, "linear conversion");
+  obj_ads.setPhysConv(1000.F, 100.F, 1.F);
+  checkNear(obj_ads.convertToPhysVal(6400.F), 1000.F * f_volt * f_volt + 100.F * f_volt + 1.F, 1e-4F,
+            "quadratic conversion");
+
+  obj_ads.setPhysConv(arr_table, 3);
+  checkNear(obj_ads.convertToPhysVal(6400.F), 500.F * f_volt, 1e-3F, "table interpolates the first range");
+  checkNear(obj_ads.convertToPhysVal(19200.F), 1000.F * 3.F * f_volt - 50.F, 1e-3F,
+            "table interpolates the second range");
+  checkNear(obj_ads.convertToPhysVal(6400.5F), 500.F * (f_volt + 0.5F * ADS1115_LSB_0P256), 1e-4F,
+            "fractional conversion values");
+  checkNear(obj_ads.convertToPhysVal(-100.F), 0.F, 0.F, "below the table");
+  obj_ads.setPhysConv(arr_too_large, ADS1115_CONV_TABLE_MAX + 1);
+  checkNear(obj_ads.convertToPhysVal(6400.F), 500.F * f_volt, 1e-3F, "oversized table keeps the previous conversion");
+
+  // getPhysVal converts the latest conversion
+  obj_sim.setInputVoltage(ADS1115_MUX_AIN0_AIN1, 0.15F);
+  obj_sim.advanceTimeUs(2000);
+  checkNear(obj_ads.getPhysVal(), 100.F, 1000.F * 2.F * CHECK_LSB_0P256, "physical value of a conversion");
+}
+
+
+static void checkDecimator(){
+  ADS1115Decimator obj_decim;
+  int i_outputs = 0;
+  float f_max_abs = 0.F;
+
+  check(!obj_decim.setup(0, 2, 1), "CIC ratio 0 is rejected");
+  check(!obj_decim.setup(19, ADS1115_DECIM_FIR_MAX_RATIO + 1, 1), "FIR ratio above the maximum is rejected");
+  check(!obj_decim.setup(19, 2, ADS1115_DECIM_AVG_MAX_LEN + 1), "average above the maximum is rejected");
+  check(obj_decim.setup(19, 2, 19), "475 SPS mode of the firmware");
+  check(obj_decim.getCicRatio() == 19 && obj_decim.getFirRatio() == 2 && obj_decim.getAvgLen() == 19,
+        "settings read back");
+
+  // DC gain 1 and one output per R * D conversions
+  for (int i_conv = 0; i_conv < 38 * 100; i_conv++){
+    i_outputs += obj_decim.push(1000) ? 1 : 0;
+  }
+  check(i_outputs >= 96 && i_outputs <= 100, "one output per 38 conversions");
+  checkNear(obj_decim.getOutput(), 1000.F, 0.01F, "unity gain at DC");
+
+  // a range switch rescales the average, the output continues without a step
+  obj_decim.restart(16.F);
+  checkNear(obj_decim.getOutput(), 16000.F, 0.1F, "output is rescaled on restart");
+  bool b_continuous = true;
+  for (int i_conv = 0; i_conv < 38 * 40; i_conv++){
+    if (obj_decim.push(16000)){
+      b_continuous = b_continuous && fabsf(obj_decim.getOutput() - 16000.F) < 0.5F;
+    }
+  }
+  check(b_continuous, "output continues after a restart");
+  obj_decim.reset();
+  check(obj_decim.getOutputCount() == 0 && obj_decim.getOutput() == 0.F, "reset clears the output");
+
+  // 50 Hz hum at 475 SPS is on a CIC null, with 10 % oscillator deviation the average keeps it below -80 dB
+  const float arr_rates[3] = {475.F, 475.F * 1.1F, 475.F * 0.9F};
+  const char * arr_names[3] = {"50 Hz hum is rejected at the nominal rate", "50 Hz hum is damped at +10 % rate",
+                               "50 Hz hum is damped at -10 % rate"};
+  for (int i_rate = 0; i_rate < 3; i_rate++){
+    obj_decim.reset();
+    f_max_abs = 0.F;
+    for (int i_conv = 0; i_conv < 475 * 10; i_conv++){
+      float f_hum = 10000.F * sinf(2.F * (float)M_PI * 50.F * i_conv / arr_rates[i_rate]);
+      if (obj_decim.push((int16_t)lroundf(f_hum)) && i_conv > 475 * 3){
+        f_max_abs = fmaxf(f_max_abs, fabsf(obj_decim.getOutput()));
+      }
+    }
+    check(f_max_abs < 10000.F * 1e-4F, arr_names[i_rate]);
+  }
+
+  checkNear(obj_decim.getGroupDelay(), 3 * 18 / 2.F + 10 * 19 + 9 * 38, 1e-3F, "group delay in conversions");
+}
+
+
+int main(){
+  checkTransport();
+  checkFilter();
+  checkPhysVal();
+  checkDecimator();
+
+  if (s_i_failures){
+    printf("ads_check: %d checks FAILED\n", s_i_failures);
+  }
+  return s_i_failures ? 1 : 0;
+}
@@ -0,0 +1,1207 @@
+/*********
+ *
+ * coffee_bench
+ * Closed loop benchmark of the temperature control on a Linux host. The boiler model drives the ADS1115 emulator,
+ * the real driver chain (filter -> getPhysVal()) feeds the PID controller whose output switches the simulated SSR.
+ * A run heats up from cold, holds the target and pulls one shot. Results are printed as key=value lines.
+ * With --autotune=<rule> a relay auto tuning experiment runs first and its parameters are used for the run. The PID
+ * rules (zn_pid, tl_pid) give a derivative time of about 30 s which counters the shot within the slope window, the
+ * measured temperature falls slower than the 0.1 K/s of the slope detection. The shot is detected by the depth of the
+ * drop then (--brew-drop, 0 to detect by the slope only).
+ * With --identify=1 an open loop step test identifies the FOPDT model of the Smith predictor (--mode=smith). The
+ * Smith mode runs with its own gains (--smith-kp, --smith-ki, --smith-kd) as the firmware (CtrlSmith*Factor).
+ * With --linearity=1 the delivered heater power is measured for every output step of the selected SSR mode.
+ * With --adc-rate=475|860 the ADS1115 oversamples and the conversions pass the decimator as in the firmware
+ * (SigRateMode). --hum adds mains hum to the sensor voltage. The emulator samples the input at the end of a
+ * conversion, so the bench averages the hum over the conversion time and scales the noise with the square root of
+ * the data rate (--noise is the value at 8 SPS) to model the integrating converter. --noise-scaling=0 keeps the
+ * noise constant, as the datasheet specifies for the smallest full scale range where quantization dominates.
+ * --adc-clock changes the data rate by the relative deviation of the ADS1115 oscillator (datasheet: +-10 %), the
+ * firmware and the bench still assume the nominal rate.
+ * With --scan=1 the scan scheduler converts four channels (boiler, group head, reference, pressure) once spread over
+ * three devices and once on a single device, cycle time and accuracy of both layouts are compared.
+ * With --range-sweep=1 the sensor temperature ramps beyond the 0.256 V full scale range and the wire breaks at the
+ * end, with and without auto ranging of the PGA (--auto-range, default on as in the firmware).
+ * --adc-offset adds an input offset to all inputs of the ADS1115, --exc-error changes the bridge excitation relative to
+ * the nominal value of the conversion table. With --cal-interval=<s> the online calibration (SigCalInterval) measures
+ * a shorted input and a reference divider on the same excitation between the conversions of the boiler input.
+ * The fault manager of the firmware guards the heater output. --fault injects a fault at --fault-at for
+ * --fault-duration: nack (I2C), frozen (conversion register), open (broken wire), detach (sensor off the boiler,
+ * reads ambient) or ssr_stuck (SSR does not switch off).
+ *
+ * usage: coffee_bench [--key=value ...] [--csv=trace.csv] [--autotune=zn_pid|zn_pi|tl_pid|tl_pi|...]
+ *                     [--mode=pid|smith] [--smith-kp=<Kp>] [--smith-ki=<Tn>] [--smith-kd=<Tv>] [--identify=1]
+ *                     [--ssr-mode=pwm|burst] [--linearity=1]
+ *                     [--adc-rate=8|475|860] [--adc-clock=<rel>] [--hum=<V>] [--hum-freq=<Hz>]
+ *                     [--noise-scaling=0|1] [--scan=1]
+ *                     [--auto-range=0|1] [--range-sweep=1] [--adc-offset=<V>] [--exc-error=<rel>]
+ *                     [--cal-interval=<s>] [--fault=nack|frozen|open|detach|ssr_stuck] [--fault-at=<s>]
+ *                     [--fault-duration=<s>]
+ *
+*********/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include "ADS111x_sim.hpp"
+#include "ADS111x_decimator.hpp"
+#include "ADS111x_scan.hpp"
+#include "ADS111x_calib.hpp"
+#include "PIDCtrl.hpp"
+#include "PIDAutoTune.hpp"
+#include "BrewDetector.hpp"
+#include "SmithPredictor.hpp"
+#include "FaultManager.hpp"
+#include "BoilerSim.hpp"
+#include "BurstFire.hpp"
+
+#define BENCH_PLANT_STEP_S 0.01       // step of the simulation loop
+#define BENCH_SETTLE_BAND 0.5F        // temperature band around the target for settling and recovery in K
+#define BENCH_STEADY_WINDOW_S 60.     // window before the shot for the steady state error
+#define BENCH_CONV_TABLE_SIZE 16      // sample points of the Pt1000 lookup table (0..150 °C)
+#define BENCH_AUTOTUNE_HYSTERESIS 0.5F  // same settings as the firmware (autotune.hpp)
+#define BENCH_AUTOTUNE_CYCLES 4
+#define BENCH_AUTOTUNE_TIMEOUT_S 3600.F
+#define BENCH_AUTOTUNE_MARGIN 15.F
+#define BENCH_IDENT_INTERVAL_S 1.     // sample interval of the recorded step response
+#define BENCH_IDENT_MAX_SAMPLES 65536
+#define BENCH_LINEARITY_PERIODS 4     // burst periods (resolution half-waves) per output step of the linearity sweep
+#define BENCH_SCAN_DURATION_S 10.     // virtual time per scan layout
+#define BENCH_SCAN_CHANNELS 4
+#define BENCH_SWEEP_START_TEMP 20.F   // temperature ramp of the range sweep in °C
+#define BENCH_SWEEP_END_TEMP 148.F
+#define BENCH_SWEEP_RATE 0.5F         // K/s
+#define BENCH_SWEEP_FAULT_S 10.       // duration of the broken wire at the end of the sweep
+#define BENCH_CAL_REF_OHM 1385.F      // reference resistor of the calibration input (Pt1000 at 100 °C)
+#define BENCH_RDY_TIMEOUT_S 1.        // sample timeout of the measurement task (MEAS_RDY_TIMEOUT_MS)
+#define BENCH_TEMP_MIN 5.F            // limits of the fault manager as in the firmware (configFault() in main.cpp)
+#define BENCH_TEMP_MAX 160.F
+#define BENCH_TEMP_SAFETY_MAX 140.F
+
+enum eBenchFault {
+  BENCH_FAULT_NONE,
+  BENCH_FAULT_NACK,
+  BENCH_FAULT_FROZEN,
+  BENCH_FAULT_OPEN,
+  BENCH_FAULT_DETACH,
+  BENCH_FAULT_SSR_STUCK,
+  BENCH_FAULT_CNT
+};
+
+static const char * arrBenchFaultNames[BENCH_FAULT_CNT] = {"none", "nack", "frozen", "open", "detach", "ssr_stuck"};
+
+struct bench_config {
+  float fTarget;
+  float fPropFactor;
+  float fIntFactor;
+  float fDifFactor;
+  float fSmithPropFactor;     // gains of the Smith mode
+  float fSmithIntFactor;
+  float fSmithDifFactor;
+  bool bTimeFactor;
+  float fLowLimit;
+  float fHighLimit;
+  float fSsrFreq;
+  bool bSsrBurst;             // burst fire instead of the PWM
+  float fStartTemp;
+  double fDurationS;
+  double fBrewAtS;
+  float fBrewFlowMlS;
+  float fBrewDurationS;
+  float fNoiseVolt;           // noise at 8 SPS
+  bool bNoiseScaling;         // noise grows with the square root of the data rate
+  bool bFilterActive;
+  int iAdcRate;               // data rate in SPS: 8, 475 or 860
+  float fAdcClockError;       // relative deviation of the data rate from the nominal value
+  float fHumVolt;             // amplitude of the mains hum on the sensor voltage
+  float fHumFreqHz;
+  uint32_t iSeed;
+  const char * strCsvPath;
+  int iAutoTuneRule;          // -1: use the configured parameters
+  brew_params objBrew;        // shot detection and feed-forward boost
+  int iCtrlMode;              // eCtrlMode
+  fopdt_model objModel;       // plant model of the Smith predictor
+  bool bIdentify;             // identify objModel with a step test before the run
+  float fIdentifyStep;        // step of the manipulated variable
+  double fIdentifyDurationS;
+  bool bLinearity;            // measure the power linearity of the SSR output instead of the run
+  bool bScan;                 // compare the layouts of the scan scheduler instead of the run
+  bool bAutoRange;            // PGA auto ranging (SigAutoRange)
+  bool bRangeSweep;           // compare the measurement range with and without auto ranging instead of the run
+  float fAdcOffsetVolt;       // input offset of the ADS1115
+  float fExcError;            // relative deviation of the bridge excitation from the nominal value
+  float fCalInterval;         // online calibration interval in s, 0: off (SigCalInterval)
+  int iFault;                 // eBenchFault
+  double fFaultAtS;
+  double fFaultDurationS;
+};
+
+struct bench_result {
+  double fSettlingTimeS;      // heat-up: time until the water stays within the band
+  float fOvershoot;           // heat-up: maximum water temperature above target
+  float fSteadyStateError;    // mean absolute water temperature error before the shot
+  float fBrewDip;             // maximum drop below target during and after the shot
+  double fRecoveryTimeS;      // time from shot start until the water stays within the band
+  uint32_t iCtrlSteps;
+  double fCtrlStepMeanNs;
+  double fCtrlStepMaxNs;
+  double fRealTimeFactor;
+  double fHeaterEnergyKJ;
+  uint32_t iSsrSwitches;
+  float fMeasNoise;           // standard deviation of measured minus sensor temperature before the shot
+  float fMeasBias;            // mean of measured minus sensor temperature before the shot
+  ads1115_cal_status objCal;  // online calibration at the end of the run
+  uint32_t iFaultLatched;     // latched fault codes at the end of the run
+  int iFaultAction;           // most restrictive safe-state action of the run
+  double fFaultDetectS;       // first fault activation after the injection, -1 if none
+  float fFaultWaterMax;       // maximum water temperature after the injection
+  uint32_t iShots;            // shots detected by the brew detector
+  double fShotDetectDelayS;   // detection time after the start of the shot
+  brew_shot objShot;          // statistics of the first detected shot
+};
+
+// input of the ADS1115 emulator
+struct bench_input {
+  BoilerSim * ptrPlant;
+  float fHumVolt;
+  float fHumFreqHz;
+  float fConvTimeS;
+  float fExcitation;          // actual bridge excitation
+  float fAdcOffsetVolt;
+  bool bDetached;             // sensor is off the boiler and reads the ambient temperature
+};
+
+static volatile bool bConvReady = false;
+
+
+static float getCalRefVolt(float f_excitation){
+  /**
+   * Voltage of the reference divider of the calibration, against the excitation midpoint
+   */
+
+  return f_excitation * (BENCH_CAL_REF_OHM / (BENCH_CAL_REF_OHM + BOILERSIM_PT1000_R0) - 0.5F);
+}
+
+
+static float getSensorInput(int64_t i_time_us, uint8_t i_mux, void * ptr_ctx){
+  /**
+   * Input of the ADS1115 emulator: bridge voltage of the boiler model plus the hum averaged over the conversion, the
+   * calibration inputs are wired as in the firmware (CAL_ZERO_MUX, CAL_REF_MUX in main.cpp)
+   */
+
+  bench_input * ptr_input = (bench_input *)ptr_ctx;
+
+  if (i_mux == ADS1115_MUX_AIN1_AIN3){
+    return ptr_input->fAdcOffsetVolt;
+  }
+  if (i_mux == ADS1115_MUX_AIN2_AIN3){
+    return getCalRefVolt(ptr_input->fExcitation) + ptr_input->fAdcOffsetVolt;
+  }
+
+  float f_temp = ptr_input->bDetached ? BoilerSim::getDefaultParams().fAmbientTemp :
+                 ptr_input->ptrPlant->getSensorTemp();
+  float f_volt = BoilerSim::getBridgeVoltage(f_temp, ptr_input->fExcitation) + ptr_input->fAdcOffsetVolt;
+
+  if (ptr_input->fHumVolt != 0.F){
+    double f_omega = 2. * M_PI * ptr_input->fHumFreqHz;
+    double f_time_s = i_time_us / 1e6;
+    f_volt += ptr_input->fHumVolt * (cos(f_omega * (f_time_s - ptr_input->fConvTimeS)) - cos(f_omega * f_time_s)) /
+              (f_omega * ptr_input->fConvTimeS);
+  }
+  return f_volt;
+}
+
+
+static void onConvReady(int64_t i_time_us, void * ptr_ctx){
+  /**
+   * Emulated ALERT/RDY interrupt
+   */
+
+  bConvReady = true;
+}
+
+
+static bool getStuckGate(double f_time_s, void * ptr_ctx){
+  /**
+   * Gate of an SSR which does not switch off any more
+   */
+
+  return true;
+}
+
+
+static bool getBurstGate(double f_time_s, void * ptr_ctx){
+  /**
+   * Gate of the boiler model in burst fire mode, the zero crossings of the model drive the distribution
+   */
+
+  return ((BurstFire *)ptr_ctx)->nextHalfWave();
+}
+
+
+static void setupSsr(BoilerSim * ptr_plant, BurstFire * ptr_burst, const bench_config & obj_cfg){
+  /**
+   * Connect the SSR driver of the firmware (ssr.cpp) to the boiler model
+   */
+
+  ptr_burst->setResolution((uint32_t)obj_cfg.fHighLimit);
+  ptr_burst->reset();
+  ptr_plant->setGateFunction(obj_cfg.bSsrBurst ? getBurstGate : NULL, ptr_burst);
+}
+
+
+static void setSsrOutput(BoilerSim * ptr_plant, BurstFire * ptr_burst, const bench_config & obj_cfg, float f_output){
+  /**
+   * Apply the manipulated variable to the SSR, as setSsrDuty() of the firmware
+   */
+
+  if (obj_cfg.bSsrBurst){
+    ptr_burst->setLevel((uint32_t)(f_output + 0.5F));
+  } else {
+    ptr_plant->setSsrPwm(f_output / obj_cfg.fHighLimit, obj_cfg.fSsrFreq);
+  }
+}
+
+
+static void getDecimation(const bench_config & obj_cfg, int * ptr_cic_ratio, int * ptr_fir_ratio, int * ptr_avg_len){
+  /**
+   * Decimation ratios and average of the firmware sample modes (arrAdcRateModes in main.cpp)
+   */
+
+  *ptr_cic_ratio = (obj_cfg.iAdcRate == 475) ? 19 : ((obj_cfg.iAdcRate == 860) ? 43 : 1);
+  *ptr_fir_ratio = (obj_cfg.iAdcRate == 8) ? 1 : 2;
+  *ptr_avg_len = (obj_cfg.iAdcRate == 475) ? 19 : ((obj_cfg.iAdcRate == 860) ? 15 : 1);
+}
+
+
+static double getPlantStep(const bench_config & obj_cfg){
+  /**
+   * Step of the simulation loop, shorter than a conversion to see every conversion ready pulse
+   */
+
+  return (obj_cfg.iAdcRate > 100) ? 0.5 / obj_cfg.iAdcRate : BENCH_PLANT_STEP_S;
+}
+
+
+static void setupAdc(ADS1115SimTransport * ptr_sim, bench_input * ptr_input, BoilerSim * ptr_plant,
+                     const bench_config & obj_cfg){
+  /**
+   * Connect the emulator to the boiler model
+   */
+
+  ptr_input->ptrPlant = ptr_plant;
+  ptr_input->fHumVolt = obj_cfg.fHumVolt;
+  ptr_input->fHumFreqHz = obj_cfg.fHumFreqHz;
+  ptr_input->fConvTimeS = 1.F / (obj_cfg.iAdcRate * (1.F + obj_cfg.fAdcClockError));
+  ptr_input->fExcitation = BoilerSim::getDefaultParams().fBridgeVoltage * (1.F + obj_cfg.fExcError);
+  ptr_input->fAdcOffsetVolt = obj_cfg.fAdcOffsetVolt;
+  ptr_input->bDetached = false;
+  ptr_sim->setInputFunction(getSensorInput, ptr_input);
+  ptr_sim->setNoise(obj_cfg.fNoiseVolt * (obj_cfg.bNoiseScaling ? sqrtf(obj_cfg.iAdcRate / 8.F) : 1.F), obj_cfg.iSeed);
+  ptr_sim->setClockError(obj_cfg.fAdcClockError);
+  ptr_sim->setRdyCallback(onConvReady, NULL);
+}
+
+
+static bool readSample(ADS1115 * ptr_ads, ADS1115Calibrator * ptr_calib, ADS1115Decimator * ptr_decim,
+                       const bench_config & obj_cfg, float * ptr_value){
+  /**
+   * Read out a conversion as the measurement task of the firmware does
+   *
+   * @param ptr_value: physical value
+   * @return: false if the decimator has no new output yet
+   */
+
+  if (obj_cfg.iAdcRate == 8){
+    *ptr_value = ptr_ads->convertToPhysVal(ptr_calib->process());
+    return true;
+  }
+  uint8_t i_range = ptr_ads->getRange();
+  int16_t i_raw_value = (int16_t)ptr_calib->process();
+  if (!ptr_ads->getConnectionStatus()){
+    // the sample is reported as faulty, the decimator restarts with the next valid conversion
+    ptr_decim->reset();
+    *ptr_value = ptr_ads->convertToPhysVal(ptr_decim->getOutput());
+    return true;
+  }
+  if (ptr_ads->isRangeSettling() || i_range != ptr_ads->getRange()){
+    // CIC and FIR restart in the new range, the average is rescaled
+    ptr_decim->restart(ADS1115::getLsbVolt(i_range) / ADS1115::getLsbVolt(ptr_ads->getRange()));
+    return false;
+  }
+  if (!ptr_decim->push(i_raw_value)){
+    return false;
+  }
+  *ptr_value = ptr_ads->convertToPhysVal(ptr_decim->getOutput());
+  return true;
+}
+
+
+static void configADS1115(ADS1115 * ptr_ads, ADS1115Calibrator * ptr_calib, ADS1115Decimator * ptr_decim,
+                          const bench_config & obj_cfg){
+  /**
+   * Same configuration as the firmware (configADS1115() in main.cpp) plus a Pt1000 lookup table of the bridge
+   */
+
+  static float arr_conv_table[BENCH_CONV_TABLE_SIZE][2];
+  int i_cic_ratio;
+  int i_fir_ratio;
+  int i_avg_len;
+
+  getDecimation(obj_cfg, &i_cic_ratio, &i_fir_ratio, &i_avg_len);
+  ptr_decim->setup(i_cic_ratio, i_fir_ratio, i_avg_len);
+
+  ptr_ads->begin(0, 0, ADS1115_I2CADD_DEFAULT);
+  if (obj_cfg.bFilterActive && i_cic_ratio == 1){
+    ptr_ads->activateFilter();
+  }
+  ptr_ads->setCompPolarity(ADS1115_CMP_POL_ACTIVE_HIGH);
+  ptr_ads->setMux(ADS1115_MUX_AIN0_AIN1);
+  ptr_ads->setRate((obj_cfg.iAdcRate == 475) ? ADS1115_RATE_475 :
+                   ((obj_cfg.iAdcRate == 860) ? ADS1115_RATE_860 : ADS1115_RATE_8));
+
+  for (int i_row = 0; i_row < BENCH_CONV_TABLE_SIZE; i_row++){
+    float f_temp = 10.F * i_row;
+    arr_conv_table[i_row][0] = BoilerSim::getBridgeVoltage(f_temp, BoilerSim::getDefaultParams().fBridgeVoltage);
+    arr_conv_table[i_row][1] = f_temp;
+  }
+  ptr_ads->setPhysConv(arr_conv_table, BENCH_CONV_TABLE_SIZE);
+
+  ptr_ads->setPGA(ADS1115_PGA_0P256);
+  if (obj_cfg.bAutoRange){
+    ptr_ads->activateAutoRange(ADS1115_PGA_4P096, ADS1115_PGA_0P256);
+  }
+  ptr_ads->setCompLatchingMode(ADS1115_CMP_LAT_ACTIVE);
+  ptr_ads->setPinRdyMode(ADS1115_CONV_READY_ACTIVE, ADS1115_CMP_QUE_ASSERT_1_CONV);
+  ptr_ads->setOpMode(ADS1115_MODE_CONTINUOUS);
+
+  ptr_calib->setup(ptr_ads, ADS1115_MUX_AIN0_AIN1, ADS1115_MUX_AIN1_AIN3, ADS1115_MUX_AIN2_AIN3,
+                   getCalRefVolt(BoilerSim::getDefaultParams().fBridgeVoltage),
+                   (uint32_t)(obj_cfg.fCalInterval * obj_cfg.iAdcRate));
+}
+
+
+static bench_config getDefaultConfig(){
+  /**
+   * Defaults of the firmware configuration (resetConfiguration() in main.cpp)
+   */
+
+  bench_config obj_cfg;
+
+  obj_cfg.fTarget = 91.F;
+  obj_cfg.fPropFactor = 10.F;
+  obj_cfg.fIntFactor = 350.F;
+  obj_cfg.fDifFactor = 0.F;
+  obj_cfg.fSmithPropFactor = 80.F;
+  obj_cfg.fSmithIntFactor = 350.F;
+  obj_cfg.fSmithDifFactor = 0.F;
+  obj_cfg.bTimeFactor = true;
+  obj_cfg.fLowLimit = 0.F;
+  obj_cfg.fHighLimit = 255.F;
+  obj_cfg.fSsrFreq = 15.F;
+  obj_cfg.bSsrBurst = false;
+  obj_cfg.fStartTemp = 20.F;
+  obj_cfg.fDurationS = 1500.;
+  obj_cfg.fBrewAtS = 1200.;
+  obj_cfg.fBrewFlowMlS = 2.F;
+  obj_cfg.fBrewDurationS = 25.F;
+  obj_cfg.fNoiseVolt = 20e-6F;
+  obj_cfg.bFilterActive = true;
+  obj_cfg.iAdcRate = 8;
+  obj_cfg.fAdcClockError = 0.F;
+  obj_cfg.bNoiseScaling = true;
+  obj_cfg.fHumVolt = 0.F;
+  obj_cfg.fHumFreqHz = 50.F;
+  obj_cfg.iSeed = 1;
+  obj_cfg.strCsvPath = NULL;
+  obj_cfg.iAutoTuneRule = -1;
+  obj_cfg.objBrew = BrewDetector::getDefaultParams();
+  obj_cfg.iCtrlMode = CTRL_MODE_PID;
+  obj_cfg.objModel.fGain = 2.95F;
+  obj_cfg.objModel.fTimeConstS = 2386.F;
+  obj_cfg.objModel.fDeadTimeS = 11.6F;
+  obj_cfg.bIdentify = false;
+  obj_cfg.fIdentifyStep = 127.F;
+  obj_cfg.fIdentifyDurationS = 600.;
+  obj_cfg.bLinearity = false;
+  obj_cfg.bScan = false;
+  obj_cfg.bAutoRange = true;
+  obj_cfg.bRangeSweep = false;
+  obj_cfg.fAdcOffsetVolt = 0.F;
+  obj_cfg.fExcError = 0.F;
+  obj_cfg.fCalInterval = 0.F;
+  obj_cfg.iFault = BENCH_FAULT_NONE;
+  obj_cfg.fFaultAtS = 900.;
+  obj_cfg.fFaultDurationS = 300.;
+
+  return obj_cfg;
+}
+
+
+static bool parseArgument(const char * str_arg, bench_config * ptr_cfg){
+  /**
+   * Parse one --key=value argument
+   *
+   * @return: false if the argument is unknown
+   */
+
+  const char * ptr_value = strchr(str_arg, '=');
+
+  if (strncmp(str_arg, "--", 2) != 0 || !ptr_value){
+    return false;
+  }
+
+  size_t i_key_len = ptr_value - str_arg - 2;
+  const char * str_key = str_arg + 2;
+  ptr_value++;
+
+  #define BENCH_ARG(name) (i_key_len == strlen(name) && strncmp(str_key, name, i_key_len) == 0)
+  if (BENCH_ARG("target")) ptr_cfg->fTarget = atof(ptr_value);
+  else if (BENCH_ARG("kp")) ptr_cfg->fPropFactor = atof(ptr_value);
+  else if (BENCH_ARG("ki")) ptr_cfg->fIntFactor = atof(ptr_value);
+  else if (BENCH_ARG("kd")) ptr_cfg->fDifFactor = atof(ptr_value);
+  else if (BENCH_ARG("smith-kp")) ptr_cfg->fSmithPropFactor = atof(ptr_value);
+  else if (BENCH_ARG("smith-ki")) ptr_cfg->fSmithIntFactor = atof(ptr_value);
+  else if (BENCH_ARG("smith-kd")) ptr_cfg->fSmithDifFactor = atof(ptr_value);
+  else if (BENCH_ARG("time-factor")) ptr_cfg->bTimeFactor = atoi(ptr_value) != 0;
+  else if (BENCH_ARG("ssr-freq")) ptr_cfg->fSsrFreq = atof(ptr_value);
+  else if (BENCH_ARG("ssr-mode")){
+    if (strcmp(ptr_value, "pwm") == 0) ptr_cfg->bSsrBurst = false;
+    else if (strcmp(ptr_value, "burst") == 0) ptr_cfg->bSsrBurst = true;
+    else return false;
+  }
+  else if (BENCH_ARG("linearity")) ptr_cfg->bLinearity = atoi(ptr_value) != 0;
+  else if (BENCH_ARG("scan")) ptr_cfg->bScan = atoi(ptr_value) != 0;
+  else if (BENCH_ARG("auto-range")) ptr_cfg->bAutoRange = atoi(ptr_value) != 0;
+  else if (BENCH_ARG("range-sweep")) ptr_cfg->bRangeSweep = atoi(ptr_value) != 0;
+  else if (BENCH_ARG("adc-offset")) ptr_cfg->fAdcOffsetVolt = atof(ptr_value);
+  else if (BENCH_ARG("exc-error")) ptr_cfg->fExcError = atof(ptr_value);
+  else if (BENCH_ARG("cal-interval")) ptr_cfg->fCalInterval = atof(ptr_value);
+  else if (BENCH_ARG("fault")){
+    ptr_cfg->iFault = -1;
+    for (int i_fault = 0; i_fault < BENCH_FAULT_CNT; i_fault++){
+      if (strcmp(ptr_value, arrBenchFaultNames[i_fault]) == 0){
+        ptr_cfg->iFault = i_fault;
+      }
+    }
+    return ptr_cfg->iFault >= 0;
+  }
+  else if (BENCH_ARG("fault-at")) ptr_cfg->fFaultAtS = atof(ptr_value);
+  else if (BENCH_ARG("fault-duration")) ptr_cfg->fFaultDurationS = atof(ptr_value);
+  else if (BENCH_ARG("start-temp")) ptr_cfg->fStartTemp = atof(ptr_value);
+  else if (BENCH_ARG("duration")) ptr_cfg->fDurationS = atof(ptr_value);
+  else if (BENCH_ARG("brew-at")) ptr_cfg->fBrewAtS = atof(ptr_value);
+  else if (BENCH_ARG("brew-flow")) ptr_cfg->fBrewFlowMlS = atof(ptr_value);
+  else if (BENCH_ARG("brew-duration")) ptr_cfg->fBrewDurationS = atof(ptr_value);
+  else if (BENCH_ARG("noise")) ptr_cfg->fNoiseVolt = atof(ptr_value);
+  else if (BENCH_ARG("filter")) ptr_cfg->bFilterActive = atoi(ptr_value) != 0;
+  else if (BENCH_ARG("adc-rate")){
+    ptr_cfg->iAdcRate = atoi(ptr_value);
+    return ptr_cfg->iAdcRate == 8 || ptr_cfg->iAdcRate == 475 || ptr_cfg->iAdcRate == 860;
+  }
+  else if (BENCH_ARG("adc-clock")) ptr_cfg->fAdcClockError = atof(ptr_value);
+  else if (BENCH_ARG("noise-scaling")) ptr_cfg->bNoiseScaling = atoi(ptr_value) != 0;
+  else if (BENCH_ARG("hum")) ptr_cfg->fHumVolt = atof(ptr_value);
+  else if (BENCH_ARG("hum-freq")) ptr_cfg->fHumFreqHz = atof(ptr_value);
+  else if (BENCH_ARG("seed")) ptr_cfg->iSeed = atoi(ptr_value);
+  else if (BENCH_ARG("csv")) ptr_cfg->strCsvPath = ptr_value;
+  else if (BENCH_ARG("brew-detect")) ptr_cfg->objBrew.bSlopeDetect = atoi(ptr_value) != 0;
+  else if (BENCH_ARG("brew-slope")) ptr_cfg->objBrew.fSlopeThresh = atof(ptr_value);
+  else if (BENCH_ARG("brew-drop")) ptr_cfg->objBrew.fDropThresh = atof(ptr_value);
+  else if (BENCH_ARG("brew-switch")) ptr_cfg->objBrew.bSwitchDetect = atoi(ptr_value) != 0;
+  else if (BENCH_ARG("boost")) ptr_cfg->objBrew.fBoost = atof(ptr_value);
+  else if (BENCH_ARG("boost-hold")) ptr_cfg->objBrew.fBoostHoldS = atof(ptr_value);
+  else if (BENCH_ARG("boost-ramp")) ptr_cfg->objBrew.fBoostRampS = atof(ptr_value);
+  else if (BENCH_ARG("mode")){
+    if (strcmp(ptr_value, "pid") == 0) ptr_cfg->iCtrlMode = CTRL_MODE_PID;
+    else if (strcmp(ptr_value, "smith") == 0) ptr_cfg->iCtrlMode = CTRL_MODE_SMITH;
+    else return false;
+  }
+  else if (BENCH_ARG("model-gain")) ptr_cfg->objModel.fGain = atof(ptr_value);
+  else if (BENCH_ARG("model-tau")) ptr_cfg->objModel.fTimeConstS = atof(ptr_value);
+  else if (BENCH_ARG("model-dead")) ptr_cfg->objModel.fDeadTimeS = atof(ptr_value);
+  else if (BENCH_ARG("identify")) ptr_cfg->bIdentify = atoi(ptr_value) != 0;
+  else if (BENCH_ARG("identify-step")) ptr_cfg->fIdentifyStep = atof(ptr_value);
+  else if (BENCH_ARG("identify-duration")) ptr_cfg->fIdentifyDurationS = atof(ptr_value);
+  else if (BENCH_ARG("autotune")){
+    ptr_cfg->iAutoTuneRule = -1;
+    for (int i_rule = 0; i_rule < AUTOTUNE_RULE_CNT; i_rule++){
+      if (strcmp(ptr_value, PIDAutoTune::getRuleName(i_rule)) == 0){
+        ptr_cfg->iAutoTuneRule = i_rule;
+      }
+    }
+    return ptr_cfg->iAutoTuneRule >= 0;
+  }
+  else return false;
+  #undef BENCH_ARG
+
+  return true;
+}
+
+
+static bool runAutoTune(const bench_config & obj_cfg, autotune_result * ptr_result){
+  /**
+   * Run the relay experiment from the start temperature as the measurement task of the firmware does
+   *
+   * @return: false if the experiment failed
+   */
+
+  BoilerSim obj_plant;
+  ADS1115SimTransport obj_adc_sim;
+  ADS1115 obj_ads(&obj_adc_sim);
+  ADS1115Calibrator obj_calib;
+  ADS1115Decimator obj_decim;
+  bench_input obj_input;
+  PIDAutoTune obj_tuner;
+  BurstFire obj_burst;
+  double f_prev_ctrl_s = -1.;
+
+  obj_plant.reset(obj_cfg.fStartTemp);
+  setupSsr(&obj_plant, &obj_burst, obj_cfg);
+  setupAdc(&obj_adc_sim, &obj_input, &obj_plant, obj_cfg);
+  configADS1115(&obj_ads, &obj_calib, &obj_decim, obj_cfg);
+
+  obj_tuner.start(obj_cfg.fTarget, obj_cfg.fLowLimit, obj_cfg.fHighLimit, BENCH_AUTOTUNE_HYSTERESIS,
+                  BENCH_AUTOTUNE_CYCLES, obj_cfg.iAutoTuneRule, BENCH_AUTOTUNE_TIMEOUT_S,
+                  obj_cfg.fTarget + BENCH_AUTOTUNE_MARGIN);
+
+  while (obj_tuner.getState() == AUTOTUNE_STATE_RUNNING){
+    obj_plant.step(getPlantStep(obj_cfg));
+    int64_t i_delta_us = (int64_t)(obj_plant.getTimeS() * 1e6) - obj_adc_sim.getTimeUs();
+    if (i_delta_us > 0){
+      obj_adc_sim.advanceTimeUs(i_delta_us);
+    }
+
+    if (!bConvReady){
+      continue;
+    }
+    bConvReady = false;
+
+    float f_measured;
+    if (!readSample(&obj_ads, &obj_calib, &obj_decim, obj_cfg, &f_measured)){
+      continue;
+    }
+
+    double f_time_s = obj_plant.getTimeS();
+    float f_dt_s = (f_prev_ctrl_s < 0.) ? 0.F : (float)(f_time_s - f_prev_ctrl_s);
+    float f_output = obj_tuner.update(f_measured, f_dt_s);
+
+    f_prev_ctrl_s = f_time_s;
+    setSsrOutput(&obj_plant, &obj_burst, obj_cfg, f_output);
+  }
+
+  printf("autotune_rule=%s\n", PIDAutoTune::getRuleName(obj_cfg.iAutoTuneRule));
+  printf("autotune_duration_s=%.1f\n", obj_tuner.getElapsedS());
+  if (!obj_tuner.getResult(ptr_result)){
+    printf("autotune_error=%d\n", obj_tuner.getError());
+    return false;
+  }
+  printf("autotune_ku=%.3f\n", ptr_result->fUltimateGain);
+  printf("autotune_pu_s=%.1f\n", ptr_result->fUltimatePeriodS);
+  printf("autotune_amplitude_k=%.3f\n", ptr_result->fAmplitude);
+  printf("autotune_kp=%.3f\n", ptr_result->fPropFactor);
+  printf("autotune_tn_s=%.1f\n", ptr_result->fIntTimeS);
+  printf("autotune_tv_s=%.1f\n", ptr_result->fDifTimeS);
+  return true;
+}
+
+
+static bool runIdentify(const bench_config & obj_cfg, fopdt_model * ptr_model){
+  /**
+   * Open loop step test from the start temperature, the measured response is fitted with a FOPDT model
+   *
+   * @return: false if the model could not be identified
+   */
+
+  static float arr_response[BENCH_IDENT_MAX_SAMPLES];
+  BoilerSim obj_plant;
+  ADS1115SimTransport obj_adc_sim;
+  ADS1115 obj_ads(&obj_adc_sim);
+  ADS1115Calibrator obj_calib;
+  ADS1115Decimator obj_decim;
+  bench_input obj_input;
+  BurstFire obj_burst;
+  int i_cnt = 0;
+  double f_next_sample_s = 0.;
+
+  obj_plant.reset(obj_cfg.fStartTemp);
+  setupSsr(&obj_plant, &obj_burst, obj_cfg);
+  setupAdc(&obj_adc_sim, &obj_input, &obj_plant, obj_cfg);
+  configADS1115(&obj_ads, &obj_calib, &obj_decim, obj_cfg);
+  setSsrOutput(&obj_plant, &obj_burst, obj_cfg, obj_cfg.fIdentifyStep);
+
+  while (obj_plant.getTimeS() < obj_cfg.fIdentifyDurationS && i_cnt < BENCH_IDENT_MAX_SAMPLES){
+    obj_plant.step(getPlantStep(obj_cfg));
+    int64_t i_delta_us = (int64_t)(obj_plant.getTimeS() * 1e6) - obj_adc_sim.getTimeUs();
+    if (i_delta_us > 0){
+      obj_adc_sim.advanceTimeUs(i_delta_us);
+    }
+
+    if (!bConvReady){
+      continue;
+    }
+    bConvReady = false;
+
+    float f_measured;
+    if (!readSample(&obj_ads, &obj_calib, &obj_decim, obj_cfg, &f_measured)){
+      continue;
+    }
+    if (obj_plant.getTimeS() >= f_next_sample_s){
+      arr_response[i_cnt++] = f_measured;
+      f_next_sample_s += BENCH_IDENT_INTERVAL_S;
+    }
+  }
+
+  if (!SmithPredictor::identifyStep(arr_response, i_cnt, (float)BENCH_IDENT_INTERVAL_S, obj_cfg.fIdentifyStep,
+                                    ptr_model)){
+    printf("identify_error=1\n");
+    return false;
+  }
+  printf("identify_gain_k=%.3f\n", ptr_model->fGain);
+  printf("identify_time_const_s=%.1f\n", ptr_model->fTimeConstS);
+  printf("identify_dead_time_s=%.2f\n", ptr_model->fDeadTimeS);
+  return true;
+}
+
+
+static void setBenchFault(ADS1115SimTransport * ptr_sim, bench_input * ptr_input, BoilerSim * ptr_plant,
+                          BurstFire * ptr_burst, const bench_config & obj_cfg, bool b_active){
+  /**
+   * Inject or remove the fault of the run
+   */
+
+  uint32_t i_sim_faults = 0;
+
+  if (b_active && obj_cfg.iFault == BENCH_FAULT_NACK){
+    i_sim_faults = ADS1115_SIM_FAULT_NACK;
+  } else if (b_active && obj_cfg.iFault == BENCH_FAULT_FROZEN){
+    i_sim_faults = ADS1115_SIM_FAULT_FROZEN;
+  } else if (b_active && obj_cfg.iFault == BENCH_FAULT_OPEN){
+    i_sim_faults = ADS1115_SIM_FAULT_OPEN_INPUT;
+  }
+  ptr_sim->setFaults(i_sim_faults);
+  ptr_input->bDetached = b_active && obj_cfg.iFault == BENCH_FAULT_DETACH;
+  if (b_active && obj_cfg.iFault == BENCH_FAULT_SSR_STUCK){
+    ptr_plant->setGateFunction(getStuckGate, NULL);
+  } else {
+    setupSsr(ptr_plant, ptr_burst, obj_cfg);
+  }
+}
+
+
+static bench_result runBench(const bench_config & obj_cfg){
+  /**
+   * Run the closed loop simulation
+   */
+
+  bench_result obj_res = {};
+  BoilerSim obj_plant;
+  ADS1115SimTransport obj_adc_sim;
+  ADS1115 obj_ads(&obj_adc_sim);
+  ADS1115Calibrator obj_calib;
+  ADS1115Decimator obj_decim;
+  bench_input obj_input;
+  PIDCtrl obj_pid;
+  BrewDetector obj_brew;
+  SmithPredictor obj_smith;
+  BurstFire obj_burst;
+  FaultManager obj_faults;
+  fault_params obj_fault_params = FaultManager::getDefaultParams();
+  FILE * obj_csv = NULL;
+
+  obj_plant.reset(obj_cfg.fStartTemp);
+  setupSsr(&obj_plant, &obj_burst, obj_cfg);
+  setupAdc(&obj_adc_sim, &obj_input, &obj_plant, obj_cfg);
+  configADS1115(&obj_ads, &obj_calib, &obj_decim, obj_cfg);
+
+  obj_pid.setTarget(obj_cfg.fTarget);
+  if (obj_cfg.iCtrlMode == CTRL_MODE_SMITH){
+    obj_pid.setParameters(obj_cfg.fSmithPropFactor, obj_cfg.fSmithIntFactor, obj_cfg.fSmithDifFactor,
+                          obj_cfg.bTimeFactor);
+    obj_pid.activate(true, true, obj_cfg.fSmithDifFactor != 0.F);
+  } else {
+    obj_pid.setParameters(obj_cfg.fPropFactor, obj_cfg.fIntFactor, obj_cfg.fDifFactor, obj_cfg.bTimeFactor);
+    obj_pid.activate(true, true, obj_cfg.fDifFactor != 0.F);
+  }
+  obj_pid.setLimits(obj_cfg.fLowLimit, obj_cfg.fHighLimit);
+  obj_brew.setParams(obj_cfg.objBrew);
+  obj_brew.setTarget(obj_cfg.fTarget);
+  int i_cic_ratio;
+  int i_fir_ratio;
+  int i_avg_len;
+  getDecimation(obj_cfg, &i_cic_ratio, &i_fir_ratio, &i_avg_len);
+  obj_smith.setModel(obj_cfg.objModel, (float)i_cic_ratio * i_fir_ratio / obj_cfg.iAdcRate);
+  obj_fault_params.fOutputMax = obj_cfg.fHighLimit;
+  obj_fault_params.fTempMin = BENCH_TEMP_MIN;
+  obj_fault_params.fTempMax = BENCH_TEMP_MAX;
+  obj_fault_params.fOverTemp = BENCH_TEMP_SAFETY_MAX;
+  obj_faults.setParams(obj_fault_params);
+
+  if (obj_cfg.strCsvPath){
+    obj_csv = fopen(obj_cfg.strCsvPath, "w");
+    if (obj_csv){
+      fprintf(obj_csv, "time_s,water_temp,sensor_temp,measured_temp,output,feed_forward,brewing\n");
+    }
+  }
+
+  double f_last_outside_s = 0.;
+  double f_brew_last_outside_s = obj_cfg.fBrewAtS;
+  double f_steady_err_sum = 0.;
+  uint32_t i_steady_cnt = 0;
+  double f_noise_sum = 0.;
+  double f_noise_sq_sum = 0.;
+  uint32_t i_noise_cnt = 0;
+  float f_min_after_brew = obj_cfg.fTarget;
+  double f_prev_ctrl_s = -1.;
+  float f_prev_output = 0.F;
+  double f_step_sum_ns = 0.;
+  bool b_brew_started = false;
+  bool b_fault_active = false;
+  double f_last_rdy_s = 0.;
+  float f_heater_output = 0.F;
+
+  obj_res.fFaultDetectS = -1.;
+
+  auto t_wall_start = std::chrono::steady_clock::now();
+
+  while (obj_plant.getTimeS() < obj_cfg.fDurationS){
+    if (!b_brew_started && obj_plant.getTimeS() >= obj_cfg.fBrewAtS){
+      obj_plant.startBrew(obj_cfg.fBrewFlowMlS, obj_cfg.fBrewDurationS);
+      b_brew_started = true;
+    }
+    bool b_fault = obj_cfg.iFault != BENCH_FAULT_NONE && obj_plant.getTimeS() >= obj_cfg.fFaultAtS &&
+                   obj_plant.getTimeS() < obj_cfg.fFaultAtS + obj_cfg.fFaultDurationS;
+    if (b_fault != b_fault_active){
+      setBenchFault(&obj_adc_sim, &obj_input, &obj_plant, &obj_burst, obj_cfg, b_fault);
+      b_fault_active = b_fault;
+    }
+
+    obj_plant.step(getPlantStep(obj_cfg));
+    int64_t i_delta_us = (int64_t)(obj_plant.getTimeS() * 1e6) - obj_adc_sim.getTimeUs();
+    if (i_delta_us > 0){
+      obj_adc_sim.advanceTimeUs(i_delta_us);
+    }
+
+    double f_time_s = obj_plant.getTimeS();
+    float f_water = obj_plant.getWaterTemp();
+
+    // heat-up and brew statistics on the true water temperature
+    if (f_time_s < obj_cfg.fBrewAtS){
+      if (fabsf(f_water - obj_cfg.fTarget) > BENCH_SETTLE_BAND){
+        f_last_outside_s = f_time_s;
+      }
+      obj_res.fOvershoot = fmaxf(obj_res.fOvershoot, f_water - obj_cfg.fTarget);
+      if (f_time_s >= obj_cfg.fBrewAtS - BENCH_STEADY_WINDOW_S){
+        f_steady_err_sum += fabsf(f_water - obj_cfg.fTarget);
+        i_steady_cnt++;
+      }
+    } else {
+      if (fabsf(f_water - obj_cfg.fTarget) > BENCH_SETTLE_BAND){
+        f_brew_last_outside_s = f_time_s;
+      }
+      f_min_after_brew = fminf(f_min_after_brew, f_water);
+    }
+    if (obj_cfg.iFault != BENCH_FAULT_NONE && f_time_s >= obj_cfg.fFaultAtS){
+      obj_res.fFaultWaterMax = fmaxf(obj_res.fFaultWaterMax, f_water);
+      if (obj_res.fFaultDetectS < 0. && obj_faults.getLatchedMask() != 0){
+        obj_res.fFaultDetectS = f_time_s - obj_cfg.fFaultAtS;
+      }
+    }
+
+    fault_input obj_fault_input;
+    obj_fault_input.fTimeS = f_time_s;
+    obj_fault_input.fTarget = obj_cfg.fTarget;
+    obj_fault_input.fOutput = f_heater_output;
+    obj_fault_input.bBrewing = obj_brew.getState() != BREW_STATE_IDLE;
+
+    if (!bConvReady){
+      if (f_time_s - f_last_rdy_s >= BENCH_RDY_TIMEOUT_S){
+        // sample timeout of the measurement task
+        f_last_rdy_s = f_time_s;
+        obj_fault_input.bSample = false;
+        obj_fault_input.bI2cError = false;
+        obj_fault_input.bFrozen = false;
+        obj_fault_input.fTemperature = 0.F;
+        if (obj_faults.update(obj_fault_input) > FAULT_ACTION_CAP){
+          obj_pid.reset();
+          obj_smith.reset();
+          f_prev_ctrl_s = -1.;
+          f_prev_output = 0.F;
+        }
+        f_heater_output = obj_faults.limitOutput(f_heater_output);
+        setSsrOutput(&obj_plant, &obj_burst, obj_cfg, f_heater_output);
+      }
+      continue;
+    }
+    bConvReady = false;
+    f_last_rdy_s = f_time_s;
+
+    // control step as in the measurement task of the firmware
+    auto t_step_start = std::chrono::steady_clock::now();
+    float f_measured;
+    if (!readSample(&obj_ads, &obj_calib, &obj_decim, obj_cfg, &f_measured)){
+      continue;
+    }
+    obj_fault_input.bSample = true;
+    obj_fault_input.bI2cError = !obj_ads.getConnectionStatus();
+    obj_fault_input.bFrozen = obj_ads.isValueFrozen();
+    obj_fault_input.fTemperature = f_measured;
+    int i_fault_action = obj_faults.update(obj_fault_input);
+    obj_res.iFaultAction = (i_fault_action > obj_res.iFaultAction) ? i_fault_action : obj_res.iFaultAction;
+
+    float f_output = 0.F;
+    float f_feed_forward = 0.F;
+    if (obj_faults.isSampleUsable() && i_fault_action <= FAULT_ACTION_CAP){
+      float f_dt_s = (f_prev_ctrl_s < 0.) ? 0.F : (float)(f_time_s - f_prev_ctrl_s);
+      float f_feedback = f_measured;
+      if (obj_cfg.iCtrlMode == CTRL_MODE_SMITH){
+        obj_smith.update(f_prev_output, f_dt_s);
+        f_feedback = obj_smith.getFeedback(f_measured);
+      }
+      f_output = obj_pid.update(f_feedback, f_dt_s);
+      // the pump switch of the machine is the brewing state of the plant
+      f_feed_forward = obj_brew.update(f_time_s, f_measured, obj_plant.isBrewing());
+      f_output = fminf(f_output + f_feed_forward, obj_cfg.fHighLimit);
+      f_prev_output = f_output;
+      f_prev_ctrl_s = f_time_s;
+    } else if (i_fault_action == FAULT_ACTION_CAP){
+      // short signal dropout: the controller keeps its state, the previous output is held
+      f_output = f_heater_output;
+    } else {
+      obj_pid.reset();
+      obj_smith.reset();
+      f_prev_ctrl_s = -1.;
+      f_prev_output = 0.F;
+    }
+    f_output = obj_faults.limitOutput(f_output);
+    f_heater_output = f_output;
+    auto t_step_end = std::chrono::steady_clock::now();
+
+    setSsrOutput(&obj_plant, &obj_burst, obj_cfg, f_output);
+
+    if (f_time_s < obj_cfg.fBrewAtS && f_time_s >= obj_cfg.fBrewAtS - BENCH_STEADY_WINDOW_S){
+      float f_noise = f_measured - obj_plant.getSensorTemp();
+      f_noise_sum += f_noise;
+      f_noise_sq_sum += f_noise * f_noise;
+      i_noise_cnt++;
+    }
+
+    double f_step_ns = std::chrono::duration<double, std::nano>(t_step_end - t_step_start).count();
+    f_step_sum_ns += f_step_ns;
+    obj_res.fCtrlStepMaxNs = fmax(obj_res.fCtrlStepMaxNs, f_step_ns);
+    obj_res.iCtrlSteps++;
+
+    if (obj_csv){
+      fprintf(obj_csv, "%.3f,%.3f,%.3f,%.3f,%.1f,%.1f,%d\n", f_time_s, f_water, obj_plant.getSensorTemp(), f_measured,
+              f_output, f_feed_forward, obj_plant.isBrewing() ? 1 : 0);
+    }
+  }
+
+  double f_wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_wall_start).count();
+
+  obj_res.fSettlingTimeS = f_last_outside_s;
+  obj_res.fSteadyStateError = (i_steady_cnt > 0) ? (float)(f_steady_err_sum / i_steady_cnt) : 0.F;
+  if (i_noise_cnt > 0){
+    // the mean is the error of the conversion table
+    double f_noise_mean = f_noise_sum / i_noise_cnt;
+    obj_res.fMeasNoise = (float)sqrt(fmax(f_noise_sq_sum / i_noise_cnt - f_noise_mean * f_noise_mean, 0.));
+    obj_res.fMeasBias = (float)f_noise_mean;
+  }
+  obj_calib.getStatus(&obj_res.objCal);
+  obj_res.iFaultLatched = obj_faults.getLatchedMask();
+  obj_res.fBrewDip = obj_cfg.fTarget - f_min_after_brew;
+  obj_res.fRecoveryTimeS = f_brew_last_outside_s - obj_cfg.fBrewAtS;
+  obj_res.fCtrlStepMeanNs = (obj_res.iCtrlSteps > 0) ? f_step_sum_ns / obj_res.iCtrlSteps : 0.;
+  obj_res.fRealTimeFactor = (f_wall_s > 0.) ? obj_cfg.fDurationS / f_wall_s : 0.;
+  obj_res.fHeaterEnergyKJ = obj_plant.getHeaterEnergyJ() / 1000.;
+  obj_res.iSsrSwitches = obj_plant.getSsrSwitchCount();
+  obj_res.iShots = obj_brew.getShotCount();
+  if (obj_brew.getShot(obj_res.iShots - 1, &obj_res.objShot)){
+    obj_res.fShotDetectDelayS = obj_res.objShot.fStartS - obj_cfg.fBrewAtS;
+  }
+
+  if (obj_csv){
+    fclose(obj_csv);
+  }
+  return obj_res;
+}
+
+
+static void runLinearity(const bench_config & obj_cfg){
+  /**
+   * Open loop sweep over all output steps, the delivered heater energy is compared with the ideal linear power
+   */
+
+  BoilerSim obj_plant;
+  BurstFire obj_burst;
+  boiler_sim_params obj_params = BoilerSim::getDefaultParams();
+  double f_step_s = BENCH_LINEARITY_PERIODS * obj_cfg.fHighLimit * 0.5 / obj_params.fMainsFreqHz;
+  double f_err_max = 0.;
+  double f_err_sq_sum = 0.;
+  int i_steps = (int)obj_cfg.fHighLimit;
+
+  setupSsr(&obj_plant, &obj_burst, obj_cfg);
+  for (int i_output = 0; i_output <= i_steps; i_output++){
+    double f_energy_start_j = obj_plant.getHeaterEnergyJ();
+
+    setSsrOutput(&obj_plant, &obj_burst, obj_cfg, (float)i_output);
+    obj_plant.step(f_step_s);
+
+    double f_power = (obj_plant.getHeaterEnergyJ() - f_energy_start_j) / f_step_s / obj_params.fHeaterPowerW;
+    double f_err = fabs(f_power - i_output / obj_cfg.fHighLimit);
+    f_err_max = fmax(f_err_max, f_err);
+    f_err_sq_sum += f_err * f_err;
+  }
+
+  printf("linearity_steps=%d\n", i_steps + 1);
+  printf("linearity_error_max_percent=%.3f\n", f_err_max * 100.);
+  printf("linearity_error_rms_percent=%.3f\n", sqrt(f_err_sq_sum / (i_steps + 1)) * 100.);
+  printf("ssr_switches=%u\n", obj_plant.getSsrSwitchCount());
+}
+
+
+static float getSweepInput(int64_t i_time_us, uint8_t i_mux, void * ptr_ctx){
+  /**
+   * Input of the range sweep: bridge voltage of a temperature ramp
+   */
+
+  float f_temp = fminf(BENCH_SWEEP_START_TEMP + BENCH_SWEEP_RATE * i_time_us / 1e6F, BENCH_SWEEP_END_TEMP);
+  return BoilerSim::getBridgeVoltage(f_temp, BoilerSim::getDefaultParams().fBridgeVoltage);
+}
+
+
+static void runRangeSweep(const bench_config & obj_cfg, const char * str_mode, bool b_auto_range){
+  /**
+   * Ramp the sensor temperature beyond the smallest full scale range and break the wire at the end. Measured values
+   * are compared with the ramp delayed by the group delay of the filter, steps of the output show discontinuities at
+   * range switches.
+   */
+
+  bench_config obj_sweep_cfg = obj_cfg;
+  ADS1115SimTransport obj_adc_sim;
+  ADS1115 obj_ads(&obj_adc_sim);
+  ADS1115Calibrator obj_calib;
+  ADS1115Decimator obj_decim;
+  double f_ramp_end_s = (BENCH_SWEEP_END_TEMP - BENCH_SWEEP_START_TEMP) / BENCH_SWEEP_RATE;
+  float f_err_max = 0.F;
+  float f_step_err_max = 0.F;
+  float f_prev_value = NAN;
+  float f_fault_value = 0.F;
+  float f_delay_s = 0.F;
+  int i_settle_samples = 0;
+
+  obj_sweep_cfg.bAutoRange = b_auto_range;
+  obj_sweep_cfg.fCalInterval = 0.F; // the sweep input has no calibration inputs
+  obj_adc_sim.setInputFunction(getSweepInput, NULL);
+  obj_adc_sim.setNoise(obj_cfg.fNoiseVolt * (obj_cfg.bNoiseScaling ? sqrtf(obj_cfg.iAdcRate / 8.F) : 1.F),
+                       obj_cfg.iSeed);
+  obj_adc_sim.setClockError(obj_cfg.fAdcClockError);
+  obj_adc_sim.setRdyCallback(onConvReady, NULL);
+  configADS1115(&obj_ads, &obj_calib, &obj_decim, obj_sweep_cfg);
+
+  if (obj_cfg.iAdcRate == 8){
+    // moving average over the conversion buffer
+    f_delay_s = (obj_cfg.bFilterActive ? 0.5F * (ADS1115_CONV_BUF_SIZE - 1) : 0.F) / obj_cfg.iAdcRate;
+  } else {
+    f_delay_s = obj_decim.getGroupDelay() / obj_cfg.iAdcRate;
+  }
+
+  while (obj_adc_sim.getTimeUs() < (f_ramp_end_s + BENCH_SWEEP_FAULT_S) * 1e6){
+    double f_time_s = obj_adc_sim.getTimeUs() / 1e6;
+    float f_value;
+
+    obj_adc_sim.setFaults((f_time_s >= f_ramp_end_s) ? ADS1115_SIM_FAULT_OPEN_INPUT : 0);
+    obj_adc_sim.advanceTimeUs((int64_t)(getPlantStep(obj_cfg) * 1e6));
+    if (!bConvReady){
+      continue;
+    }
+    bConvReady = false;
+    if (!readSample(&obj_ads, &obj_calib, &obj_decim, obj_cfg, &f_value)){
+      continue;
+    }
+
+    float f_true = fminf(BENCH_SWEEP_START_TEMP + BENCH_SWEEP_RATE * (float)(f_time_s - f_delay_s),
+                         BENCH_SWEEP_END_TEMP);
+    if (f_time_s >= f_ramp_end_s){
+      f_fault_value = f_value;
+      continue;
+    }
+    // skip the filter start-up
+    if (++i_settle_samples <= ADS1115_CONV_BUF_SIZE){
+      f_prev_value = f_value;
+      continue;
+    }
+    f_err_max = fmaxf(f_err_max, fabsf(f_value - f_true));
+    f_step_err_max = fmaxf(f_step_err_max, fabsf(f_value - f_prev_value) - BENCH_SWEEP_RATE / obj_cfg.iAdcRate);
+    f_prev_value = f_value;
+  }
+
+  printf("range_%s_error_max_k=%.3f\n", str_mode, f_err_max);
+  printf("range_%s_step_error_max_k=%.3f\n", str_mode, f_step_err_max);
+  printf("range_%s_switches=%u\n", str_mode, obj_ads.getRangeSwitchCount());
+  printf("range_%s_final_pga=%u\n", str_mode, obj_ads.getRange());
+  printf("range_%s_open_wire_temp=%.1f\n", str_mode, f_fault_value);
+}
+
+
+static void runScanLayout(const bench_config & obj_cfg, const char * str_layout, bool b_parallel){
+  /**
+   * Scan boiler, group head, reference and pressure channel, either on three devices or all on the default device.
+   * The inputs are constant voltages with noise, the error is the mean absolute deviation of the conversions.
+   */
+
+  const char * arr_names[BENCH_SCAN_CHANNELS] = {"boiler", "group_head", "reference", "pressure"};
+  float f_excitation = BoilerSim::getDefaultParams().fBridgeVoltage;
+  float arr_volts[BENCH_SCAN_CHANNELS] = {BoilerSim::getBridgeVoltage(93.F, f_excitation),
+                                          BoilerSim::getBridgeVoltage(88.F, f_excitation), 2.5F, 1.3F};
+  ads1115_scan_channel arr_channels[BENCH_SCAN_CHANNELS] = {
+    {ADS1115_I2CADD_DEFAULT, ADS1115_MUX_AIN0_AIN1, ADS1115_PGA_0P256, ADS1115_RATE_128, 0},
+    {ADS1115_I2CADD_ADDR_VDD, ADS1115_MUX_AIN2_AIN3, ADS1115_PGA_0P256, ADS1115_RATE_128, 0},
+    {ADS1115_I2CADD_ADDR_VDD, ADS1115_MUX_AIN0_GND, ADS1115_PGA_4P096, ADS1115_RATE_128, 500},
+    {ADS1115_I2CADD_ADDR_SDA, ADS1115_MUX_AIN1_GND, ADS1115_PGA_4P096, ADS1115_RATE_128, 0},
+  };
+  double arr_err_sum[BENCH_SCAN_CHANNELS] = {};
+  uint32_t arr_err_cnt[BENCH_SCAN_CHANNELS] = {};
+  uint32_t arr_prev_cnt[BENCH_SCAN_CHANNELS] = {};
+  ADS1115SimTransport arr_devices[3] = {ADS1115SimTransport(ADS1115_I2CADD_DEFAULT),
+                                        ADS1115SimTransport(ADS1115_I2CADD_ADDR_VDD),
+                                        ADS1115SimTransport(ADS1115_I2CADD_ADDR_SDA)};
+  ADS1115SimBus obj_bus;
+  ADS1115Scanner obj_scanner;
+
+  for (int i_ch = 0; i_ch < BENCH_SCAN_CHANNELS; i_ch++){
+    if (!b_parallel){
+      arr_channels[i_ch].iAddress = ADS1115_I2CADD_DEFAULT;
+    }
+    for (int i_dev = 0; i_dev < 3; i_dev++){
+      arr_devices[i_dev].setInputVoltage(arr_channels[i_ch].iMux, arr_volts[i_ch]);
+    }
+  }
+  for (int i_dev = 0; i_dev < 3; i_dev++){
+    arr_devices[i_dev].setNoise(obj_cfg.fNoiseVolt, obj_cfg.iSeed + i_dev);
+    obj_bus.addDevice(&arr_devices[i_dev]);
+  }
+
+  obj_scanner.setTransport(&obj_bus);
+  obj_scanner.setChannels(arr_channels, BENCH_SCAN_CHANNELS);
+  obj_scanner.start();
+
+  while (obj_bus.getTimeUs() < BENCH_SCAN_DURATION_S * 1e6){
+    obj_bus.advanceTimeUs(obj_scanner.service() - obj_bus.getTimeUs());
+
+    for (int i_ch = 0; i_ch < BENCH_SCAN_CHANNELS; i_ch++){
+      ads1115_scan_result obj_result;
+      obj_scanner.getResult(i_ch, &obj_result);
+      if (obj_result.iCount != arr_prev_cnt[i_ch]){
+        arr_err_sum[i_ch] += fabs(obj_result.fVoltage - arr_volts[i_ch]);
+        arr_err_cnt[i_ch]++;
+        arr_prev_cnt[i_ch] = obj_result.iCount;
+      }
+    }
+  }
+
+  printf("scan_%s_devices=%d\n", str_layout, obj_scanner.getDeviceCount());
+  printf("scan_%s_cycles_per_s=%.1f\n", str_layout, obj_scanner.getCycleCount() / BENCH_SCAN_DURATION_S);
+  printf("scan_%s_cycle_us=%u\n", str_layout, obj_scanner.getCycleTimeUs());
+  printf("scan_%s_bus_load_percent=%.1f\n", str_layout,
+         obj_bus.getTransactionCount() * ADS1115_SIM_TRANSACTION_US / (BENCH_SCAN_DURATION_S * 1e4));
+  for (int i_ch = 0; i_ch < BENCH_SCAN_CHANNELS; i_ch++){
+    ads1115_scan_result obj_result;
+    obj_scanner.getResult(i_ch, &obj_result);
+    printf("scan_%s_%s_error_uv=%.1f\n", str_layout, arr_names[i_ch],
+           (arr_err_cnt[i_ch] > 0) ? arr_err_sum[i_ch] / arr_err_cnt[i_ch] * 1e6 : 0.);
+    printf("scan_%s_%s_errors=%u\n", str_layout, arr_names[i_ch], obj_result.iErrors);
+  }
+}
+
+
+int main(int argc, char ** argv){
+  bench_config obj_cfg = getDefaultConfig();
+
+  for (int i_arg = 1; i_arg < argc; i_arg++){
+    if (!parseArgument(argv[i_arg], &obj_cfg)){
+      fprintf(stderr, "unknown argument %s\n", argv[i_arg]);
+      return 2;
+    }
+  }
+
+  if (obj_cfg.bLinearity){
+    runLinearity(obj_cfg);
+    return 0;
+  }
+
+  if (obj_cfg.bRangeSweep){
+    runRangeSweep(obj_cfg, "fixed", false);
+    runRangeSweep(obj_cfg, "auto", true);
+    return 0;
+  }
+
+  if (obj_cfg.bScan){
+    runScanLayout(obj_cfg, "parallel", true);
+    runScanLayout(obj_cfg, "single", false);
+    return 0;
+  }
+
+  if (obj_cfg.iAutoTuneRule >= 0){
+    autotune_result obj_tune_res;
+
+    if (!runAutoTune(obj_cfg, &obj_tune_res)){
+      return 1;
+    }
+    // parameters in time constant form as written into the firmware configuration
+    obj_cfg.fPropFactor = obj_tune_res.fPropFactor;
+    obj_cfg.fIntFactor = obj_tune_res.fIntTimeS;
+    obj_cfg.fDifFactor = obj_tune_res.fDifTimeS;
+    obj_cfg.bTimeFactor = true;
+  }
+
+  if (obj_cfg.bIdentify && !runIdentify(obj_cfg, &obj_cfg.objModel)){
+    return 1;
+  }
+
+  bench_result obj_res = runBench(obj_cfg);
+
+  printf("settling_time_s=%.1f\n", obj_res.fSettlingTimeS);
+  printf("overshoot_k=%.3f\n", obj_res.fOvershoot);
+  printf("steady_state_error_k=%.3f\n", obj_res.fSteadyStateError);
+  printf("meas_noise_k=%.4f\n", obj_res.fMeasNoise);
+  printf("meas_bias_k=%.3f\n", obj_res.fMeasBias);
+  printf("faults_latched=");
+  for (int i_code = 0, i_cnt = 0; i_code < FAULT_CNT; i_code++){
+    if (obj_res.iFaultLatched & FAULT_BIT(i_code)){
+      printf("%s%s", (i_cnt++ > 0) ? "," : "", FaultManager::getFaultName(i_code));
+    }
+  }
+  printf("%s\n", (obj_res.iFaultLatched == 0) ? "none" : "");
+  printf("fault_action_max=%s\n", FaultManager::getActionName(obj_res.iFaultAction));
+  if (obj_cfg.iFault != BENCH_FAULT_NONE){
+    printf("fault_detect_s=%.2f\n", obj_res.fFaultDetectS);
+    printf("fault_water_max=%.2f\n", obj_res.fFaultWaterMax);
+  }
+  if (obj_cfg.fCalInterval > 0.F){
+    printf("cal_offset_uv=%.2f\n", obj_res.objCal.fOffsetVolt * 1e6F);
+    printf("cal_gain=%.5f\n", obj_res.objCal.fGain);
+    printf("cal_measurements=%u\n", obj_res.objCal.iZeroCnt + obj_res.objCal.iRefCnt);
+    printf("cal_rejected=%u\n", obj_res.objCal.iRejectCnt);
+    printf("cal_substituted=%u\n", obj_res.objCal.iSubstituteCnt);
+  }
+  printf("brew_dip_k=%.3f\n", obj_res.fBrewDip);
+  printf("brew_recovery_s=%.1f\n", obj_res.fRecoveryTimeS);
+  printf("ctrl_steps=%u\n", obj_res.iCtrlSteps);
+  printf("ctrl_step_mean_ns=%.0f\n", obj_res.fCtrlStepMeanNs);
+  printf("ctrl_step_max_ns=%.0f\n", obj_res.fCtrlStepMaxNs);
+  printf("real_time_factor=%.0f\n", obj_res.fRealTimeFactor);
+  printf("heater_energy_kj=%.1f\n", obj_res.fHeaterEnergyKJ);
+  printf("ssr_switches=%u\n", obj_res.iSsrSwitches);
+  printf("shots_detected=%u\n", obj_res.iShots);
+  if (obj_res.iShots > 0){
+    printf("shot_detect_delay_s=%.1f\n", obj_res.fShotDetectDelayS);
+    printf("shot_dip_k=%.3f\n", obj_res.objShot.fDip);
+    printf("shot_recovery_s=%.1f\n", obj_res.objShot.fRecoveryS);
+    printf("shot_boost_integral=%.0f\n", obj_res.objShot.fBoostIntegral);
+  }
+
+  return 0;
+}
@@ -0,0 +1,58 @@
+# Run a coffee_bench scenario and compare its key=value results with limits, used by ctest:
+#   cmake -DBENCH=<coffee_bench> "-DARGS=--autotune=zn_pid" "-DCHECKS=shots_detected>=1,overshoot_k<3" \
+#         -P check_bench.cmake
+# A check is <key><op><limit> with the operators <, <=, > and >=, checks are separated by commas.
+
+separate_arguments(bench_args UNIX_COMMAND "${ARGS}")
+execute_process(COMMAND "${BENCH}" ${bench_args} OUTPUT_VARIABLE output RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "coffee_bench ${ARGS} failed (${result}):\n${output}")
+endif()
+
+string(REPLACE "," ";" checks "${CHECKS}")
+set(failed "")
+foreach(check IN LISTS checks)
+  if(NOT check MATCHES "^([a-z0-9_]+)(<=|>=|<|>)(-?[0-9.]+)$")
+    message(FATAL_ERROR "invalid check ${check}")
+  endif()
+  set(key "${CMAKE_MATCH_1}")
+  set(op "${CMAKE_MATCH_2}")
+  set(limit "${CMAKE_MATCH_3}")
+  if(NOT output MATCHES "(^|\n)${key}=(-?[0-9.]+)")
+    message(FATAL_ERROR "coffee_bench ${ARGS} does not report ${key}:\n${output}")
+  endif()
+  set(value "${CMAKE_MATCH_2}")
+
+  if(op STREQUAL "<")
+    set(pass 0)
+    if(value LESS limit)
+      set(pass 1)
+    endif()
+  elseif(op STREQUAL "<=")
+    set(pass 0)
+    if(NOT value GREATER limit)
+      set(pass 1)
+    endif()
+  elseif(op STREQUAL ">")
+    set(pass 0)
+    if(value GREATER limit)
+      set(pass 1)
+    endif()
+  else()
+    set(pass 0)
+    if(NOT value LESS limit)
+      set(pass 1)
+    endif()
+  endif()
+
+  if(pass)
+    message(STATUS "${key}=${value} (${op}${limit})")
+  else()
+    list(APPEND failed "${key}=${value}, expected ${op}${limit}")
+  endif()
+endforeach()
+
+if(failed)
+  string(REPLACE ";" "\n  " failed "${failed}")
+  message(FATAL_ERROR "coffee_bench ${ARGS}:\n  ${failed}")
+endif()
@@ -0,0 +1,428 @@
+/*********
+ *
+ * coffee_httpd_model
+ * Host model of the web server of the device, the counterpart of coffee_loadgen when no device is at hand. It
+ * reproduces the parts of esp_http_server which decide latency and throughput under load:
+ *  - one server task handles the requests of all sessions one after another from a select() loop
+ *  - a fixed session pool; a connection beyond it is accepted and closed at once (IDF default) or the least recently
+ *    used session is closed first (lru_purge_enable)
+ *  - every request costs --handler-ms of server time, responses of unknown paths are --body-bytes long
+ *  - the WiFi link: response bytes pass a per-socket send buffer of --sndbuf bytes which drains over one shared link
+ *    at --link-kib-s, a send blocks until the data fits into the buffer (lwIP semantics). A delivery thread writes the
+ *    bytes to the loopback socket when the link would have delivered them.
+ *  - downloads of files below --root are read in --chunk bytes per step, the flash read costs --flash-kib-s
+ * The link and flash rates are assumptions, not measurements: absolute numbers are those of the model, the
+ * comparison of two profiles under the same assumptions is the result.
+ *
+ * --profile=baseline: IDF defaults and the original download loop (7 sessions, no LRU purge, 8192 byte chunks)
+ * --profile=tuned: settings of start_web_server() and download_get_handler() (13 sessions with
+ *                  CONFIG_LWIP_MAX_SOCKETS=16, LRU purge, 4096 byte chunks)
+ * Single options after --profile override it.
+ *
+ *   ./build-host/coffee_httpd_model --profile=tuned --root=/tmp/www &
+ *   ./build-host/coffee_loadgen --host=127.0.0.1 --port=8080 --connections=12 --duration=20
+ *
+ * usage: coffee_httpd_model [--port=<n>] [--profile=baseline|tuned] [--sockets=<n>] [--lru=0|1] [--chunk=<bytes>]
+ *                           [--handler-ms=<ms>] [--body-bytes=<n>] [--sndbuf=<bytes>] [--link-kib-s=<rate>]
+ *                           [--flash-kib-s=<rate>] [--root=<dir>]
+ *
+*********/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define MODEL_MAX_SESSIONS 32
+#define MODEL_REQUEST_MAX 2048        // request header of one request
+#define MODEL_CHUNK_MAX 16384
+
+struct model_config {
+  int iPort;
+  int iSockets;                     // session pool (max_open_sockets)
+  bool bLruPurge;                   // lru_purge_enable
+  int iChunk;                       // bytes per read and send step of a download
+  double fHandlerMs;                // server time per request
+  int iBodyBytes;                   // response size of paths which are not files
+  int iSndBuf;                      // TCP send buffer per socket (CONFIG_LWIP_TCP_SND_BUF_DEFAULT)
+  double fLinkKibS;                 // shared WiFi link
+  double fFlashKibS;                // LittleFS read rate
+  const char * strRoot;             // directory of the downloadable files, NULL for none
+};
+
+struct model_session {
+  int iSock;
+  double fLastUsedS;                // for the LRU purge
+  double fDeliveredS;               // time at which the link has delivered the last queued byte of the socket
+  std::string strRequest;           // received part of the next request
+};
+
+// bytes on their way over the modelled link, written to the socket at fDueS
+struct model_delivery {
+  double fDueS;
+  uint64_t iOrder;                  // keeps the order of items with the same due time
+  int iSock;
+  std::string strData;
+  bool bClose;                      // close the socket after the data
+  bool operator>(const model_delivery & obj_other) const {
+    return (fDueS != obj_other.fDueS) ? fDueS > obj_other.fDueS : iOrder > obj_other.iOrder;
+  }
+};
+
+using model_clock = std::chrono::steady_clock;
+
+static const model_clock::time_point s_t_start = model_clock::now();
+static std::priority_queue<model_delivery, std::vector<model_delivery>, std::greater<model_delivery>> s_obj_deliveries;
+static std::mutex s_delivery_mutex;
+static std::condition_variable s_delivery_cv;
+static uint64_t s_i_delivery_order = 0;
+static double s_f_link_busy_s = 0.;       // time at which the shared link has sent everything queued so far
+
+
+static double nowS(){
+  return std::chrono::duration<double>(model_clock::now() - s_t_start).count();
+}
+
+
+static void sleepUntilS(double f_time_s){
+  double f_wait_s = f_time_s - nowS();
+  if (f_wait_s > 0.){
+    std::this_thread::sleep_for(std::chrono::duration<double>(f_wait_s));
+  }
+}
+
+
+static model_config getProfile(const char * str_profile){
+  /**
+   * Settings of a firmware version
+   *
+   * @param str_profile: "baseline" or "tuned"
+   */
+
+  model_config obj_cfg;
+
+  obj_cfg.iPort = 8080;
+  obj_cfg.iSockets = 7;             // HTTPD_DEFAULT_CONFIG()
+  obj_cfg.bLruPurge = false;
+  obj_cfg.iChunk = 8192;            // fread() into the scratch buffer
+  obj_cfg.fHandlerMs = 2.;
+  obj_cfg.iBodyBytes = 2048;
+  obj_cfg.iSndBuf = 5744;
+  obj_cfg.fLinkKibS = 600.;
+  obj_cfg.fFlashKibS = 1000.;
+  obj_cfg.strRoot = NULL;
+
+  if (strcmp(str_profile, "tuned") == 0){
+    obj_cfg.iSockets = 13;          // HTTPD_SOCKETS_MAX with CONFIG_LWIP_MAX_SOCKETS=16
+    obj_cfg.bLruPurge = true;
+    obj_cfg.iChunk = 4096;          // DOWNLOAD_CHUNK_SIZE
+  }
+  return obj_cfg;
+}
+
+
+static bool parseArgument(const char * str_arg, model_config * ptr_cfg){
+  /**
+   * Parse one --key=value argument
+   *
+   * @return: false if the argument is unknown or invalid
+   */
+
+  const char * ptr_value = strchr(str_arg, '=');
+
+  if (strncmp(str_arg, "--", 2) != 0 || !ptr_value){
+    return false;
+  }
+
+  size_t i_key_len = ptr_value - str_arg - 2;
+  const char * str_key = str_arg + 2;
+  ptr_value++;
+
+  #define MODEL_ARG(name) (i_key_len == strlen(name) && strncmp(str_key, name, i_key_len) == 0)
+  if (MODEL_ARG("profile")){
+    if (strcmp(ptr_value, "baseline") != 0 && strcmp(ptr_value, "tuned") != 0){
+      return false;
+    }
+    int i_port = ptr_cfg->iPort;
+    const char * str_root = ptr_cfg->strRoot;
+    *ptr_cfg = getProfile(ptr_value);
+    ptr_cfg->iPort = i_port;
+    ptr_cfg->strRoot = str_root;
+  }
+  else if (MODEL_ARG("port")) ptr_cfg->iPort = atoi(ptr_value);
+  else if (MODEL_ARG("sockets")) ptr_cfg->iSockets = atoi(ptr_value);
+  else if (MODEL_ARG("lru")) ptr_cfg->bLruPurge = atoi(ptr_value) != 0;
+  else if (MODEL_ARG("chunk")) ptr_cfg->iChunk = atoi(ptr_value);
+  else if (MODEL_ARG("handler-ms")) ptr_cfg->fHandlerMs = atof(ptr_value);
+  else if (MODEL_ARG("body-bytes")) ptr_cfg->iBodyBytes = atoi(ptr_value);
+  else if (MODEL_ARG("sndbuf")) ptr_cfg->iSndBuf = atoi(ptr_value);
+  else if (MODEL_ARG("link-kib-s")) ptr_cfg->fLinkKibS = atof(ptr_value);
+  else if (MODEL_ARG("flash-kib-s")) ptr_cfg->fFlashKibS = atof(ptr_value);
+  else if (MODEL_ARG("root")) ptr_cfg->strRoot = ptr_value;
+  else return false;
+  #undef MODEL_ARG
+
+  return ptr_cfg->iSockets > 0 && ptr_cfg->iSockets <= MODEL_MAX_SESSIONS && ptr_cfg->iChunk > 0 &&
+         ptr_cfg->iChunk <= MODEL_CHUNK_MAX && ptr_cfg->iSndBuf > 0 && ptr_cfg->fLinkKibS > 0. &&
+         ptr_cfg->fFlashKibS > 0.;
+}
+
+
+static void deliveryTask(){
+  /**
+   * Write the queued bytes to the sockets at the time the modelled link delivers them
+   */
+
+  std::unique_lock<std::mutex> obj_lock(s_delivery_mutex);
+
+  for (;;){
+    if (s_obj_deliveries.empty()){
+      s_delivery_cv.wait(obj_lock);
+      continue;
+    }
+    double f_wait_s = s_obj_deliveries.top().fDueS - nowS();
+    if (f_wait_s > 0.){
+      s_delivery_cv.wait_for(obj_lock, std::chrono::duration<double>(f_wait_s));
+      continue;
+    }
+    model_delivery obj_item = s_obj_deliveries.top();
+    s_obj_deliveries.pop();
+    obj_lock.unlock();
+
+    const char * ptr_data = obj_item.strData.data();
+    size_t i_len = obj_item.strData.size();
+    while (i_len > 0){
+      ssize_t i_sent = send(obj_item.iSock, ptr_data, i_len, MSG_NOSIGNAL);
+      if (i_sent <= 0){
+        break;
+      }
+      ptr_data += i_sent;
+      i_len -= i_sent;
+    }
+    if (obj_item.bClose){
+      close(obj_item.iSock);
+    }
+    obj_lock.lock();
+  }
+}
+
+
+static void queueDelivery(int i_sock, std::string str_data, double f_due_s, bool b_close){
+  std::lock_guard<std::mutex> obj_lock(s_delivery_mutex);
+  s_obj_deliveries.push({f_due_s, s_i_delivery_order++, i_sock, std::move(str_data), b_close});
+  s_delivery_cv.notify_one();
+}
+
+
+static void modelSend(const model_config & obj_cfg, model_session * ptr_session, std::string str_data){
+  /**
+   * Send through the send buffer of the socket and the shared link, returns when the data fits into the buffer
+   */
+
+  double f_now_s = nowS();
+  double f_byte_s = 1. / (obj_cfg.fLinkKibS * 1024.);
+
+  s_f_link_busy_s = ((s_f_link_busy_s > f_now_s) ? s_f_link_busy_s : f_now_s) + str_data.size() * f_byte_s;
+  ptr_session->fDeliveredS = s_f_link_busy_s;
+  queueDelivery(ptr_session->iSock, std::move(str_data), ptr_session->fDeliveredS, false);
+
+  // bytes beyond the send buffer are still in the call
+  sleepUntilS(ptr_session->fDeliveredS - obj_cfg.iSndBuf * f_byte_s);
+}
+
+
+static void closeSession(model_session * ptr_session, bool b_immediately){
+  /**
+   * Free the slot, the socket is closed after the queued bytes unless the session is purged
+   */
+
+  queueDelivery(ptr_session->iSock, std::string(), b_immediately ? 0. : ptr_session->fDeliveredS, true);
+  ptr_session->iSock = -1;
+}
+
+
+static void sendChunk(const model_config & obj_cfg, model_session * ptr_session, const char * ptr_data, size_t i_len){
+  char str_size[16];
+  snprintf(str_size, sizeof(str_size), "%zx\r\n", i_len);
+  modelSend(obj_cfg, ptr_session, std::string(str_size) + std::string(ptr_data, i_len) + "\r\n");
+}
+
+
+static void handleRequest(const model_config & obj_cfg, model_session * ptr_session, const std::string & str_path){
+  /**
+   * Answer one GET request: a file of the root directory as chunked download, any other path with a body of
+   * --body-bytes after --handler-ms
+   */
+
+  sleepUntilS(nowS() + obj_cfg.fHandlerMs / 1000.);
+
+  std::string str_file = obj_cfg.strRoot ? std::string(obj_cfg.strRoot) + str_path : std::string();
+  struct stat obj_stat;
+  int i_fd = (obj_cfg.strRoot && str_path.find("..") == std::string::npos && stat(str_file.c_str(), &obj_stat) == 0 &&
+              S_ISREG(obj_stat.st_mode)) ? open(str_file.c_str(), O_RDONLY) : -1;
+
+  if (i_fd < 0){
+    std::string str_body(obj_cfg.iBodyBytes, 'x');
+    char str_header[128];
+    snprintf(str_header, sizeof(str_header), "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: %d\r\n\r\n",
+             obj_cfg.iBodyBytes);
+    modelSend(obj_cfg, ptr_session, std::string(str_header) + str_body);
+    return;
+  }
+
+  static char s_arr_chunk[MODEL_CHUNK_MAX];
+  modelSend(obj_cfg, ptr_session, "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nTransfer-Encoding: chunked\r\n\r\n");
+  for (;;){
+    ssize_t i_read = read(i_fd, s_arr_chunk, obj_cfg.iChunk);
+    if (i_read <= 0){
+      break;
+    }
+    sleepUntilS(nowS() + i_read / (obj_cfg.fFlashKibS * 1024.));
+    sendChunk(obj_cfg, ptr_session, s_arr_chunk, i_read);
+  }
+  close(i_fd);
+  modelSend(obj_cfg, ptr_session, "0\r\n\r\n");
+}
+
+
+static bool serveSession(const model_config & obj_cfg, model_session * ptr_session){
+  /**
+   * Receive from a readable session and answer the complete requests
+   *
+   * @return: false if the client closed the connection
+   */
+
+  char arr_buf[MODEL_REQUEST_MAX];
+  ssize_t i_recv = recv(ptr_session->iSock, arr_buf, sizeof(arr_buf), 0);
+
+  if (i_recv <= 0){
+    return false;
+  }
+  ptr_session->strRequest.append(arr_buf, i_recv);
+  ptr_session->fLastUsedS = nowS();
+
+  size_t i_end;
+  while ((i_end = ptr_session->strRequest.find("\r\n\r\n")) != std::string::npos){
+    std::string str_request = ptr_session->strRequest.substr(0, i_end);
+    ptr_session->strRequest.erase(0, i_end + 4);
+
+    char str_path[256] = "";
+    if (sscanf(str_request.c_str(), "GET %255s", str_path) != 1){
+      return false;
+    }
+    handleRequest(obj_cfg, ptr_session, str_path);
+  }
+  return ptr_session->strRequest.size() < MODEL_REQUEST_MAX;
+}
+
+
+int main(int argc, char ** argv){
+  model_config obj_cfg = getProfile("baseline");
+
+  for (int i_arg = 1; i_arg < argc; i_arg++){
+    if (!parseArgument(argv[i_arg], &obj_cfg)){
+      fprintf(stderr, "unknown or invalid argument %s\n", argv[i_arg]);
+      return 2;
+    }
+  }
+  signal(SIGPIPE, SIG_IGN);
+
+  int i_listen = socket(AF_INET, SOCK_STREAM, 0);
+  int i_one = 1;
+  struct sockaddr_in obj_addr = {};
+  obj_addr.sin_family = AF_INET;
+  obj_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  obj_addr.sin_port = htons(obj_cfg.iPort);
+  setsockopt(i_listen, SOL_SOCKET, SO_REUSEADDR, &i_one, sizeof(i_one));
+  if (bind(i_listen, (struct sockaddr *)&obj_addr, sizeof(obj_addr)) != 0 || listen(i_listen, obj_cfg.iSockets) != 0){
+    fprintf(stderr, "cannot listen on port %d: %s\n", obj_cfg.iPort, strerror(errno));
+    return 1;
+  }
+
+  printf("port=%d\nsockets=%d\nlru_purge=%d\nchunk=%d\nhandler_ms=%.1f\nsndbuf=%d\nlink_kib_s=%.0f\n"
+         "flash_kib_s=%.0f\n", obj_cfg.iPort, obj_cfg.iSockets, obj_cfg.bLruPurge ? 1 : 0, obj_cfg.iChunk,
+         obj_cfg.fHandlerMs, obj_cfg.iSndBuf, obj_cfg.fLinkKibS, obj_cfg.fFlashKibS);
+  fflush(stdout);
+
+  std::thread obj_delivery(deliveryTask);
+  obj_delivery.detach();
+
+  model_session arr_sessions[MODEL_MAX_SESSIONS];
+  for (auto & obj_session : arr_sessions){
+    obj_session.iSock = -1;
+  }
+
+  for (;;){
+    fd_set obj_read_set;
+    int i_max_fd = i_listen;
+
+    FD_ZERO(&obj_read_set);
+    FD_SET(i_listen, &obj_read_set);
+    for (int i_idx = 0; i_idx < obj_cfg.iSockets; i_idx++){
+      if (arr_sessions[i_idx].iSock >= 0){
+        FD_SET(arr_sessions[i_idx].iSock, &obj_read_set);
+        i_max_fd = (arr_sessions[i_idx].iSock > i_max_fd) ? arr_sessions[i_idx].iSock : i_max_fd;
+      }
+    }
+    if (select(i_max_fd + 1, &obj_read_set, NULL, NULL, NULL) <= 0){
+      continue;
+    }
+
+    // one request after another, like the single server task of esp_http_server
+    for (int i_idx = 0; i_idx < obj_cfg.iSockets; i_idx++){
+      model_session * ptr_session = &arr_sessions[i_idx];
+      if (ptr_session->iSock >= 0 && FD_ISSET(ptr_session->iSock, &obj_read_set) &&
+          !serveSession(obj_cfg, ptr_session)){
+        closeSession(ptr_session, false);
+      }
+    }
+
+    if (FD_ISSET(i_listen, &obj_read_set)){
+      model_session * ptr_free = NULL;
+      model_session * ptr_lru = NULL;
+      for (int i_idx = 0; i_idx < obj_cfg.iSockets; i_idx++){
+        model_session * ptr_session = &arr_sessions[i_idx];
+        if (ptr_session->iSock < 0){
+          ptr_free = ptr_free ? ptr_free : ptr_session;
+        } else if (!ptr_lru || ptr_session->fLastUsedS < ptr_lru->fLastUsedS){
+          ptr_lru = ptr_session;
+        }
+      }
+      if (!ptr_free && obj_cfg.bLruPurge){
+        // httpd_sess_close_lru(), the connection is accepted in the next round
+        closeSession(ptr_lru, true);
+        continue;
+      }
+
+      int i_sock = accept(i_listen, NULL, NULL);
+      if (i_sock < 0){
+        continue;
+      }
+      if (!ptr_free){
+        // no session available, the connection is accepted and closed at once
+        close(i_sock);
+        continue;
+      }
+      setsockopt(i_sock, IPPROTO_TCP, TCP_NODELAY, &i_one, sizeof(i_one));
+      ptr_free->iSock = i_sock;
+      ptr_free->fLastUsedS = nowS();
+      ptr_free->fDeliveredS = 0.;
+      ptr_free->strRequest.clear();
+    }
+  }
+}
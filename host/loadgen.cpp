@@ -0,0 +1,428 @@
+/*********
+ *
+ * coffee_loadgen
+ * HTTP load generator for the web server of the device, or any other HTTP/1.1 server on a Linux host. Each
+ * connection runs in its own thread and requests the given paths in turn until the duration is over, with
+ * keep-alive (one TCP connection per thread, as browsers poll the dashboard) or with a new connection per request.
+ * Latency is measured from the connect or the request until the complete response body is received. Results are
+ * printed as key=value lines like coffee_bench, so runs against two firmware versions can be compared directly.
+ * With a single connection to a large file, e.g. --paths=/data.csv --connections=1, throughput_kib_s is the download
+ * rate of the file server.
+ *
+ * usage: coffee_loadgen [--host=<ip>] [--port=<n>] [--paths=/a,/b,...] [--connections=<n>] [--duration=<s>]
+ *                       [--keep-alive=0|1] [--timeout=<s>]
+ *
+*********/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#define LOADGEN_MAX_PATHS 16
+#define LOADGEN_HEADER_MAX 4096       // response header has to fit, the body is streamed
+
+struct loadgen_config {
+  const char * strHost;
+  int iPort;
+  std::vector<std::string> lstPaths;
+  int iConnections;
+  double fDurationS;
+  bool bKeepAlive;
+  double fTimeoutS;
+};
+
+struct loadgen_worker {
+  std::vector<float> lstLatencyMs;  // completed requests
+  uint32_t iErrors;                 // connect, send or receive failures and timeouts
+  uint32_t iBadStatus;              // responses other than 2xx
+  uint32_t iConnects;
+  uint64_t iBodyBytes;
+};
+
+using loadgen_clock = std::chrono::steady_clock;
+
+
+static loadgen_config getDefaultConfig(){
+  loadgen_config obj_cfg;
+
+  obj_cfg.strHost = "192.168.4.1";  // soft-AP address of the device
+  obj_cfg.iPort = 80;
+  obj_cfg.lstPaths = {"/faults.json", "/shots.json", "/metrics"};
+  obj_cfg.iConnections = 8;
+  obj_cfg.fDurationS = 10.;
+  obj_cfg.bKeepAlive = true;
+  obj_cfg.fTimeoutS = 5.;
+
+  return obj_cfg;
+}
+
+
+static bool parseArgument(const char * str_arg, loadgen_config * ptr_cfg){
+  /**
+   * Parse one --key=value argument
+   *
+   * @return: false if the argument is unknown
+   */
+
+  const char * ptr_value = strchr(str_arg, '=');
+
+  if (strncmp(str_arg, "--", 2) != 0 || !ptr_value){
+    return false;
+  }
+
+  size_t i_key_len = ptr_value - str_arg - 2;
+  const char * str_key = str_arg + 2;
+  ptr_value++;
+
+  #define LOADGEN_ARG(name) (i_key_len == strlen(name) && strncmp(str_key, name, i_key_len) == 0)
+  if (LOADGEN_ARG("host")) ptr_cfg->strHost = ptr_value;
+  else if (LOADGEN_ARG("port")) ptr_cfg->iPort = atoi(ptr_value);
+  else if (LOADGEN_ARG("connections")) ptr_cfg->iConnections = atoi(ptr_value);
+  else if (LOADGEN_ARG("duration")) ptr_cfg->fDurationS = atof(ptr_value);
+  else if (LOADGEN_ARG("keep-alive")) ptr_cfg->bKeepAlive = atoi(ptr_value) != 0;
+  else if (LOADGEN_ARG("timeout")) ptr_cfg->fTimeoutS = atof(ptr_value);
+  else if (LOADGEN_ARG("paths")){
+    ptr_cfg->lstPaths.clear();
+    std::string str_paths(ptr_value);
+    size_t i_start = 0;
+    while (i_start <= str_paths.size() && ptr_cfg->lstPaths.size() < LOADGEN_MAX_PATHS){
+      size_t i_end = str_paths.find(',', i_start);
+      if (i_end == std::string::npos){
+        i_end = str_paths.size();
+      }
+      if (i_end > i_start){
+        ptr_cfg->lstPaths.push_back(str_paths.substr(i_start, i_end - i_start));
+      }
+      i_start = i_end + 1;
+    }
+  }
+  else return false;
+  #undef LOADGEN_ARG
+
+  return ptr_cfg->iConnections > 0 && !ptr_cfg->lstPaths.empty();
+}
+
+
+static int openConnection(const loadgen_config & obj_cfg, const struct addrinfo * ptr_addr){
+  /**
+   * Connect to the server
+   *
+   * @return: socket, -1 on failure
+   */
+
+  int i_sock = socket(ptr_addr->ai_family, ptr_addr->ai_socktype, ptr_addr->ai_protocol);
+  if (i_sock < 0){
+    return -1;
+  }
+
+  struct timeval obj_timeout;
+  obj_timeout.tv_sec = (time_t)obj_cfg.fTimeoutS;
+  obj_timeout.tv_usec = (suseconds_t)((obj_cfg.fTimeoutS - obj_timeout.tv_sec) * 1e6);
+  int i_one = 1;
+  setsockopt(i_sock, SOL_SOCKET, SO_RCVTIMEO, &obj_timeout, sizeof(obj_timeout));
+  setsockopt(i_sock, SOL_SOCKET, SO_SNDTIMEO, &obj_timeout, sizeof(obj_timeout));
+  setsockopt(i_sock, IPPROTO_TCP, TCP_NODELAY, &i_one, sizeof(i_one));
+
+  if (connect(i_sock, ptr_addr->ai_addr, ptr_addr->ai_addrlen) != 0){
+    close(i_sock);
+    return -1;
+  }
+  return i_sock;
+}
+
+
+static bool sendAll(int i_sock, const char * ptr_data, size_t i_len){
+  while (i_len > 0){
+    ssize_t i_sent = send(i_sock, ptr_data, i_len, MSG_NOSIGNAL);
+    if (i_sent <= 0){
+      return false;
+    }
+    ptr_data += i_sent;
+    i_len -= i_sent;
+  }
+  return true;
+}
+
+
+class ResponseReader
+{
+  /**
+   * Buffered reader of one connection, parses the status line, Content-Length and chunked bodies
+   */
+
+  public:
+    explicit ResponseReader(int i_sock) : _iSock(i_sock), _iPos(0), _iLen(0) {}
+
+    bool readResponse(int * ptr_status, bool * ptr_close, uint64_t * ptr_body_bytes){
+      /**
+       * Read one complete response
+       *
+       * @param ptr_status: HTTP status code
+       * @param ptr_close: true if the server closes the connection after the response
+       * @param ptr_body_bytes: size of the body
+       * @return: false on a receive failure, timeout or malformed response
+       */
+
+      std::string str_line;
+      long i_content_len = -1;
+      bool b_chunked = false;
+
+      *ptr_close = false;
+      *ptr_body_bytes = 0;
+      if (!_readLine(&str_line) || sscanf(str_line.c_str(), "HTTP/%*d.%*d %d", ptr_status) != 1){
+        return false;
+      }
+      *ptr_close = str_line.compare(0, 8, "HTTP/1.0") == 0;
+      for (;;){
+        if (!_readLine(&str_line)){
+          return false;
+        }
+        if (str_line.empty()){
+          break;
+        }
+        if (strncasecmp(str_line.c_str(), "Content-Length:", 15) == 0){
+          i_content_len = atol(str_line.c_str() + 15);
+        } else if (strncasecmp(str_line.c_str(), "Transfer-Encoding:", 18) == 0){
+          b_chunked = strcasestr(str_line.c_str(), "chunked") != NULL;
+        } else if (strncasecmp(str_line.c_str(), "Connection:", 11) == 0){
+          *ptr_close = strcasestr(str_line.c_str(), "close") != NULL;
+        }
+      }
+
+      if (b_chunked){
+        for (;;){
+          if (!_readLine(&str_line)){
+            return false;
+          }
+          long i_chunk = strtol(str_line.c_str(), NULL, 16);
+          if (i_chunk == 0){
+            // trailer ends with an empty line
+            do {
+              if (!_readLine(&str_line)){
+                return false;
+              }
+            } while (!str_line.empty());
+            return true;
+          }
+          if (!_skip(i_chunk) || !_readLine(&str_line)){
+            return false;
+          }
+          *ptr_body_bytes += i_chunk;
+        }
+      }
+      if (i_content_len >= 0){
+        *ptr_body_bytes = i_content_len;
+        return _skip(i_content_len);
+      }
+      // body until the server closes the connection
+      *ptr_close = true;
+      while (_fill()){
+        *ptr_body_bytes += _iLen - _iPos;
+        _iPos = _iLen;
+      }
+      return true;
+    }
+
+  private:
+    int _iSock;
+    size_t _iPos;
+    size_t _iLen;
+    char _arrBuf[LOADGEN_HEADER_MAX];
+
+    bool _fill(void){
+      if (_iPos < _iLen){
+        return true;
+      }
+      ssize_t i_recv = recv(_iSock, _arrBuf, sizeof(_arrBuf), 0);
+      if (i_recv <= 0){
+        return false;
+      }
+      _iPos = 0;
+      _iLen = i_recv;
+      return true;
+    }
+
+    bool _readLine(std::string * ptr_line){
+      ptr_line->clear();
+      for (;;){
+        if (!_fill()){
+          return false;
+        }
+        char c_char = _arrBuf[_iPos++];
+        if (c_char == '\n'){
+          if (!ptr_line->empty() && ptr_line->back() == '\r'){
+            ptr_line->pop_back();
+          }
+          return true;
+        }
+        if (ptr_line->size() >= LOADGEN_HEADER_MAX){
+          return false;
+        }
+        ptr_line->push_back(c_char);
+      }
+    }
+
+    bool _skip(long i_bytes){
+      while (i_bytes > 0){
+        if (!_fill()){
+          return false;
+        }
+        size_t i_take = std::min((size_t)i_bytes, _iLen - _iPos);
+        _iPos += i_take;
+        i_bytes -= i_take;
+      }
+      return true;
+    }
+};
+
+
+static void runWorker(const loadgen_config & obj_cfg, const struct addrinfo * ptr_addr, int i_worker,
+                      loadgen_clock::time_point t_end, loadgen_worker * ptr_result){
+  /**
+   * Request the paths in turn until the end time, starting with a different path per worker
+   */
+
+  int i_sock = -1;
+  ResponseReader * ptr_reader = NULL;
+  size_t i_path = i_worker % obj_cfg.lstPaths.size();
+  char str_request[512];
+
+  while (loadgen_clock::now() < t_end){
+    auto t_start = loadgen_clock::now();
+
+    if (i_sock < 0){
+      i_sock = openConnection(obj_cfg, ptr_addr);
+      if (i_sock < 0){
+        ptr_result->iErrors++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        continue;
+      }
+      ptr_result->iConnects++;
+      ptr_reader = new ResponseReader(i_sock);
+    }
+
+    int i_len = snprintf(str_request, sizeof(str_request), "GET %s HTTP/1.1\r\nHost: %s\r\nConnection: %s\r\n\r\n",
+                         obj_cfg.lstPaths[i_path].c_str(), obj_cfg.strHost, obj_cfg.bKeepAlive ? "keep-alive" : "close");
+    i_path = (i_path + 1) % obj_cfg.lstPaths.size();
+
+    int i_status = 0;
+    bool b_close = true;
+    uint64_t i_body_bytes = 0;
+    bool b_ok = sendAll(i_sock, str_request, i_len) && ptr_reader->readResponse(&i_status, &b_close, &i_body_bytes);
+
+    if (b_ok){
+      auto t_done = loadgen_clock::now();
+      ptr_result->lstLatencyMs.push_back(std::chrono::duration<float, std::milli>(t_done - t_start).count());
+      ptr_result->iBodyBytes += i_body_bytes;
+      if (i_status < 200 || i_status >= 300){
+        ptr_result->iBadStatus++;
+      }
+    } else {
+      ptr_result->iErrors++;
+    }
+    if (!b_ok || b_close || !obj_cfg.bKeepAlive){
+      close(i_sock);
+      delete ptr_reader;
+      ptr_reader = NULL;
+      i_sock = -1;
+    }
+  }
+
+  if (i_sock >= 0){
+    close(i_sock);
+    delete ptr_reader;
+  }
+}
+
+
+static float getPercentile(const std::vector<float> & lst_sorted, float f_percent){
+  if (lst_sorted.empty()){
+    return 0.F;
+  }
+  size_t i_idx = (size_t)(f_percent / 100.F * (lst_sorted.size() - 1) + 0.5F);
+  return lst_sorted[std::min(i_idx, lst_sorted.size() - 1)];
+}
+
+
+int main(int argc, char ** argv){
+  loadgen_config obj_cfg = getDefaultConfig();
+
+  for (int i_arg = 1; i_arg < argc; i_arg++){
+    if (!parseArgument(argv[i_arg], &obj_cfg)){
+      fprintf(stderr, "unknown or invalid argument %s\n", argv[i_arg]);
+      return 2;
+    }
+  }
+
+  struct addrinfo obj_hints = {};
+  struct addrinfo * ptr_addr = NULL;
+  char str_port[8];
+
+  obj_hints.ai_family = AF_UNSPEC;
+  obj_hints.ai_socktype = SOCK_STREAM;
+  snprintf(str_port, sizeof(str_port), "%d", obj_cfg.iPort);
+  if (getaddrinfo(obj_cfg.strHost, str_port, &obj_hints, &ptr_addr) != 0){
+    fprintf(stderr, "unknown host %s\n", obj_cfg.strHost);
+    return 2;
+  }
+
+  std::vector<loadgen_worker> lst_results(obj_cfg.iConnections);
+  std::vector<std::thread> lst_threads;
+  auto t_start = loadgen_clock::now();
+  auto t_end = t_start + std::chrono::duration_cast<loadgen_clock::duration>(
+                 std::chrono::duration<double>(obj_cfg.fDurationS));
+
+  for (int i_worker = 0; i_worker < obj_cfg.iConnections; i_worker++){
+    lst_results[i_worker].iErrors = 0;
+    lst_results[i_worker].iBadStatus = 0;
+    lst_results[i_worker].iConnects = 0;
+    lst_results[i_worker].iBodyBytes = 0;
+    lst_threads.emplace_back(runWorker, std::cref(obj_cfg), ptr_addr, i_worker, t_end, &lst_results[i_worker]);
+  }
+  for (auto & obj_thread : lst_threads){
+    obj_thread.join();
+  }
+  double f_elapsed_s = std::chrono::duration<double>(loadgen_clock::now() - t_start).count();
+  freeaddrinfo(ptr_addr);
+
+  std::vector<float> lst_latency;
+  uint32_t i_errors = 0;
+  uint32_t i_bad_status = 0;
+  uint32_t i_connects = 0;
+  uint64_t i_body_bytes = 0;
+  for (auto & obj_res : lst_results){
+    lst_latency.insert(lst_latency.end(), obj_res.lstLatencyMs.begin(), obj_res.lstLatencyMs.end());
+    i_errors += obj_res.iErrors;
+    i_bad_status += obj_res.iBadStatus;
+    i_connects += obj_res.iConnects;
+    i_body_bytes += obj_res.iBodyBytes;
+  }
+  std::sort(lst_latency.begin(), lst_latency.end());
+
+  printf("connections=%d\n", obj_cfg.iConnections);
+  printf("keep_alive=%d\n", obj_cfg.bKeepAlive ? 1 : 0);
+  printf("requests=%zu\n", lst_latency.size());
+  printf("errors=%u\n", i_errors);
+  printf("bad_status=%u\n", i_bad_status);
+  printf("tcp_connects=%u\n", i_connects);
+  printf("throughput_rps=%.1f\n", lst_latency.size() / f_elapsed_s);
+  printf("throughput_kib_s=%.1f\n", i_body_bytes / 1024. / f_elapsed_s);
+  printf("latency_p50_ms=%.2f\n", getPercentile(lst_latency, 50.F));
+  printf("latency_p99_ms=%.2f\n", getPercentile(lst_latency, 99.F));
+  printf("latency_max_ms=%.2f\n", lst_latency.empty() ? 0.F : lst_latency.back());
+
+  return (lst_latency.empty()) ? 1 : 0;
+}
@@ -0,0 +1,140 @@
+// Host check of the metric registry (main/metrics.cpp): the registry is filled to its capacity with entries of the
+// size the device produces (per-URI and per-task families), rendered through a chunk sink and compared entry by entry.
+// The exposition is several times larger than the render buffer, every family including the last registered one has
+// to be complete. A passing run prints nothing, expected error logs are captured and checked. Exit code 0 on success.
+//   ./build-host/coffee_metrics_check
+
+#include <stdio.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "metrics.hpp"
+
+#define CHECK_SAMPLES_PER_FAMILY 40   // about the number of series of the http and task families
+
+static char s_arr_names[METRICS_MAX_ENTRIES][48];
+static bool s_b_oversized = false;    // one family writes more than the render buffer holds
+static int s_i_write_calls = 0;
+static int s_i_fail_at_call = -1;     // sink error injection
+
+static int s_i_failures = 0;
+
+static void check(bool b_condition, const char * str_what){
+  if (!b_condition){
+    printf("FAIL: %s\n", str_what);
+    s_i_failures++;
+  }
+}
+
+
+static double getValue(){ return 42.5; }
+
+
+static int s_i_saved_stdout = -1;
+static FILE * s_ptr_log = NULL;
+
+static void captureLog(){
+  /**
+   * Redirect stdout, which carries ESP_LOG* on the host (ADS111x_platform.hpp), into a temporary file
+   */
+  fflush(stdout);
+  s_ptr_log = tmpfile();
+  s_i_saved_stdout = dup(STDOUT_FILENO);
+  dup2(fileno(s_ptr_log), STDOUT_FILENO);
+}
+
+
+static std::string releaseLog(){
+  /**
+   * Restore stdout
+   * @return: output since captureLog()
+   */
+  std::string str_log;
+  char char_buf[256];
+  size_t i_len;
+
+  fflush(stdout);
+  dup2(s_i_saved_stdout, STDOUT_FILENO);
+  close(s_i_saved_stdout);
+  rewind(s_ptr_log);
+  while ((i_len = fread(char_buf, 1, sizeof(char_buf), s_ptr_log)) > 0){
+    str_log.append(char_buf, i_len);
+  }
+  fclose(s_ptr_log);
+  return str_log;
+}
+
+
+static void collectFamily(const char * str_name){
+  char char_labels[64];
+  int i_samples = s_b_oversized ? METRICS_BUF_SIZE / 16 : CHECK_SAMPLES_PER_FAMILY;
+
+  for (int i_idx = 0; i_idx < i_samples; i_idx++){
+    snprintf(char_labels, sizeof(char_labels), "uri=\"/some/handler/path\",idx=\"%d\"", i_idx);
+    metricsWriteSample(str_name, char_labels, i_idx * 0.001);
+  }
+}
+
+
+static esp_err_t writeToString(void * ptr_ctx, const char * ptr_data, size_t i_len){
+  if (s_i_write_calls++ == s_i_fail_at_call){
+    return ESP_FAIL;
+  }
+  check(i_len > 0 && i_len <= METRICS_BUF_SIZE, "piece is not empty and fits the buffer");
+  ((std::string *)ptr_ctx)->append(ptr_data, i_len);
+  return ESP_OK;
+}
+
+
+int main(){
+  // registry filled to capacity, every second entry is a family
+  for (int i_idx = 0; i_idx < METRICS_MAX_ENTRIES; i_idx++){
+    snprintf(s_arr_names[i_idx], sizeof(s_arr_names[i_idx]), "coffee_check_metric_%02d", i_idx);
+    esp_err_t esp_ret = (i_idx % 2) ?
+        metricsRegisterFamily(s_arr_names[i_idx], "Family of the registry check", METRIC_TYPE_GAUGE, collectFamily) :
+        metricsRegister(s_arr_names[i_idx], "Single value of the registry check", METRIC_TYPE_COUNTER, getValue);
+    check(esp_ret == ESP_OK, "registration within capacity");
+  }
+
+  std::string str_out;
+  s_i_write_calls = 0;
+  check(metricsRender(writeToString, &str_out) == ESP_OK, "full registry renders");
+  int i_pieces = s_i_write_calls;
+  check(i_pieces > 1, "output is streamed in several pieces");
+  check(str_out.size() > 2 * METRICS_BUF_SIZE, "output is larger than the render buffer");
+
+  for (int i_idx = 0; i_idx < METRICS_MAX_ENTRIES; i_idx++){
+    std::string str_type = std::string("# TYPE ") + s_arr_names[i_idx] + " ";
+    check(str_out.find(str_type) != std::string::npos, "every entry is present");
+  }
+
+  // last registered family is complete up to its last sample
+  char char_last[128];
+  snprintf(char_last, sizeof(char_last), "%s{uri=\"/some/handler/path\",idx=\"%d\"} ",
+           s_arr_names[METRICS_MAX_ENTRIES - 1], CHECK_SAMPLES_PER_FAMILY - 1);
+  check(str_out.find(char_last) != std::string::npos, "last registered family is complete");
+  check(str_out.back() == '\n', "output ends with a complete line");
+
+  // errors of the sink are passed on
+  std::string str_partial;
+  s_i_write_calls = 0;
+  s_i_fail_at_call = 1;
+  check(metricsRender(writeToString, &str_partial) == ESP_FAIL, "sink error is returned");
+  s_i_fail_at_call = -1;
+
+  // an entry larger than the buffer is reported instead of being cut
+  std::string str_oversized;
+  s_b_oversized = true;
+  captureLog();
+  esp_err_t esp_oversized = metricsRender(writeToString, &str_oversized);
+  std::string str_log = releaseLog();
+  s_b_oversized = false;
+  check(esp_oversized == ESP_ERR_INVALID_SIZE, "oversized entry is an error");
+  check(str_log.find("does not fit into the render buffer") != std::string::npos, "oversized entry is logged");
+
+  if (s_i_failures){
+    printf("metrics_check: %d entries, %zu bytes in %d pieces, FAILED\n", METRICS_MAX_ENTRIES, str_out.size(),
+           i_pieces);
+  }
+  return s_i_failures ? 1 : 0;
+}
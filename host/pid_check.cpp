@@ -0,0 +1,102 @@
+// Host check of the PID controller (components/PIDCtrl): the single parts, the parameter forms, limits, anti windup and
+// the thresholds around the target. Every check compares against a limit, a passing run prints nothing. Exit code 0
+// on success.
+//   ./build-host/coffee_pid_check
+
+#include <stdio.h>
+#include <math.h>
+#include "PIDCtrl.hpp"
+
+static int s_i_failures = 0;
+
+static void checkNear(float f_value, float f_expected, const char * str_what){
+  if (!(fabsf(f_value - f_expected) <= 1e-4F * fmaxf(1.F, fabsf(f_expected)))){
+    printf("FAIL: %s: %g, expected %g\n", str_what, f_value, f_expected);
+    s_i_failures++;
+  }
+}
+
+
+static void setupPid(PIDCtrl * ptr_pid, float f_prop, float f_int, float f_dif, bool b_time_factor){
+  ptr_pid->setTarget(90.F);
+  ptr_pid->setParameters(f_prop, f_int, f_dif, b_time_factor);
+  ptr_pid->activate(f_prop != 0.F, f_int != 0.F, f_dif != 0.F);
+  ptr_pid->setLimits(0.F, 255.F);
+  ptr_pid->reset();
+}
+
+
+int main(){
+  PIDCtrl obj_pid;
+
+  // proportional part and limits
+  setupPid(&obj_pid, 10.F, 0.F, 0.F, true);
+  checkNear(obj_pid.update(88.F, 1.F), 20.F, "proportional part");
+  checkNear(obj_pid.update(91.F, 1.F), 0.F, "output is limited below");
+  checkNear(obj_pid.getPropPart(), -10.F, "proportional part beyond the limit");
+  checkNear(obj_pid.update(50.F, 1.F), 255.F, "output is limited above");
+
+  // integral part: Ki = Kp / Tn in the time factor form, Ki directly otherwise
+  setupPid(&obj_pid, 10.F, 100.F, 0.F, true);
+  for (int i_step = 0; i_step < 10; i_step++){
+    obj_pid.update(89.F, 1.F);
+  }
+  checkNear(obj_pid.getIntPart(), 1.F, "integral part with reset time");
+  checkNear(obj_pid.getOutput(), 11.F, "output is the sum of the parts");
+  obj_pid.update(89.F, 0.F);
+  checkNear(obj_pid.getIntPart(), 1.F, "no integration without time step");
+
+  setupPid(&obj_pid, 10.F, 0.5F, 0.F, false);
+  obj_pid.update(89.F, 2.F);
+  checkNear(obj_pid.getIntPart(), 1.F, "integral part with gain");
+
+  // anti windup: the integral is frozen while the output saturates in the direction of the error
+  setupPid(&obj_pid, 10.F, 10.F, 0.F, true);
+  for (int i_step = 0; i_step < 100; i_step++){
+    obj_pid.update(70.F, 1.F);
+  }
+  checkNear(obj_pid.getIntPart(), 40.F, "integral stops before the limit");
+  checkNear(obj_pid.getOutput(), 240.F, "output stays where the integral stopped");
+  obj_pid.update(91.F, 1.F);
+  checkNear(obj_pid.getIntPart(), 39.F, "integral runs back at once");
+
+  // derivative part on the measurement: Kd = Kp * Tv, no kick on a target change
+  setupPid(&obj_pid, 10.F, 0.F, 5.F, true);
+  obj_pid.update(89.F, 1.F);
+  checkNear(obj_pid.getDifPart(), 0.F, "first update has no derivative");
+  obj_pid.setTarget(95.F);
+  obj_pid.update(89.F, 1.F);
+  checkNear(obj_pid.getDifPart(), 0.F, "target change does not kick");
+  obj_pid.update(89.5F, 0.5F);
+  checkNear(obj_pid.getDifPart(), -50.F, "derivative part with derivative time");
+  setupPid(&obj_pid, 10.F, 0.F, 3.F, false);
+  obj_pid.update(89.F, 1.F);
+  obj_pid.update(88.F, 1.F);
+  checkNear(obj_pid.getDifPart(), 3.F, "derivative part with gain");
+
+  // thresholds bypass the controller and clear the integral
+  setupPid(&obj_pid, 10.F, 100.F, 0.F, true);
+  obj_pid.setThresholds(true, 5.F, true, 2.F);
+  obj_pid.update(89.F, 1.F);
+  checkNear(obj_pid.update(80.F, 1.F), 255.F, "full power below the lower threshold");
+  obj_pid.update(89.F, 1.F);
+  checkNear(obj_pid.getIntPart(), 0.1F, "integral restarts after the threshold");
+  checkNear(obj_pid.update(93.F, 1.F), 0.F, "heater off above the upper threshold");
+
+  // a deactivated integral part is cleared, reset clears all state
+  setupPid(&obj_pid, 10.F, 100.F, 0.F, true);
+  obj_pid.update(89.F, 10.F);
+  obj_pid.activate(true, false, false);
+  obj_pid.activate(true, true, false);
+  obj_pid.update(90.F, 1.F);
+  checkNear(obj_pid.getIntPart(), 0.F, "deactivation clears the integral");
+  obj_pid.update(89.F, 10.F);
+  obj_pid.reset();
+  checkNear(obj_pid.getOutput(), 0.F, "reset clears the output");
+  checkNear(obj_pid.getIntPart(), 0.F, "reset clears the integral part");
+
+  if (s_i_failures){
+    printf("pid_check: %d checks FAILED\n", s_i_failures);
+  }
+  return s_i_failures ? 1 : 0;
+}
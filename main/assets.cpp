@@ -0,0 +1,59 @@
+/*********
+ *
+ * assets
+ * URI lookup in the web interface bundle, see assets.hpp
+ *
+*********/
+
+#include <string.h>
+#include "assets.hpp"
+
+// index generated by tools/gen_web_assets.py
+extern const web_asset arrWebAssets[];
+extern const int iWebAssetCount;
+extern const uint16_t arrWebAssetSeeds[];
+extern const int iWebAssetBuckets;
+
+
+uint32_t assetsHash(uint32_t i_seed, const char * ptr_data, size_t i_len){
+  /**
+   * 32 bit FNV-1a with the seed mixed into the offset basis, same as fnv1a() of the generator
+   *
+   * @param i_seed: 0 for the bucket, the displacement seed of the bucket for the slot
+   * @param ptr_data: key
+   * @param i_len: key length in bytes
+   * @return: hash value
+   */
+
+  uint32_t i_hash = 0x811C9DC5U ^ i_seed;
+
+  for (size_t i_idx = 0; i_idx < i_len; i_idx++){
+    i_hash ^= (uint8_t)ptr_data[i_idx];
+    i_hash *= 0x01000193U;
+  }
+  return i_hash;
+}
+
+
+const web_asset * assetsFind(const char * str_uri, size_t i_len){
+  /**
+   * Find an embedded file by its URI
+   *
+   * @param str_uri: path of the request without query string, e.g. /index.html
+   * @param i_len: length of the path
+   * @return: asset, NULL if the bundle has no file with this URI
+   */
+
+  if (iWebAssetCount == 0){
+    return NULL;
+  }
+
+  uint16_t i_seed = arrWebAssetSeeds[assetsHash(0, str_uri, i_len) % iWebAssetBuckets];
+  const web_asset * ptr_asset = &arrWebAssets[assetsHash(i_seed, str_uri, i_len) % iWebAssetCount];
+
+  // every URI hashes to a slot, the compare rejects those which are not in the bundle
+  if (strlen(ptr_asset->strUri) != i_len || memcmp(ptr_asset->strUri, str_uri, i_len) != 0){
+    return NULL;
+  }
+  return ptr_asset;
+}
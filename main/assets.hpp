@@ -0,0 +1,28 @@
+/*********
+ *
+ * assets
+ * Web interface bundle in the app image. All files of main/src are compressed and indexed at build time by
+ * tools/gen_web_assets.py, the URI lookup is a minimal perfect hash with one string compare. Files on LittleFS with
+ * the same name override the embedded ones, so the interface stays available after the file system was formatted.
+ *
+*********/
+
+#ifndef ASSETS_h
+#define ASSETS_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct web_asset {
+  const char * strUri;
+  const char * strContentType;
+  const uint8_t * ptrData;
+  uint32_t iSize;
+  bool bGzip;               // data is gzip compressed, images are stored as they are
+  uint32_t iHash;           // FNV-1a of the data, used as ETag
+};
+
+const web_asset * assetsFind(const char * str_uri, size_t i_len);
+uint32_t assetsHash(uint32_t i_seed, const char * ptr_data, size_t i_len);
+
+#endif
@@ -0,0 +1,171 @@
+/*********
+ *
+ * autotune
+ * On-device relay auto tuning, see autotune.hpp
+ *
+*********/
+
+#include <string.h>
+#include "autotune.hpp"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char * TAG_AUTOTUNE = "autotune";
+
+static PIDAutoTune s_obj_tuner;
+static portMUX_TYPE s_autotune_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static volatile int s_i_requested_rule = -1;   // rule of a pending start request
+static volatile bool s_b_abort_requested = false;
+static bool s_b_result_pending = false;        // result not yet applied to the configuration
+static float s_f_target = 0.F;
+static float s_f_out_low = 0.F;
+static float s_f_out_high = 0.F;
+
+
+esp_err_t autotuneRequestStart(const char * str_rule){
+  /**
+   * Request an experiment, it is started with the next sample of the measurement task
+   *
+   * @param str_rule: name of the tuning rule, see PIDAutoTune::getRuleName()
+   * @return: ESP_ERR_INVALID_ARG on an unknown rule, ESP_ERR_INVALID_STATE if an experiment is running
+   */
+
+  int i_rule = -1;
+
+  for (int i_idx=0; i_idx<AUTOTUNE_RULE_CNT; i_idx++){
+    if (strcmp(str_rule, PIDAutoTune::getRuleName(i_idx)) == 0){
+      i_rule = i_idx;
+    }
+  }
+  if (i_rule < 0){
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  esp_err_t esp_ret = ESP_OK;
+
+  taskENTER_CRITICAL(&s_autotune_mux);
+  if (s_obj_tuner.getState() == AUTOTUNE_STATE_RUNNING || s_i_requested_rule >= 0){
+    esp_ret = ESP_ERR_INVALID_STATE;
+  } else {
+    s_i_requested_rule = i_rule;
+    s_b_abort_requested = false;
+  }
+  taskEXIT_CRITICAL(&s_autotune_mux);
+
+  return esp_ret;
+}
+
+
+void autotuneRequestAbort(){
+  /**
+   * Abort a pending or running experiment, the PID controller takes over with the next sample
+   */
+
+  taskENTER_CRITICAL(&s_autotune_mux);
+  s_i_requested_rule = -1;
+  s_b_abort_requested = true;
+  taskEXIT_CRITICAL(&s_autotune_mux);
+}
+
+
+void autotuneGetStatus(autotune_status * ptr_status){
+  /**
+   * Get a consistent copy of the experiment status
+   *
+   * @param ptr_status: status
+   */
+
+  taskENTER_CRITICAL(&s_autotune_mux);
+  ptr_status->iState = (s_i_requested_rule >= 0) ? AUTOTUNE_STATE_RUNNING : s_obj_tuner.getState();
+  ptr_status->iError = s_obj_tuner.getError();
+  ptr_status->iRule = (s_i_requested_rule >= 0) ? s_i_requested_rule : s_obj_tuner.getRule();
+  ptr_status->iCycles = s_obj_tuner.getCycleCount();
+  ptr_status->fElapsedS = s_obj_tuner.getElapsedS();
+  if (!s_obj_tuner.getResult(&ptr_status->objResult)){
+    memset(&ptr_status->objResult, 0, sizeof(autotune_result));
+  }
+  taskEXIT_CRITICAL(&s_autotune_mux);
+}
+
+
+void autotuneSetup(float f_target, float f_out_low, float f_out_high){
+  /**
+   * Set target and output range of the next experiment, the relay switches between the output limits
+   *
+   * @param f_target: target temperature in °C
+   * @param f_out_low: heater off
+   * @param f_out_high: full heater power
+   */
+
+  taskENTER_CRITICAL(&s_autotune_mux);
+  s_f_target = f_target;
+  s_f_out_low = f_out_low;
+  s_f_out_high = f_out_high;
+  taskEXIT_CRITICAL(&s_autotune_mux);
+}
+
+
+bool autotuneUpdate(float f_actual, float f_dt_s, float * ptr_output){
+  /**
+   * Run the experiment, called by the measurement task with each valid sample
+   *
+   * @param f_actual: filtered temperature in °C
+   * @param f_dt_s: time since the last sample in s
+   * @param ptr_output: heater output of the relay, only written while the experiment is running
+   * @return: true if the experiment controls the heater
+   */
+
+  int i_prev_state;
+  int i_state;
+
+  taskENTER_CRITICAL(&s_autotune_mux);
+  i_prev_state = s_obj_tuner.getState();
+
+  if (s_b_abort_requested){
+    s_obj_tuner.abort();
+    s_b_abort_requested = false;
+  }
+  if (s_i_requested_rule >= 0){
+    s_obj_tuner.start(s_f_target, s_f_out_low, s_f_out_high, AUTOTUNE_HYSTERESIS_K, AUTOTUNE_CYCLES,
+                      s_i_requested_rule, AUTOTUNE_TIMEOUT_S, s_f_target + AUTOTUNE_OVERTEMP_MARGIN_K);
+    s_i_requested_rule = -1;
+    i_prev_state = AUTOTUNE_STATE_IDLE;
+  }
+  if (s_obj_tuner.getState() == AUTOTUNE_STATE_RUNNING){
+    *ptr_output = s_obj_tuner.update(f_actual, f_dt_s);
+  }
+  i_state = s_obj_tuner.getState();
+  s_b_result_pending |= (i_prev_state == AUTOTUNE_STATE_RUNNING && i_state == AUTOTUNE_STATE_DONE);
+  taskEXIT_CRITICAL(&s_autotune_mux);
+
+  if (i_state != i_prev_state){
+    if (i_state == AUTOTUNE_STATE_RUNNING){
+      ESP_LOGI(TAG_AUTOTUNE, "Relay experiment started, rule %s",
+               PIDAutoTune::getRuleName(s_obj_tuner.getRule()));
+    } else if (i_state == AUTOTUNE_STATE_FAILED){
+      ESP_LOGW(TAG_AUTOTUNE, "Relay experiment failed, error %d", s_obj_tuner.getError());
+    }
+  }
+  return i_state == AUTOTUNE_STATE_RUNNING;
+}
+
+
+bool autotuneTakeResult(autotune_result * ptr_result){
+  /**
+   * Get the result of a finished experiment once, to apply it to the configuration
+   *
+   * @param ptr_result: result
+   * @return: true if a new result is available
+   */
+
+  bool b_new_result;
+
+  taskENTER_CRITICAL(&s_autotune_mux);
+  b_new_result = s_b_result_pending && s_obj_tuner.getResult(ptr_result);
+  s_b_result_pending = false;
+  taskEXIT_CRITICAL(&s_autotune_mux);
+
+  return b_new_result;
+}
@@ -0,0 +1,36 @@
+/*********
+ *
+ * autotune
+ * On-device relay auto tuning of the boiler controller. The web server requests an experiment, the measurement task
+ * runs it on the SSR output instead of the PID controller and applies the result to the configuration.
+ *
+*********/
+
+#ifndef AUTOTUNE_h
+#define AUTOTUNE_h
+
+#include "esp_err.h"
+#include "PIDAutoTune.hpp"
+
+#define AUTOTUNE_HYSTERESIS_K 0.5F       // relay hysteresis around the target, above the filtered sensor noise
+#define AUTOTUNE_CYCLES 4                // evaluated limit cycles
+#define AUTOTUNE_TIMEOUT_S 3600.F        // experiment fails if the cycles are not completed within this time
+#define AUTOTUNE_OVERTEMP_MARGIN_K 15.F  // experiment fails above target + margin
+
+struct autotune_status {
+  int iState;               // eAutoTuneState
+  int iError;               // eAutoTuneError
+  int iRule;                // eAutoTuneRule
+  int iCycles;              // evaluated cycles so far
+  float fElapsedS;
+  autotune_result objResult; // valid if iState is AUTOTUNE_STATE_DONE
+};
+
+esp_err_t autotuneRequestStart(const char * str_rule);
+void autotuneRequestAbort();
+void autotuneGetStatus(autotune_status * ptr_status);
+void autotuneSetup(float f_target, float f_out_low, float f_out_high);
+bool autotuneUpdate(float f_actual, float f_dt_s, float * ptr_output);
+bool autotuneTakeResult(autotune_result * ptr_result);
+
+#endif
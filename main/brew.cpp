@@ -0,0 +1,126 @@
+/*********
+ *
+ * brew
+ * Brew shot detection on the device, see brew.hpp
+ *
+*********/
+
+#include "brew.hpp"
+#include "recorder.hpp"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char * TAG_BREW = "brew";
+
+static BrewDetector s_obj_detector;
+static portMUX_TYPE s_brew_mux = portMUX_INITIALIZER_UNLOCKED;
+static gpio_num_t s_i_switch_pin = GPIO_NUM_NC;
+static uint32_t s_i_logged_shots = 0;   // shots already passed to the recorder
+
+
+esp_err_t brewSetup(const brew_params & obj_params, float f_target, gpio_num_t i_switch_pin){
+  /**
+   * Apply the brew configuration
+   *
+   * @param obj_params: detection and boost parameters
+   * @param f_target: target temperature of the controller in °C
+   * @param i_switch_pin: input of the pump/brew switch (active low), used if switch detection is active
+   * @return: result of the GPIO configuration
+   */
+
+  esp_err_t esp_ret = ESP_OK;
+
+  if (obj_params.bSwitchDetect && s_i_switch_pin != i_switch_pin){
+    gpio_config_t conf_switch_pin;
+    conf_switch_pin.pin_bit_mask = (1ULL << i_switch_pin);
+    conf_switch_pin.mode = GPIO_MODE_INPUT;
+    conf_switch_pin.pull_up_en = GPIO_PULLUP_ENABLE;
+    conf_switch_pin.pull_down_en = GPIO_PULLDOWN_DISABLE;
+    conf_switch_pin.intr_type = GPIO_INTR_DISABLE;
+    esp_ret = gpio_config(&conf_switch_pin);
+  }
+
+  taskENTER_CRITICAL(&s_brew_mux);
+  s_obj_detector.setParams(obj_params);
+  s_obj_detector.setTarget(f_target);
+  s_i_switch_pin = obj_params.bSwitchDetect ? i_switch_pin : GPIO_NUM_NC;
+  taskEXIT_CRITICAL(&s_brew_mux);
+
+  return esp_ret;
+}
+
+
+float brewUpdate(int64_t i_time_us, float f_actual){
+  /**
+   * Process a valid sample, called by the measurement task
+   *
+   * @param i_time_us: monotonic sample time
+   * @param f_actual: filtered temperature in °C
+   * @return: feed-forward boost which is added to the controller output
+   */
+
+  bool b_switch = (s_i_switch_pin != GPIO_NUM_NC) && (gpio_get_level(s_i_switch_pin) == 0);
+  brew_shot obj_shot;
+  bool b_new_shot;
+  float f_feed_forward;
+
+  taskENTER_CRITICAL(&s_brew_mux);
+  f_feed_forward = s_obj_detector.update(i_time_us / 1e6, f_actual, b_switch);
+  b_new_shot = (s_obj_detector.getShotCount() != s_i_logged_shots) && s_obj_detector.getShot(0, &obj_shot);
+  s_i_logged_shots = s_obj_detector.getShotCount();
+  taskEXIT_CRITICAL(&s_brew_mux);
+
+  if (b_new_shot){
+    ESP_LOGI(TAG_BREW, "Shot %u: dip %.2f K, recovery %.1f s", obj_shot.iShotNumber, obj_shot.fDip,
+             obj_shot.fRecoveryS);
+    // the recorder task appends it to the shot file, the measurement task does not wait for the flash
+    if (recorderPushShot(obj_shot) != ESP_OK){
+      ESP_LOGW(TAG_BREW, "Shot %u is not written to the shot file", obj_shot.iShotNumber);
+    }
+  }
+  return f_feed_forward;
+}
+
+
+void brewGetReport(brew_report * ptr_report){
+  /**
+   * Get a consistent copy of detector state, shot history and the trace of the latest shot
+   *
+   * @param ptr_report: report
+   */
+
+  taskENTER_CRITICAL(&s_brew_mux);
+  ptr_report->iState = s_obj_detector.getState();
+  ptr_report->fSlope = s_obj_detector.getSlope();
+  ptr_report->fFeedForward = s_obj_detector.getFeedForward();
+  ptr_report->iShotCnt = s_obj_detector.getShotCount();
+  ptr_report->iHistoryCnt = 0;
+  while (ptr_report->iHistoryCnt < BREW_SHOT_HISTORY &&
+         s_obj_detector.getShot(ptr_report->iHistoryCnt, &ptr_report->arrShots[ptr_report->iHistoryCnt])){
+    ptr_report->iHistoryCnt++;
+  }
+  ptr_report->iTraceCnt = s_obj_detector.getTrace(ptr_report->arrTrace, BREW_TRACE_LEN, &ptr_report->fTraceIntervalS,
+                                                  &ptr_report->iTraceShot);
+  ptr_report->iTracePreCnt = s_obj_detector.getTracePreCount();
+  taskEXIT_CRITICAL(&s_brew_mux);
+}
+
+
+uint32_t brewGetShotCount(){
+  return s_obj_detector.getShotCount();
+}
+
+
+int brewGetState(){
+  /**
+   * State of the detector, eBrewState
+   */
+
+  int i_state;
+
+  taskENTER_CRITICAL(&s_brew_mux);
+  i_state = s_obj_detector.getState();
+  taskEXIT_CRITICAL(&s_brew_mux);
+  return i_state;
+}
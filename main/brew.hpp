@@ -0,0 +1,40 @@
+/*********
+ *
+ * brew
+ * Brew shot detection on the device. The measurement task feeds the detector with every valid sample and adds its
+ * feed-forward boost to the controller output. Finished shots are appended to the shot file, statistics and the trace
+ * of the latest shot are served by the web server.
+ *
+*********/
+
+#ifndef BREW_h
+#define BREW_h
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+#include "BrewDetector.hpp"
+
+#define BREW_SHOT_FILE_PATH "/littlefs/shots.csv"
+
+struct brew_report {
+  int iState;                               // eBrewState
+  float fSlope;                             // temperature slope in K/s
+  float fFeedForward;                       // actual boost
+  uint32_t iShotCnt;                        // shots since start
+  int iHistoryCnt;
+  brew_shot arrShots[BREW_SHOT_HISTORY];    // latest shot first
+  uint32_t iTraceShot;                      // number of the traced shot
+  float fTraceIntervalS;
+  int iTracePreCnt;                         // trace samples before the detection
+  int iTraceCnt;
+  float arrTrace[BREW_TRACE_LEN];
+};
+
+esp_err_t brewSetup(const brew_params & obj_params, float f_target, gpio_num_t i_switch_pin);
+float brewUpdate(int64_t i_time_us, float f_actual);
+void brewGetReport(brew_report * ptr_report);
+uint32_t brewGetShotCount();
+int brewGetState();
+
+#endif
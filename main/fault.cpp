@@ -0,0 +1,123 @@
+/*********
+ *
+ * fault
+ * Sensor fault manager on the device, see fault.hpp
+ *
+*********/
+
+#include "fault.hpp"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char * TAG_FAULT = "fault";
+
+static FaultManager s_obj_manager;
+static portMUX_TYPE s_fault_mux = portMUX_INITIALIZER_UNLOCKED;
+
+
+void faultSetup(const fault_params & obj_params){
+  /**
+   * Apply the limits of the fault checks
+   *
+   * @param obj_params: limits and safe-state timing
+   */
+
+  taskENTER_CRITICAL(&s_fault_mux);
+  s_obj_manager.setParams(obj_params);
+  taskEXIT_CRITICAL(&s_fault_mux);
+}
+
+
+int faultUpdate(const fault_input & obj_input){
+  /**
+   * Check a control cycle, called by the measurement task for every sample and every sample timeout
+   *
+   * @param obj_input: sample and heater output of the cycle
+   * @return: safe-state action, eFaultAction
+   */
+
+  uint32_t i_prev_mask;
+  uint32_t i_mask;
+  int i_prev_action;
+  int i_action;
+
+  taskENTER_CRITICAL(&s_fault_mux);
+  i_prev_mask = s_obj_manager.getActiveMask();
+  i_prev_action = s_obj_manager.getAction();
+  i_action = s_obj_manager.update(obj_input);
+  i_mask = s_obj_manager.getActiveMask();
+  taskEXIT_CRITICAL(&s_fault_mux);
+
+  for (int i_code = 0; i_code < FAULT_CNT; i_code++){
+    if ((i_mask & ~i_prev_mask) & FAULT_BIT(i_code)){
+      ESP_LOGW(TAG_FAULT, "Fault %s at %.1f °C", FaultManager::getFaultName(i_code), obj_input.fTemperature);
+    }
+  }
+  if (i_action != i_prev_action){
+    ESP_LOGW(TAG_FAULT, "Heater safe state: %s", FaultManager::getActionName(i_action));
+  }
+  return i_action;
+}
+
+
+bool faultSampleUsable(){
+  return s_obj_manager.isSampleUsable();
+}
+
+
+int faultGetAction(){
+  /**
+   * @return: safe-state action of the latest cycle, eFaultAction
+   */
+
+  return s_obj_manager.getAction();
+}
+
+
+float faultLimitOutput(float f_output){
+  /**
+   * Limit the heater output according to the action of the latest cycle
+   *
+   * @param f_output: controller output, or the previous output if the sample is not usable
+   * @return: heater output
+   */
+
+  float f_limited;
+
+  taskENTER_CRITICAL(&s_fault_mux);
+  f_limited = s_obj_manager.limitOutput(f_output);
+  taskEXIT_CRITICAL(&s_fault_mux);
+  return f_limited;
+}
+
+
+void faultGetReport(fault_report * ptr_report){
+  /**
+   * Get a consistent copy of the fault state
+   *
+   * @param ptr_report: report
+   */
+
+  taskENTER_CRITICAL(&s_fault_mux);
+  ptr_report->iAction = s_obj_manager.getAction();
+  ptr_report->iActiveMask = s_obj_manager.getActiveMask();
+  ptr_report->iLatchedMask = s_obj_manager.getLatchedMask();
+  ptr_report->fHoldOutput = s_obj_manager.getHoldOutput();
+  for (int i_code = 0; i_code < FAULT_CNT; i_code++){
+    s_obj_manager.getEntry(i_code, &ptr_report->arrEntries[i_code]);
+  }
+  taskEXIT_CRITICAL(&s_fault_mux);
+}
+
+
+void faultClear(){
+  /**
+   * Acknowledge the latched faults, heater plausibility faults and the limp timeout release the heater again
+   */
+
+  taskENTER_CRITICAL(&s_fault_mux);
+  s_obj_manager.clear();
+  taskEXIT_CRITICAL(&s_fault_mux);
+  ESP_LOGI(TAG_FAULT, "Faults cleared");
+}
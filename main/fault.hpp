@@ -0,0 +1,33 @@
+/*********
+ *
+ * fault
+ * Sensor fault manager on the device. The measurement task checks every sample and every sample timeout before the
+ * heater is driven: the most restrictive safe-state action of the active faults caps the output, switches to the open
+ * loop limp mode or turns the heater off. New faults are logged, the latched fault codes are served by the web server
+ * until they are cleared from the dashboard.
+ *
+*********/
+
+#ifndef FAULT_h
+#define FAULT_h
+
+#include <stdint.h>
+#include "FaultManager.hpp"
+
+struct fault_report {
+  int iAction;                          // eFaultAction of the latest cycle
+  uint32_t iActiveMask;                 // FAULT_BIT(eFaultCode)
+  uint32_t iLatchedMask;
+  float fHoldOutput;                    // learned holding output of the limp mode, fraction of the output range
+  fault_entry arrEntries[FAULT_CNT];
+};
+
+void faultSetup(const fault_params & obj_params);
+int faultUpdate(const fault_input & obj_input);
+bool faultSampleUsable();
+int faultGetAction();
+float faultLimitOutput(float f_output);
+void faultGetReport(fault_report * ptr_report);
+void faultClear();
+
+#endif
@@ -0,0 +1,155 @@
+/*********
+ *
+ * jsonarena
+ * Bump allocator for cJSON, see jsonarena.hpp
+ *
+*********/
+
+#include <stdlib.h>
+#include "jsonarena.hpp"
+#include "memplan.hpp"
+#include "metrics.hpp"
+#include "cJSON.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+static const char * TAG_JSON_ARENA = "jsonarena";
+
+static uint8_t s_arr_arena[JSON_ARENA_SIZE] __attribute__((aligned(JSON_ARENA_ALIGN)));
+static size_t s_i_top = 0;                      // fill level in bytes
+static uint8_t * s_ptr_last = NULL;             // last allocation, can be given back by cJSON_free
+static TaskHandle_t s_ptr_owner = NULL;         // task with the open scope
+static int s_i_depth = 0;
+static SemaphoreHandle_t s_arena_mutex = NULL;
+static StaticSemaphore_t s_obj_arena_mutex_buf;
+
+// written only by the owner of the arena, the 32 bit fields are read without lock
+static json_arena_stats s_obj_stats = {JSON_ARENA_SIZE, 0, 0, 0};
+
+
+static void * arenaMalloc(size_t i_size){
+  /**
+   * cJSON allocation hook, bump allocation for the owner of the arena, heap for all others
+   *
+   * @param i_size: requested size in bytes
+   * @return: memory block, NULL if the heap is exhausted
+   */
+
+  if (s_ptr_owner != NULL && s_ptr_owner == xTaskGetCurrentTaskHandle()){
+    size_t i_aligned = (i_size + JSON_ARENA_ALIGN - 1) & ~(size_t)(JSON_ARENA_ALIGN - 1);
+
+    if (i_aligned <= JSON_ARENA_SIZE - s_i_top){
+      s_ptr_last = &s_arr_arena[s_i_top];
+      s_i_top += i_aligned;
+      s_obj_stats.iUsed = s_i_top;
+      if (s_i_top > s_obj_stats.iPeak){
+        s_obj_stats.iPeak = s_i_top;
+      }
+      return s_ptr_last;
+    }
+    s_obj_stats.iOverflows++;
+  }
+
+  memplanCountAlloc(i_size);
+  return malloc(i_size);
+}
+
+
+static void arenaFree(void * ptr_mem){
+  /**
+   * cJSON free hook, arena blocks are released with the scope, only the last one is given back immediately
+   *
+   * @param ptr_mem: block of arenaMalloc()
+   */
+
+  uint8_t * ptr_block = (uint8_t *)ptr_mem;
+
+  if (ptr_block >= s_arr_arena && ptr_block < s_arr_arena + JSON_ARENA_SIZE){
+    if (ptr_block == s_ptr_last && s_ptr_owner == xTaskGetCurrentTaskHandle()){
+      s_i_top = ptr_block - s_arr_arena;
+      s_obj_stats.iUsed = s_i_top;
+      s_ptr_last = NULL;
+    }
+    return;
+  }
+  free(ptr_mem);
+}
+
+
+void jsonArenaInit(){
+  /**
+   * Install the arena as allocator of cJSON, called before the configuration is loaded
+   */
+
+  s_arena_mutex = xSemaphoreCreateRecursiveMutexStatic(&s_obj_arena_mutex_buf);
+
+  cJSON_Hooks obj_hooks = {arenaMalloc, arenaFree};
+  cJSON_InitHooks(&obj_hooks);
+  ESP_LOGI(TAG_JSON_ARENA, "cJSON arena with %u bytes installed", (unsigned)JSON_ARENA_SIZE);
+}
+
+
+size_t jsonArenaBegin(){
+  /**
+   * Open a scope, cJSON allocations of the calling task are served by the arena until jsonArenaEnd(). Scopes of the
+   * same task can be nested, other tasks wait until the scope is closed.
+   *
+   * @return: mark to pass to jsonArenaEnd()
+   */
+
+  xSemaphoreTakeRecursive(s_arena_mutex, portMAX_DELAY);
+  if (s_i_depth++ == 0){
+    s_ptr_owner = xTaskGetCurrentTaskHandle();
+  }
+  // blocks of the enclosing scope must not be given back by this one
+  s_ptr_last = NULL;
+  return s_i_top;
+}
+
+
+void jsonArenaEnd(size_t i_mark){
+  /**
+   * Close a scope and release every cJSON allocation made since its jsonArenaBegin(). Pointers into the released
+   * part, e.g. the result of cJSON_Print(), must not be used afterwards.
+   *
+   * @param i_mark: return value of the matching jsonArenaBegin()
+   */
+
+  s_i_top = i_mark;
+  s_obj_stats.iUsed = s_i_top;
+  s_ptr_last = NULL;
+  if (--s_i_depth == 0){
+    s_ptr_owner = NULL;
+  }
+  xSemaphoreGiveRecursive(s_arena_mutex);
+}
+
+
+void jsonArenaGetStats(json_arena_stats * ptr_stats){
+  /**
+   * Copy of the arena counters
+   *
+   * @param ptr_stats: destination
+   */
+
+  *ptr_stats = s_obj_stats;
+}
+
+
+static double getArenaPeak(){ return s_obj_stats.iPeak; }
+static double getArenaOverflows(){ return s_obj_stats.iOverflows; }
+
+
+void jsonArenaRegisterMetrics(){
+  /**
+   * Register the metrics of the cJSON arena
+   */
+
+  metricsRegister("coffee_json_arena_peak_bytes", "Highest fill level of the cJSON arena since boot",
+                  METRIC_TYPE_GAUGE, getArenaPeak);
+  metricsRegister("coffee_json_arena_overflows_total",
+                  "cJSON allocations served by the heap because the arena was full",
+                  METRIC_TYPE_COUNTER, getArenaOverflows);
+}
@@ -0,0 +1,33 @@
+/*********
+ *
+ * jsonarena
+ * Bump allocator for cJSON. All nodes, strings and print buffers of a JSON operation (configuration load and save,
+ * JSON endpoints) are taken from one static buffer between jsonArenaBegin() and jsonArenaEnd(), the end of the scope
+ * releases all of them at once by resetting the fill level. The arena belongs to the task which opened the scope,
+ * cJSON calls of other tasks and allocations which do not fit anymore are served by the heap.
+ *
+*********/
+
+#ifndef JSONARENA_h
+#define JSONARENA_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define JSON_ARENA_SIZE 12288     // bytes, configuration tree plus print buffer with margin
+#define JSON_ARENA_ALIGN 8        // cJSON nodes contain a double
+
+struct json_arena_stats {
+  uint32_t iSize;
+  uint32_t iUsed;                 // fill level of the open scopes
+  uint32_t iPeak;                 // highest fill level since boot
+  uint32_t iOverflows;            // allocations served by the heap because the arena was full
+};
+
+void jsonArenaInit();
+size_t jsonArenaBegin();
+void jsonArenaEnd(size_t i_mark);
+void jsonArenaGetStats(json_arena_stats * ptr_stats);
+void jsonArenaRegisterMetrics();
+
+#endif
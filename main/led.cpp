@@ -0,0 +1,331 @@
+/*********
+ *
+ * led
+ * Status engine of the RGB LED, see led.hpp
+ *
+*********/
+
+#include <stdint.h>
+#include "led.hpp"
+#include "metrics.hpp"
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "driver/ledc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define LED_DUTY_MAX ((1U << LED_DUTY_RES) - 1U)
+
+#define LED_EVENT_LAYER (1U << 0)     // a layer changed its pattern
+#define LED_EVENT_FADE_END (1U << 1)  // all fades of the step are finished
+#define LED_EVENT_HOLD_END (1U << 2)  // hold time of the step is over
+
+static const char * TAG_LED = "led";
+
+struct led_step {
+  uint8_t iColor;         // eLEDColor
+  bool bGain;             // apply the brightness correction per channel
+  uint16_t iFadeMs;       // hardware fade to the color, 0 switches at once
+  uint16_t iHoldMs;       // time on the color after the fade
+};
+
+struct led_sequence {
+  const led_step * ptrSteps;
+  uint8_t iCnt;           // one step is shown until the pattern changes, more steps repeat
+};
+
+// color at full brightness in 8 bit RGB, scaled by the color and channel factors into the duty table
+static const uint8_t s_arr_color_rgb[LED_COLOR_CNT][3] = {
+  {0, 0, 0},              // off
+  {255, 0, 0},            // red
+  {0, 255, 0},            // green
+  {0, 0, 255},            // blue
+  {255, 10, 0},           // orange
+  {170, 0, 255},          // purple
+  {100, 100, 100}         // white
+};
+
+// repeating sequences need a hold time in at least one step, otherwise the engine would never sleep
+static const led_step s_arr_steps_off[] = {{LED_COLOR_OFF, false, 500, 0}};
+static const led_step s_arr_steps_boot[] = {{LED_COLOR_WHITE, true, 1000, 0}};
+static const led_step s_arr_steps_online[] = {{LED_COLOR_PURPLE, false, 1000, 0}};
+static const led_step s_arr_steps_offline[] = {{LED_COLOR_BLUE, false, 1500, 0}, {LED_COLOR_OFF, false, 1500, 500}};
+static const led_step s_arr_steps_ready[] = {{LED_COLOR_GREEN, true, 1000, 0}};
+static const led_step s_arr_steps_heating[] = {{LED_COLOR_ORANGE, true, 1000, 0}, {LED_COLOR_OFF, true, 1000, 200}};
+static const led_step s_arr_steps_fault[] = {{LED_COLOR_RED, true, 0, 150}, {LED_COLOR_OFF, true, 0, 150}};
+
+#define LED_SEQUENCE(arr_steps) {arr_steps, sizeof(arr_steps) / sizeof(arr_steps[0])}
+
+static const led_sequence s_arr_sequences[LED_PATTERN_CNT] = {
+  LED_SEQUENCE(s_arr_steps_off),
+  LED_SEQUENCE(s_arr_steps_boot),
+  LED_SEQUENCE(s_arr_steps_online),
+  LED_SEQUENCE(s_arr_steps_offline),
+  LED_SEQUENCE(s_arr_steps_ready),
+  LED_SEQUENCE(s_arr_steps_heating),
+  LED_SEQUENCE(s_arr_steps_fault)
+};
+
+static const ledc_channel_t s_arr_channels[3] = {LED_RED_CHANNEL, LED_GRN_CHANNEL, LED_BLU_CHANNEL};
+
+static uint32_t s_arr_duty[LED_COLOR_CNT][2][3];                 // color, without/with channel gain, channel
+static volatile uint8_t s_arr_layers[LED_LAYER_CNT] = {};         // declared pattern per layer
+static volatile int s_i_fades_pending = 0;
+static volatile uint32_t s_i_transitions = 0;
+static portMUX_TYPE s_led_mux = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t s_h_led_task = NULL;
+static esp_timer_handle_t s_h_hold_timer = NULL;
+
+
+static bool IRAM_ATTR fadeEndIsr(const ledc_cb_param_t * ptr_param, void * ptr_arg){
+  /**
+   * Fade end interrupt of a color channel, the last channel of a step wakes the engine
+   */
+
+  BaseType_t b_woken = pdFALSE;
+  bool b_last;
+
+  if (ptr_param->event != LEDC_FADE_END_EVT){
+    return false;
+  }
+  portENTER_CRITICAL_ISR(&s_led_mux);
+  b_last = --s_i_fades_pending == 0;
+  portEXIT_CRITICAL_ISR(&s_led_mux);
+
+  if (b_last){
+    xTaskNotifyFromISR(s_h_led_task, LED_EVENT_FADE_END, eSetBits, &b_woken);
+  }
+  return b_woken == pdTRUE;
+}
+
+
+static void holdTimerCallback(void * ptr_arg){
+  xTaskNotify(s_h_led_task, LED_EVENT_HOLD_END, eSetBits);
+}
+
+
+static int getActivePattern(){
+  /**
+   * Pattern of the highest active layer
+   *
+   * @return: eLedPattern, LED_PATTERN_NONE (LED off) if no layer is active
+   */
+
+  for (int i_layer = LED_LAYER_CNT - 1; i_layer >= 0; i_layer--){
+    if (s_arr_layers[i_layer] != LED_PATTERN_NONE){
+      return s_arr_layers[i_layer];
+    }
+  }
+  return LED_PATTERN_NONE;
+}
+
+
+static bool startStep(const led_step & obj_step){
+  /**
+   * Output the color of a step, channels which change are faded by the LEDC hardware
+   *
+   * @param obj_step: step to show
+   * @return: true if a fade is running, its end is signaled by LED_EVENT_FADE_END
+   */
+
+  const uint32_t * ptr_duty = s_arr_duty[obj_step.iColor][obj_step.bGain ? 1 : 0];
+  bool arr_fade[3];
+  int i_fades = 0;
+
+  for (int i_ch = 0; i_ch < 3; i_ch++){
+    arr_fade[i_ch] = obj_step.iFadeMs > 0 && ledc_get_duty(LEDC_HIGH_SPEED_MODE, s_arr_channels[i_ch]) != ptr_duty[i_ch];
+    i_fades += arr_fade[i_ch] ? 1 : 0;
+  }
+
+  // counter is complete before the first fade can end
+  portENTER_CRITICAL(&s_led_mux);
+  s_i_fades_pending = i_fades;
+  portEXIT_CRITICAL(&s_led_mux);
+
+  for (int i_ch = 0; i_ch < 3; i_ch++){
+    if (arr_fade[i_ch]){
+      ledc_set_fade_with_time(LEDC_HIGH_SPEED_MODE, s_arr_channels[i_ch], ptr_duty[i_ch], obj_step.iFadeMs);
+      ledc_fade_start(LEDC_HIGH_SPEED_MODE, s_arr_channels[i_ch], LEDC_FADE_NO_WAIT);
+    } else {
+      ledc_set_duty(LEDC_HIGH_SPEED_MODE, s_arr_channels[i_ch], ptr_duty[i_ch]);
+      ledc_update_duty(LEDC_HIGH_SPEED_MODE, s_arr_channels[i_ch]);
+    }
+  }
+  s_i_transitions++;
+  return i_fades > 0;
+}
+
+
+static bool holdStep(int i_pattern, int i_step){
+  /**
+   * The color of a step is reached, wait for its hold time
+   *
+   * @return: true if the next step follows at once
+   */
+
+  const led_sequence & obj_seq = s_arr_sequences[i_pattern];
+
+  if (obj_seq.ptrSteps[i_step].iHoldMs > 0){
+    esp_timer_start_once(s_h_hold_timer, obj_seq.ptrSteps[i_step].iHoldMs * 1000ULL);
+    return false;
+  }
+  return obj_seq.iCnt > 1;
+}
+
+
+static void ledTask(void * ptr_params){
+  /**
+   * LED engine: sleeps until a fade ends, a hold time is over or a layer changes. A running fade is not interrupted,
+   * a new pattern starts at the end of the actual fade.
+   */
+
+  uint32_t i_events = 0;
+  int i_pattern = LED_PATTERN_NONE;
+  int i_step = -1;              // nothing shown yet
+  bool b_fading = false;
+  bool b_layer_changed = true;  // show the layers declared before the start
+
+  for (;;){
+    bool b_advance = false;
+
+    if (i_events & LED_EVENT_LAYER){
+      b_layer_changed = true;
+    }
+    if ((i_events & LED_EVENT_FADE_END) && b_fading){
+      b_fading = false;
+      b_advance = holdStep(i_pattern, i_step);
+    }
+    if ((i_events & LED_EVENT_HOLD_END) && !b_fading){
+      b_advance = s_arr_sequences[i_pattern].iCnt > 1;
+    }
+
+    if (b_layer_changed && !b_fading){
+      int i_active = getActivePattern();
+
+      b_layer_changed = false;
+      if (i_active != i_pattern || i_step < 0){
+        esp_timer_stop(s_h_hold_timer);
+        i_pattern = i_active;
+        i_step = -1;
+        b_advance = true;
+      }
+    }
+
+    // steps without fade and hold time follow each other directly
+    while (b_advance){
+      const led_sequence & obj_seq = s_arr_sequences[i_pattern];
+
+      i_step = (i_step + 1) % obj_seq.iCnt;
+      b_fading = startStep(obj_seq.ptrSteps[i_step]);
+      b_advance = !b_fading && holdStep(i_pattern, i_step);
+    }
+
+    xTaskNotifyWait(0, UINT32_MAX, &i_events, portMAX_DELAY);
+  }
+}
+
+
+esp_err_t ledSetup(const led_config & obj_config){
+  /**
+   * Configure the LEDC channels of the RGB LED, precompute the duty table and start the engine
+   *
+   * @param obj_config: pins, PWM frequency and brightness correction
+   * @return: ESP_OK or the error of the LEDC driver
+   */
+
+  for (int i_color = 0; i_color < LED_COLOR_CNT; i_color++){
+    for (int i_ch = 0; i_ch < 3; i_ch++){
+      float f_duty = s_arr_color_rgb[i_color][i_ch] * obj_config.arrColorFactor[i_color];
+      float f_duty_gain = f_duty * obj_config.arrGain[i_ch];
+
+      f_duty = (f_duty > LED_DUTY_MAX) ? LED_DUTY_MAX : ((f_duty < 0.F) ? 0.F : f_duty);
+      f_duty_gain = (f_duty_gain > LED_DUTY_MAX) ? LED_DUTY_MAX : ((f_duty_gain < 0.F) ? 0.F : f_duty_gain);
+      s_arr_duty[i_color][0][i_ch] = (uint32_t)f_duty;
+      s_arr_duty[i_color][1][i_ch] = (uint32_t)f_duty_gain;
+    }
+  }
+
+  ledc_timer_config_t conf_ledc_timer;
+  conf_ledc_timer.speed_mode       = LEDC_HIGH_SPEED_MODE;
+  conf_ledc_timer.timer_num        = LED_LEDC_TIMER;
+  conf_ledc_timer.duty_resolution  = LED_DUTY_RES;
+  conf_ledc_timer.freq_hz          = obj_config.iFreq;
+  conf_ledc_timer.clk_cfg          = LEDC_AUTO_CLK;
+
+  esp_err_t esp_ret = ledc_timer_config(&conf_ledc_timer);
+  if (esp_ret != ESP_OK){
+    ESP_LOGE(TAG_LED, "LEDC timer configuration failed (%s)", esp_err_to_name(esp_ret));
+    return esp_ret;
+  }
+
+  ledc_channel_config_t conf_ledc_channel;
+  for (int i_ch = 0; i_ch < 3; i_ch++){
+    conf_ledc_channel.channel    = s_arr_channels[i_ch];
+    conf_ledc_channel.duty       = 0;
+    conf_ledc_channel.gpio_num   = obj_config.arrPins[i_ch];
+    conf_ledc_channel.speed_mode = LEDC_HIGH_SPEED_MODE;
+    conf_ledc_channel.hpoint     = 0;
+    conf_ledc_channel.timer_sel  = LED_LEDC_TIMER;
+    conf_ledc_channel.flags.output_invert = 0;
+    conf_ledc_channel.intr_type  = LEDC_INTR_DISABLE;
+    ledc_channel_config(&conf_ledc_channel);
+  }
+
+  // fade end interrupts drive the sequences
+  ledc_fade_func_install(0);
+  ledc_cbs_t obj_callbacks = {fadeEndIsr};
+  for (int i_ch = 0; i_ch < 3; i_ch++){
+    ledc_cb_register(LEDC_HIGH_SPEED_MODE, s_arr_channels[i_ch], &obj_callbacks, NULL);
+  }
+
+  esp_timer_create_args_t obj_timer_args = {};
+  obj_timer_args.callback = holdTimerCallback;
+  obj_timer_args.dispatch_method = ESP_TIMER_TASK;
+  obj_timer_args.name = "led";
+  esp_ret = esp_timer_create(&obj_timer_args, &s_h_hold_timer);
+  if (esp_ret != ESP_OK){
+    return esp_ret;
+  }
+
+  if (xTaskCreate(ledTask, "led", LED_TASK_STACK_SIZE, NULL, LED_TASK_PRIORITY, &s_h_led_task) != pdPASS){
+    return ESP_ERR_NO_MEM;
+  }
+  return ESP_OK;
+}
+
+
+void ledSetLayer(int i_layer, int i_pattern){
+  /**
+   * Declare the pattern of a status layer, called by the producers whenever their state is evaluated. The engine is
+   * only woken up if the pattern of the layer changes.
+   *
+   * @param i_layer: eLedLayer
+   * @param i_pattern: eLedPattern, LED_PATTERN_NONE deactivates the layer
+   */
+
+  if (i_layer < 0 || i_layer >= LED_LAYER_CNT || i_pattern < 0 || i_pattern >= LED_PATTERN_CNT){
+    return;
+  }
+  if (s_arr_layers[i_layer] == i_pattern){
+    return;
+  }
+  s_arr_layers[i_layer] = (uint8_t)i_pattern;
+
+  if (s_h_led_task){
+    xTaskNotify(s_h_led_task, LED_EVENT_LAYER, eSetBits);
+  }
+}
+
+
+static double getLedTransitions(){ return s_i_transitions; }
+
+
+void ledRegisterMetrics(){
+  /**
+   * Register the metrics of the LED engine
+   */
+
+  metricsRegister("coffee_led_transitions_total", "Color steps output by the LED engine", METRIC_TYPE_COUNTER,
+                  getLedTransitions);
+}
@@ -0,0 +1,68 @@
+/*********
+ *
+ * led
+ * Status engine of the RGB LED. Producers declare a pattern per status layer, the LED shows the pattern of the highest
+ * active layer (fault > heating > ready > network). A pattern is a short sequence of color steps, each step is a
+ * hardware fade of the LEDC channels followed by an optional hold: the fade end interrupt and a one-shot timer wake
+ * the engine task, which sleeps in between and only reacts to layer changes at step boundaries.
+ *
+*********/
+
+#ifndef LED_h
+#define LED_h
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+
+#define LED_DUTY_RES LEDC_TIMER_13_BIT
+#define LED_LEDC_TIMER LEDC_TIMER_0
+#define LED_RED_CHANNEL LEDC_CHANNEL_0
+#define LED_GRN_CHANNEL LEDC_CHANNEL_1
+#define LED_BLU_CHANNEL LEDC_CHANNEL_2
+#define LED_TASK_STACK_SIZE 2048
+#define LED_TASK_PRIORITY 2         // below all control and network tasks
+
+enum eLEDColor{
+  LED_COLOR_OFF,
+  LED_COLOR_RED,
+  LED_COLOR_GREEN,
+  LED_COLOR_BLUE,
+  LED_COLOR_ORANGE,
+  LED_COLOR_PURPLE,
+  LED_COLOR_WHITE,
+  LED_COLOR_CNT
+};
+
+// status layers in ascending priority
+enum eLedLayer{
+  LED_LAYER_NETWORK,
+  LED_LAYER_READY,
+  LED_LAYER_HEATING,
+  LED_LAYER_FAULT,
+  LED_LAYER_CNT
+};
+
+enum eLedPattern{
+  LED_PATTERN_NONE,         // layer is inactive
+  LED_PATTERN_BOOT,         // white, device is starting
+  LED_PATTERN_ONLINE,       // purple, station is connected
+  LED_PATTERN_OFFLINE,      // slow blue breathing, only the soft AP is available
+  LED_PATTERN_READY,        // green, boiler is at temperature
+  LED_PATTERN_HEATING,      // orange breathing, boiler is away from the target
+  LED_PATTERN_FAULT,        // fast red blinking, the fault manager limits the heater
+  LED_PATTERN_CNT
+};
+
+struct led_config {
+  gpio_num_t arrPins[3];                  // red, green, blue
+  uint32_t iFreq;                         // Hz, PWM frequency
+  float arrGain[3];                       // brightness correction per channel (red, green, blue)
+  float arrColorFactor[LED_COLOR_CNT];    // brightness correction per color
+};
+
+esp_err_t ledSetup(const led_config & obj_config);
+void ledSetLayer(int i_layer, int i_pattern);
+void ledRegisterMetrics();
+
+#endif
@@ -20,27 +20,37 @@
 #define P_GRN_LED_PWM GPIO_NUM_27
 #define P_BLU_LED_PWM GPIO_NUM_12
 #define P_STAT_LED GPIO_NUM_33 // green status LED
-#define LEDC_DUTY_RES LEDC_TIMER_13_BIT // Set duty resolution to 13 bits
+
+// Input of the pump/brew switch, active low
+#define P_BREW_SWITCH GPIO_NUM_32
+// Input of the zero-cross detector, pulse before each zero crossing of the mains (SsrMode 2)
+#define P_ZERO_CROSS GPIO_NUM_34
 
 // File system definitions
 #define FORMAT_SPIFFS_IF_FAILED true
 #define JSON_MEMORY 1600
 
 
-// define timer related channels for PWM signals
-#define RwmRedChannel LEDC_CHANNEL_0 //  PWM channel. There are 16 channels from 0 to 15. Channel 13 is now Red-LED
-#define RwmGrnChannel LEDC_CHANNEL_1 //  PWM channel. There are 16 channels from 0 to 15. Channel 14 is now Green-LED
-#define RwmBluChannel LEDC_CHANNEL_2 //  PWM channel. There are 16 channels from 0 to 15. Channel 15 is now Blue-LED
-#define PwmSsrChannel LEDC_CHANNEL_3  //  PWM channel. There are 16 channels from 0 to 15. Channel 0 is now SSR-Controll
-
 #define WDT_Timeout 15 // WatchDog Timeout in seconds
 
-#define WIFI_CONNECTED_BIT BIT0
-#define WIFI_FAIL_CONNECT_BIT BIT1
+#define MEAS_TASK_STACK_SIZE 4096
+#define MEAS_TASK_PRIORITY 10
+#define MEAS_RDY_TIMEOUT_MS 1000 // timeout for the ALERT/RDY pulse of the ADS1115
+
+#define CTRL_TEMP_PLAUSIBLE_MIN 5.0F   // sensor range of the fault manager, limp mode outside (open or shorted wire)
+#define CTRL_TEMP_PLAUSIBLE_MAX 160.0F
+#define CTRL_TEMP_SAFETY_MAX 140.0F    // heater is switched off above this measured temperature
+#define CTRL_READY_ENTER_K 1.0F        // status LED shows ready within this distance to the target
+#define CTRL_READY_LEAVE_K 2.0F        // and heating again outside of this distance
+
+#define WIFI_INITIAL_CONNECT_TIMEOUT_MS 10000 // waiting time for WiFi on startup, connection is retried in background
+#define WIFI_SSID_MAX_LEN 32     // limits of IEEE 802.11, the configuration holds them without heap allocation
+#define WIFI_PASSWORD_MAX_LEN 64
+#define PARAM_FILE_MAX_SIZE 4096 // parameter file is read into a static buffer
 
 #include <stdio.h>
+#include <math.h>
 #include <sys/stat.h>
-#include <string>
 #include "esp_littlefs.h"
 #include "esp_log.h"
 #include "esp_err.h"
@@ -50,6 +60,8 @@
 #include "freertos/event_groups.h"
 #include "cJSON.h"
 #include "driver/ledc.h"
+#include "driver/gpio.h"
+#include "esp_timer.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_netif.h"
@@ -61,15 +73,41 @@
 #include "lwip/err.h"
 #include "lwip/sys.h"
 #include "webserver.cpp"
+#include "wifi_manager.hpp"
+#include "timebase.hpp"
+#include "measurement.hpp"
+#include "metrics.hpp"
+#include "profiler.hpp"
+#include "autotune.hpp"
+#include "brew.hpp"
+#include "ssr.hpp"
+#include "scan.hpp"
+#include "fault.hpp"
+#include "telemetry.hpp"
+#include "memplan.hpp"
+#include "jsonarena.hpp"
+#include "led.hpp"
+#include "recorder.hpp"
 #include "ADS111x.hpp"
-
-static EventGroupHandle_t s_wifi_event_group;
+#include "ADS111x_decimator.hpp"
+#include "ADS111x_scan.hpp"
+#include "ADS111x_calib.hpp"
+#include "PIDCtrl.hpp"
+#include "SmithPredictor.hpp"
 
 // config structure for online calibration
 struct config {
-  std::string wifiSSID;
-  std::string wifiPassword;
+  char wifiSSID[WIFI_SSID_MAX_LEN + 1];
+  char wifiPassword[WIFI_PASSWORD_MAX_LEN + 1];
   float CtrlTarget;
+  bool CtrlRemoteWrite;
+  uint32_t CtrlMode;
+  float CtrlModelGain;
+  float CtrlModelTimeConst;
+  float CtrlModelDeadTime;
+  float CtrlSmithPropFactor;
+  float CtrlSmithIntFactor;
+  float CtrlSmithDifFactor;
   bool CtrlTimeFactor;
   bool CtrlPropActivate;
   float CtrlPropFactor;
@@ -83,8 +121,10 @@ struct config {
   float HighTresholdValue;
   float LowLimitManipulation;
   float HighLimitManipulation;
+  uint32_t SsrMode;
   uint32_t SsrFreq;
   uint32_t PwmSsrResolution;
+  uint32_t SsrMainsFreq;
   uint32_t RwmRgbFreq;
   uint32_t RwmRgbResolution; 
   float RwmRgbGainFactorRed;
@@ -97,34 +137,95 @@ struct config {
   float RwmRgbColorPurpleFactor;
   float RwmRgbColorWhiteFactor;
   bool SigFilterActive;
+  uint32_t SigRateMode;
+  bool SigAutoRange;
+  bool SigScanActive;
+  uint32_t SigScanPeriod;
+  uint32_t SigCalInterval;
+  float SigCalRefVolt;
+  bool BrewSlopeDetect;
+  float BrewSlopeThreshold;
+  float BrewDropThreshold;
+  bool BrewSwitchDetect;
+  float BrewShotDuration;
+  float BrewBoostValue;
+  float BrewBoostHoldTime;
+  float BrewBoostRampTime;
 };
 
 // File paths for measurement and calibration file
-const char* strMeasFilePath = "/data.csv";
+const char* strMeasFilePath = "/littlefs/data.csv";
 bool bMeasFileLocked = false;
-const char* strParamFilePath = "/params.json";
+const char* strParamFilePath = "/littlefs/params.json";
 bool bParamFileLocked = false;
 const char* strRecentLogFilePath = "/logfile_recent.txt";
 const char* strLastLogFilePath = "/logfile_last.txt";
 static char bufPrintLog[512];
 const char* strUserLogLabel = "USER";
-static int iWifiRetryNum;
-
-enum eLEDColor{
-  LED_COLOR_RED,
-  LED_COLOR_GREEN,
-  LED_COLOR_BLUE,
-  LED_COLOR_ORANGE,
-  LED_COLOR_PURPLE,
-  LED_COLOR_WHITE
+
+// Initialize ADS1115 I2C connection, driver and controller are statically allocated
+static ADS1115 s_obj_ads1115;
+ADS1115 *objADS1115 = &s_obj_ads1115;
+
+// Temperature controller of the boiler
+static PIDCtrl s_obj_pid;
+PIDCtrl *objPID = &s_obj_pid;
+// Dead time compensation of the controller feedback (CtrlMode), statically allocated
+SmithPredictor objSmith;
+
+// Sample modes of the ADS1115 (SigRateMode): data rate and decimation of the oversampling pipeline. The CIC nulls
+// are at multiples of rate / CIC ratio and reject mains hum at the nominal rate, the oscillator of the ADS1115 may
+// deviate by 10 %. The moving average behind the FIR spans 1.5 s as the driver filter at 8 SPS (ADS1115_CONV_BUF_SIZE
+// conversions), so all modes feed the controller with the same noise bandwidth and the average damps the hum the
+// shifted nulls let through.
+enum eAdcRateMode {
+  ADC_RATE_MODE_8SPS,     // 8 SPS, filter of the driver (SigFilterActive)
+  ADC_RATE_MODE_475SPS,   // 475 SPS decimated to 12.5 Hz, CIC nulls at multiples of 25 Hz (50 Hz mains)
+  ADC_RATE_MODE_860SPS,   // 860 SPS decimated to 10 Hz, CIC nulls at multiples of 20 Hz (60 Hz mains)
+  ADC_RATE_MODE_CNT
+};
+
+struct adc_rate_mode {
+  uint8_t iRate;          // ADS1115_RATE_*
+  float fRateSps;
+  int iCicRatio;
+  int iFirRatio;
+  int iAvgLen;            // moving average over the decimated samples
+};
+
+static const adc_rate_mode arrAdcRateModes[ADC_RATE_MODE_CNT] = {
+  {ADS1115_RATE_8, 8.F, 1, 1, 1},
+  {ADS1115_RATE_475, 475.F, 19, 2, 19},
+  {ADS1115_RATE_860, 860.F, 43, 2, 15},
 };
 
-// Initialize ADS1115 I2C connection
-ADS1115 *objADS1115 = new ADS1115;
+// Oversampling pipeline of the high-rate modes, statically allocated
+ADS1115Decimator objDecimator;
+
+// Online calibration of the boiler input (SigCalInterval). AIN3 is wired to the excitation midpoint that AIN1 sits on,
+// so AIN1-AIN3 is a shorted input, AIN2 is the midpoint of a reference resistor and R0 on the same excitation.
+#define CAL_ZERO_MUX ADS1115_MUX_AIN1_AIN3
+#define CAL_REF_MUX ADS1115_MUX_AIN2_AIN3
+ADS1115Calibrator objCalibrator;
+
+// Auxiliary channels of the scan scheduler (SigScanActive). The boiler device (ADS1115_I2CADD_DEFAULT) runs in
+// continuous mode for the control loop and must not appear here. The channels of one device are converted one after
+// the other, the devices in parallel.
+static const scan_channel arrScanChannels[] = {
+  // name, {address, mux, PGA, data rate, settling time in us}
+  {"group_head", {ADS1115_I2CADD_ADDR_VDD, ADS1115_MUX_AIN0_AIN1, ADS1115_PGA_0P256, ADS1115_RATE_128, 0}},
+  {"reference", {ADS1115_I2CADD_ADDR_VDD, ADS1115_MUX_AIN3_GND, ADS1115_PGA_4P096, ADS1115_RATE_128, 500}},
+  {"pressure", {ADS1115_I2CADD_ADDR_SDA, ADS1115_MUX_AIN0_GND, ADS1115_PGA_4P096, ADS1115_RATE_128, 0}},
+};
 
 // define configuration struct
 config objConfig;
 
+// measurement task and ALERT/RDY interrupt
+static TaskHandle_t xMeasTaskHandle = NULL;
+static volatile int64_t iConvRdyTimeUs = 0;
+static volatile uint32_t iConvRdyIsrCount = 0;
+
 int vprintf_into_FS(const char* szFormat, va_list args) {
 	//write evaluated format string into buffer
 	int i_ret = vsnprintf (bufPrintLog, sizeof(bufPrintLog), szFormat, args);
@@ -164,29 +265,44 @@ esp_err_t saveConfiguration(){
   cJSON *json_ssr = NULL;
   cJSON *json_led = NULL;
   cJSON *json_signal = NULL;
+  cJSON *json_brew = NULL;
   char *json_print = NULL;
 
+  // the tree and the print buffer are released together at the end
+  size_t i_arena_mark = jsonArenaBegin();
+
   json_doc = cJSON_CreateObject();
   cJSON_AddItemToObject(json_doc, "Wifi", json_wifi = cJSON_CreateObject());
-  cJSON_AddStringToObject(json_wifi, "wifiSSID", objConfig.wifiSSID.c_str());
-  cJSON_AddStringToObject(json_wifi, "wifiPassword", objConfig.wifiPassword.c_str());
+  cJSON_AddStringToObject(json_wifi, "wifiSSID", objConfig.wifiSSID);
+  cJSON_AddStringToObject(json_wifi, "wifiPassword", objConfig.wifiPassword);
   cJSON_AddItemToObject(json_doc, "PID", json_pid = cJSON_CreateObject());
-  cJSON_AddNumberToObject(json_pid, "CtrlTimeFactor", objConfig.CtrlTimeFactor);
-  cJSON_AddNumberToObject(json_pid, "CtrlPropActivate", objConfig.CtrlPropActivate);
+  cJSON_AddBoolToObject(json_pid, "CtrlTimeFactor", objConfig.CtrlTimeFactor);
+  cJSON_AddBoolToObject(json_pid, "CtrlPropActivate", objConfig.CtrlPropActivate);
   cJSON_AddNumberToObject(json_pid, "CtrlPropFactor", objConfig.CtrlPropFactor);
-  cJSON_AddNumberToObject(json_pid, "CtrlIntActivate", objConfig.CtrlIntActivate);
+  cJSON_AddBoolToObject(json_pid, "CtrlIntActivate", objConfig.CtrlIntActivate);
   cJSON_AddNumberToObject(json_pid, "CtrlIntFactor", objConfig.CtrlIntFactor);
+  cJSON_AddBoolToObject(json_pid, "CtrlDifActivate", objConfig.CtrlDifActivate);
   cJSON_AddNumberToObject(json_pid, "CtrlDifFactor", objConfig.CtrlDifFactor);
   cJSON_AddNumberToObject(json_pid, "CtrlTarget", objConfig.CtrlTarget);
-  cJSON_AddNumberToObject(json_pid, "LowThresholdActivate", objConfig.LowThresholdActivate);
+  cJSON_AddBoolToObject(json_pid, "CtrlRemoteWrite", objConfig.CtrlRemoteWrite);
+  cJSON_AddNumberToObject(json_pid, "CtrlMode", objConfig.CtrlMode);
+  cJSON_AddNumberToObject(json_pid, "CtrlModelGain", objConfig.CtrlModelGain);
+  cJSON_AddNumberToObject(json_pid, "CtrlModelTimeConst", objConfig.CtrlModelTimeConst);
+  cJSON_AddNumberToObject(json_pid, "CtrlModelDeadTime", objConfig.CtrlModelDeadTime);
+  cJSON_AddNumberToObject(json_pid, "CtrlSmithPropFactor", objConfig.CtrlSmithPropFactor);
+  cJSON_AddNumberToObject(json_pid, "CtrlSmithIntFactor", objConfig.CtrlSmithIntFactor);
+  cJSON_AddNumberToObject(json_pid, "CtrlSmithDifFactor", objConfig.CtrlSmithDifFactor);
+  cJSON_AddBoolToObject(json_pid, "LowThresholdActivate", objConfig.LowThresholdActivate);
   cJSON_AddNumberToObject(json_pid, "LowThresholdValue", objConfig.LowThresholdValue);
-  cJSON_AddNumberToObject(json_pid, "HighThresholdActivate", objConfig.HighThresholdActivate);
+  cJSON_AddBoolToObject(json_pid, "HighThresholdActivate", objConfig.HighThresholdActivate);
   cJSON_AddNumberToObject(json_pid, "HighTresholdValue", objConfig.HighTresholdValue);
   cJSON_AddNumberToObject(json_pid, "LowLimitManipulation", objConfig.LowLimitManipulation);
   cJSON_AddNumberToObject(json_pid, "HighLimitManipulation", objConfig.HighLimitManipulation);
   cJSON_AddItemToObject(json_doc, "SSR", json_ssr = cJSON_CreateObject());
+  cJSON_AddNumberToObject(json_ssr, "SsrMode", objConfig.SsrMode);
   cJSON_AddNumberToObject(json_ssr, "SsrFreq", objConfig.SsrFreq);
   cJSON_AddNumberToObject(json_ssr, "PwmSsrResolution", objConfig.PwmSsrResolution);
+  cJSON_AddNumberToObject(json_ssr, "SsrMainsFreq", objConfig.SsrMainsFreq);
   cJSON_AddItemToObject(json_doc, "LED", json_led = cJSON_CreateObject());
   cJSON_AddNumberToObject(json_led, "RwmRgbFreq", objConfig.RwmRgbFreq);
   cJSON_AddNumberToObject(json_led, "RwmRgbResolution", objConfig.RwmRgbResolution);
@@ -200,12 +316,31 @@ esp_err_t saveConfiguration(){
   cJSON_AddNumberToObject(json_led, "GainFactorColorPurple", objConfig.RwmRgbColorPurpleFactor);
   cJSON_AddNumberToObject(json_led, "GainFactorColorWhite", objConfig.RwmRgbColorWhiteFactor);
   cJSON_AddItemToObject(json_doc, "Signal", json_signal = cJSON_CreateObject());
-  cJSON_AddNumberToObject(json_signal, "SigFilterActive", objConfig.SigFilterActive);
-
-  if (!bParamFileLocked){
+  cJSON_AddBoolToObject(json_signal, "SigFilterActive", objConfig.SigFilterActive);
+  cJSON_AddNumberToObject(json_signal, "SigRateMode", objConfig.SigRateMode);
+  cJSON_AddBoolToObject(json_signal, "SigAutoRange", objConfig.SigAutoRange);
+  cJSON_AddBoolToObject(json_signal, "SigScanActive", objConfig.SigScanActive);
+  cJSON_AddNumberToObject(json_signal, "SigScanPeriod", objConfig.SigScanPeriod);
+  cJSON_AddNumberToObject(json_signal, "SigCalInterval", objConfig.SigCalInterval);
+  cJSON_AddNumberToObject(json_signal, "SigCalRefVolt", objConfig.SigCalRefVolt);
+  cJSON_AddItemToObject(json_doc, "Brew", json_brew = cJSON_CreateObject());
+  cJSON_AddBoolToObject(json_brew, "BrewSlopeDetect", objConfig.BrewSlopeDetect);
+  cJSON_AddNumberToObject(json_brew, "BrewSlopeThreshold", objConfig.BrewSlopeThreshold);
+  cJSON_AddNumberToObject(json_brew, "BrewDropThreshold", objConfig.BrewDropThreshold);
+  cJSON_AddBoolToObject(json_brew, "BrewSwitchDetect", objConfig.BrewSwitchDetect);
+  cJSON_AddNumberToObject(json_brew, "BrewShotDuration", objConfig.BrewShotDuration);
+  cJSON_AddNumberToObject(json_brew, "BrewBoostValue", objConfig.BrewBoostValue);
+  cJSON_AddNumberToObject(json_brew, "BrewBoostHoldTime", objConfig.BrewBoostHoldTime);
+  cJSON_AddNumberToObject(json_brew, "BrewBoostRampTime", objConfig.BrewBoostRampTime);
+
+  // print into one arena block instead of a growing buffer, the file including its line breaks must fit the load buffer
+  json_print = (char *)cJSON_malloc(PARAM_FILE_MAX_SIZE - 2);
+  if (!json_print || !cJSON_PrintPreallocated(json_doc, json_print, PARAM_FILE_MAX_SIZE - 2, true)){
+    ESP_LOGE("JSON", "Configuration does not fit into %d bytes, file not written.\n", PARAM_FILE_MAX_SIZE);
+    b_success = ESP_FAIL;
+  } else if (!bParamFileLocked){
     bParamFileLocked = true;
     FILE *obj_file = fopen(strParamFilePath, "w");
-    json_print = cJSON_Print(json_doc);
 
     fprintf(obj_file, "\n%s\n", json_print);
 
@@ -213,11 +348,13 @@ esp_err_t saveConfiguration(){
     b_success = ESP_OK;
     fclose(obj_file);
     bParamFileLocked = false;
-    cJSON_free(json_doc);
-    cJSON_free(json_print);
   } else {
     b_success = ESP_FAIL;
   }
+
+  cJSON_free(json_print);
+  cJSON_Delete(json_doc);
+  jsonArenaEnd(i_arena_mark);
   return b_success;
 }
 
@@ -229,8 +366,8 @@ void resetConfiguration(bool b_safe_to_json){
    * @param b_safe_to_json: Safe initial configuration to json file
    */
   
-  objConfig.wifiSSID = "";
-  objConfig.wifiPassword = "";
+  objConfig.wifiSSID[0] = '\0';
+  objConfig.wifiPassword[0] = '\0';
   objConfig.CtrlTimeFactor = true;
   objConfig.CtrlPropActivate = true;
   objConfig.CtrlPropFactor = 10.0;
@@ -239,14 +376,26 @@ void resetConfiguration(bool b_safe_to_json){
   objConfig.CtrlDifActivate = false;
   objConfig.CtrlDifFactor = 0.0;
   objConfig.CtrlTarget = 91.0;
+  objConfig.CtrlRemoteWrite = false; // setpoint and gain commands of the WebSocket clients (/ws), no authentication
+  objConfig.CtrlMode = CTRL_MODE_PID;
+  // FOPDT model of the boiler, identified with a 50 % heater step (coffee_bench --identify=1)
+  objConfig.CtrlModelGain = 2.95; // K per step of the manipulated variable
+  objConfig.CtrlModelTimeConst = 2386.0; // s
+  objConfig.CtrlModelDeadTime = 11.6; // s
+  // gains of the Smith mode, the dead time is out of the loop and the gain can be higher (coffee_bench --mode=smith)
+  objConfig.CtrlSmithPropFactor = 80.0;
+  objConfig.CtrlSmithIntFactor = 350.0;
+  objConfig.CtrlSmithDifFactor = 0.0;
   objConfig.LowThresholdActivate = false;
   objConfig.LowThresholdValue = 0.0;
   objConfig.HighThresholdActivate = false;
   objConfig.HighTresholdValue = 0.0;
   objConfig.LowLimitManipulation = 0;
   objConfig.HighLimitManipulation = 255;
-  objConfig.SsrFreq = 15;
-  objConfig.PwmSsrResolution = 8;
+  objConfig.SsrMode = SSR_MODE_PWM; // burst fire is opt-in, DC balanced only with the zero-cross input
+  objConfig.SsrFreq = 15; // Hz, SsrMode 0 only
+  objConfig.PwmSsrResolution = 8; // bits, full scale of the manipulated variable (255 half-waves in burst mode)
+  objConfig.SsrMainsFreq = 50;
   objConfig.RwmRgbFreq = 500; // Hz - PWM frequency
   objConfig.RwmRgbResolution = 8; //  resulution of the DC; 0 => 0%; 255 = (2**8) => 100%.
   objConfig.RwmRgbGainFactorRed = 1.0;
@@ -259,15 +408,29 @@ void resetConfiguration(bool b_safe_to_json){
   objConfig.RwmRgbColorPurpleFactor = 1.0;
   objConfig.RwmRgbColorWhiteFactor = 1.0;
   objConfig.SigFilterActive = true;
+  objConfig.SigRateMode = ADC_RATE_MODE_8SPS;
+  objConfig.SigAutoRange = true; // PGA follows the signal between 4.096 V and 0.256 V full scale
+  objConfig.SigScanActive = false;
+  objConfig.SigScanPeriod = 100; // ms
+  objConfig.SigCalInterval = 0; // s, 0: no calibration inputs wired
+  objConfig.SigCalRefVolt = 0.2018F; // V, 1385 Ohm reference (Pt1000 at 100 °C) at 2.5 V excitation
+  objConfig.BrewSlopeDetect = true;
+  objConfig.BrewSlopeThreshold = 0.1; // K/s
+  objConfig.BrewDropThreshold = 0.3; // K below the maximum of the last 6 s, for shots a derivative part flattens
+  objConfig.BrewSwitchDetect = false;
+  objConfig.BrewShotDuration = 25.0; // s, shot duration if detected by the slope
+  objConfig.BrewBoostValue = 150.0; // feed-forward heater boost in units of the manipulated variable
+  objConfig.BrewBoostHoldTime = 15.0;
+  objConfig.BrewBoostRampTime = 10.0;
 
   if (b_safe_to_json){
     saveConfiguration();
   }
 }
 
-esp_err_t WriteJsonItem(cJSON * json_item, std::string * str_element){
-  if (cJSON_IsString(json_item) && (json_item->valuestring != NULL)){
-    *str_element=json_item->valuestring;
+esp_err_t WriteJsonItem(cJSON * json_item, char * str_element, size_t i_size){
+  if (cJSON_IsString(json_item) && (json_item->valuestring != NULL) && strlen(json_item->valuestring) < i_size){
+    strcpy(str_element, json_item->valuestring);
     return ESP_OK;
   } else {
     return ESP_FAIL;
@@ -275,7 +438,7 @@ esp_err_t WriteJsonItem(cJSON * json_item, std::string * str_element){
 }
 
 esp_err_t WriteJsonItem(cJSON * json_item, float * f_element){
-  if (cJSON_IsNumber(json_item) && (json_item->valuedouble)){
+  if (cJSON_IsNumber(json_item)){
     *f_element=json_item->valuedouble;
     return ESP_OK;
   } else {
@@ -285,7 +448,7 @@ esp_err_t WriteJsonItem(cJSON * json_item, float * f_element){
 
 
 esp_err_t WriteJsonItem(cJSON * json_item, uint32_t * i_element){
-  if (cJSON_IsNumber(json_item) && (json_item->valuedouble)){
+  if (cJSON_IsNumber(json_item)){
     *i_element=json_item->valuedouble;
     return ESP_OK;
   } else {
@@ -319,7 +482,8 @@ esp_err_t loadConfiguration(){
   esp_err_t esp_res;
   size_t file_read_res;
   long i_file_size;
-  char * char_file_buf;
+  // parameter file, terminated for the parser
+  static char char_file_buf[PARAM_FILE_MAX_SIZE + 1];
 
   if (!bParamFileLocked){
     // file is not locked by another process
@@ -334,10 +498,9 @@ esp_err_t loadConfiguration(){
       i_file_size = ftell(obj_param_file);
       rewind(obj_param_file);
 
-      // allocate memory for buffer
-      char_file_buf = (char *)malloc(sizeof(char)*i_file_size);
-      // read parameter file from file system
-      file_read_res = fread(char_file_buf, 1, i_file_size, obj_param_file);
+      // read parameter file from file system, a larger file than the buffer is treated as unreadable
+      file_read_res = (i_file_size <= PARAM_FILE_MAX_SIZE) ? fread(char_file_buf, 1, i_file_size, obj_param_file) : 0;
+      char_file_buf[file_read_res] = '\0';
 
       // close file and release file lock
       fclose(obj_param_file);
@@ -348,7 +511,8 @@ esp_err_t loadConfiguration(){
         ESP_LOGE("LittleFS", "unable to read file to buffer, reset configuration and write to file.");
         resetConfiguration(true);
       } else {
-        // file read to buffer successful
+        // file read to buffer successful, the parsed tree lives in the JSON arena
+        size_t i_arena_mark = jsonArenaBegin();
         cJSON *json_doc = cJSON_Parse(char_file_buf);
 
         if (json_doc){
@@ -360,18 +524,27 @@ esp_err_t loadConfiguration(){
           
           // get Wifi entries
           cJSON * json_wifi = cJSON_GetObjectItemCaseSensitive(json_doc, "Wifi");
-          (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_wifi,"wifiSSID"), &objConfig.wifiSSID)==ESP_FAIL)?(b_set_default_values=true): 0;
-          (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_wifi,"wifiPassword"), &objConfig.wifiPassword)==ESP_FAIL)?(b_set_default_values=true): 0;
+          (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_wifi,"wifiSSID"), objConfig.wifiSSID, sizeof(objConfig.wifiSSID))==ESP_FAIL)?(b_set_default_values=true): 0;
+          (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_wifi,"wifiPassword"), objConfig.wifiPassword, sizeof(objConfig.wifiPassword))==ESP_FAIL)?(b_set_default_values=true): 0;
 
           // get PID entries
           cJSON * json_pid = cJSON_GetObjectItemCaseSensitive(json_doc, "PID");
           (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_pid,"CtrlTimeFactor"), &objConfig.CtrlTimeFactor)==ESP_FAIL)?(b_set_default_values=true): 0;
           (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_pid,"CtrlPropActivate"), &objConfig.CtrlPropActivate)==ESP_FAIL)?(b_set_default_values=true): 0;
+          (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_pid,"CtrlPropFactor"), &objConfig.CtrlPropFactor)==ESP_FAIL)?(b_set_default_values=true): 0;
           (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_pid,"CtrlIntActivate"), &objConfig.CtrlIntActivate)==ESP_FAIL)?(b_set_default_values=true): 0;
           (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_pid,"CtrlIntFactor"), &objConfig.CtrlIntFactor)==ESP_FAIL)?(b_set_default_values=true): 0;
           (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_pid,"CtrlDifActivate"), &objConfig.CtrlDifActivate)==ESP_FAIL)?(b_set_default_values=true): 0;
           (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_pid,"CtrlDifFactor"), &objConfig.CtrlDifFactor)==ESP_FAIL)?(b_set_default_values=true): 0;
           (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_pid,"CtrlTarget"), &objConfig.CtrlTarget)==ESP_FAIL)?(b_set_default_values=true): 0;
+          (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_pid,"CtrlRemoteWrite"), &objConfig.CtrlRemoteWrite)==ESP_FAIL)?(b_set_default_values=true): 0;
+          (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_pid,"CtrlMode"), &objConfig.CtrlMode)==ESP_FAIL)?(b_set_default_values=true): 0;
+          (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_pid,"CtrlModelGain"), &objConfig.CtrlModelGain)==ESP_FAIL)?(b_set_default_values=true): 0;
+          (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_pid,"CtrlModelTimeConst"), &objConfig.CtrlModelTimeConst)==ESP_FAIL)?(b_set_default_values=true): 0;
+          (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_pid,"CtrlModelDeadTime"), &objConfig.CtrlModelDeadTime)==ESP_FAIL)?(b_set_default_values=true): 0;
+          (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_pid,"CtrlSmithPropFactor"), &objConfig.CtrlSmithPropFactor)==ESP_FAIL)?(b_set_default_values=true): 0;
+          (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_pid,"CtrlSmithIntFactor"), &objConfig.CtrlSmithIntFactor)==ESP_FAIL)?(b_set_default_values=true): 0;
+          (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_pid,"CtrlSmithDifFactor"), &objConfig.CtrlSmithDifFactor)==ESP_FAIL)?(b_set_default_values=true): 0;
           (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_pid,"LowThresholdActivate"), &objConfig.LowThresholdActivate)==ESP_FAIL)?(b_set_default_values=true): 0;
           (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_pid,"LowThresholdValue"), &objConfig.LowThresholdValue)==ESP_FAIL)?(b_set_default_values=true): 0;
           (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_pid,"HighThresholdActivate"), &objConfig.HighThresholdActivate)==ESP_FAIL)?(b_set_default_values=true): 0;
@@ -381,8 +554,10 @@ esp_err_t loadConfiguration(){
 
           // get SSR entries
           cJSON * json_ssr = cJSON_GetObjectItemCaseSensitive(json_doc, "SSR");
+          (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_ssr,"SsrMode"), &objConfig.SsrMode)==ESP_FAIL)?(b_set_default_values=true): 0;
           (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_ssr,"SsrFreq"), &objConfig.SsrFreq)==ESP_FAIL)?(b_set_default_values=true): 0;
           (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_ssr,"PwmSsrResolution"), &objConfig.PwmSsrResolution)==ESP_FAIL)?(b_set_default_values=true): 0;
+          (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_ssr,"SsrMainsFreq"), &objConfig.SsrMainsFreq)==ESP_FAIL)?(b_set_default_values=true): 0;
 
           // get LED entries
           cJSON * json_led = cJSON_GetObjectItemCaseSensitive(json_doc, "LED");
@@ -401,9 +576,27 @@ esp_err_t loadConfiguration(){
           // get signal entries
           cJSON * json_signal = cJSON_GetObjectItemCaseSensitive(json_doc, "Signal");
           (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_signal,"SigFilterActive"), &objConfig.SigFilterActive)==ESP_FAIL)?(b_set_default_values=true): 0;
+          (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_signal,"SigRateMode"), &objConfig.SigRateMode)==ESP_FAIL)?(b_set_default_values=true): 0;
+          (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_signal,"SigAutoRange"), &objConfig.SigAutoRange)==ESP_FAIL)?(b_set_default_values=true): 0;
+          (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_signal,"SigScanActive"), &objConfig.SigScanActive)==ESP_FAIL)?(b_set_default_values=true): 0;
+          (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_signal,"SigScanPeriod"), &objConfig.SigScanPeriod)==ESP_FAIL)?(b_set_default_values=true): 0;
+          (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_signal,"SigCalInterval"), &objConfig.SigCalInterval)==ESP_FAIL)?(b_set_default_values=true): 0;
+          (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_signal,"SigCalRefVolt"), &objConfig.SigCalRefVolt)==ESP_FAIL)?(b_set_default_values=true): 0;
+
+          // get brew entries
+          cJSON * json_brew = cJSON_GetObjectItemCaseSensitive(json_doc, "Brew");
+          (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_brew,"BrewSlopeDetect"), &objConfig.BrewSlopeDetect)==ESP_FAIL)?(b_set_default_values=true): 0;
+          (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_brew,"BrewSlopeThreshold"), &objConfig.BrewSlopeThreshold)==ESP_FAIL)?(b_set_default_values=true): 0;
+          (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_brew,"BrewDropThreshold"), &objConfig.BrewDropThreshold)==ESP_FAIL)?(b_set_default_values=true): 0;
+          (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_brew,"BrewSwitchDetect"), &objConfig.BrewSwitchDetect)==ESP_FAIL)?(b_set_default_values=true): 0;
+          (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_brew,"BrewShotDuration"), &objConfig.BrewShotDuration)==ESP_FAIL)?(b_set_default_values=true): 0;
+          (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_brew,"BrewBoostValue"), &objConfig.BrewBoostValue)==ESP_FAIL)?(b_set_default_values=true): 0;
+          (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_brew,"BrewBoostHoldTime"), &objConfig.BrewBoostHoldTime)==ESP_FAIL)?(b_set_default_values=true): 0;
+          (WriteJsonItem(cJSON_GetObjectItemCaseSensitive(json_brew,"BrewBoostRampTime"), &objConfig.BrewBoostRampTime)==ESP_FAIL)?(b_set_default_values=true): 0;
 
           // release memory of hole JSON object
-          cJSON_free(json_doc);
+          cJSON_Delete(json_doc);
+          jsonArenaEnd(i_arena_mark);
 
           if (b_set_default_values){
             // default values are set to Json object -> write it back to file.
@@ -413,6 +606,7 @@ esp_err_t loadConfiguration(){
           }
         } else {
           // parse error in JSON file
+          jsonArenaEnd(i_arena_mark);
           const char *error_ptr = cJSON_GetErrorPtr();
           if (error_ptr != NULL) {
             ESP_LOGE("JSON", "JSON deserializion error of paramter file before: %s\n", error_ptr);
@@ -421,8 +615,6 @@ esp_err_t loadConfiguration(){
           resetConfiguration(true);
         }
       }
-      // release memory of buffer
-      free(char_file_buf);
     } else {
       // file open not possible
       ESP_LOGE("LittleFS", "Cannot open parameter file.\n");
@@ -439,249 +631,215 @@ esp_err_t loadConfiguration(){
 }
 
 
-void setColor(int i_color, bool b_gain_active) {
-  /** Function to output a RGB value to the LED
-   * examples: (from https://www.rapidtables.com/web/color/RGB_Color.html)
-   * setColor(255, 0, 0);     // Red 
-   * setColor(0, 255, 0);     // Green 
-   * setColor(0, 0, 255);     // Blue 
-   * setColor(255, 255, 255); // White 
-   * setColor(170, 0, 255);   // Purple 
-   * setColor(255,10,0);      // Orange 
-   * setColor(255,20,0);      // Yellow 
-   *
-   * @param i_color        color to set for the RGB LED
-   * @param b_gain_active  gain factor is used for displaying LED
+void configLED(){
+  /**
+   * @brief Method to configure LED functionality
+   * 
    */
 
-  float f_red_value = 0.0F;
-  float f_green_value = 0.0F;
-  float f_blue_value = 0.0F;
-  float f_max_resolution = (float)(1<<13)-1.0F;
-
-  if (i_color == LED_COLOR_RED){
-    f_red_value = 255.F * objConfig.RwmRgbColorRedFactor;
-  } else if (i_color == LED_COLOR_BLUE) {
-    f_blue_value = 255.F * objConfig.RwmRgbColorBlueFactor;
-  } else if (i_color == LED_COLOR_GREEN) {
-    f_green_value = 255.F * objConfig.RwmRgbColorGreenFactor;
-  } else if (i_color == LED_COLOR_ORANGE) {
-    f_red_value = 255.F * objConfig.RwmRgbColorOrangeFactor;
-    f_green_value = 10.F * objConfig.RwmRgbColorOrangeFactor;
-  } else if (i_color == LED_COLOR_PURPLE) {
-    f_red_value = 170.F * objConfig.RwmRgbColorPurpleFactor;
-    f_blue_value = 255.F * objConfig.RwmRgbColorPurpleFactor;
-  } else if (i_color == LED_COLOR_WHITE) {
-    f_red_value = 100.F * objConfig.RwmRgbColorWhiteFactor;
-    f_green_value = 100.F * objConfig.RwmRgbColorWhiteFactor;
-    f_blue_value = 100.F * objConfig.RwmRgbColorWhiteFactor;
+  led_config obj_led_config;
+  obj_led_config.arrPins[0] = P_RED_LED_PWM;
+  obj_led_config.arrPins[1] = P_GRN_LED_PWM;
+  obj_led_config.arrPins[2] = P_BLU_LED_PWM;
+  obj_led_config.iFreq = objConfig.RwmRgbFreq;
+  obj_led_config.arrGain[0] = objConfig.RwmRgbGainFactorRed;
+  obj_led_config.arrGain[1] = objConfig.RwmRgbGainFactorGreen;
+  obj_led_config.arrGain[2] = objConfig.RwmRgbGainFactorBlue;
+  obj_led_config.arrColorFactor[LED_COLOR_OFF] = 0.F;
+  obj_led_config.arrColorFactor[LED_COLOR_RED] = objConfig.RwmRgbColorRedFactor;
+  obj_led_config.arrColorFactor[LED_COLOR_GREEN] = objConfig.RwmRgbColorGreenFactor;
+  obj_led_config.arrColorFactor[LED_COLOR_BLUE] = objConfig.RwmRgbColorBlueFactor;
+  obj_led_config.arrColorFactor[LED_COLOR_ORANGE] = objConfig.RwmRgbColorOrangeFactor;
+  obj_led_config.arrColorFactor[LED_COLOR_PURPLE] = objConfig.RwmRgbColorPurpleFactor;
+  obj_led_config.arrColorFactor[LED_COLOR_WHITE] = objConfig.RwmRgbColorWhiteFactor;
+
+  // status layers are shown by the LED engine from now on
+  if (ledSetup(obj_led_config) != ESP_OK){
+    ESP_LOGE("LED", "RGB LED could not be configured.");
   }
 
-  if (b_gain_active){
-    // gain is active
-    f_red_value *= objConfig.RwmRgbGainFactorRed;
-    f_green_value *= objConfig.RwmRgbGainFactorGreen;
-    f_blue_value *= objConfig.RwmRgbGainFactorBlue;
+  // set green status LED to on
+  gpio_set_direction(P_STAT_LED, GPIO_MODE_OUTPUT);
+  gpio_set_level(P_STAT_LED, 1);
+}
+
+
+void configSSR(){
+  /**
+   * @brief Configure the output of the solid state relay of the heater
+   * 
+   */
+
+  ssr_config obj_ssr_config;
+  obj_ssr_config.iMode = objConfig.SsrMode;
+  obj_ssr_config.iOutputPin = P_SSR_PWM;
+  obj_ssr_config.iZeroCrossPin = P_ZERO_CROSS;
+  obj_ssr_config.iPwmFreq = objConfig.SsrFreq;
+  obj_ssr_config.iResolution = objConfig.PwmSsrResolution;
+  obj_ssr_config.iMainsFreq = objConfig.SsrMainsFreq;
+
+  if (ssrSetup(obj_ssr_config) != ESP_OK){
+    esp_log_write(ESP_LOG_ERROR, strUserLogLabel, "Failed to configure the heater output, heater stays off.\n");
   }
+}
 
-  // Value saturation check
-  f_red_value = (f_red_value>f_max_resolution) ? f_max_resolution : f_red_value;
-  f_red_value = (f_red_value<0.F) ? 0.F: f_red_value;
 
-  f_green_value = (f_green_value>f_max_resolution) ? f_max_resolution : f_green_value;
-  f_green_value = (f_green_value<0.F) ? 0.F : f_green_value;
+void setSsrDuty(float f_duty){
+  /**
+   * Set the duty cycle of the heater
+   * 
+   * @param f_duty: duty in steps of the PWM resolution (manipulated variable of the controller)
+   */
 
-  f_blue_value = (f_blue_value>f_max_resolution) ? f_max_resolution : f_blue_value;
-  f_blue_value = (f_blue_value<0.F) ? 0.F : f_blue_value;
+  ssrSetDuty(f_duty);
+}
 
-  ledc_set_fade_with_time(LEDC_HIGH_SPEED_MODE, RwmRedChannel, (int)f_red_value, 1000);
-  ledc_set_fade_with_time(LEDC_HIGH_SPEED_MODE, RwmGrnChannel, (int)f_green_value, 1000);
-  ledc_set_fade_with_time(LEDC_HIGH_SPEED_MODE, RwmBluChannel, (int)f_blue_value, 1000);
 
-  ledc_fade_start(LEDC_HIGH_SPEED_MODE, RwmRedChannel, LEDC_FADE_NO_WAIT);
-  ledc_fade_start(LEDC_HIGH_SPEED_MODE, RwmGrnChannel, LEDC_FADE_NO_WAIT);
-  ledc_fade_start(LEDC_HIGH_SPEED_MODE, RwmBluChannel, LEDC_FADE_NO_WAIT);
+const adc_rate_mode * getAdcRateMode(){
+  /**
+   * @return: sample mode of the configuration, 8 SPS on an invalid setting
+   */
 
-}// setColor
+  return &arrAdcRateModes[(objConfig.SigRateMode < ADC_RATE_MODE_CNT) ? objConfig.SigRateMode : ADC_RATE_MODE_8SPS];
+}
 
 
-void configLED(){
+float getCtrlSamplePeriod(){
   /**
-   * @brief Method to configure LED functionality
-   * 
+   * @return: nominal period of the controller in s, the output period of the sample pipeline
    */
-  
-  // Configure LED timer
-  ledc_timer_config_t conf_ledc_timer;
-  conf_ledc_timer.speed_mode       = LEDC_HIGH_SPEED_MODE;
-  conf_ledc_timer.timer_num        = LEDC_TIMER_0;
-  conf_ledc_timer.duty_resolution  = LEDC_DUTY_RES;
-  conf_ledc_timer.freq_hz          = objConfig.RwmRgbFreq;
-  conf_ledc_timer.clk_cfg          = LEDC_AUTO_CLK;
-
-  ledc_timer_config(&conf_ledc_timer);
-
-  // configure RGB LED
-  ledc_channel_config_t ledc_channel[3];
-
-  // define config for red LED
-  ledc_channel[0].channel  = RwmRedChannel;
-  ledc_channel[0].duty = 0;
-  ledc_channel[0].gpio_num = P_RED_LED_PWM;
-  ledc_channel[0].speed_mode = LEDC_HIGH_SPEED_MODE;
-  ledc_channel[0].hpoint = 0;
-  ledc_channel[0].timer_sel = LEDC_TIMER_0;
-  ledc_channel[0].flags.output_invert = 0;
-
-  // define config for green led
-  ledc_channel[1].channel  = RwmGrnChannel;
-  ledc_channel[1].duty = 0;
-  ledc_channel[1].gpio_num = P_GRN_LED_PWM;
-  ledc_channel[1].speed_mode = LEDC_HIGH_SPEED_MODE;
-  ledc_channel[1].hpoint = 0;
-  ledc_channel[1].timer_sel = LEDC_TIMER_0;
-  ledc_channel[1].flags.output_invert = 0;
-  
-  // define config for blue led
-  ledc_channel[2].channel  = RwmBluChannel;
-  ledc_channel[2].duty = 0;
-  ledc_channel[2].gpio_num = P_BLU_LED_PWM;
-  ledc_channel[2].speed_mode = LEDC_HIGH_SPEED_MODE;
-  ledc_channel[2].hpoint = 0;
-  ledc_channel[2].timer_sel = LEDC_TIMER_0;
-  ledc_channel[2].flags.output_invert = 0;
 
-  // Set LED Controller with previously prepared configuration
-  for (int i_ch = 0; i_ch < 3; i_ch++) {
-    ledc_channel_config(&ledc_channel[i_ch]);
-  }
+  const adc_rate_mode * ptr_mode = getAdcRateMode();
+  return ptr_mode->iCicRatio * ptr_mode->iFirRatio / ptr_mode->fRateSps;
+}
 
-  // initialize fade service
-   ledc_fade_func_install(0);
 
-  // set green status LED to on
-  gpio_set_direction(P_STAT_LED, GPIO_MODE_OUTPUT);
-  gpio_set_level(P_STAT_LED, 1);
+void configPID(){
+  /**
+   * Apply controller configuration
+   */
+
+  objPID->setTarget(objConfig.CtrlTarget);
+  if (objConfig.CtrlMode == CTRL_MODE_SMITH){
+    objPID->setParameters(objConfig.CtrlSmithPropFactor, objConfig.CtrlSmithIntFactor, objConfig.CtrlSmithDifFactor,
+                          objConfig.CtrlTimeFactor);
+  } else {
+    objPID->setParameters(objConfig.CtrlPropFactor, objConfig.CtrlIntFactor, objConfig.CtrlDifFactor,
+                          objConfig.CtrlTimeFactor);
+  }
+  objPID->activate(objConfig.CtrlPropActivate, objConfig.CtrlIntActivate, objConfig.CtrlDifActivate);
+  objPID->setLimits(objConfig.LowLimitManipulation, objConfig.HighLimitManipulation);
+  objPID->setThresholds(objConfig.LowThresholdActivate, objConfig.LowThresholdValue,
+                        objConfig.HighThresholdActivate, objConfig.HighTresholdValue);
+  autotuneSetup(objConfig.CtrlTarget, objConfig.LowLimitManipulation, objConfig.HighLimitManipulation);
+  telemetrySetTarget(objConfig.CtrlTarget);
+
+  fopdt_model obj_model;
+  obj_model.fGain = objConfig.CtrlModelGain;
+  obj_model.fTimeConstS = objConfig.CtrlModelTimeConst;
+  obj_model.fDeadTimeS = objConfig.CtrlModelDeadTime;
+  if (!objSmith.setModel(obj_model, getCtrlSamplePeriod())){
+    ESP_LOGW("ESP", "Model dead time exceeds the delay line of the Smith predictor, it is limited to %.1f s",
+             objSmith.getDelaySamples() * getCtrlSamplePeriod());
+  }
 }
 
 
-static void event_handler(void * arg, esp_event_base_t event_base, int32_t event_id, void * event_data){
-  if (event_base == WIFI_EVENT){
-    if (event_id == WIFI_EVENT_STA_START){
-      esp_wifi_connect();
-    } else if (event_id == WIFI_EVENT_STA_DISCONNECTED){
-      if (iWifiRetryNum < 3){
-        esp_wifi_connect();
-        iWifiRetryNum++;
-        ESP_LOGI("Wifi", "retry to connect to the AP");
-      } else {
-        xEventGroupSetBits(s_wifi_event_group, WIFI_FAIL_CONNECT_BIT);
-      }
-      ESP_LOGI("Wifi", "connect to AP fail.");
-    } else if (event_id == WIFI_EVENT_AP_STACONNECTED) {
-        wifi_event_ap_staconnected_t* event = (wifi_event_ap_staconnected_t*) event_data;
-        ESP_LOGI("Wifi", "station " MACSTR " join, AID=%d", MAC2STR(event->mac), event->aid);
-    } else if (event_id == WIFI_EVENT_AP_STADISCONNECTED) {
-        wifi_event_ap_stadisconnected_t* event = (wifi_event_ap_stadisconnected_t*) event_data;
-        ESP_LOGI("Wifi", "station " MACSTR " leave, AID=%d", MAC2STR(event->mac), event->aid);
-    }
-  } else if (event_base == IP_EVENT ) {
-    if(event_id == IP_EVENT_STA_GOT_IP){
-      ip_event_got_ip_t * event = (ip_event_got_ip_t*) event_data;
-      ESP_LOGI("Wifi", "Device got IP address: " IPSTR, IP2STR(&event->ip_info.ip));
-      iWifiRetryNum = 0;
-      xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
-    }
+void configBrew(){
+  /**
+   * Apply brew shot detection and feed-forward configuration
+   */
+
+  brew_params obj_params = BrewDetector::getDefaultParams();
+
+  obj_params.bSlopeDetect = objConfig.BrewSlopeDetect;
+  obj_params.fSlopeThresh = objConfig.BrewSlopeThreshold;
+  obj_params.fDropThresh = objConfig.BrewDropThreshold;
+  obj_params.bSwitchDetect = objConfig.BrewSwitchDetect;
+  obj_params.fShotDurationS = objConfig.BrewShotDuration;
+  obj_params.fBoost = objConfig.BrewBoostValue;
+  obj_params.fBoostHoldS = objConfig.BrewBoostHoldTime;
+  obj_params.fBoostRampS = objConfig.BrewBoostRampTime;
+
+  if (brewSetup(obj_params, objConfig.CtrlTarget, P_BREW_SWITCH) != ESP_OK){
+    ESP_LOGE("ESP", "Failed to configure brew switch input.");
   }
 }
 
 
-esp_err_t connectWiFi(const int i_total_fail = 3, const int i_timout_attemp = 1000){
+void configFault(){
   /**
-   * Try to connect to WiFi Accesspoint based on the given information in the header file WiFiAccess.h.
-   * A defined number of connection is performed.
-   * @param 
-   *    i_timout_attemp:     Total amount of connection attemps
-   *    i_waiting_time:   Waiting time between connection attemps
-   * 
-   * @return 
-   *    b_status:         true if connection is successfull
+   * Apply the limits of the sensor fault manager
    */
-  
-  esp_err_t b_successful = ESP_FAIL;
-    
-  s_wifi_event_group = xEventGroupCreate();
 
-  ESP_ERROR_CHECK(esp_netif_init());
+  fault_params obj_params = FaultManager::getDefaultParams();
+
+  obj_params.fOutputMax = objConfig.HighLimitManipulation;
+  obj_params.fTempMin = CTRL_TEMP_PLAUSIBLE_MIN;
+  obj_params.fTempMax = CTRL_TEMP_PLAUSIBLE_MAX;
+  obj_params.fOverTemp = CTRL_TEMP_SAFETY_MAX;
+  faultSetup(obj_params);
+  // setpoints of the WebSocket clients keep a margin to the over temperature limit
+  telemetrySetup(objConfig.CtrlRemoteWrite, obj_params.fOverTemp);
+}
 
-  ESP_ERROR_CHECK(esp_event_loop_create_default());
-  esp_netif_create_default_wifi_sta();
 
-  wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-  ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+void applyAutoTuneResult(const autotune_result * ptr_result){
+  /**
+   * Write the parameters of a finished auto tuning experiment into the configuration and the controller. The rules
+   * tune the PID on the measured temperature, the gains of the Smith mode are kept.
+   *
+   * @param ptr_result: result of the relay experiment
+   */
 
-  esp_event_handler_instance_t instance_any_id;
-  esp_event_handler_instance_t instance_got_ip;
-  ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &event_handler, NULL, &instance_any_id));
-  ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &event_handler, NULL, &instance_got_ip));
+  objConfig.CtrlTimeFactor = true;
+  objConfig.CtrlPropActivate = true;
+  objConfig.CtrlPropFactor = ptr_result->fPropFactor;
+  objConfig.CtrlIntActivate = ptr_result->fIntTimeS > 0.F;
+  objConfig.CtrlIntFactor = ptr_result->fIntTimeS;
+  objConfig.CtrlDifActivate = ptr_result->fDifTimeS > 0.F;
+  objConfig.CtrlDifFactor = ptr_result->fDifTimeS;
+
+  configPID();
+  objPID->reset();
+
+  esp_log_write(ESP_LOG_INFO, strUserLogLabel, "Auto tuning (%s): Ku=%.3f Pu=%.1fs -> Kp=%.3f Tn=%.1fs Tv=%.1fs\n",
+                PIDAutoTune::getRuleName(ptr_result->iRule), ptr_result->fUltimateGain, ptr_result->fUltimatePeriodS,
+                ptr_result->fPropFactor, ptr_result->fIntTimeS, ptr_result->fDifTimeS);
+
+  // the caller is the measurement task, the flash write is done by the recorder
+  if (recorderRequestConfigSave() != ESP_OK){
+    ESP_LOGW("LittleFS", "Auto tuning result is not saved, recorder is not running");
+  }
+}
 
-  wifi_config_t wifi_config;
-  // initialize wifi_config with zeros
-  memset(&wifi_config, 0, sizeof(wifi_config));
-  strcpy((char*)wifi_config.sta.ssid, objConfig.wifiSSID.c_str());
-  strcpy((char*)wifi_config.sta.password, objConfig.wifiPassword.c_str());
-  wifi_config.sta.threshold.authmode = WIFI_AUTH_WPA2_WPA3_PSK;
-    
-  ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-  ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config) );
-    
-  ESP_ERROR_CHECK(esp_wifi_start());
-
-  /* Waiting until either the connection is established (WIFI_CONNECTED_BIT) or connection failed for the maximum
-  * number of re-tries (WIFI_FAIL_BIT). The bits are set by event_handler() (see above) */
-  EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group, WIFI_CONNECTED_BIT | WIFI_FAIL_CONNECT_BIT, pdFALSE, pdFALSE, portMAX_DELAY);
-
-  /* xEventGroupWaitBits() returns the bits before the call returned, hence we can test which event actually
-  * happened. */
-  if (bits & WIFI_CONNECTED_BIT) {
-    ESP_LOGI("Wifi",  "Connection successful");
-    b_successful = ESP_OK;
-    wifi_ap_record_t ap;
-    esp_wifi_sta_get_ap_info(&ap);
-    int i_db_m = ap.rssi;
-    int i_db_perc = 0;
-
-    if (i_db_m>=-50) {
-      i_db_perc = 100;
-    } else if (i_db_m<=-100) {
-      i_db_perc = 0;
+
+void applyTelemetryCommand(const telemetry_command * ptr_cmd){
+  /**
+   * Apply a setpoint or gain command of a WebSocket client to the running controller. The configuration file is not
+   * written, the settings page stores the configuration.
+   *
+   * @param ptr_cmd: command checked by the web server
+   */
+
+  if (ptr_cmd->iType == TELEMETRY_CMD_SETPOINT){
+    objConfig.CtrlTarget = ptr_cmd->arrValues[0];
+    configPID();
+    configBrew();
+  } else if (ptr_cmd->iType == TELEMETRY_CMD_GAINS){
+    // the gains of the active control mode
+    if (objConfig.CtrlMode == CTRL_MODE_SMITH){
+      objConfig.CtrlSmithPropFactor = ptr_cmd->arrValues[0];
+      objConfig.CtrlSmithIntFactor = ptr_cmd->arrValues[1];
+      objConfig.CtrlSmithDifFactor = ptr_cmd->arrValues[2];
     } else {
-      i_db_perc = 2*(i_db_m+100);
+      objConfig.CtrlPropFactor = ptr_cmd->arrValues[0];
+      objConfig.CtrlIntFactor = ptr_cmd->arrValues[1];
+      objConfig.CtrlDifFactor = ptr_cmd->arrValues[2];
     }
-
-    ESP_LOGI("Wifi", "Signal strength: %d dB -> %d %%\n", i_db_m, i_db_perc);
-  } else if (bits & WIFI_FAIL_CONNECT_BIT) {
-      ESP_ERROR_CHECK(esp_wifi_stop());
-      ESP_LOGI("Wifi",  "Connection unsuccessful. Creating Soft AP instead.");
-      wifi_config_t wifi_config;
-      memset(&wifi_config, 0, sizeof(wifi_config));
-      strcpy((char*)wifi_config.ap.ssid, "CoffeeCtrl");
-      wifi_config.ap.ssid_len = strlen("CoffeeCtrl");
-      wifi_config.ap.channel = 10;
-      strcpy((char*)wifi_config.ap.password, "");
-      wifi_config.ap.max_connection = 5;
-      //wifi_config.ap.pmf_cfg.required = false;
-      wifi_config.ap.authmode = WIFI_AUTH_OPEN;
-
-      ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_AP));
-      ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_AP, &wifi_config));
-      ESP_ERROR_CHECK(esp_wifi_start());
-  } else {
-      ESP_LOGE("Wifi", "Unexpected event during WiFi configuration apears");
+    configPID();
   }
-
-  return b_successful;
-} // connectWiFi
+}
 
 
 esp_err_t configADS1115(){
@@ -695,10 +853,14 @@ esp_err_t configADS1115(){
     return ESP_FAIL;
   }
 
-  // Set Signal Filter Status
-  if(objConfig.SigFilterActive){
+  const adc_rate_mode * ptr_rate_mode = getAdcRateMode();
+
+  // Set Signal Filter Status, the decimator replaces the filter in the high-rate modes
+  if(objConfig.SigFilterActive && ptr_rate_mode->iCicRatio == 1){
     objADS1115->activateFilter();
   }
+  objDecimator.setup(ptr_rate_mode->iCicRatio, ptr_rate_mode->iFirRatio, ptr_rate_mode->iAvgLen);
+  measSetRawRate((ptr_rate_mode->iCicRatio > 1) ? ptr_rate_mode->fRateSps : 0.F);
 
   // set Comparator Polarity to active high
   objADS1115->setCompPolarity(ADS1115_CMP_POL_ACTIVE_HIGH);
@@ -707,7 +869,12 @@ esp_err_t configADS1115(){
   objADS1115->setMux(ADS1115_MUX_AIN0_AIN1);
 
   // set data rate (samples per second)
-  objADS1115->setRate(ADS1115_RATE_8);
+  objADS1115->setRate(ptr_rate_mode->iRate);
+  if (ptr_rate_mode->iCicRatio > 1){
+    esp_log_write(ESP_LOG_INFO, strUserLogLabel, "Oversampling with %.0f SPS, decimation %d x %d to %.1f Hz, "
+                  "average over %d samples\n", ptr_rate_mode->fRateSps, ptr_rate_mode->iCicRatio,
+                  ptr_rate_mode->iFirRatio, 1.F / getCtrlSamplePeriod(), ptr_rate_mode->iAvgLen);
+  }
 
 
   #ifdef Pt1000_CONV_LINEAR
@@ -728,8 +895,11 @@ esp_err_t configADS1115(){
     }
   #endif
 
-  // set gain amplifier
+  // set gain amplifier, auto ranging starts in the smallest range and steps up on a wide excursion or sensor fault
   objADS1115->setPGA(ADS1115_PGA_0P256);
+  if (objConfig.SigAutoRange){
+    objADS1115->activateAutoRange(ADS1115_PGA_4P096, ADS1115_PGA_0P256);
+  }
 
   // set latching mode
   objADS1115->setCompLatchingMode(ADS1115_CMP_LAT_ACTIVE);
@@ -739,16 +909,521 @@ esp_err_t configADS1115(){
 
   // set to continues conversion method
   objADS1115->setOpMode(ADS1115_MODE_CONTINUOUS);
+
+  // offset and gain correction from the calibration inputs, measured between the conversions of the boiler input
+  objCalibrator.setup(objADS1115, ADS1115_MUX_AIN0_AIN1, CAL_ZERO_MUX, CAL_REF_MUX, objConfig.SigCalRefVolt,
+                      (uint32_t)(objConfig.SigCalInterval * ptr_rate_mode->fRateSps));
+  if (objCalibrator.isActive()){
+    esp_log_write(ESP_LOG_INFO, strUserLogLabel, "Online calibration every %u s, reference %.4f V\n",
+                  objConfig.SigCalInterval, objConfig.SigCalRefVolt);
+  }
   
   objADS1115->printConfigReg();
   return ESP_OK;
 }
 
 
+void createMeasFile(){
+  /**
+   * Create measurement file with header. Time stamps in the file are seconds since boot of the monotonic time base,
+   * the wall clock anchors for conversion are available on /timebase.json
+   */
+
+  FILE *obj_file = fopen(strMeasFilePath, "w");
+
+  if (!obj_file){
+    ESP_LOGE("LittleFS", "Failed to create measurement file");
+    return;
+  }
+
+  uint16_t i_config_reg = objADS1115->getRegisterValue(ADS1115_CONFIG_REG);
+  uint16_t i_low_reg = objADS1115->getRegisterValue(ADS1115_LOW_THRESH_REG);
+  uint16_t i_high_reg = objADS1115->getRegisterValue(ADS1115_HIGH_THRESH_REG);
+
+  fprintf(obj_file, "Measurement File, time in seconds since boot (wall clock anchors: /timebase.json)\n");
+  fprintf(obj_file, "ADS1115 register settings\n");
+  fprintf(obj_file, "Config register: %d\n", i_config_reg);
+  fprintf(obj_file, "Low threshold register: %d\n", i_low_reg);
+  fprintf(obj_file, "High threshold register: %d\n\n", i_high_reg);
+  fprintf(obj_file, "Time,Temperature,TargetPWM,Buffer,InterruptCountAlertReady,Range\n");
+
+  fflush(obj_file);
+  fclose(obj_file);
+}
+
+
+static void IRAM_ATTR convReadyIsr(void * ptr_arg){
+  /**
+   * ALERT/RDY interrupt of the ADS1115. The conversion is stamped here, the I2C readout is done in the measurement task.
+   */
+
+  BaseType_t b_higher_prio_task_woken = pdFALSE;
+
+  iConvRdyTimeUs = esp_timer_get_time();
+  iConvRdyIsrCount++;
+  vTaskNotifyGiveFromISR(xMeasTaskHandle, &b_higher_prio_task_woken);
+
+  if (b_higher_prio_task_woken){
+    portYIELD_FROM_ISR();
+  }
+}
+
+
+static void stopControl(){
+  /**
+   * Leave closed loop control, the controller and the model restart from scratch with the next usable sample
+   */
+
+  autotuneRequestAbort();
+  objPID->reset();
+  objSmith.reset();
+}
+
+
+static void updateStatusLed(int i_fault_action, float f_temperature, float f_target){
+  /**
+   * Status layers of the boiler, called every control cycle. The LED engine only wakes up if a layer changes.
+   *
+   * @param i_fault_action: eFaultAction of the fault manager
+   * @param f_temperature: measured temperature, ignored while a fault is active
+   * @param f_target: setpoint of the controller
+   */
+
+  static bool s_b_at_temperature = false;
+
+  ledSetLayer(LED_LAYER_FAULT, (i_fault_action > FAULT_ACTION_NONE) ? LED_PATTERN_FAULT : LED_PATTERN_NONE);
+  if (i_fault_action > FAULT_ACTION_NONE){
+    return;
+  }
+
+  // hysteresis, noise at the edge of the band does not toggle the indication
+  float f_distance = fabsf(f_temperature - f_target);
+  s_b_at_temperature = (f_distance <= (s_b_at_temperature ? CTRL_READY_LEAVE_K : CTRL_READY_ENTER_K));
+  ledSetLayer(LED_LAYER_READY, s_b_at_temperature ? LED_PATTERN_READY : LED_PATTERN_NONE);
+  ledSetLayer(LED_LAYER_HEATING, s_b_at_temperature ? LED_PATTERN_NONE : LED_PATTERN_HEATING);
+}
+
+
+static void measTask(void * ptr_params){
+  /**
+   * Measurement task: read out each conversion of the ADS1115, stamp it with the monotonic time of the ALERT/RDY
+   * interrupt and append it to the sample buffer, the recorder task writes the measurement file from there. In the
+   * oversampling modes a conversion costs one register read and the decimator step, pulses which arrive while the task
+   * is late are counted as lost.
+   */
+
+  meas_sample obj_sample;
+  autotune_result obj_tune_result;
+  telemetry_command obj_command;
+  int64_t i_prev_time_us = 0; // time stamp of the previous controller update
+  float f_prev_output = 0.F;  // heater output since the previous update
+  float f_heater_output = 0.F; // output applied to the SSR
+  fault_input obj_fault_input;
+  bool b_oversampling = getAdcRateMode()->iCicRatio > 1;
+
+  for (;;){
+    uint32_t i_pulses = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(MEAS_RDY_TIMEOUT_MS));
+    if (i_pulses == 0){
+      // no conversion ready pulse within timeout, the fault manager holds the output first and then limits it
+      obj_fault_input.fTimeS = esp_timer_get_time() / 1e6;
+      obj_fault_input.bSample = false;
+      obj_fault_input.fOutput = f_heater_output;
+      int i_timeout_action = faultUpdate(obj_fault_input);
+      if (i_timeout_action > FAULT_ACTION_CAP){
+        stopControl();
+        i_prev_time_us = 0;
+        f_prev_output = 0.F;
+      }
+      ledSetLayer(LED_LAYER_FAULT, (i_timeout_action > FAULT_ACTION_NONE) ? LED_PATTERN_FAULT : LED_PATTERN_NONE);
+      f_heater_output = faultLimitOutput(f_heater_output);
+      setSsrDuty(f_heater_output);
+      continue;
+    }
+
+    obj_sample.iTimeUs = iConvRdyTimeUs;
+    obj_sample.iIsrCount = iConvRdyIsrCount;
+
+    // commands of the WebSocket clients change the controller between two updates
+    if (telemetryTakeCommand(&obj_command)){
+      applyTelemetryCommand(&obj_command);
+    }
+
+    if (b_oversampling){
+      // every conversion passes the decimator, control and logging run at its output rate only
+      uint8_t i_range = objADS1115->getRange();
+      int16_t i_raw_value = (int16_t)objCalibrator.process();
+      measPushRaw(obj_sample.iTimeUs, (int16_t)objADS1115->getLatestBufVal(), i_pulses - 1, objADS1115->getRange());
+
+      if (!objADS1115->getConnectionStatus()){
+        // the decimator has no valid output: the fault manager gets an I2C error, control and logging wait for the
+        // decimator, which restarts with the next valid conversion
+        objDecimator.reset();
+        obj_fault_input.fTimeS = obj_sample.iTimeUs / 1e6;
+        obj_fault_input.bSample = true;
+        obj_fault_input.bI2cError = true;
+        obj_fault_input.bFrozen = false;
+        obj_fault_input.fTarget = objPID->getTarget();
+        obj_fault_input.fOutput = f_heater_output;
+        obj_fault_input.bBrewing = brewGetState() != BREW_STATE_IDLE;
+        int i_error_action = faultUpdate(obj_fault_input);
+        if (i_error_action > FAULT_ACTION_CAP){
+          stopControl();
+          i_prev_time_us = 0;
+          f_prev_output = 0.F;
+        }
+        f_heater_output = faultLimitOutput(f_heater_output);
+        setSsrDuty(f_heater_output);
+        ledSetLayer(LED_LAYER_FAULT, (i_error_action > FAULT_ACTION_NONE) ? LED_PATTERN_FAULT : LED_PATTERN_NONE);
+        continue;
+      } else if (objADS1115->isRangeSettling() || i_range != objADS1115->getRange()){
+        // the integer CIC state can not be rescaled, CIC and FIR restart in the new range, the average is rescaled
+        objDecimator.restart(ADS1115::getLsbVolt(i_range) / ADS1115::getLsbVolt(objADS1115->getRange()));
+        continue;
+      } else if (!objDecimator.push(i_raw_value)){
+        continue;
+      }
+      obj_sample.fTemperature = objADS1115->convertToPhysVal(objDecimator.getOutput());
+    } else {
+      obj_sample.fTemperature = objADS1115->convertToPhysVal(objCalibrator.process());
+    }
+    obj_sample.iRawValue = (int16_t)objADS1115->getLatestBufVal();
+    obj_sample.iRange = objADS1115->getRange();
+    obj_sample.iFaultBits = (objADS1115->isValueFrozen() ? MEAS_FAULT_VALUE_FROZEN : 0) |
+                            (objADS1115->getConnectionStatus() ? 0 : MEAS_FAULT_I2C_ERROR);
+
+    // the fault manager decides how far the controller may drive the heater
+    obj_fault_input.fTimeS = obj_sample.iTimeUs / 1e6;
+    obj_fault_input.bSample = true;
+    obj_fault_input.bI2cError = (obj_sample.iFaultBits & MEAS_FAULT_I2C_ERROR) != 0;
+    obj_fault_input.bFrozen = (obj_sample.iFaultBits & MEAS_FAULT_VALUE_FROZEN) != 0;
+    obj_fault_input.fTemperature = obj_sample.fTemperature;
+    obj_fault_input.fTarget = objPID->getTarget();
+    obj_fault_input.fOutput = f_heater_output;
+    obj_fault_input.bBrewing = brewGetState() != BREW_STATE_IDLE;
+    int i_fault_action = faultUpdate(obj_fault_input);
+
+    if (faultSampleUsable() && i_fault_action <= FAULT_ACTION_CAP){
+      float f_dt_s = (i_prev_time_us > 0) ? (obj_sample.iTimeUs - i_prev_time_us) / 1e6F : 0.F;
+
+      float f_feed_forward = brewUpdate(obj_sample.iTimeUs, obj_sample.fTemperature);
+      float f_feedback = obj_sample.fTemperature;
+
+      // the model follows the heater output in every mode to be ready on a mode change
+      objSmith.update(f_prev_output, f_dt_s);
+      if (objConfig.CtrlMode == CTRL_MODE_SMITH){
+        f_feedback = objSmith.getFeedback(obj_sample.fTemperature);
+      }
+
+      // a running auto tuning experiment drives the heater instead of the controller
+      if (!autotuneUpdate(obj_sample.fTemperature, f_dt_s, &obj_sample.fTargetPwm)){
+        if (autotuneTakeResult(&obj_tune_result)){
+          applyAutoTuneResult(&obj_tune_result);
+        }
+        // feed-forward boost of a detected shot on top of the controller
+        obj_sample.fTargetPwm = objPID->update(f_feedback, f_dt_s) + f_feed_forward;
+        obj_sample.fTargetPwm = (obj_sample.fTargetPwm > objConfig.HighLimitManipulation) ?
+                                objConfig.HighLimitManipulation : obj_sample.fTargetPwm;
+      }
+      i_prev_time_us = obj_sample.iTimeUs;
+      f_prev_output = obj_sample.fTargetPwm;
+    } else if (i_fault_action == FAULT_ACTION_CAP){
+      // short signal dropout: the controller keeps its state, the previous output is held
+      obj_sample.fTargetPwm = f_heater_output;
+    } else {
+      stopControl();
+      obj_sample.fTargetPwm = 0.F;
+      i_prev_time_us = 0;
+      f_prev_output = 0.F;
+    }
+    obj_sample.fTargetPwm = faultLimitOutput(obj_sample.fTargetPwm);
+    f_heater_output = obj_sample.fTargetPwm;
+    setSsrDuty(obj_sample.fTargetPwm);
+    measPush(&obj_sample);
+    updateStatusLed(i_fault_action, obj_sample.fTemperature, objPID->getTarget());
+  }
+}
+
+
+void configScan(){
+  /**
+   * Start the scan of the auxiliary channels, the devices share the I2C bus of the boiler device
+   */
+
+  if (!objConfig.SigScanActive){
+    return;
+  }
+  esp_err_t esp_ret = scanSetup(objADS1115->getTransport(), arrScanChannels,
+                                sizeof(arrScanChannels) / sizeof(arrScanChannels[0]), objConfig.SigScanPeriod * 1000);
+  if (esp_ret != ESP_OK){
+    esp_log_write(ESP_LOG_ERROR, strUserLogLabel, "Failed to start the channel scan (%s)\n", esp_err_to_name(esp_ret));
+  }
+}
+
+
+void startMeasTask(){
+  /**
+   * Start measurement task and attach it to the ALERT/RDY pin of the ADS1115
+   */
+
+  xTaskCreate(measTask, "meas", MEAS_TASK_STACK_SIZE, NULL, MEAS_TASK_PRIORITY, &xMeasTaskHandle);
+
+  gpio_config_t conf_rdy_pin;
+  conf_rdy_pin.pin_bit_mask = (1ULL << CONV_RDY_PIN);
+  conf_rdy_pin.mode = GPIO_MODE_INPUT;
+  conf_rdy_pin.pull_up_en = GPIO_PULLUP_DISABLE;
+  conf_rdy_pin.pull_down_en = GPIO_PULLDOWN_ENABLE;
+  conf_rdy_pin.intr_type = GPIO_INTR_POSEDGE;
+  gpio_config(&conf_rdy_pin);
+
+  gpio_install_isr_service(0);
+  gpio_isr_handler_add(CONV_RDY_PIN, convReadyIsr, NULL);
+}
+
+
+static double getI2cTransactions(){
+  ads1115_i2c_stats obj_stats;
+  objADS1115->getI2cStats(&obj_stats);
+  return obj_stats.iTransactions;
+}
+
+static double getI2cErrors(){
+  ads1115_i2c_stats obj_stats;
+  objADS1115->getI2cStats(&obj_stats);
+  return obj_stats.iErrors;
+}
+
+static double getI2cLatencyMax(){
+  ads1115_i2c_stats obj_stats;
+  objADS1115->getI2cStats(&obj_stats);
+  return obj_stats.iLatencyMaxUs / 1e6;
+}
+
+static void collectI2cLatency(const char * str_name){
+  ads1115_i2c_stats obj_stats;
+  objADS1115->getI2cStats(&obj_stats);
+  metricsWriteSample("coffee_i2c_latency_seconds_sum", NULL, obj_stats.iLatencySumUs / 1e6);
+  metricsWriteSample("coffee_i2c_latency_seconds_count", NULL, obj_stats.iTransactions);
+}
+
+static void collectTaskCpu(const char * str_name){
+  // report is too large for the httpd stack, metrics are rendered by the httpd task only
+  static profiler_report obj_report;
+  char char_labels[40];
+
+  profilerGetReport(&obj_report);
+  for (int i_idx = 0; i_idx < obj_report.iTaskCnt; i_idx++){
+    snprintf(char_labels, sizeof(char_labels), "task=\"%s\"", obj_report.arrTasks[i_idx].strName);
+    metricsWriteSample(str_name, char_labels, obj_report.arrTasks[i_idx].arrCpuPercent[1]);
+  }
+}
+
+static double getAdcSamples(){ return measGetCount(); }
+
+static double getAdcSampleRate(){
+  meas_timing obj_timing;
+  measGetTiming(&obj_timing, false);
+  return (obj_timing.fMeanIntervalUs > 0.F) ? 1e6 / obj_timing.fMeanIntervalUs : 0.;
+}
+
+static double getAdcFaultBits(){
+  meas_sample obj_sample;
+  return measGetLatest(&obj_sample) ? obj_sample.iFaultBits : 0;
+}
+
+static double getAdcRawSamples(){
+  meas_raw_info obj_info;
+  measGetRawInfo(&obj_info);
+  return obj_info.iCount;
+}
+
+static double getAdcRawLost(){
+  meas_raw_info obj_info;
+  measGetRawInfo(&obj_info);
+  return obj_info.iLost;
+}
+
+static double getAdcRangeSwitches(){ return objADS1115->getRangeSwitchCount(); }
+
+static double getAdcRange(){ return objADS1115->getRange(); }
+
+static double getCalOffset(){
+  ads1115_cal_status obj_status;
+  objCalibrator.getStatus(&obj_status);
+  return obj_status.fOffsetVolt;
+}
+
+static double getCalGain(){
+  ads1115_cal_status obj_status;
+  objCalibrator.getStatus(&obj_status);
+  return obj_status.fGain;
+}
+
+static double getCalRejected(){
+  ads1115_cal_status obj_status;
+  objCalibrator.getStatus(&obj_status);
+  return obj_status.iRejectCnt;
+}
+
+static double getScanCycles(){
+  static scan_report obj_report;
+  scanGetReport(&obj_report);
+  return obj_report.iCycleCnt;
+}
+
+static void collectScanVoltage(const char * str_name){
+  // report is too large for the httpd stack, metrics are rendered by the httpd task only
+  static scan_report obj_report;
+  char char_labels[40];
+
+  scanGetReport(&obj_report);
+  for (int i_ch = 0; i_ch < obj_report.iChannelCnt; i_ch++){
+    if (obj_report.arrResults[i_ch].bValid){
+      snprintf(char_labels, sizeof(char_labels), "channel=\"%s\"", obj_report.arrNames[i_ch]);
+      metricsWriteSample(str_name, char_labels, obj_report.arrResults[i_ch].fVoltage);
+    }
+  }
+}
+
+static double getFaultAction(){
+  fault_report obj_report;
+  faultGetReport(&obj_report);
+  return obj_report.iAction;
+}
+
+static double getFaultLatched(){
+  fault_report obj_report;
+  faultGetReport(&obj_report);
+  return obj_report.iLatchedMask;
+}
+
+static void collectFaults(const char * str_name){
+  /**
+   * Activations per fault code
+   */
+
+  fault_report obj_report;
+  char char_labels[40];
+
+  faultGetReport(&obj_report);
+  for (int i_code = 0; i_code < FAULT_CNT; i_code++){
+    snprintf(char_labels, sizeof(char_labels), "fault=\"%s\"", FaultManager::getFaultName(i_code));
+    metricsWriteSample(str_name, char_labels, obj_report.arrEntries[i_code].iCount);
+  }
+}
+
+static double getCtrlJitterMax(){
+  // maximum is reset on each scrape
+  meas_timing obj_timing;
+  measGetTiming(&obj_timing, true);
+  return obj_timing.iMaxJitterUs / 1e6;
+}
+
+
+static double getBrewShots(){
+  return brewGetShotCount();
+}
+
+
+static double getSsrHalfWaves(){
+  ssr_stats obj_stats;
+  ssrGetStats(&obj_stats);
+  return obj_stats.iHalfWaves;
+}
+
+static double getSsrOnHalfWaves(){
+  ssr_stats obj_stats;
+  ssrGetStats(&obj_stats);
+  return obj_stats.iOnHalfWaves;
+}
+
+static double getSsrMainsFreq(){
+  ssr_stats obj_stats;
+  ssrGetStats(&obj_stats);
+  return obj_stats.fMainsFreq;
+}
+
+
+void registerMetrics(){
+  /**
+   * Register metrics of the measurement and control path, system metrics are registered by the metrics module
+   */
+
+  metricsRegister("coffee_i2c_transactions_total", "I2C transactions with the ADS1115", METRIC_TYPE_COUNTER,
+                  getI2cTransactions);
+  metricsRegister("coffee_i2c_errors_total", "Failed I2C transactions with the ADS1115", METRIC_TYPE_COUNTER,
+                  getI2cErrors);
+  metricsRegisterFamily("coffee_i2c_latency_seconds", "Duration of I2C transactions with the ADS1115",
+                        METRIC_TYPE_SUMMARY, collectI2cLatency);
+  metricsRegister("coffee_i2c_latency_max_seconds", "Longest I2C transaction with the ADS1115", METRIC_TYPE_GAUGE,
+                  getI2cLatencyMax);
+  metricsRegister("coffee_adc_samples_total", "Samples read from the ADS1115", METRIC_TYPE_COUNTER, getAdcSamples);
+  metricsRegister("coffee_adc_samples_per_second", "Average sample rate of the ADS1115", METRIC_TYPE_GAUGE,
+                  getAdcSampleRate);
+  metricsRegister("coffee_adc_raw_samples_total", "Conversions read in the oversampling modes before decimation",
+                  METRIC_TYPE_COUNTER, getAdcRawSamples);
+  metricsRegister("coffee_adc_raw_lost_total", "Conversions missed in the oversampling modes (late readout)",
+                  METRIC_TYPE_COUNTER, getAdcRawLost);
+  metricsRegister("coffee_adc_range_switches_total", "PGA switches of the auto ranging", METRIC_TYPE_COUNTER,
+                  getAdcRangeSwitches);
+  metricsRegister("coffee_adc_range", "Actual PGA setting of the ADS1115 (0: 6.144 V ... 5: 0.256 V full scale)",
+                  METRIC_TYPE_GAUGE, getAdcRange);
+  if (objCalibrator.isActive()){
+    metricsRegister("coffee_adc_cal_offset_volts", "Input offset of the ADS1115 from the shorted calibration input",
+                    METRIC_TYPE_GAUGE, getCalOffset);
+    metricsRegister("coffee_adc_cal_gain", "Gain correction from the reference calibration input", METRIC_TYPE_GAUGE,
+                    getCalGain);
+    metricsRegister("coffee_adc_cal_rejected_total", "Implausible calibration measurements", METRIC_TYPE_COUNTER,
+                    getCalRejected);
+  }
+  if (objConfig.SigScanActive){
+    metricsRegister("coffee_adc_scan_cycles_total", "Completed cycles of the auxiliary channel scan", METRIC_TYPE_COUNTER,
+                    getScanCycles);
+    metricsRegisterFamily("coffee_adc_scan_volts", "Input voltage of the auxiliary channels", METRIC_TYPE_GAUGE,
+                          collectScanVoltage);
+  }
+  metricsRegister("coffee_adc_fault_bits", "Signal fault bits of the latest sample (1: frozen, 2: I2C error)",
+                  METRIC_TYPE_GAUGE, getAdcFaultBits);
+  metricsRegister("coffee_heater_safe_state", "Safe-state action of the fault manager (0: none, 1: cap, 2: limp, 3: off)",
+                  METRIC_TYPE_GAUGE, getFaultAction);
+  metricsRegister("coffee_fault_latched_bits", "Latched fault codes since the last clear (bit per code, see /faults.json)",
+                  METRIC_TYPE_GAUGE, getFaultLatched);
+  metricsRegisterFamily("coffee_faults_total", "Activations per fault code", METRIC_TYPE_COUNTER, collectFaults);
+  metricsRegister("coffee_ctrl_jitter_max_seconds", "Maximum sample interval jitter since the last scrape",
+                  METRIC_TYPE_GAUGE, getCtrlJitterMax);
+  metricsRegister("coffee_brew_shots_total", "Detected brew shots", METRIC_TYPE_COUNTER, getBrewShots);
+  metricsRegister("coffee_ssr_half_waves_total", "Mains half-waves clocked by the burst fire driver",
+                  METRIC_TYPE_COUNTER, getSsrHalfWaves);
+  metricsRegister("coffee_ssr_on_half_waves_total", "Mains half-waves with the heater on (burst fire)",
+                  METRIC_TYPE_COUNTER, getSsrOnHalfWaves);
+  metricsRegister("coffee_ssr_mains_hertz", "Mains frequency measured by the zero-cross input, 0 if not available",
+                  METRIC_TYPE_GAUGE, getSsrMainsFreq);
+  metricsRegisterFamily("coffee_task_cpu_percent", "CPU load per task over 10 s in percent of one core",
+                        METRIC_TYPE_GAUGE, collectTaskCpu);
+  metricsRegisterSystem();
+  memplanRegisterMetrics();
+  jsonArenaRegisterMetrics();
+  ledRegisterMetrics();
+  recorderRegisterMetrics();
+}
+
+
 extern "C" {
   void app_main();
 }
 
+static void networkLedHandler(void * arg, esp_event_base_t event_base, int32_t event_id, void * event_data){
+  /**
+   * Network layer of the status LED, follows the station connection
+   */
+
+  if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP){
+    ledSetLayer(LED_LAYER_NETWORK, LED_PATTERN_ONLINE);
+  } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED){
+    ledSetLayer(LED_LAYER_NETWORK, LED_PATTERN_OFFLINE);
+  }
+}
+
+
 void app_main(void)
 {
   // initialize LittleFS and load configuration files
@@ -797,6 +1472,9 @@ void app_main(void)
   unsigned int i_reset_reason = esp_reset_reason();
   ESP_LOGI("ESP", "Last reset reason: %d\n", i_reset_reason);
 
+  // cJSON allocates from the JSON arena from the first configuration load on
+  jsonArenaInit();
+
   // initialize configuration before load json file
   resetConfiguration(false);
 
@@ -806,84 +1484,77 @@ void app_main(void)
   }
 
   configLED();
-  setColor(LED_COLOR_WHITE, true); // White
+  ledSetLayer(LED_LAYER_NETWORK, LED_PATTERN_BOOT);
 
-  char char_timestamp[64];
+  // sample task run times from now on
+  if (profilerStart() != ESP_OK){
+    ESP_LOGE("ESP", "Task profiler could not be started.");
+  }
 
-  // Connect to wifi and create time stamp if device is Online
-  if (connectWiFi(3, 3000) == ESP_OK){
-    // Device is online, connecting to ntp server
+  // configure ADS1115
+  if(configADS1115() == ESP_FAIL) {
+    // the measurement task reports the missing conversions (FAULT_NO_SAMPLE) and keeps the heater off
+    ESP_LOGE("ADS1115", "ADS1115 configuration not successful.\n");
+  }
 
-    // set time zone to western europe / berlin
-    setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
-    tzset();
+  // heater output and controller, the measurement task runs the control loop
+  configSSR();
+  configPID();
+  configBrew();
+  configFault();
 
-    sntp_setoperatingmode(SNTP_OPMODE_POLL);
-    sntp_setservername(0, "pool.ntp.org");
-    // accept ntp server of dhcp if available
-    sntp_servermode_dhcp(1);
+  // Create measurement file header and start logging, independent of network and time synchronization
+  createMeasFile();
+  if (recorderStart(strMeasFilePath, saveConfiguration) != ESP_OK){
+    ESP_LOGE("LittleFS", "Recorder task could not be started, samples are only kept in RAM");
+  }
+  startMeasTask();
+  configScan();
 
-    sntp_init();
+  // record wall clock anchors whenever SNTP synchronizes
+  timebaseInit();
 
-    struct tm obj_timeinfo = {};
-    time_t obj_now = 0;
-    int i_retry_ntp = 0;
-    const int i_max_retry_ntp = 15;
+  // Start WiFi connection manager, connection is kept alive in background
+  wifiManagerStart(objConfig.wifiSSID, objConfig.wifiPassword);
 
-    while (sntp_get_sync_status() == SNTP_SYNC_STATUS_RESET && ++i_retry_ntp < i_max_retry_ntp) {
-      // try to connect to ntp server
-      ESP_LOGI("time", "Waiting for system time to be set... (%d/%d)", i_retry_ntp, i_max_retry_ntp);
-      vTaskDelay(2000 / portTICK_PERIOD_MS);
-    }
+  // set time zone to western europe / berlin
+  setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
+  tzset();
 
-    if (sntp_get_sync_status() == SNTP_SYNC_STATUS_COMPLETED){
-      // time is synchronized
-      time(&obj_now);
-      localtime_r(&obj_now, &obj_timeinfo);
-      
-      strftime(char_timestamp, sizeof(char_timestamp), "%c", &obj_timeinfo);
-      ESP_LOGI("time", "The current time is %s", char_timestamp);
-    } else {
-      // no time sync possible
-      ESP_LOGI("time", "Failed to obtain time stamp online");
-    }
+  sntp_setoperatingmode(SNTP_OPMODE_POLL);
+  sntp_setservername(0, "pool.ntp.org");
+  // accept ntp server of dhcp if available
+  sntp_servermode_dhcp(1);
 
-    setColor(LED_COLOR_PURPLE, false);
+  // time is synchronized in background as soon as the device is online
+  sntp_init();
 
-    //initialize mDNS service
-    esp_err_t err = mdns_init();
-    if (err) {
-        printf("MDNS Init failed: %d\n", err);
-    }
-    
-    //set hostname
-    mdns_hostname_set("coffeectrl");
-    //set default instance
-    mdns_instance_name_set("Coffee Ctrl for Rancilio Silvia");
+  // later connection changes are shown by the event handler
+  esp_event_handler_instance_register(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &networkLedHandler, NULL, NULL);
+  esp_event_handler_instance_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &networkLedHandler, NULL, NULL);
 
-    start_web_server("/littlefs");
+  if (wifiManagerWaitConnected(WIFI_INITIAL_CONNECT_TIMEOUT_MS)){
+    ledSetLayer(LED_LAYER_NETWORK, LED_PATTERN_ONLINE);
+  } else {
+    ledSetLayer(LED_LAYER_NETWORK, LED_PATTERN_OFFLINE);
+    ESP_LOGW("Wifi", "No connection on startup, retrying in background. Soft AP is available.");
   }
 
-  // configure ADS1115
-  if(configADS1115() == ESP_FAIL) {
-    // TODO add diagnosis when ADS1115 is not connected
-    ESP_LOGE("ADS1115", "ADS1115 configuration not successful.\n");
+  //initialize mDNS service
+  esp_err_t err = mdns_init();
+  if (err) {
+      printf("MDNS Init failed: %d\n", err);
   }
+  
+  //set hostname
+  mdns_hostname_set("coffeectrl");
+  //set default instance
+  mdns_instance_name_set("Coffee Ctrl for Rancilio Silvia");
 
-  // Create measurement file header
-  FILE *obj_file = fopen(strMeasFilePath, "w");  
-  uint16_t i_config_reg = objADS1115->getRegisterValue(ADS1115_CONFIG_REG);
-  uint16_t i_low_reg = objADS1115->getRegisterValue(ADS1115_LOW_THRESH_REG);
-  uint16_t i_high_reg = objADS1115->getRegisterValue(ADS1115_HIGH_THRESH_REG);
-	  
-  fprintf(obj_file, "Measurement File created on %s\n", char_timestamp);
-  fprintf(obj_file, "ADS1115 register settings\n");
-  fprintf(obj_file, "ADS1115 register settings\n");
-  fprintf(obj_file, "Config register: %d\n", i_config_reg);
-  fprintf(obj_file, "Low threshold register: %d\n", i_low_reg);
-  fprintf(obj_file, "High threshold register: %d\n\n", i_high_reg);
-  fprintf(obj_file, "Time,Temperature,TargetPWM,Buffer,InterruptCountAlertReady\n");
+  // web server is available in station and soft AP mode
+  registerMetrics();
+  start_web_server("/littlefs");
 
-  fflush(obj_file);
-  fclose(obj_file);
+  // initialization is complete, later allocations of the application are reported as after-freeze allocations
+  memplanFreeze();
 };
@@ -0,0 +1,245 @@
+/*********
+ *
+ * measurement
+ * Ring buffer of the latest measurement samples, see measurement.hpp
+ *
+*********/
+
+#include "measurement.hpp"
+#include "freertos/FreeRTOS.h"
+
+static meas_sample s_arr_samples[MEAS_RING_SIZE];
+static uint32_t s_i_sample_cnt = 0; // total number of pushed samples
+static meas_timing s_obj_timing = {};
+static portMUX_TYPE s_meas_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static int16_t s_arr_raw[MEAS_RAW_RING_SIZE];
+static meas_raw_info s_obj_raw_info = {};
+
+
+void measPush(const meas_sample * ptr_sample){
+  /**
+   * Add a sample to the ring buffer, the oldest sample is overwritten
+   *
+   * @param ptr_sample: sample to add
+   */
+
+  portENTER_CRITICAL(&s_meas_mux);
+  if (s_i_sample_cnt > 0){
+    // update interval statistics, average over roughly 16 samples
+    int64_t i_prev_time_us = s_arr_samples[(s_i_sample_cnt - 1) % MEAS_RING_SIZE].iTimeUs;
+    uint32_t i_interval_us = (uint32_t)(ptr_sample->iTimeUs - i_prev_time_us);
+
+    if (s_obj_timing.fMeanIntervalUs == 0.F){
+      s_obj_timing.fMeanIntervalUs = (float)i_interval_us;
+    } else {
+      s_obj_timing.fMeanIntervalUs += ((float)i_interval_us - s_obj_timing.fMeanIntervalUs) / 16.F;
+    }
+
+    float f_jitter_us = (float)i_interval_us - s_obj_timing.fMeanIntervalUs;
+    uint32_t i_jitter_us = (uint32_t)((f_jitter_us < 0.F) ? -f_jitter_us : f_jitter_us);
+    s_obj_timing.iLastIntervalUs = i_interval_us;
+    if (i_jitter_us > s_obj_timing.iMaxJitterUs){
+      s_obj_timing.iMaxJitterUs = i_jitter_us;
+    }
+  }
+  s_arr_samples[s_i_sample_cnt % MEAS_RING_SIZE] = *ptr_sample;
+  s_i_sample_cnt++;
+  portEXIT_CRITICAL(&s_meas_mux);
+}
+
+
+bool measGetLatest(meas_sample * ptr_sample){
+  /**
+   * Copy the latest sample
+   *
+   * @param ptr_sample: destination of the copy
+   * @return: false if no sample is available yet
+   */
+
+  bool b_available = false;
+
+  portENTER_CRITICAL(&s_meas_mux);
+  if (s_i_sample_cnt > 0){
+    *ptr_sample = s_arr_samples[(s_i_sample_cnt - 1) % MEAS_RING_SIZE];
+    b_available = true;
+  }
+  portEXIT_CRITICAL(&s_meas_mux);
+
+  return b_available;
+}
+
+
+int measCopySince(int64_t i_time_us, meas_sample * arr_samples, int i_max_samples){
+  /**
+   * Copy all buffered samples which are younger than the given time stamp, oldest first. If more samples are available
+   * than fit into the destination, the latest ones are copied.
+   *
+   * @param i_time_us: monotonic time stamp, only samples with a later time stamp are copied
+   * @param arr_samples: destination array
+   * @param i_max_samples: size of the destination array
+   * @return: number of copied samples
+   */
+
+  int i_cnt = 0;
+
+  portENTER_CRITICAL(&s_meas_mux);
+  uint32_t i_available = (s_i_sample_cnt < MEAS_RING_SIZE) ? s_i_sample_cnt : MEAS_RING_SIZE;
+  uint32_t i_first = s_i_sample_cnt - i_available;
+
+  // skip samples which are older than the requested time stamp
+  while (i_first < s_i_sample_cnt && s_arr_samples[i_first % MEAS_RING_SIZE].iTimeUs <= i_time_us){
+    i_first++;
+  }
+  if (s_i_sample_cnt - i_first > (uint32_t)i_max_samples){
+    i_first = s_i_sample_cnt - i_max_samples;
+  }
+  for (uint32_t i_pos = i_first; i_pos < s_i_sample_cnt; i_pos++){
+    arr_samples[i_cnt++] = s_arr_samples[i_pos % MEAS_RING_SIZE];
+  }
+  portEXIT_CRITICAL(&s_meas_mux);
+
+  return i_cnt;
+}
+
+
+int measCopyFrom(uint32_t i_seq, meas_sample * arr_samples, int i_max_samples, uint32_t * ptr_first_seq){
+  /**
+   * Copy buffered samples starting at a sequence number, oldest first. Unlike measCopySince() a reader which copies
+   * block by block gets every sample as long as it keeps up with the ring.
+   *
+   * @param i_seq: sequence number of the first requested sample, e.g. the end of the previous copy
+   * @param arr_samples: destination array
+   * @param i_max_samples: size of the destination array
+   * @param ptr_first_seq: sequence number of the first copied sample, larger than i_seq if samples were overwritten
+   * @return: number of copied samples
+   */
+
+  int i_cnt = 0;
+
+  portENTER_CRITICAL(&s_meas_mux);
+  uint32_t i_end = s_i_sample_cnt;
+  uint32_t i_first = i_end - ((i_end < MEAS_RING_SIZE) ? i_end : MEAS_RING_SIZE);
+
+  if (i_seq > i_first && i_seq <= i_end){
+    i_first = i_seq;
+  }
+  for (uint32_t i_pos = i_first; i_pos < i_end && i_cnt < i_max_samples; i_pos++){
+    arr_samples[i_cnt++] = s_arr_samples[i_pos % MEAS_RING_SIZE];
+  }
+  portEXIT_CRITICAL(&s_meas_mux);
+
+  *ptr_first_seq = i_first;
+  return i_cnt;
+}
+
+
+uint32_t measGetCount(){
+  /**
+   * @return: total number of samples since boot
+   */
+
+  return s_i_sample_cnt;
+}
+
+
+void measGetTiming(meas_timing * ptr_timing, bool b_reset_max){
+  /**
+   * Copy timing statistics of the sample stream
+   *
+   * @param ptr_timing: destination of the copy
+   * @param b_reset_max: reset the maximum jitter after the copy
+   */
+
+  portENTER_CRITICAL(&s_meas_mux);
+  *ptr_timing = s_obj_timing;
+  if (b_reset_max){
+    s_obj_timing.iMaxJitterUs = 0;
+  }
+  portEXIT_CRITICAL(&s_meas_mux);
+}
+
+
+void measSetRawRate(float f_rate_sps){
+  /**
+   * Activate the raw stream
+   *
+   * @param f_rate_sps: nominal data rate of the ADS1115, 0 if the stream is not used
+   */
+
+  portENTER_CRITICAL(&s_meas_mux);
+  s_obj_raw_info.fRateSps = f_rate_sps;
+  portEXIT_CRITICAL(&s_meas_mux);
+}
+
+
+void measPushRaw(int64_t i_time_us, int16_t i_raw_value, uint32_t i_lost, uint8_t i_range){
+  /**
+   * Add a raw conversion to the high-rate ring buffer
+   *
+   * @param i_time_us: monotonic time stamp of the conversion
+   * @param i_raw_value: conversion register value
+   * @param i_lost: conversions missed since the previous one
+   * @param i_range: range tag of the value, a change is recorded with its sequence number
+   */
+
+  portENTER_CRITICAL(&s_meas_mux);
+  if (i_range != s_obj_raw_info.iRange || s_obj_raw_info.iCount == 0){
+    s_obj_raw_info.iRange = i_range;
+    s_obj_raw_info.iRangeSeq = s_obj_raw_info.iCount;
+  }
+  s_arr_raw[s_obj_raw_info.iCount % MEAS_RAW_RING_SIZE] = i_raw_value;
+  s_obj_raw_info.iCount++;
+  s_obj_raw_info.iLost += i_lost;
+  s_obj_raw_info.iLatestTimeUs = i_time_us;
+  portEXIT_CRITICAL(&s_meas_mux);
+}
+
+
+int measCopyRawSince(uint32_t i_seq, int16_t * arr_values, int i_max_values, uint32_t * ptr_first_seq){
+  /**
+   * Copy raw conversions starting at a sequence number, oldest first. If more conversions are available than fit
+   * into the destination, the latest ones are copied.
+   *
+   * @param i_seq: sequence number of the first requested conversion, e.g. iCount of the previous request
+   * @param arr_values: destination array
+   * @param i_max_values: size of the destination array
+   * @param ptr_first_seq: sequence number of the first copied conversion
+   * @return: number of copied conversions
+   */
+
+  int i_cnt = 0;
+
+  portENTER_CRITICAL(&s_meas_mux);
+  uint32_t i_end = s_obj_raw_info.iCount;
+  uint32_t i_available = (i_end < MEAS_RAW_RING_SIZE) ? i_end : MEAS_RAW_RING_SIZE;
+  uint32_t i_first = i_end - i_available;
+
+  // sequence numbers from the future (reboot of the device) restart the stream
+  if (i_seq > i_first && i_seq <= i_end){
+    i_first = i_seq;
+  }
+  if (i_end - i_first > (uint32_t)i_max_values){
+    i_first = i_end - i_max_values;
+  }
+  for (uint32_t i_pos = i_first; i_pos < i_end; i_pos++){
+    arr_values[i_cnt++] = s_arr_raw[i_pos % MEAS_RAW_RING_SIZE];
+  }
+  portEXIT_CRITICAL(&s_meas_mux);
+
+  *ptr_first_seq = i_first;
+  return i_cnt;
+}
+
+
+void measGetRawInfo(meas_raw_info * ptr_info){
+  /**
+   * Copy the state of the raw stream
+   *
+   * @param ptr_info: destination of the copy
+   */
+
+  portENTER_CRITICAL(&s_meas_mux);
+  *ptr_info = s_obj_raw_info;
+  portEXIT_CRITICAL(&s_meas_mux);
+}
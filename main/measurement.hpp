@@ -0,0 +1,59 @@
+/*********
+ *
+ * measurement
+ * Ring buffer of the latest measurement samples. Written by the measurement task, read by the web server.
+ * In the oversampling modes the raw conversions before decimation are kept in a second ring for diagnostics.
+ *
+*********/
+
+#ifndef MEASUREMENT_h
+#define MEASUREMENT_h
+
+#include <stdint.h>
+
+#define MEAS_RING_SIZE 256 // number of samples kept in RAM
+#define MEAS_RAW_RING_SIZE 2048 // number of raw high-rate conversions kept in RAM
+
+// signal fault bits of a sample
+#define MEAS_FAULT_VALUE_FROZEN (1<<0)  // raw value did not change over the filter buffer
+#define MEAS_FAULT_I2C_ERROR (1<<1)     // last I2C transaction with the ADS1115 failed
+
+struct meas_sample {
+  int64_t iTimeUs;      // monotonic time stamp of the conversion in us since boot
+  float fTemperature;   // filtered physical value
+  float fTargetPwm;     // manipulated variable of the heater
+  int16_t iRawValue;    // unfiltered conversion register value
+  uint8_t iRange;       // range tag, PGA setting (ADS1115_PGA_*) of the raw value
+  uint32_t iIsrCount;   // number of ALERT/RDY interrupts since boot
+  uint8_t iFaultBits;   // signal fault bits, see MEAS_FAULT_*
+};
+
+// timing of the sample stream
+struct meas_timing {
+  uint32_t iLastIntervalUs; // interval between the two latest samples
+  float fMeanIntervalUs;    // moving average of the sample interval
+  uint32_t iMaxJitterUs;    // maximum deviation of an interval from the average since the last reset
+};
+
+// state of the raw high-rate stream
+struct meas_raw_info {
+  float fRateSps;           // nominal data rate, 0 if the stream is not active
+  uint32_t iCount;          // conversions since boot, sequence number of the next conversion
+  uint32_t iLost;           // conversions which were not read out in time
+  int64_t iLatestTimeUs;    // time stamp of the latest conversion
+  uint8_t iRange;           // range tag (ADS1115_PGA_*) of the latest conversion
+  uint32_t iRangeSeq;       // sequence number of the first conversion in this range
+};
+
+void measPush(const meas_sample * ptr_sample);
+bool measGetLatest(meas_sample * ptr_sample);
+int measCopySince(int64_t i_time_us, meas_sample * arr_samples, int i_max_samples);
+int measCopyFrom(uint32_t i_seq, meas_sample * arr_samples, int i_max_samples, uint32_t * ptr_first_seq);
+uint32_t measGetCount();
+void measGetTiming(meas_timing * ptr_timing, bool b_reset_max);
+void measSetRawRate(float f_rate_sps);
+void measPushRaw(int64_t i_time_us, int16_t i_raw_value, uint32_t i_lost, uint8_t i_range);
+int measCopyRawSince(uint32_t i_seq, int16_t * arr_values, int i_max_values, uint32_t * ptr_first_seq);
+void measGetRawInfo(meas_raw_info * ptr_info);
+
+#endif
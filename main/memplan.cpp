@@ -0,0 +1,150 @@
+/*********
+ *
+ * memplan
+ * Allocation counters of the static memory plan, see memplan.hpp
+ *
+*********/
+
+#include <stdlib.h>
+#include <new>
+#include "memplan.hpp"
+#include "metrics.hpp"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char * TAG_MEMPLAN = "memplan";
+
+static memplan_stats s_obj_stats = {};
+static portMUX_TYPE s_memplan_mux = portMUX_INITIALIZER_UNLOCKED;
+
+
+void memplanCountAlloc(size_t i_size){
+  /**
+   * Count an allocation of the application, called by operator new and the heap fallback of the cJSON arena
+   *
+   * @param i_size: requested size in bytes
+   */
+
+  taskENTER_CRITICAL(&s_memplan_mux);
+  if (s_obj_stats.bFrozen){
+    s_obj_stats.iAllocsAfterFreeze++;
+    s_obj_stats.iBytesAfterFreeze += i_size;
+  } else {
+    s_obj_stats.iAllocsBoot++;
+  }
+  taskEXIT_CRITICAL(&s_memplan_mux);
+}
+
+
+void memplanFreeze(){
+  /**
+   * End of the initialization, later allocations of the application are counted as after-freeze allocations
+   */
+
+  uint32_t i_free = esp_get_free_heap_size();
+
+  taskENTER_CRITICAL(&s_memplan_mux);
+  s_obj_stats.bFrozen = true;
+  s_obj_stats.iFreeAtFreeze = i_free;
+  taskEXIT_CRITICAL(&s_memplan_mux);
+
+  ESP_LOGI(TAG_MEMPLAN, "Heap frozen with %u bytes free, %u allocations during boot", (unsigned)i_free,
+           (unsigned)s_obj_stats.iAllocsBoot);
+}
+
+
+void memplanGetStats(memplan_stats * ptr_stats){
+  /**
+   * Consistent copy of the counters
+   *
+   * @param ptr_stats: destination
+   */
+
+  taskENTER_CRITICAL(&s_memplan_mux);
+  *ptr_stats = s_obj_stats;
+  taskEXIT_CRITICAL(&s_memplan_mux);
+}
+
+
+static double getAllocsAfterFreeze(){
+  memplan_stats obj_stats;
+  memplanGetStats(&obj_stats);
+  return obj_stats.iAllocsAfterFreeze;
+}
+
+
+static double getBytesAfterFreeze(){
+  memplan_stats obj_stats;
+  memplanGetStats(&obj_stats);
+  return (double)obj_stats.iBytesAfterFreeze;
+}
+
+
+static double getHeapDrift(){
+  memplan_stats obj_stats;
+  memplanGetStats(&obj_stats);
+  return obj_stats.bFrozen ? (double)obj_stats.iFreeAtFreeze - esp_get_free_heap_size() : 0.;
+}
+
+
+static double getLargestFreeBlock(){ return heap_caps_get_largest_free_block(MALLOC_CAP_8BIT); }
+
+
+void memplanRegisterMetrics(){
+  /**
+   * Register the metrics of the memory plan
+   */
+
+  metricsRegister("coffee_heap_allocs_after_freeze_total", "Allocations of the application after boot",
+                  METRIC_TYPE_COUNTER, getAllocsAfterFreeze);
+  metricsRegister("coffee_heap_alloc_bytes_after_freeze_total", "Bytes allocated by the application after boot",
+                  METRIC_TYPE_COUNTER, getBytesAfterFreeze);
+  metricsRegister("coffee_heap_drift_bytes", "Free heap at the end of boot minus free heap now",
+                  METRIC_TYPE_GAUGE, getHeapDrift);
+  metricsRegister("coffee_heap_largest_free_block_bytes", "Largest free heap block, falls with fragmentation",
+                  METRIC_TYPE_GAUGE, getLargestFreeBlock);
+}
+
+
+// allocations of the application with new, counted before they reach the heap
+void * operator new(size_t i_size){
+  memplanCountAlloc(i_size);
+  void * ptr_mem = malloc(i_size);
+  if (!ptr_mem){
+    abort();
+  }
+  return ptr_mem;
+}
+
+void * operator new[](size_t i_size){
+  return operator new(i_size);
+}
+
+void * operator new(size_t i_size, const std::nothrow_t &) noexcept{
+  memplanCountAlloc(i_size);
+  return malloc(i_size);
+}
+
+void * operator new[](size_t i_size, const std::nothrow_t &) noexcept{
+  memplanCountAlloc(i_size);
+  return malloc(i_size);
+}
+
+void operator delete(void * ptr_mem) noexcept{
+  free(ptr_mem);
+}
+
+void operator delete[](void * ptr_mem) noexcept{
+  free(ptr_mem);
+}
+
+void operator delete(void * ptr_mem, size_t) noexcept{
+  free(ptr_mem);
+}
+
+void operator delete[](void * ptr_mem, size_t) noexcept{
+  free(ptr_mem);
+}
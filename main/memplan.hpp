@@ -0,0 +1,31 @@
+/*********
+ *
+ * memplan
+ * Static memory plan. Long-lived objects of the application live in static storage, allocations after boot are
+ * counted: memplanFreeze() marks the end of the initialization, every later operator new of the application and every
+ * cJSON allocation that does not fit into the JSON arena increments the after-freeze counters. The free heap at the
+ * freeze is the baseline of the heap drift, which also covers allocations of ESP-IDF components (sockets, WiFi
+ * buffers) that are not counted.
+ *
+*********/
+
+#ifndef MEMPLAN_h
+#define MEMPLAN_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct memplan_stats {
+  bool bFrozen;
+  uint32_t iAllocsBoot;         // allocations before the freeze
+  uint32_t iAllocsAfterFreeze;  // allocations after the freeze, should stay 0 apart from request handling
+  uint64_t iBytesAfterFreeze;
+  uint32_t iFreeAtFreeze;       // free heap at the freeze in bytes
+};
+
+void memplanFreeze();
+void memplanCountAlloc(size_t i_size);
+void memplanGetStats(memplan_stats * ptr_stats);
+void memplanRegisterMetrics();
+
+#endif
@@ -0,0 +1,187 @@
+/*********
+ *
+ * metrics
+ * Fixed registry of device metrics, see metrics.hpp
+ *
+*********/
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <assert.h>
+#include "metrics.hpp"
+
+static const char * TAG_METRICS = "metrics";
+
+struct metric_entry {
+  const char * strName;
+  const char * strHelp;
+  int iType;
+  metric_value_fn fnValue;      // single value metric
+  metric_collect_fn fnCollect;  // metric family with labels, used if fnValue is NULL
+};
+
+static metric_entry s_arr_metrics[METRICS_MAX_ENTRIES];
+static int s_i_metric_cnt = 0;
+
+static char s_char_buf[METRICS_BUF_SIZE];
+static size_t s_i_buf_len = 0;
+static bool s_b_buf_overflow = false;
+
+
+static void metricsAppend(const char * str_format, ...){
+  /**
+   * Append formatted text to the render buffer, an overflow is flagged and the text is dropped
+   */
+
+  if (s_b_buf_overflow){
+    return;
+  }
+
+  va_list args;
+  va_start(args, str_format);
+  int i_ret = vsnprintf(s_char_buf + s_i_buf_len, METRICS_BUF_SIZE - s_i_buf_len, str_format, args);
+  va_end(args);
+
+  if (i_ret < 0 || (size_t)i_ret >= METRICS_BUF_SIZE - s_i_buf_len){
+    s_b_buf_overflow = true;
+  } else {
+    s_i_buf_len += i_ret;
+  }
+}
+
+
+static esp_err_t addEntry(const char * str_name, const char * str_help, int i_type, metric_value_fn fn_value,
+                          metric_collect_fn fn_collect){
+  /**
+   * Append an entry to the registry. The registry is sized at compile time, running out of entries is a programming
+   * error and stops the device in debug builds.
+   *
+   * @return: ESP_ERR_NO_MEM if the registry is full
+   */
+
+  if (s_i_metric_cnt >= METRICS_MAX_ENTRIES){
+    ESP_LOGE(TAG_METRICS, "Registry full (%d entries), metric %s is dropped, raise METRICS_MAX_ENTRIES",
+             METRICS_MAX_ENTRIES, str_name);
+    assert(!"metric registry full");
+    return ESP_ERR_NO_MEM;
+  }
+
+  s_arr_metrics[s_i_metric_cnt].strName = str_name;
+  s_arr_metrics[s_i_metric_cnt].strHelp = str_help;
+  s_arr_metrics[s_i_metric_cnt].iType = i_type;
+  s_arr_metrics[s_i_metric_cnt].fnValue = fn_value;
+  s_arr_metrics[s_i_metric_cnt].fnCollect = fn_collect;
+  s_i_metric_cnt++;
+  return ESP_OK;
+}
+
+
+esp_err_t metricsRegister(const char * str_name, const char * str_help, int i_type, metric_value_fn fn_value){
+  /**
+   * Register a single value metric. Name and help text are not copied, they must be string literals.
+   *
+   * @param str_name: metric name
+   * @param str_help: help text
+   * @param i_type: metric type, see eMetricType
+   * @param fn_value: function returning the actual value
+   * @return: ESP_ERR_NO_MEM if the registry is full
+   */
+
+  return addEntry(str_name, str_help, i_type, fn_value, NULL);
+}
+
+
+esp_err_t metricsRegisterFamily(const char * str_name, const char * str_help, int i_type, metric_collect_fn fn_collect){
+  /**
+   * Register a metric family with labels. The collect function writes all samples with metricsWriteSample().
+   *
+   * @param str_name: metric name, passed to the collect function
+   * @param str_help: help text
+   * @param i_type: metric type, see eMetricType
+   * @param fn_collect: collect function
+   * @return: ESP_ERR_NO_MEM if the registry is full
+   */
+
+  return addEntry(str_name, str_help, i_type, NULL, fn_collect);
+}
+
+
+void metricsWriteSample(const char * str_name, const char * str_labels, double f_value){
+  /**
+   * Write one sample line, to be used from collect functions
+   *
+   * @param str_name: sample name, may differ from the family name (e.g. _sum and _count of a summary)
+   * @param str_labels: label set without braces (e.g. uri="/"), NULL for no labels
+   * @param f_value: sample value
+   */
+
+  if (str_labels){
+    metricsAppend("%s{%s} %.10g\n", str_name, str_labels, f_value);
+  } else {
+    metricsAppend("%s %.10g\n", str_name, f_value);
+  }
+}
+
+
+static void renderEntry(const metric_entry * ptr_entry){
+  static const char * arr_type_names[] = {"counter", "gauge", "summary"};
+
+  metricsAppend("# HELP %s %s\n# TYPE %s %s\n", ptr_entry->strName, ptr_entry->strHelp,
+                ptr_entry->strName, arr_type_names[ptr_entry->iType]);
+
+  if (ptr_entry->fnValue){
+    metricsWriteSample(ptr_entry->strName, NULL, ptr_entry->fnValue());
+  } else {
+    ptr_entry->fnCollect(ptr_entry->strName);
+  }
+}
+
+
+esp_err_t metricsRender(metric_write_fn fn_write, void * ptr_ctx){
+  /**
+   * Render all registered metrics and pass the text in pieces of whole entries to the write function. The size of
+   * the output is not limited by the buffer, only a single entry has to fit. Must only be called from one task (the
+   * http server).
+   *
+   * @param fn_write: output of a piece, e.g. one chunk of the http response
+   * @param ptr_ctx: passed to fn_write
+   * @return: ESP_OK, ESP_ERR_INVALID_SIZE if an entry does not fit into the buffer or the error of fn_write. The
+   *          output is incomplete on error, pieces written before are not taken back.
+   */
+
+  esp_err_t esp_ret;
+
+  s_i_buf_len = 0;
+
+  for (int i_idx = 0; i_idx < s_i_metric_cnt; i_idx++){
+    size_t i_entry_start = s_i_buf_len;
+
+    s_b_buf_overflow = false;
+    renderEntry(&s_arr_metrics[i_idx]);
+    if (!s_b_buf_overflow){
+      continue;
+    }
+
+    // the entry does not fit behind the previous ones: write them and render the entry again into the empty buffer
+    if (i_entry_start > 0){
+      esp_ret = fn_write(ptr_ctx, s_char_buf, i_entry_start);
+      if (esp_ret != ESP_OK){
+        return esp_ret;
+      }
+      s_i_buf_len = 0;
+      s_b_buf_overflow = false;
+      renderEntry(&s_arr_metrics[i_idx]);
+    }
+    if (s_b_buf_overflow){
+      ESP_LOGE(TAG_METRICS, "Metric %s does not fit into the render buffer (%d bytes)",
+               s_arr_metrics[i_idx].strName, METRICS_BUF_SIZE);
+      return ESP_ERR_INVALID_SIZE;
+    }
+  }
+
+  if (s_i_buf_len > 0){
+    return fn_write(ptr_ctx, s_char_buf, s_i_buf_len);
+  }
+  return ESP_OK;
+}
@@ -0,0 +1,47 @@
+/*********
+ *
+ * metrics
+ * Fixed registry of device metrics, rendered in the Prometheus text exposition format. The text is produced entry by
+ * entry in a reusable buffer and streamed out in pieces, so the size of the output is not bound to the buffer. The
+ * registry and the renderer do not depend on ESP-IDF and are checked on the host (host/metrics_check.cpp), the system
+ * metrics are in metrics_system.cpp.
+ *
+*********/
+
+#ifndef METRICS_h
+#define METRICS_h
+
+#include <stddef.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_err.h"
+#include "esp_log.h"
+#else
+#include "ADS111x_platform.hpp"
+#endif
+
+#define METRICS_MAX_ENTRIES 96  // size of the metric registry, about half of it is used
+#define METRICS_MAX_TASKS 12    // number of tasks with stack high water mark metric
+#define METRICS_BUF_SIZE 8192   // render buffer, must hold the largest single entry
+
+enum eMetricType{
+  METRIC_TYPE_COUNTER,
+  METRIC_TYPE_GAUGE,
+  METRIC_TYPE_SUMMARY
+};
+
+// read out of a single value metric
+typedef double (*metric_value_fn)(void);
+// read out of a metric family with labels, writes its samples with metricsWriteSample()
+typedef void (*metric_collect_fn)(const char * str_name);
+// output of the rendered text, called with whole entries
+typedef esp_err_t (*metric_write_fn)(void * ptr_ctx, const char * ptr_data, size_t i_len);
+
+esp_err_t metricsRegister(const char * str_name, const char * str_help, int i_type, metric_value_fn fn_value);
+esp_err_t metricsRegisterFamily(const char * str_name, const char * str_help, int i_type, metric_collect_fn fn_collect);
+esp_err_t metricsRegisterTask(const char * str_task_name);
+void metricsRegisterSystem();
+void metricsWriteSample(const char * str_name, const char * str_labels, double f_value);
+esp_err_t metricsRender(metric_write_fn fn_write, void * ptr_ctx);
+
+#endif
@@ -0,0 +1,137 @@
+/*********
+ *
+ * metrics_system
+ * System metrics of the device: uptime, heap, file system, task stacks and WiFi, see metrics.hpp
+ *
+*********/
+
+#include <stdio.h>
+#include "metrics.hpp"
+#include "wifi_manager.hpp"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_littlefs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define METRICS_FS_INFO_PERIOD_US (60LL * 1000000LL) // esp_littlefs_info walks the file system, cache its result
+
+struct metric_task {
+  const char * strName;
+  TaskHandle_t xHandle;  // resolved on first render, task may be created after registration
+};
+
+static metric_task s_arr_tasks[METRICS_MAX_TASKS];
+static int s_i_task_cnt = 0;
+
+static size_t s_i_fs_total_bytes = 0;
+static size_t s_i_fs_used_bytes = 0;
+static int64_t s_i_fs_info_time_us = 0;
+
+
+esp_err_t metricsRegisterTask(const char * str_task_name){
+  /**
+   * Add a task to the stack high water mark metric
+   *
+   * @param str_task_name: FreeRTOS task name, must be a string literal
+   * @return: ESP_ERR_NO_MEM if the task table is full
+   */
+
+  if (s_i_task_cnt >= METRICS_MAX_TASKS){
+    return ESP_ERR_NO_MEM;
+  }
+
+  s_arr_tasks[s_i_task_cnt].strName = str_task_name;
+  s_arr_tasks[s_i_task_cnt].xHandle = NULL;
+  s_i_task_cnt++;
+  return ESP_OK;
+}
+
+
+
+static void updateFsInfo(){
+  /**
+   * Refresh cached LittleFS usage
+   */
+
+  int64_t i_now_us = esp_timer_get_time();
+
+  if (s_i_fs_info_time_us == 0 || i_now_us - s_i_fs_info_time_us > METRICS_FS_INFO_PERIOD_US){
+    esp_littlefs_info("littlefs", &s_i_fs_total_bytes, &s_i_fs_used_bytes);
+    s_i_fs_info_time_us = i_now_us;
+  }
+}
+
+
+static double getUptime(){ return esp_timer_get_time() / 1e6; }
+static double getHeapFree(){ return esp_get_free_heap_size(); }
+static double getHeapMinFree(){ return esp_get_minimum_free_heap_size(); }
+static double getFsUsed(){ updateFsInfo(); return s_i_fs_used_bytes; }
+static double getFsTotal(){ updateFsInfo(); return s_i_fs_total_bytes; }
+static double getWifiConnected(){ return wifiManagerIsConnected() ? 1 : 0; }
+static double getWifiRssi(){ return wifiManagerGetRssi(); }
+
+static double getWifiReconnects(){
+  wifi_stats obj_stats;
+  wifiManagerGetStats(&obj_stats);
+  return obj_stats.iReconnectCount;
+}
+
+static double getWifiTimeToIp(){
+  wifi_stats obj_stats;
+  wifiManagerGetStats(&obj_stats);
+  return (obj_stats.iLastTimeToIpUs < 0) ? -1. : obj_stats.iLastTimeToIpUs / 1e6;
+}
+
+
+static void collectTaskStack(const char * str_name){
+  /**
+   * Collect stack high water mark of all registered tasks
+   */
+
+  char char_labels[40];
+
+  for (int i_idx = 0; i_idx < s_i_task_cnt; i_idx++){
+    if (!s_arr_tasks[i_idx].xHandle){
+      s_arr_tasks[i_idx].xHandle = xTaskGetHandle(s_arr_tasks[i_idx].strName);
+      if (!s_arr_tasks[i_idx].xHandle){
+        continue;
+      }
+    }
+    snprintf(char_labels, sizeof(char_labels), "task=\"%s\"", s_arr_tasks[i_idx].strName);
+    metricsWriteSample(str_name, char_labels, uxTaskGetStackHighWaterMark(s_arr_tasks[i_idx].xHandle));
+  }
+}
+
+
+void metricsRegisterSystem(){
+  /**
+   * Register metrics of the system: uptime, heap, file system, task stacks and WiFi
+   */
+
+  metricsRegister("coffee_uptime_seconds", "Time since boot", METRIC_TYPE_COUNTER, getUptime);
+  metricsRegister("coffee_heap_free_bytes", "Free heap size", METRIC_TYPE_GAUGE, getHeapFree);
+  metricsRegister("coffee_heap_min_free_bytes", "Minimum free heap size since boot", METRIC_TYPE_GAUGE, getHeapMinFree);
+  metricsRegister("coffee_littlefs_used_bytes", "Used bytes on LittleFS", METRIC_TYPE_GAUGE, getFsUsed);
+  metricsRegister("coffee_littlefs_total_bytes", "Total bytes on LittleFS", METRIC_TYPE_GAUGE, getFsTotal);
+  metricsRegisterFamily("coffee_task_stack_free_bytes", "Stack high water mark per task", METRIC_TYPE_GAUGE,
+                        collectTaskStack);
+  metricsRegister("coffee_wifi_connected", "Station has an IP address", METRIC_TYPE_GAUGE, getWifiConnected);
+  metricsRegister("coffee_wifi_rssi_dbm", "Latest RSSI of the station", METRIC_TYPE_GAUGE, getWifiRssi);
+  metricsRegister("coffee_wifi_reconnects_total", "Lost station connections", METRIC_TYPE_COUNTER, getWifiReconnects);
+  metricsRegister("coffee_wifi_time_to_ip_seconds", "Time from link loss until IP of the last connection",
+                  METRIC_TYPE_GAUGE, getWifiTimeToIp);
+
+  // tasks of the application and of ESP-IDF
+  metricsRegisterTask("meas");
+  metricsRegisterTask("scan");
+  metricsRegisterTask("wifi_manager");
+  metricsRegisterTask("profiler");
+  metricsRegisterTask("led");
+  metricsRegisterTask("recorder");
+  metricsRegisterTask("httpd");
+  metricsRegisterTask("tiT");
+  metricsRegisterTask("wifi");
+  metricsRegisterTask("sys_evt");
+  metricsRegisterTask("esp_timer");
+}
@@ -0,0 +1,217 @@
+/*********
+ *
+ * profiler
+ * Task runtime profiler, see profiler.hpp
+ *
+*********/
+
+#include <string.h>
+#include "profiler.hpp"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#define PROFILER_TASK_STACK_SIZE 3072
+#define PROFILER_TASK_PRIORITY 1
+
+static const char * TAG_PROFILER = "profiler";
+
+// sampling state of a task, matched between samples by the task number
+struct profiler_task_state {
+  uint32_t iTaskNumber;
+  uint32_t iPrevRunTime;
+  uint32_t iPrevSwitches;
+  float arrCpuPercent[PROFILER_WINDOW_CNT];
+  float fSwitchesPerSec;
+  bool bValid;
+};
+
+static volatile uint32_t s_arr_switch_cnt[PROFILER_SWITCH_SLOTS];  // written by the trace hook
+
+static TaskStatus_t s_arr_status[PROFILER_MAX_TASKS];
+static profiler_task_state s_arr_state[PROFILER_MAX_TASKS];
+static uint32_t s_i_prev_total_run_time = 0;
+static const int s_arr_windows_s[PROFILER_WINDOW_CNT] = PROFILER_WINDOWS_S;
+
+static profiler_report s_obj_report = {};
+static SemaphoreHandle_t s_report_mutex = NULL;
+
+
+extern "C" void IRAM_ATTR profilerTaskSwitchedIn(uint32_t i_task_number){
+  /**
+   * Trace hook, called by the scheduler on every context switch with interrupts disabled
+   *
+   * @param i_task_number: uxTCBNumber of the task which is switched in
+   */
+
+  s_arr_switch_cnt[i_task_number % PROFILER_SWITCH_SLOTS]++;
+}
+
+
+static profiler_task_state * getTaskState(uint32_t i_task_number){
+  /**
+   * Find the sampling state of a task or allocate a free one
+   *
+   * @param i_task_number: unique task number
+   * @return: NULL if the table is full
+   */
+
+  profiler_task_state * ptr_free = NULL;
+
+  for (int i_idx = 0; i_idx < PROFILER_MAX_TASKS; i_idx++){
+    if (s_arr_state[i_idx].bValid && s_arr_state[i_idx].iTaskNumber == i_task_number){
+      return &s_arr_state[i_idx];
+    }
+    if (!s_arr_state[i_idx].bValid && !ptr_free){
+      ptr_free = &s_arr_state[i_idx];
+    }
+  }
+  return ptr_free;
+}
+
+
+static void profilerSample(){
+  /**
+   * Read the run time counters of all tasks and update the report. Load values are exponentially weighted moving
+   * averages with the window length as time constant, the first window is the plain value of the last period.
+   */
+
+  uint32_t i_total_run_time;
+  UBaseType_t i_task_cnt = uxTaskGetSystemState(s_arr_status, PROFILER_MAX_TASKS, &i_total_run_time);
+
+  if (i_task_cnt == 0){
+    ESP_LOGW(TAG_PROFILER, "More than %d tasks, profiling skipped", PROFILER_MAX_TASKS);
+    return;
+  }
+
+  // run time counters are 32 bit, the unsigned difference is valid over one wrap around
+  uint32_t i_elapsed = i_total_run_time - s_i_prev_total_run_time;
+  s_i_prev_total_run_time = i_total_run_time;
+  if (i_elapsed == 0){
+    return;
+  }
+
+  bool arr_seen[PROFILER_MAX_TASKS] = {};
+  profiler_report * ptr_report = &s_obj_report;
+
+  xSemaphoreTake(s_report_mutex, portMAX_DELAY);
+  ptr_report->iTimeUs = esp_timer_get_time();
+  ptr_report->iTaskCnt = 0;
+
+  for (UBaseType_t i_idx = 0; i_idx < i_task_cnt; i_idx++){
+    TaskStatus_t * ptr_status = &s_arr_status[i_idx];
+    profiler_task_state * ptr_state = getTaskState(ptr_status->xTaskNumber);
+    uint32_t i_switches = s_arr_switch_cnt[ptr_status->xTaskNumber % PROFILER_SWITCH_SLOTS];
+
+    if (!ptr_state){
+      continue;
+    }
+    arr_seen[ptr_state - s_arr_state] = true;
+
+    if (!ptr_state->bValid){
+      // new task, rates are available from the next sample on
+      memset(ptr_state, 0, sizeof(profiler_task_state));
+      ptr_state->iTaskNumber = ptr_status->xTaskNumber;
+      ptr_state->iPrevRunTime = ptr_status->ulRunTimeCounter;
+      ptr_state->iPrevSwitches = i_switches;
+      ptr_state->bValid = true;
+    }
+
+    float f_cpu_percent = 100.F * (float)(ptr_status->ulRunTimeCounter - ptr_state->iPrevRunTime) / (float)i_elapsed;
+    float f_switches_per_sec = (float)(i_switches - ptr_state->iPrevSwitches) * 1000.F / PROFILER_SAMPLE_PERIOD_MS;
+    ptr_state->iPrevRunTime = ptr_status->ulRunTimeCounter;
+    ptr_state->iPrevSwitches = i_switches;
+
+    ptr_state->arrCpuPercent[0] = f_cpu_percent;
+    for (int i_win = 1; i_win < PROFILER_WINDOW_CNT; i_win++){
+      ptr_state->arrCpuPercent[i_win] += (f_cpu_percent - ptr_state->arrCpuPercent[i_win]) / s_arr_windows_s[i_win];
+    }
+    ptr_state->fSwitchesPerSec += (f_switches_per_sec - ptr_state->fSwitchesPerSec) / s_arr_windows_s[1];
+
+    profiler_task_info * ptr_info = &ptr_report->arrTasks[ptr_report->iTaskCnt++];
+    strlcpy(ptr_info->strName, ptr_status->pcTaskName, sizeof(ptr_info->strName));
+    ptr_info->iTaskNumber = ptr_status->xTaskNumber;
+    ptr_info->iState = (uint8_t)ptr_status->eCurrentState;
+    ptr_info->iPriority = (uint8_t)ptr_status->uxCurrentPriority;
+    BaseType_t i_affinity = xTaskGetAffinity(ptr_status->xHandle);
+    ptr_info->iCore = (i_affinity == tskNO_AFFINITY) ? -1 : (int8_t)i_affinity;
+    ptr_info->iStackFreeBytes = ptr_status->usStackHighWaterMark;
+    memcpy(ptr_info->arrCpuPercent, ptr_state->arrCpuPercent, sizeof(ptr_info->arrCpuPercent));
+    ptr_info->fSwitchesPerSec = ptr_state->fSwitchesPerSec;
+
+    // the idle task of a core runs whenever nothing else does
+    for (int i_core = 0; i_core < portNUM_PROCESSORS; i_core++){
+      if (ptr_status->xHandle == xTaskGetIdleTaskHandleForCPU(i_core)){
+        for (int i_win = 0; i_win < PROFILER_WINDOW_CNT; i_win++){
+          float f_load = 100.F - ptr_state->arrCpuPercent[i_win];
+          ptr_report->arrCoreLoad[i_core][i_win] = (f_load < 0.F) ? 0.F : f_load;
+        }
+      }
+    }
+  }
+  xSemaphoreGive(s_report_mutex);
+
+  // release state of deleted tasks
+  for (int i_idx = 0; i_idx < PROFILER_MAX_TASKS; i_idx++){
+    if (!arr_seen[i_idx]){
+      s_arr_state[i_idx].bValid = false;
+    }
+  }
+}
+
+
+static void profilerTask(void * pvParameters){
+  /**
+   * Sample run time counters periodically
+   */
+
+  TickType_t x_last_wake = xTaskGetTickCount();
+
+  for (;;){
+    vTaskDelayUntil(&x_last_wake, pdMS_TO_TICKS(PROFILER_SAMPLE_PERIOD_MS));
+    profilerSample();
+  }
+}
+
+
+esp_err_t profilerStart(){
+  /**
+   * Start the profiler task
+   *
+   * @return: ESP_ERR_NO_MEM if mutex or task could not be created
+   */
+
+  s_report_mutex = xSemaphoreCreateMutex();
+  if (!s_report_mutex){
+    return ESP_ERR_NO_MEM;
+  }
+
+  // first sample only initializes the counters
+  uxTaskGetSystemState(s_arr_status, PROFILER_MAX_TASKS, &s_i_prev_total_run_time);
+
+  if (xTaskCreate(profilerTask, "profiler", PROFILER_TASK_STACK_SIZE, NULL, PROFILER_TASK_PRIORITY, NULL) != pdPASS){
+    ESP_LOGE(TAG_PROFILER, "Failed to create profiler task");
+    return ESP_ERR_NO_MEM;
+  }
+  return ESP_OK;
+}
+
+
+void profilerGetReport(profiler_report * ptr_report){
+  /**
+   * Copy the latest report
+   *
+   * @param ptr_report: destination of the copy, the report is about 1.5 kB and should not be placed on a small stack
+   */
+
+  if (!s_report_mutex){
+    memset(ptr_report, 0, sizeof(profiler_report));
+    return;
+  }
+
+  xSemaphoreTake(s_report_mutex, portMAX_DELAY);
+  *ptr_report = s_obj_report;
+  xSemaphoreGive(s_report_mutex);
+}
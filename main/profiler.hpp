@@ -0,0 +1,46 @@
+/*********
+ *
+ * profiler
+ * Task runtime profiler. A low priority task samples the FreeRTOS run time counters once per second and derives
+ * CPU load per task and core, stack high water marks and context switch rates. Requires
+ * CONFIG_FREERTOS_USE_TRACE_FACILITY and CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS, context switches are counted by
+ * the trace hook in profiler_trace.h.
+ *
+*********/
+
+#ifndef PROFILER_h
+#define PROFILER_h
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+#define PROFILER_MAX_TASKS 32           // size of the task table, tasks beyond are not profiled
+#define PROFILER_SAMPLE_PERIOD_MS 1000  // sample period of the run time counters
+#define PROFILER_WINDOW_CNT 3           // number of averaging windows
+#define PROFILER_WINDOWS_S {1, 10, 60}  // averaging windows in seconds
+#define PROFILER_SWITCH_SLOTS 64        // context switch counters, indexed by task number modulo slots
+#define PROFILER_TASK_NAME_LEN 16       // equals CONFIG_FREERTOS_MAX_TASK_NAME_LEN
+
+struct profiler_task_info {
+  char strName[PROFILER_TASK_NAME_LEN];
+  uint32_t iTaskNumber;                     // unique task number of FreeRTOS
+  uint8_t iState;                           // eTaskState
+  uint8_t iPriority;                        // actual priority
+  int8_t iCore;                             // core affinity, -1 if not pinned
+  uint32_t iStackFreeBytes;                 // stack high water mark
+  float arrCpuPercent[PROFILER_WINDOW_CNT]; // CPU load in percent of one core
+  float fSwitchesPerSec;                    // context switches averaged over the second window
+};
+
+struct profiler_report {
+  int64_t iTimeUs;                                              // monotonic time of the latest sample
+  float arrCoreLoad[portNUM_PROCESSORS][PROFILER_WINDOW_CNT];  // load per core in percent
+  int iTaskCnt;
+  profiler_task_info arrTasks[PROFILER_MAX_TASKS];
+};
+
+esp_err_t profilerStart();
+void profilerGetReport(profiler_report * ptr_report);
+
+#endif
@@ -0,0 +1,23 @@
+/*********
+ *
+ * profiler_trace
+ * FreeRTOS trace hook of the task profiler. The project CMakeLists includes this header into every C translation
+ * unit, so the hook replaces the empty default of FreeRTOS.h. Only tasks.c expands the macro, pxCurrentTCB and
+ * uxTCBNumber (configUSE_TRACE_FACILITY) are visible there.
+ *
+*********/
+
+#ifndef PROFILER_TRACE_h
+#define PROFILER_TRACE_h
+
+#ifndef __ASSEMBLER__
+
+#include <stdint.h>
+
+void profilerTaskSwitchedIn(uint32_t i_task_number);
+
+#define traceTASK_SWITCHED_IN() profilerTaskSwitchedIn(pxCurrentTCB[xPortGetCoreID()]->uxTCBNumber)
+
+#endif
+
+#endif
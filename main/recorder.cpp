@@ -0,0 +1,201 @@
+/*********
+ *
+ * recorder
+ * File output of the control loop, see recorder.hpp
+ *
+*********/
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include "recorder.hpp"
+#include "measurement.hpp"
+#include "brew.hpp"
+#include "metrics.hpp"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+static const char * TAG_RECORDER = "recorder";
+
+static const char * s_str_meas_path = NULL;
+static meas_sample s_arr_block[RECORDER_BLOCK_SAMPLES];
+static uint32_t s_i_next_seq = 0;           // sequence number of the next sample to write
+static uint32_t s_i_written = 0;            // samples written since boot
+static uint32_t s_i_lost = 0;               // samples overwritten in the ring before they were written
+static recorder_save_fn s_fn_save_config = NULL;
+static QueueHandle_t s_h_shot_queue = NULL;
+static TaskHandle_t s_h_recorder_task = NULL;
+
+
+static void appendSamples(FILE * obj_file){
+  /**
+   * Write all samples which were pushed since the previous call and flush the file
+   *
+   * @param obj_file: measurement file, NULL if it could not be opened (samples are only kept in RAM)
+   */
+
+  uint32_t i_first_seq;
+  int i_cnt;
+  bool b_written = false;
+
+  while ((i_cnt = measCopyFrom(s_i_next_seq, s_arr_block, RECORDER_BLOCK_SAMPLES, &i_first_seq)) > 0){
+    s_i_lost += i_first_seq - s_i_next_seq;
+    s_i_next_seq = i_first_seq + i_cnt;
+    if (!obj_file){
+      continue;
+    }
+
+    for (int i_idx = 0; i_idx < i_cnt; i_idx++){
+      const meas_sample & obj_sample = s_arr_block[i_idx];
+      fprintf(obj_file, "%lld.%06lld,%.3f,%.1f,%d,%u,%u\n", obj_sample.iTimeUs / 1000000LL,
+              obj_sample.iTimeUs % 1000000LL, obj_sample.fTemperature, obj_sample.fTargetPwm, obj_sample.iRawValue,
+              obj_sample.iIsrCount, obj_sample.iRange);
+    }
+    s_i_written += i_cnt;
+    b_written = true;
+  }
+
+  if (b_written){
+    fflush(obj_file);
+  }
+}
+
+
+static void appendShots(){
+  /**
+   * Append the statistics of the queued shots to the shot file
+   */
+
+  brew_shot obj_shot;
+  struct stat obj_stat;
+
+  if (uxQueueMessagesWaiting(s_h_shot_queue) == 0){
+    return;
+  }
+
+  bool b_new_file = stat(BREW_SHOT_FILE_PATH, &obj_stat) != 0;
+  FILE * obj_file = fopen(BREW_SHOT_FILE_PATH, "a");
+
+  if (!obj_file){
+    ESP_LOGE(TAG_RECORDER, "Failed to open shot file");
+    xQueueReset(s_h_shot_queue);
+    return;
+  }
+  if (b_new_file){
+    fprintf(obj_file, "Shot,Start,Trigger,Duration,StartTemperature,MinTemperature,Dip,Recovery,BoostIntegral\n");
+  }
+  while (xQueueReceive(s_h_shot_queue, &obj_shot, 0) == pdTRUE){
+    fprintf(obj_file, "%u,%.3f,%s,%.1f,%.2f,%.2f,%.2f,%.1f,%.0f\n", obj_shot.iShotNumber, obj_shot.fStartS,
+            obj_shot.bSwitchTriggered ? "switch" : "slope", obj_shot.fDurationS, obj_shot.fStartTemp,
+            obj_shot.fMinTemp, obj_shot.fDip, obj_shot.fRecoveryS, obj_shot.fBoostIntegral);
+  }
+  fclose(obj_file);
+}
+
+
+static void recorderTask(void * ptr_params){
+  /**
+   * Recorder task: wake up once per period or on a request and write what the measurement task produced in the
+   * meantime. A configuration save which fails (configuration file locked) is retried in the next period.
+   */
+
+  FILE * obj_file = fopen(s_str_meas_path, "a");
+  bool b_save_pending = false;
+
+  if (!obj_file){
+    ESP_LOGE(TAG_RECORDER, "Failed to open measurement file, samples are only kept in RAM");
+  }
+
+  for (;;){
+    uint32_t i_events = 0;
+    xTaskNotifyWait(0, UINT32_MAX, &i_events, pdMS_TO_TICKS(RECORDER_PERIOD_MS));
+    appendSamples(obj_file);
+    appendShots();
+
+    b_save_pending |= (i_events & RECORDER_EVENT_SAVE_CONFIG) != 0;
+    if (b_save_pending && s_fn_save_config){
+      b_save_pending = (s_fn_save_config() != ESP_OK);
+      if (b_save_pending){
+        ESP_LOGW(TAG_RECORDER, "Configuration file is locked, saving is retried");
+      }
+    }
+  }
+}
+
+
+esp_err_t recorderStart(const char * str_meas_path, recorder_save_fn fn_save_config){
+  /**
+   * Start the recorder task, called once on startup after the measurement file is created
+   *
+   * @param str_meas_path: measurement file, new samples are appended
+   * @param fn_save_config: writes the configuration file, called on recorderRequestConfigSave()
+   * @return: ESP_ERR_INVALID_STATE if already running, ESP_ERR_NO_MEM if the task can not be created
+   */
+
+  if (s_h_recorder_task){
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  s_str_meas_path = str_meas_path;
+  s_fn_save_config = fn_save_config;
+  s_i_next_seq = measGetCount();
+
+  s_h_shot_queue = xQueueCreate(RECORDER_SHOT_QUEUE_LEN, sizeof(brew_shot));
+  if (!s_h_shot_queue){
+    return ESP_ERR_NO_MEM;
+  }
+  if (xTaskCreate(recorderTask, "recorder", RECORDER_TASK_STACK_SIZE, NULL, RECORDER_TASK_PRIORITY,
+                  &s_h_recorder_task) != pdPASS){
+    return ESP_ERR_NO_MEM;
+  }
+  return ESP_OK;
+}
+
+
+esp_err_t recorderRequestConfigSave(){
+  /**
+   * Let the recorder task save the configuration, returns at once. Used by the measurement task, which must not wait
+   * for the flash or the JSON arena.
+   *
+   * @return: ESP_ERR_INVALID_STATE if the recorder is not running
+   */
+
+  if (!s_h_recorder_task){
+    return ESP_ERR_INVALID_STATE;
+  }
+  xTaskNotify(s_h_recorder_task, RECORDER_EVENT_SAVE_CONFIG, eSetBits);
+  return ESP_OK;
+}
+
+
+esp_err_t recorderPushShot(const brew_shot & obj_shot){
+  /**
+   * Queue the statistics of a finished shot for the shot file, returns at once
+   *
+   * @param obj_shot: shot statistics
+   * @return: ESP_ERR_INVALID_STATE if the recorder is not running, ESP_ERR_NO_MEM if the queue is full
+   */
+
+  if (!s_h_shot_queue){
+    return ESP_ERR_INVALID_STATE;
+  }
+  return (xQueueSend(s_h_shot_queue, &obj_shot, 0) == pdTRUE) ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+
+static double getWrittenSamples(){ return s_i_written; }
+static double getLostSamples(){ return s_i_lost; }
+
+
+void recorderRegisterMetrics(){
+  /**
+   * Register the metrics of the recorder
+   */
+
+  metricsRegister("coffee_recorder_samples_total", "Samples written to the measurement file", METRIC_TYPE_COUNTER,
+                  getWrittenSamples);
+  metricsRegister("coffee_recorder_lost_samples_total",
+                  "Samples overwritten in the ring before the recorder wrote them", METRIC_TYPE_COUNTER,
+                  getLostSamples);
+}
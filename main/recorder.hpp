@@ -0,0 +1,36 @@
+/*********
+ *
+ * recorder
+ * File output of the control loop. LittleFS flushes and block erases stall the writer for tens of milliseconds, so the
+ * measurement task only pushes its samples into the measurement ring. A low priority task appends the new samples of
+ * the ring to the measurement file once per period and flushes it. The recorder reads the ring at its own position,
+ * samples which were overwritten before it got to them are counted as lost.
+ * Other flash writes of the measurement task are done by the recorder as well: the statistics of finished shots are
+ * queued and appended to the shot file, and the configuration is saved after auto tuning.
+ *
+*********/
+
+#ifndef RECORDER_h
+#define RECORDER_h
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "BrewDetector.hpp"
+
+#define RECORDER_TASK_STACK_SIZE 4096
+#define RECORDER_TASK_PRIORITY 3          // below control and network tasks, above the LED engine
+#define RECORDER_PERIOD_MS 1000           // the measurement file is appended and flushed once per period
+#define RECORDER_BLOCK_SAMPLES 32         // samples copied from the ring per step
+#define RECORDER_SHOT_QUEUE_LEN 4         // finished shots waiting for the shot file
+
+// notification bits of the recorder task
+#define RECORDER_EVENT_SAVE_CONFIG (1 << 0)
+
+typedef esp_err_t (*recorder_save_fn)();
+
+esp_err_t recorderStart(const char * str_meas_path, recorder_save_fn fn_save_config);
+esp_err_t recorderRequestConfigSave();
+esp_err_t recorderPushShot(const brew_shot & obj_shot);
+void recorderRegisterMetrics();
+
+#endif
@@ -0,0 +1,120 @@
+/*********
+ *
+ * scan
+ * Auxiliary analog channels, see scan.hpp
+ *
+*********/
+
+#include <string.h>
+#include "scan.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char * TAG_SCAN = "scan";
+
+static ADS1115Scanner s_obj_scanner;
+static scan_report s_obj_report;
+static portMUX_TYPE s_scan_mux = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t s_h_scan_task = NULL;
+static esp_timer_handle_t s_h_scan_timer = NULL;
+
+
+static void scanTimerCallback(void * ptr_arg){
+  xTaskNotifyGive(s_h_scan_task);
+}
+
+
+static void scanTask(void * ptr_params){
+  /**
+   * Scan task: let the scheduler process the due devices, publish the results and sleep until the next deadline.
+   * Deadlines are in microseconds, the esp_timer wakes the task independent of the tick rate.
+   */
+
+  s_obj_scanner.start();
+
+  for (;;){
+    int64_t i_next_us = s_obj_scanner.service();
+
+    taskENTER_CRITICAL(&s_scan_mux);
+    for (int i_ch=0; i_ch<s_obj_report.iChannelCnt; i_ch++){
+      s_obj_scanner.getResult(i_ch, &s_obj_report.arrResults[i_ch]);
+    }
+    s_obj_report.iCycleCnt = s_obj_scanner.getCycleCount();
+    s_obj_report.iCycleTimeUs = s_obj_scanner.getCycleTimeUs();
+    taskEXIT_CRITICAL(&s_scan_mux);
+
+    int64_t i_wait_us = i_next_us - esp_timer_get_time();
+    if (i_wait_us > 0){
+      esp_timer_start_once(s_h_scan_timer, i_wait_us);
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+  }
+}
+
+
+esp_err_t scanSetup(ADS1115Transport * ptr_transport, const scan_channel * arr_channels, int i_channel_cnt,
+                    uint32_t i_period_us){
+  /**
+   * Set up the channel table and start the scan task, called once on startup
+   *
+   * @param ptr_transport: initialized I2C transport, shared with the boiler temperature device
+   * @param arr_channels: channel table
+   * @param i_channel_cnt: number of channels
+   * @param i_period_us: period of the scan cycles, 0 for back-to-back cycles
+   * @return: ESP_ERR_INVALID_ARG for an invalid channel table, ESP_ERR_INVALID_STATE if already running
+   */
+
+  ads1115_scan_channel arr_adc[ADS1115_SCAN_MAX_CHANNELS];
+
+  if (s_h_scan_task){
+    return ESP_ERR_INVALID_STATE;
+  }
+  if (i_channel_cnt > ADS1115_SCAN_MAX_CHANNELS){
+    return ESP_ERR_INVALID_ARG;
+  }
+  for (int i_ch=0; i_ch<i_channel_cnt; i_ch++){
+    arr_adc[i_ch] = arr_channels[i_ch].objAdc;
+  }
+
+  s_obj_scanner.setTransport(ptr_transport);
+  if (!s_obj_scanner.setChannels(arr_adc, i_channel_cnt)){
+    return ESP_ERR_INVALID_ARG;
+  }
+  s_obj_scanner.setCyclePeriodUs(i_period_us);
+
+  memset(&s_obj_report, 0, sizeof(s_obj_report));
+  s_obj_report.iChannelCnt = i_channel_cnt;
+  s_obj_report.iCyclePeriodUs = i_period_us;
+  for (int i_ch=0; i_ch<i_channel_cnt; i_ch++){
+    strlcpy(s_obj_report.arrNames[i_ch], arr_channels[i_ch].strName, SCAN_NAME_LEN);
+  }
+
+  esp_timer_create_args_t obj_timer_args = {};
+  obj_timer_args.callback = scanTimerCallback;
+  obj_timer_args.dispatch_method = ESP_TIMER_TASK;
+  obj_timer_args.name = "scan";
+  esp_err_t esp_ret = esp_timer_create(&obj_timer_args, &s_h_scan_timer);
+  if (esp_ret != ESP_OK){
+    return esp_ret;
+  }
+
+  xTaskCreate(scanTask, "scan", SCAN_TASK_STACK_SIZE, NULL, SCAN_TASK_PRIORITY, &s_h_scan_task);
+  ESP_LOGI(TAG_SCAN, "Scanning %d channels on %d devices, period %u us", i_channel_cnt,
+           s_obj_scanner.getDeviceCount(), i_period_us);
+  return ESP_OK;
+}
+
+
+void scanGetReport(scan_report * ptr_report){
+  /**
+   * Copy of the latest results
+   *
+   * @param ptr_report: destination, iChannelCnt is 0 if the scan is not active
+   */
+
+  taskENTER_CRITICAL(&s_scan_mux);
+  *ptr_report = s_obj_report;
+  taskEXIT_CRITICAL(&s_scan_mux);
+}
@@ -0,0 +1,40 @@
+/*********
+ *
+ * scan
+ * Auxiliary analog channels on further ADS1115 of the I2C bus, e.g. group head temperature, pressure transducer and
+ * a reference voltage. The scan scheduler of the driver round-robins the channels, a task wakes up at its microsecond
+ * deadlines with an esp_timer. The boiler temperature keeps its own device in continuous mode with ALERT/RDY, the
+ * scanned channels must use other addresses.
+ *
+*********/
+
+#ifndef SCAN_h
+#define SCAN_h
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "ADS111x_scan.hpp"
+
+#define SCAN_TASK_STACK_SIZE 3072
+#define SCAN_TASK_PRIORITY 9        // below the measurement task
+#define SCAN_NAME_LEN 16
+
+struct scan_channel {
+  const char * strName;
+  ads1115_scan_channel objAdc;
+};
+
+struct scan_report {
+  int iChannelCnt;
+  char arrNames[ADS1115_SCAN_MAX_CHANNELS][SCAN_NAME_LEN];
+  ads1115_scan_result arrResults[ADS1115_SCAN_MAX_CHANNELS];
+  uint32_t iCycleCnt;
+  uint32_t iCycleTimeUs;      // duration of the latest cycle
+  uint32_t iCyclePeriodUs;
+};
+
+esp_err_t scanSetup(ADS1115Transport * ptr_transport, const scan_channel * arr_channels, int i_channel_cnt,
+                    uint32_t i_period_us);
+void scanGetReport(scan_report * ptr_report);
+
+#endif
@@ -0,0 +1,287 @@
+// Canvas line chart and gauge of the web interface, served gzipped from flash so that the pages render without
+// internet access (soft-AP mode). The line chart keeps its points in typed arrays and reduces them to one min/max
+// bucket per pixel column: a new point updates a single bucket, a redraw costs the plot width and not the point count.
+
+function LineChart(obj_canvas, dct_options) {
+  // dct_options: title, x_title, capacity, series [{name, color, axis}], axes [{title, min, max, step}]
+  this.obj_canvas = obj_canvas;
+  this.dct_options = dct_options;
+  this.i_capacity = dct_options.capacity || 50000;
+  this.arr_x = new Float64Array(this.i_capacity);
+  this.lst_y = dct_options.series.map(() => new Float32Array(this.i_capacity));
+  this.i_count = 0;
+  this.f_x_min = 0;
+  this.f_x_max = 1;
+  this.b_draw_pending = false;
+  this.i_margin_left = 55;
+  this.i_margin_right = (dct_options.axes.length > 1) ? 55 : 15;
+  this.i_margin_top = 45;
+  this.i_margin_bottom = 40;
+  this.resize();
+  window.addEventListener("resize", () => { this.resize(); this.requestDraw(); });
+}
+
+LineChart.prototype.resize = function() {
+  // match the canvas to its CSS size, the buckets are rebuilt for the new plot width
+  var f_ratio = window.devicePixelRatio || 1;
+  this.obj_canvas.width = Math.round(this.obj_canvas.clientWidth * f_ratio);
+  this.obj_canvas.height = Math.round(this.obj_canvas.clientHeight * f_ratio);
+  this.f_ratio = f_ratio;
+  this.i_width = Math.max(1, Math.round(this.obj_canvas.clientWidth - this.i_margin_left - this.i_margin_right));
+  this.i_height = Math.max(1, Math.round(this.obj_canvas.clientHeight - this.i_margin_top - this.i_margin_bottom));
+  this.lst_buckets = this.dct_options.series.map(() => ({
+    min: new Float32Array(this.i_width),
+    max: new Float32Array(this.i_width),
+    first: new Float32Array(this.i_width),
+    last: new Float32Array(this.i_width),
+    used: new Uint8Array(this.i_width)
+  }));
+  this.rebuild();
+};
+
+LineChart.prototype.rebuild = function() {
+  // fill the buckets from all points, needed after a change of the x range or the plot width
+  for (var obj_bucket of this.lst_buckets) {
+    obj_bucket.used.fill(0);
+  }
+  for (var i = 0; i < this.i_count; i++) {
+    this.addToBucket(i);
+  }
+};
+
+LineChart.prototype.addToBucket = function(i_point) {
+  var i_col = Math.floor((this.arr_x[i_point] - this.f_x_min) / (this.f_x_max - this.f_x_min) * (this.i_width - 1));
+  i_col = Math.min(Math.max(i_col, 0), this.i_width - 1);
+
+  for (var i_series = 0; i_series < this.lst_y.length; i_series++) {
+    var f_y = this.lst_y[i_series][i_point];
+    var obj_bucket = this.lst_buckets[i_series];
+    if (isNaN(f_y)) {
+      continue;
+    }
+    if (!obj_bucket.used[i_col]) {
+      obj_bucket.used[i_col] = 1;
+      obj_bucket.min[i_col] = f_y;
+      obj_bucket.max[i_col] = f_y;
+      obj_bucket.first[i_col] = f_y;
+    } else {
+      obj_bucket.min[i_col] = Math.min(obj_bucket.min[i_col], f_y);
+      obj_bucket.max[i_col] = Math.max(obj_bucket.max[i_col], f_y);
+    }
+    obj_bucket.last[i_col] = f_y;
+  }
+};
+
+LineChart.prototype.append = function(f_x, lst_values) {
+  // add a point, x has to increase; the oldest tenth is dropped when the capacity is reached
+  var b_rebuild = false;
+
+  if (this.i_count == this.i_capacity) {
+    var i_drop = Math.ceil(this.i_capacity / 10);
+    this.arr_x.copyWithin(0, i_drop, this.i_count);
+    for (var arr_y of this.lst_y) {
+      arr_y.copyWithin(0, i_drop, this.i_count);
+    }
+    this.i_count -= i_drop;
+    this.f_x_min = this.arr_x[0];
+    b_rebuild = true;
+  }
+  if (this.i_count == 0) {
+    this.f_x_min = f_x;
+    this.f_x_max = f_x + 1;
+  }
+
+  this.arr_x[this.i_count] = f_x;
+  for (var i_series = 0; i_series < this.lst_y.length; i_series++) {
+    this.lst_y[i_series][this.i_count] = lst_values[i_series];
+  }
+  this.i_count++;
+
+  if (f_x > this.f_x_max) {
+    // x range grows with a quarter headroom, the buckets are only rebuilt when it is used up
+    this.f_x_max = this.f_x_min + (f_x - this.f_x_min) * 1.25;
+    b_rebuild = true;
+  }
+  if (b_rebuild) {
+    this.rebuild();
+  } else {
+    this.addToBucket(this.i_count - 1);
+  }
+  this.requestDraw();
+};
+
+LineChart.prototype.getLastX = function() {
+  return (this.i_count > 0) ? this.arr_x[this.i_count - 1] : -Infinity;
+};
+
+LineChart.prototype.requestDraw = function() {
+  // several appends within one frame are drawn once
+  if (!this.b_draw_pending) {
+    this.b_draw_pending = true;
+    window.requestAnimationFrame(() => { this.b_draw_pending = false; this.draw(); });
+  }
+};
+
+LineChart.prototype.draw = function() {
+  var obj_ctx = this.obj_canvas.getContext("2d");
+  var i_left = this.i_margin_left;
+  var i_top = this.i_margin_top;
+  var i_bottom = i_top + this.i_height;
+
+  obj_ctx.setTransform(this.f_ratio, 0, 0, this.f_ratio, 0, 0);
+  obj_ctx.clearRect(0, 0, this.obj_canvas.clientWidth, this.obj_canvas.clientHeight);
+  obj_ctx.font = "12px sans-serif";
+  obj_ctx.lineWidth = 1;
+
+  // title and legend
+  obj_ctx.fillStyle = "#000";
+  obj_ctx.textAlign = "left";
+  obj_ctx.fillText(this.dct_options.title || "", i_left, 15);
+  var i_legend_x = i_left;
+  for (var obj_series of this.dct_options.series) {
+    obj_ctx.fillStyle = obj_series.color;
+    obj_ctx.fillRect(i_legend_x, 26, 12, 4);
+    obj_ctx.fillStyle = "#000";
+    obj_ctx.fillText(obj_series.name, i_legend_x + 16, 32);
+    i_legend_x += 24 + obj_ctx.measureText(obj_series.name).width;
+  }
+
+  // y axes with grid of the first axis
+  for (var i_axis = 0; i_axis < this.dct_options.axes.length; i_axis++) {
+    var obj_axis = this.dct_options.axes[i_axis];
+    var f_step = obj_axis.step || (obj_axis.max - obj_axis.min) / 10;
+    var i_x = (i_axis == 0) ? i_left - 5 : i_left + this.i_width + 5;
+    obj_ctx.textAlign = (i_axis == 0) ? "right" : "left";
+    obj_ctx.fillStyle = "#000";
+    for (var f_tick = obj_axis.min; f_tick <= obj_axis.max + f_step / 2; f_tick += f_step) {
+      var i_y = Math.round(this.toY(f_tick, obj_axis)) + 0.5;
+      obj_ctx.fillText(+f_tick.toFixed(1), i_x, i_y + 4);
+      if (i_axis == 0) {
+        obj_ctx.strokeStyle = "#e0e0e0";
+        obj_ctx.beginPath();
+        obj_ctx.moveTo(i_left, i_y);
+        obj_ctx.lineTo(i_left + this.i_width, i_y);
+        obj_ctx.stroke();
+      }
+    }
+    obj_ctx.save();
+    obj_ctx.translate((i_axis == 0) ? 12 : this.obj_canvas.clientWidth - 4, i_top + this.i_height / 2);
+    obj_ctx.rotate(-Math.PI / 2);
+    obj_ctx.textAlign = "center";
+    obj_ctx.fillText(obj_axis.title || "", 0, 0);
+    obj_ctx.restore();
+  }
+
+  // x axis
+  obj_ctx.textAlign = "center";
+  var f_x_step = this.getTickStep((this.f_x_max - this.f_x_min) / 8);
+  for (var f_tick = Math.ceil(this.f_x_min / f_x_step) * f_x_step; f_tick <= this.f_x_max; f_tick += f_x_step) {
+    var i_x = i_left + (f_tick - this.f_x_min) / (this.f_x_max - this.f_x_min) * (this.i_width - 1);
+    obj_ctx.fillText(+f_tick.toFixed(1), i_x, i_bottom + 15);
+  }
+  obj_ctx.fillText(this.dct_options.x_title || "", i_left + this.i_width / 2, i_bottom + 32);
+  obj_ctx.strokeStyle = "#888";
+  obj_ctx.strokeRect(i_left + 0.5, i_top + 0.5, this.i_width, this.i_height);
+
+  // one vertical min/max stroke per used column, consecutive columns are connected
+  obj_ctx.save();
+  obj_ctx.beginPath();
+  obj_ctx.rect(i_left, i_top, this.i_width, this.i_height);
+  obj_ctx.clip();
+  for (var i_series = 0; i_series < this.lst_buckets.length; i_series++) {
+    var obj_bucket = this.lst_buckets[i_series];
+    var obj_axis = this.dct_options.axes[this.dct_options.series[i_series].axis || 0];
+    var b_started = false;
+
+    obj_ctx.strokeStyle = this.dct_options.series[i_series].color;
+    obj_ctx.lineWidth = 1.5;
+    obj_ctx.beginPath();
+    for (var i_col = 0; i_col < this.i_width; i_col++) {
+      if (!obj_bucket.used[i_col]) {
+        continue;
+      }
+      var i_x = i_left + i_col + 0.5;
+      if (b_started) {
+        obj_ctx.lineTo(i_x, this.toY(obj_bucket.first[i_col], obj_axis));
+      } else {
+        obj_ctx.moveTo(i_x, this.toY(obj_bucket.first[i_col], obj_axis));
+        b_started = true;
+      }
+      if (obj_bucket.min[i_col] != obj_bucket.max[i_col]) {
+        obj_ctx.lineTo(i_x, this.toY(obj_bucket.min[i_col], obj_axis));
+        obj_ctx.lineTo(i_x, this.toY(obj_bucket.max[i_col], obj_axis));
+      }
+      obj_ctx.lineTo(i_x, this.toY(obj_bucket.last[i_col], obj_axis));
+    }
+    obj_ctx.stroke();
+  }
+  obj_ctx.restore();
+};
+
+LineChart.prototype.toY = function(f_value, obj_axis) {
+  return this.i_margin_top + (1 - (f_value - obj_axis.min) / (obj_axis.max - obj_axis.min)) * this.i_height;
+};
+
+LineChart.prototype.getTickStep = function(f_raw_step) {
+  // 1, 2 or 5 times a power of ten
+  var f_power = Math.pow(10, Math.floor(Math.log10(Math.max(f_raw_step, 1e-9))));
+  var f_norm = f_raw_step / f_power;
+  return ((f_norm <= 1) ? 1 : (f_norm <= 2) ? 2 : (f_norm <= 5) ? 5 : 10) * f_power;
+};
+
+
+function Gauge(obj_canvas, dct_options) {
+  // dct_options: label, min, max, suffix, digits, bands [{from, to, color}]
+  this.obj_canvas = obj_canvas;
+  this.dct_options = dct_options;
+  this.f_value = dct_options.min;
+  this.draw();
+}
+
+Gauge.prototype.setValue = function(f_value, lst_bands) {
+  this.f_value = f_value;
+  if (lst_bands) {
+    this.dct_options.bands = lst_bands;
+  }
+  this.draw();
+};
+
+Gauge.prototype.draw = function() {
+  var obj_ctx = this.obj_canvas.getContext("2d");
+  var dct_opt = this.dct_options;
+  var f_size = Math.min(this.obj_canvas.width, this.obj_canvas.height);
+  var f_cx = this.obj_canvas.width / 2;
+  var f_cy = this.obj_canvas.height / 2;
+  var f_radius = f_size / 2 - 6;
+  var f_start = 0.75 * Math.PI;
+  var f_span = 1.5 * Math.PI;
+  var toAngle = (f_value) => f_start + f_span * Math.min(Math.max((f_value - dct_opt.min) / (dct_opt.max - dct_opt.min), 0), 1);
+
+  obj_ctx.clearRect(0, 0, this.obj_canvas.width, this.obj_canvas.height);
+  obj_ctx.lineWidth = f_radius * 0.15;
+  obj_ctx.strokeStyle = "#eee";
+  obj_ctx.beginPath();
+  obj_ctx.arc(f_cx, f_cy, f_radius * 0.9, f_start, f_start + f_span);
+  obj_ctx.stroke();
+  for (var obj_band of (dct_opt.bands || [])) {
+    obj_ctx.strokeStyle = obj_band.color;
+    obj_ctx.beginPath();
+    obj_ctx.arc(f_cx, f_cy, f_radius * 0.9, toAngle(obj_band.from), toAngle(obj_band.to));
+    obj_ctx.stroke();
+  }
+
+  // needle
+  var f_angle = toAngle(this.f_value);
+  obj_ctx.strokeStyle = "#c63";
+  obj_ctx.lineWidth = 3;
+  obj_ctx.beginPath();
+  obj_ctx.moveTo(f_cx, f_cy);
+  obj_ctx.lineTo(f_cx + Math.cos(f_angle) * f_radius * 0.8, f_cy + Math.sin(f_angle) * f_radius * 0.8);
+  obj_ctx.stroke();
+
+  obj_ctx.fillStyle = "#333";
+  obj_ctx.textAlign = "center";
+  obj_ctx.font = Math.round(f_radius * 0.2) + "px sans-serif";
+  obj_ctx.fillText(dct_opt.label || "", f_cx, f_cy - f_radius * 0.3);
+  obj_ctx.fillText(this.f_value.toFixed(dct_opt.digits || 0) + (dct_opt.suffix || ""), f_cx, f_cy + f_radius * 0.55);
+};
@@ -0,0 +1,76 @@
+// Decoder of the binary WebSocket channel /ws, frame layout see telemetry.hpp of the firmware. All values are little endian.
+
+const TELEMETRY_FRAME_SAMPLES = 0x01;
+const TELEMETRY_FRAME_ACK = 0x02;
+const TELEMETRY_CMD_SETPOINT = 0x10;
+const TELEMETRY_CMD_GAINS = 0x11;
+const TELEMETRY_HEADER_LEN = 16;
+const TELEMETRY_SAMPLE_LEN = 16;
+const TELEMETRY_RESULTS = ["ok", "invalid", "busy", "denied"];
+const TELEMETRY_FAULT_ACTIONS = ["none", "cap", "limp", "off"];
+
+var obj_telemetry_ws = null;
+
+function telemetryConnect(fn_on_samples, fn_on_ack) {
+  // open the channel, it is reopened after a connection loss
+  obj_telemetry_ws = new WebSocket("ws://" + window.location.host + "/ws");
+  obj_telemetry_ws.binaryType = "arraybuffer";
+
+  obj_telemetry_ws.onmessage = function(obj_event) {
+    var obj_view = new DataView(obj_event.data);
+    var i_type = obj_view.getUint8(0);
+
+    if (i_type == TELEMETRY_FRAME_SAMPLES) {
+      var obj_frame = {
+        seq: obj_view.getUint32(4, true),
+        target: obj_view.getFloat32(8, true),
+        fault_action: TELEMETRY_FAULT_ACTIONS[obj_view.getUint8(12)],
+        samples: []
+      };
+      var i_count = obj_view.getUint16(2, true);
+
+      for (var i = 0; i < i_count; i++) {
+        var i_pos = TELEMETRY_HEADER_LEN + i * TELEMETRY_SAMPLE_LEN;
+        obj_frame.samples.push({
+          time_s: obj_view.getUint32(i_pos, true) / 1000,
+          temperature: obj_view.getFloat32(i_pos + 4, true),
+          target_pwm: obj_view.getFloat32(i_pos + 8, true),
+          raw: obj_view.getInt16(i_pos + 12, true),
+          range: obj_view.getUint8(i_pos + 14),
+          fault_bits: obj_view.getUint8(i_pos + 15)
+        });
+      }
+      fn_on_samples(obj_frame);
+    } else if (i_type == TELEMETRY_FRAME_ACK && fn_on_ack) {
+      fn_on_ack(obj_view.getUint8(1), TELEMETRY_RESULTS[obj_view.getUint8(2)]);
+    }
+  };
+
+  obj_telemetry_ws.onclose = function() {
+    setTimeout(function() { telemetryConnect(fn_on_samples, fn_on_ack); }, 2000);
+  };
+}
+
+function telemetrySend(i_type, lst_values) {
+  // command frame: type, 3 reserved bytes, float values
+  if (!obj_telemetry_ws || obj_telemetry_ws.readyState != WebSocket.OPEN) {
+    return false;
+  }
+  var obj_buf = new ArrayBuffer(4 + 4 * lst_values.length);
+  var obj_view = new DataView(obj_buf);
+
+  obj_view.setUint8(0, i_type);
+  for (var i = 0; i < lst_values.length; i++) {
+    obj_view.setFloat32(4 + 4 * i, lst_values[i], true);
+  }
+  obj_telemetry_ws.send(obj_buf);
+  return true;
+}
+
+function telemetrySendSetpoint(f_target) {
+  return telemetrySend(TELEMETRY_CMD_SETPOINT, [f_target]);
+}
+
+function telemetrySendGains(f_prop, f_int, f_dif) {
+  return telemetrySend(TELEMETRY_CMD_GAINS, [f_prop, f_int, f_dif]);
+}
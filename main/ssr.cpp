@@ -0,0 +1,243 @@
+/*********
+ *
+ * ssr
+ * Output stage of the heater, see ssr.hpp
+ *
+*********/
+
+#include "ssr.hpp"
+#include "BurstFire.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "driver/ledc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char * TAG_SSR = "ssr";
+
+static BurstFire s_obj_burst;
+static ssr_config s_obj_config = {SSR_MODE_PWM, GPIO_NUM_NC, GPIO_NUM_NC, 15, 8, 50};
+static esp_timer_handle_t s_h_half_wave_timer = NULL;
+static uint32_t s_i_half_wave_us = 10000;
+static volatile uint32_t s_i_last_zc_us = 0;    // time of the latest accepted zero-cross pulse, wraps after 71 min
+static volatile uint32_t s_i_zc_period_us = 0;  // interval between the latest two pulses
+static volatile uint32_t s_i_zc_cnt = 0;
+static volatile bool s_b_zc_lost = false;
+
+
+static void switchHalfWave(){
+  /**
+   * Gate of the coming half-wave, the zero crossing SSR latches it at the next crossing. Not placed in IRAM: the
+   * callees (gpio_set_level, BurstFire) live in flash and the ISR service is installed without ESP_INTR_FLAG_IRAM,
+   * so the handlers are deferred while the flash cache is disabled.
+   */
+
+  gpio_set_level(s_obj_config.iOutputPin, s_obj_burst.nextHalfWave() ? 1 : 0);
+}
+
+
+static void zeroCrossIsr(void * ptr_arg){
+  /**
+   * Pulse of the zero-cross detector, arrives shortly before the crossing
+   */
+
+  uint32_t i_now_us = (uint32_t)esp_timer_get_time();
+  uint32_t i_period_us = i_now_us - s_i_last_zc_us;
+
+  if (i_period_us < s_i_half_wave_us / SSR_ZC_DEBOUNCE_DIV){
+    return;
+  }
+  s_i_zc_period_us = i_period_us;
+  s_i_last_zc_us = i_now_us;
+  s_i_zc_cnt++;
+
+  if (!s_b_zc_lost){
+    switchHalfWave();
+  }
+}
+
+
+static void halfWaveTimerCallback(void * ptr_arg){
+  switchHalfWave();
+}
+
+
+static esp_err_t setupPwm(){
+  /**
+   * Legacy output: LEDC PWM with SsrFreq, not aligned to the mains
+   */
+
+  ledc_timer_config_t conf_ssr_timer;
+  conf_ssr_timer.speed_mode       = LEDC_HIGH_SPEED_MODE;
+  conf_ssr_timer.timer_num        = SSR_LEDC_TIMER;
+  conf_ssr_timer.duty_resolution  = (ledc_timer_bit_t)s_obj_config.iResolution;
+  conf_ssr_timer.freq_hz          = s_obj_config.iPwmFreq;
+  conf_ssr_timer.clk_cfg          = LEDC_AUTO_CLK;
+
+  esp_err_t esp_ret = ledc_timer_config(&conf_ssr_timer);
+  if (esp_ret != ESP_OK){
+    return esp_ret;
+  }
+
+  ledc_channel_config_t conf_ssr_channel;
+  conf_ssr_channel.channel  = SSR_LEDC_CHANNEL;
+  conf_ssr_channel.duty = 0;
+  conf_ssr_channel.gpio_num = s_obj_config.iOutputPin;
+  conf_ssr_channel.speed_mode = LEDC_HIGH_SPEED_MODE;
+  conf_ssr_channel.hpoint = 0;
+  conf_ssr_channel.timer_sel = SSR_LEDC_TIMER;
+  conf_ssr_channel.intr_type = LEDC_INTR_DISABLE;
+  conf_ssr_channel.flags.output_invert = 0;
+
+  return ledc_channel_config(&conf_ssr_channel);
+}
+
+
+static esp_err_t setupBurst(){
+  /**
+   * Burst fire output: plain GPIO switched once per half-wave by the timer or the zero-cross interrupt
+   */
+
+  gpio_config_t conf_out_pin;
+  conf_out_pin.pin_bit_mask = (1ULL << s_obj_config.iOutputPin);
+  conf_out_pin.mode = GPIO_MODE_OUTPUT;
+  conf_out_pin.pull_up_en = GPIO_PULLUP_DISABLE;
+  conf_out_pin.pull_down_en = GPIO_PULLDOWN_DISABLE;
+  conf_out_pin.intr_type = GPIO_INTR_DISABLE;
+  esp_err_t esp_ret = gpio_config(&conf_out_pin);
+  gpio_set_level(s_obj_config.iOutputPin, 0);
+
+  if (esp_ret == ESP_OK && s_h_half_wave_timer == NULL){
+    esp_timer_create_args_t conf_timer;
+    conf_timer.callback = halfWaveTimerCallback;
+    conf_timer.arg = NULL;
+    conf_timer.dispatch_method = ESP_TIMER_TASK;
+    conf_timer.name = "ssr";
+    conf_timer.skip_unhandled_events = false;
+    esp_ret = esp_timer_create(&conf_timer, &s_h_half_wave_timer);
+  }
+  if (esp_ret != ESP_OK){
+    return esp_ret;
+  }
+
+  if (s_obj_config.iMode == SSR_MODE_BURST){
+    // the timer is not synchronised to the mains, polarity of the half-waves is unknown
+    s_obj_burst.setDcBalance(false);
+    return esp_timer_start_periodic(s_h_half_wave_timer, s_i_half_wave_us);
+  }
+
+  gpio_config_t conf_zc_pin;
+  conf_zc_pin.pin_bit_mask = (1ULL << s_obj_config.iZeroCrossPin);
+  conf_zc_pin.mode = GPIO_MODE_INPUT;
+  // the detector drives the line, input only pins have no internal pulls anyway
+  conf_zc_pin.pull_up_en = GPIO_PULLUP_DISABLE;
+  conf_zc_pin.pull_down_en = GPIO_PULLDOWN_DISABLE;
+  conf_zc_pin.intr_type = GPIO_INTR_POSEDGE;
+  esp_ret = gpio_config(&conf_zc_pin);
+  if (esp_ret != ESP_OK){
+    return esp_ret;
+  }
+
+  // the service may already be installed by another module
+  esp_ret = gpio_install_isr_service(0);
+  if (esp_ret != ESP_OK && esp_ret != ESP_ERR_INVALID_STATE){
+    return esp_ret;
+  }
+  s_i_last_zc_us = (uint32_t)esp_timer_get_time();
+  return gpio_isr_handler_add(s_obj_config.iZeroCrossPin, zeroCrossIsr, NULL);
+}
+
+
+esp_err_t ssrSetup(const ssr_config & obj_config){
+  /**
+   * Configure the heater output, called once on startup
+   *
+   * @param obj_config: output mode and pins
+   * @return: result of the peripheral configuration
+   */
+
+  s_obj_config = obj_config;
+  s_obj_config.iMode = (obj_config.iMode < SSR_MODE_CNT) ? obj_config.iMode : SSR_MODE_PWM;
+  s_i_half_wave_us = 500000 / ((obj_config.iMainsFreq > 0) ? obj_config.iMainsFreq : 50);
+
+  s_obj_burst.setResolution((1 << s_obj_config.iResolution) - 1);
+  s_obj_burst.setLevel(0);
+  s_obj_burst.setDcBalance(s_obj_config.iMode == SSR_MODE_BURST_ZC);
+  s_obj_burst.reset();
+
+  esp_err_t esp_ret = (s_obj_config.iMode == SSR_MODE_PWM) ? setupPwm() : setupBurst();
+  if (esp_ret != ESP_OK){
+    ESP_LOGE(TAG_SSR, "Failed to configure heater output (%s)", esp_err_to_name(esp_ret));
+  }
+  return esp_ret;
+}
+
+
+static void superviseZeroCross(){
+  /**
+   * Switch the half-wave clock to the timer while the zero-cross pulses are missing and back on their return
+   */
+
+  uint32_t i_since_zc_us = (uint32_t)esp_timer_get_time() - s_i_last_zc_us;
+  bool b_timeout = i_since_zc_us > SSR_ZC_TIMEOUT_HALF_WAVES * s_i_half_wave_us;
+
+  if (b_timeout && !s_b_zc_lost){
+    ESP_LOGW(TAG_SSR, "No zero-cross pulses, heater output falls back to the free-running timer");
+    s_b_zc_lost = true;
+    s_obj_burst.setDcBalance(false);
+    esp_timer_start_periodic(s_h_half_wave_timer, s_i_half_wave_us);
+  } else if (!b_timeout && s_b_zc_lost){
+    ESP_LOGI(TAG_SSR, "Zero-cross pulses are back");
+    esp_timer_stop(s_h_half_wave_timer);
+    s_obj_burst.setDcBalance(true);
+    s_b_zc_lost = false;
+  }
+}
+
+
+void ssrSetDuty(float f_duty){
+  /**
+   * Set the heater power
+   *
+   * @param f_duty: duty in steps of the resolution (manipulated variable of the controller). In burst fire mode it
+   *                is the number of on half-waves per 2^resolution - 1 half-waves.
+   */
+
+  float f_max_duty = (float)((1 << s_obj_config.iResolution) - 1);
+
+  f_duty = (f_duty > f_max_duty) ? f_max_duty : f_duty;
+  f_duty = (f_duty < 0.F) ? 0.F : f_duty;
+
+  if (s_obj_config.iMode == SSR_MODE_PWM){
+    ledc_set_duty(LEDC_HIGH_SPEED_MODE, SSR_LEDC_CHANNEL, (uint32_t)f_duty);
+    ledc_update_duty(LEDC_HIGH_SPEED_MODE, SSR_LEDC_CHANNEL);
+    return;
+  }
+
+  // a single word, taken over by the next half-wave
+  s_obj_burst.setLevel((uint32_t)(f_duty + 0.5F));
+
+  if (s_obj_config.iMode == SSR_MODE_BURST_ZC){
+    superviseZeroCross();
+  }
+}
+
+
+void ssrGetStats(ssr_stats * ptr_stats){
+  /**
+   * Counters of the output stage
+   *
+   * @param ptr_stats: statistics, half-wave counters are 0 in PWM mode
+   */
+
+  uint32_t i_zc_period_us = s_i_zc_period_us;
+
+  ptr_stats->iMode = s_obj_config.iMode;
+  ptr_stats->iLevel = s_obj_burst.getLevel();
+  ptr_stats->iHalfWaves = s_obj_burst.getHalfWaveCount();
+  ptr_stats->iOnHalfWaves = s_obj_burst.getOnCount();
+  ptr_stats->iZeroCrossCnt = s_i_zc_cnt;
+  ptr_stats->bZeroCrossLost = s_b_zc_lost;
+  ptr_stats->fMainsFreq = (s_obj_config.iMode == SSR_MODE_BURST_ZC && !s_b_zc_lost && i_zc_period_us > 0) ?
+                          500000.F / i_zc_period_us : 0.F;
+}
@@ -0,0 +1,55 @@
+/*********
+ *
+ * ssr
+ * Output stage of the heater. The solid state relay is driven either by a LEDC PWM (legacy) or by the burst fire
+ * driver, which switches whole mains half-waves: N of M half-waves are on, M is the full scale of the manipulated
+ * variable. The half-wave clock is the zero-cross detector input, or a free-running timer at twice the mains frequency.
+ * The timer is not synchronised to the mains: the SSR still switches at crossings, but the gate may change during a
+ * half-wave and the polarity is unknown, so the DC balance of the burst pattern is off in that mode. A zero-cross input
+ * that stops pulsing falls back to the unsynchronised timer until the pulses return.
+ *
+*********/
+
+#ifndef SSR_h
+#define SSR_h
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+
+#define SSR_LEDC_CHANNEL LEDC_CHANNEL_3   // PWM channel of the SSR (legacy mode)
+#define SSR_LEDC_TIMER LEDC_TIMER_1
+#define SSR_ZC_TIMEOUT_HALF_WAVES 10      // zero-cross input is lost after this number of missing pulses
+#define SSR_ZC_DEBOUNCE_DIV 4             // pulses closer than a quarter half-wave to the previous one are ignored
+
+enum eSsrMode {
+  SSR_MODE_PWM,           // LEDC PWM with SsrFreq, not aligned to the mains
+  SSR_MODE_BURST,         // burst fire, half-wave clock from a free-running timer (unsynchronised, no DC balance)
+  SSR_MODE_BURST_ZC,      // burst fire, half-wave clock from the zero-cross detector
+  SSR_MODE_CNT
+};
+
+struct ssr_config {
+  uint32_t iMode;               // eSsrMode
+  gpio_num_t iOutputPin;
+  gpio_num_t iZeroCrossPin;     // pulse before each zero crossing, used in SSR_MODE_BURST_ZC
+  uint32_t iPwmFreq;            // Hz, SSR_MODE_PWM
+  uint32_t iResolution;         // bits, full scale of the manipulated variable is 2^iResolution - 1
+  uint32_t iMainsFreq;          // Hz, nominal mains frequency
+};
+
+struct ssr_stats {
+  uint32_t iMode;
+  uint32_t iLevel;              // on half-waves per burst period
+  uint32_t iHalfWaves;          // half-waves since setup
+  uint32_t iOnHalfWaves;
+  uint32_t iZeroCrossCnt;       // accepted zero-cross pulses
+  float fMainsFreq;             // measured by the zero-cross input, 0 if not available
+  bool bZeroCrossLost;          // half-wave clock fell back to the timer
+};
+
+esp_err_t ssrSetup(const ssr_config & obj_config);
+void ssrSetDuty(float f_duty);
+void ssrGetStats(ssr_stats * ptr_stats);
+
+#endif
@@ -0,0 +1,165 @@
+/*********
+ *
+ * telemetry
+ * Binary frames of the WebSocket channel, see telemetry.hpp
+ *
+*********/
+
+#include <math.h>
+#include <string.h>
+#include "telemetry.hpp"
+#include "measurement.hpp"
+#include "fault.hpp"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static meas_sample s_arr_samples[TELEMETRY_MAX_SAMPLES];
+static int64_t s_i_sent_time_us = 0;       // time stamp of the latest broadcast sample
+static uint32_t s_i_frame_seq = 0;
+static volatile float s_f_target = 0.F;
+static bool s_b_write_enable = false;
+static float s_f_target_max = TELEMETRY_TARGET_MIN;
+
+static telemetry_command s_obj_command;
+static bool s_b_command_pending = false;
+static portMUX_TYPE s_telemetry_mux = portMUX_INITIALIZER_UNLOCKED;
+
+
+void telemetrySetup(bool b_write_enable, float f_over_temp){
+  /**
+   * Access of the command channel, called on startup before the web server runs
+   *
+   * @param b_write_enable: accept setpoint and gain commands of the clients
+   * @param f_over_temp: over temperature limit of the fault manager in °C, setpoints are capped
+   *                     TELEMETRY_TARGET_MARGIN below it
+   */
+
+  s_b_write_enable = b_write_enable;
+  s_f_target_max = f_over_temp - TELEMETRY_TARGET_MARGIN;
+}
+
+
+void telemetrySetTarget(float f_target){
+  /**
+   * Target of the controller reported in the sample frames
+   *
+   * @param f_target: target temperature in °C
+   */
+
+  s_f_target = f_target;
+}
+
+
+int telemetryEncodeSamples(uint8_t * ptr_buf, int i_buf_size){
+  /**
+   * Pack the samples which were added since the previous frame, called by the web server for every broadcast. The
+   * frame is encoded once and sent to all clients.
+   *
+   * @param ptr_buf: destination, at least TELEMETRY_FRAME_MAX_LEN bytes
+   * @param i_buf_size: size of the destination
+   * @return: frame length in bytes, 0 if there is no new sample
+   */
+
+  if (i_buf_size < (int)TELEMETRY_FRAME_MAX_LEN){
+    return 0;
+  }
+
+  int i_cnt = measCopySince(s_i_sent_time_us, s_arr_samples, TELEMETRY_MAX_SAMPLES);
+  if (i_cnt == 0){
+    return 0;
+  }
+  s_i_sent_time_us = s_arr_samples[i_cnt - 1].iTimeUs;
+
+  telemetry_header obj_header = {};
+  obj_header.iType = TELEMETRY_FRAME_SAMPLES;
+  obj_header.iVersion = TELEMETRY_VERSION;
+  obj_header.iCount = (uint16_t)i_cnt;
+  obj_header.iSeq = s_i_frame_seq++;
+  obj_header.fTarget = s_f_target;
+  obj_header.iFaultAction = (uint8_t)faultGetAction();
+  memcpy(ptr_buf, &obj_header, sizeof(obj_header));
+
+  telemetry_sample * ptr_sample = (telemetry_sample *)(ptr_buf + sizeof(obj_header));
+  for (int i_idx = 0; i_idx < i_cnt; i_idx++, ptr_sample++){
+    ptr_sample->iTimeMs = (uint32_t)(s_arr_samples[i_idx].iTimeUs / 1000);
+    ptr_sample->fTemperature = s_arr_samples[i_idx].fTemperature;
+    ptr_sample->fTargetPwm = s_arr_samples[i_idx].fTargetPwm;
+    ptr_sample->iRawValue = s_arr_samples[i_idx].iRawValue;
+    ptr_sample->iRange = s_arr_samples[i_idx].iRange;
+    ptr_sample->iFaultBits = s_arr_samples[i_idx].iFaultBits;
+  }
+
+  return sizeof(obj_header) + i_cnt * sizeof(telemetry_sample);
+}
+
+
+int telemetryPostCommand(const uint8_t * ptr_payload, int i_len){
+  /**
+   * Check a command frame of a client and hand it to the measurement task
+   *
+   * @param ptr_payload: binary frame
+   * @param i_len: frame length in bytes
+   * @return: TELEMETRY_RESULT_*
+   */
+
+  telemetry_command obj_cmd = {};
+
+  if (!s_b_write_enable){
+    return TELEMETRY_RESULT_DENIED;
+  }
+
+  int i_values = (i_len - TELEMETRY_CMD_HEADER_LEN) / (int)sizeof(float);
+  if (i_len > (int)sizeof(obj_cmd) || i_values < 1 || i_len != TELEMETRY_CMD_HEADER_LEN + i_values * (int)sizeof(float)){
+    return TELEMETRY_RESULT_INVALID;
+  }
+  memcpy(&obj_cmd, ptr_payload, i_len);
+
+  for (int i_idx = 0; i_idx < i_values; i_idx++){
+    if (!isfinite(obj_cmd.arrValues[i_idx]) || obj_cmd.arrValues[i_idx] < 0.F){
+      return TELEMETRY_RESULT_INVALID;
+    }
+  }
+
+  if (obj_cmd.iType == TELEMETRY_CMD_SETPOINT){
+    if (i_values != 1 || obj_cmd.arrValues[0] < TELEMETRY_TARGET_MIN || obj_cmd.arrValues[0] > s_f_target_max){
+      return TELEMETRY_RESULT_INVALID;
+    }
+  } else if (obj_cmd.iType != TELEMETRY_CMD_GAINS || i_values != 3){
+    return TELEMETRY_RESULT_INVALID;
+  }
+
+  int i_result = TELEMETRY_RESULT_OK;
+
+  taskENTER_CRITICAL(&s_telemetry_mux);
+  if (s_b_command_pending){
+    i_result = TELEMETRY_RESULT_BUSY;
+  } else {
+    s_obj_command = obj_cmd;
+    s_b_command_pending = true;
+  }
+  taskEXIT_CRITICAL(&s_telemetry_mux);
+
+  return i_result;
+}
+
+
+bool telemetryTakeCommand(telemetry_command * ptr_cmd){
+  /**
+   * Fetch a pending command, called by the measurement task before the controller update
+   *
+   * @param ptr_cmd: destination of the command
+   * @return: true if a command was pending
+   */
+
+  bool b_pending;
+
+  taskENTER_CRITICAL(&s_telemetry_mux);
+  b_pending = s_b_command_pending;
+  if (b_pending){
+    *ptr_cmd = s_obj_command;
+    s_b_command_pending = false;
+  }
+  taskEXIT_CRITICAL(&s_telemetry_mux);
+
+  return b_pending;
+}
@@ -0,0 +1,79 @@
+/*********
+ *
+ * telemetry
+ * Binary frames of the WebSocket channel /ws. The web server broadcasts the new samples of the measurement ring as
+ * one packed frame to all connected clients, clients send setpoint and gain commands which the measurement task
+ * applies with its next sample. The channel has no authentication: commands are refused unless write access is enabled
+ * in the configuration (CtrlRemoteWrite), and setpoints stay well below the over temperature limit of the fault
+ * manager. All values are little endian, as on the ESP32 and in the browser DataView decoder.
+ *
+*********/
+
+#ifndef TELEMETRY_h
+#define TELEMETRY_h
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#define TELEMETRY_VERSION 1
+#define TELEMETRY_PERIOD_MS 100             // broadcast interval of the sample frames
+#define TELEMETRY_MAX_SAMPLES 64            // samples per frame, the latest are sent if more are pending
+#define TELEMETRY_TARGET_MIN 20.F           // lowest accepted setpoint in °C
+#define TELEMETRY_TARGET_MARGIN 20.F        // K, highest accepted setpoint below the over temperature limit
+
+// frame types, server to client
+#define TELEMETRY_FRAME_SAMPLES 0x01
+#define TELEMETRY_FRAME_ACK 0x02
+
+// frame types, client to server
+#define TELEMETRY_CMD_SETPOINT 0x10         // value 0: target in °C
+#define TELEMETRY_CMD_GAINS 0x11            // values 0..2: proportional, integral and differential factor
+
+// result of a command in the acknowledge frame
+#define TELEMETRY_RESULT_OK 0
+#define TELEMETRY_RESULT_INVALID 1          // unknown type, wrong length or value out of range
+#define TELEMETRY_RESULT_BUSY 2             // previous command not yet applied
+#define TELEMETRY_RESULT_DENIED 3           // write access is disabled in the configuration
+
+struct __attribute__((packed)) telemetry_header {
+  uint8_t iType;            // TELEMETRY_FRAME_SAMPLES
+  uint8_t iVersion;         // TELEMETRY_VERSION
+  uint16_t iCount;          // samples following the header
+  uint32_t iSeq;            // frame counter, gaps show frames the client missed
+  float fTarget;            // target of the controller
+  uint8_t iFaultAction;     // eFaultAction of the heater
+  uint8_t arrReserved[3];
+};
+
+struct __attribute__((packed)) telemetry_sample {
+  uint32_t iTimeMs;         // monotonic time stamp in ms since boot
+  float fTemperature;
+  float fTargetPwm;
+  int16_t iRawValue;
+  uint8_t iRange;
+  uint8_t iFaultBits;       // MEAS_FAULT_*
+};
+
+struct __attribute__((packed)) telemetry_ack {
+  uint8_t iType;            // TELEMETRY_FRAME_ACK
+  uint8_t iCmd;             // type of the acknowledged command
+  uint8_t iResult;          // TELEMETRY_RESULT_*
+  uint8_t iReserved;
+};
+
+struct __attribute__((packed)) telemetry_command {
+  uint8_t iType;            // TELEMETRY_CMD_*
+  uint8_t arrReserved[3];
+  float arrValues[3];       // a setpoint command carries the first value only
+};
+
+#define TELEMETRY_CMD_HEADER_LEN 4          // type and reserved bytes before the values of a command
+#define TELEMETRY_FRAME_MAX_LEN (sizeof(telemetry_header) + TELEMETRY_MAX_SAMPLES * sizeof(telemetry_sample))
+
+void telemetrySetup(bool b_write_enable, float f_over_temp);
+void telemetrySetTarget(float f_target);
+int telemetryEncodeSamples(uint8_t * ptr_buf, int i_buf_size);
+int telemetryPostCommand(const uint8_t * ptr_payload, int i_len);
+bool telemetryTakeCommand(telemetry_command * ptr_cmd);
+
+#endif
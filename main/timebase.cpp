@@ -0,0 +1,170 @@
+/*********
+ *
+ * timebase
+ * Monotonic time base for measurement samples, see timebase.hpp
+ *
+*********/
+
+#include <stdio.h>
+#include <time.h>
+#include <sys/time.h>
+#include "timebase.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_sntp.h"
+#include "freertos/FreeRTOS.h"
+
+static time_anchor s_arr_anchors[TIMEBASE_ANCHOR_TABLE_SIZE];
+static int s_i_anchor_cnt = 0;  // number of valid anchors
+static int s_i_anchor_idx = -1; // index of the latest anchor
+static portMUX_TYPE s_anchor_mux = portMUX_INITIALIZER_UNLOCKED;
+
+
+static void onTimeSync(struct timeval * tv){
+  /**
+   * SNTP callback, called on every (re-)synchronization of the system time
+   */
+
+  timebaseAddAnchor();
+
+  char char_timestamp[64];
+  timebaseFormat(timebaseGetMonoUs(), char_timestamp, sizeof(char_timestamp));
+  ESP_LOGI("time", "System time synchronized, the current time is %s", char_timestamp);
+}
+
+
+void timebaseInit(){
+  /**
+   * Register SNTP callback to record wall clock anchors. Must be called before sntp_init().
+   */
+
+  sntp_set_time_sync_notification_cb(onTimeSync);
+}
+
+
+int64_t timebaseGetMonoUs(){
+  /**
+   * @return: monotonic time in us since boot, independent of SNTP
+   */
+
+  return esp_timer_get_time();
+}
+
+
+void timebaseAddAnchor(){
+  /**
+   * Record actual wall clock time together with the monotonic time as new anchor
+   */
+
+  struct timeval obj_tv;
+
+  int64_t i_mono_before = esp_timer_get_time();
+  gettimeofday(&obj_tv, NULL);
+  int64_t i_mono_after = esp_timer_get_time();
+
+  time_anchor obj_anchor;
+  // take the middle of the two readouts to cancel the call duration of gettimeofday
+  obj_anchor.iMonoUs = i_mono_before + (i_mono_after - i_mono_before) / 2;
+  obj_anchor.iEpochUs = (int64_t)obj_tv.tv_sec * 1000000LL + obj_tv.tv_usec;
+
+  portENTER_CRITICAL(&s_anchor_mux);
+  s_i_anchor_idx = (s_i_anchor_idx + 1) % TIMEBASE_ANCHOR_TABLE_SIZE;
+  s_arr_anchors[s_i_anchor_idx] = obj_anchor;
+  if (s_i_anchor_cnt < TIMEBASE_ANCHOR_TABLE_SIZE){
+    s_i_anchor_cnt++;
+  }
+  portEXIT_CRITICAL(&s_anchor_mux);
+}
+
+
+bool timebaseIsSynced(){
+  /**
+   * @return: true if at least one wall clock anchor is available
+   */
+
+  return s_i_anchor_cnt > 0;
+}
+
+
+bool timebaseMonoToEpochUs(int64_t i_mono_us, int64_t * ptr_epoch_us){
+  /**
+   * Convert monotonic time to wall clock time. The latest anchor which is not younger than the given time is used,
+   * times before the oldest anchor are converted with the oldest anchor.
+   *
+   * @param i_mono_us: monotonic time in us since boot
+   * @param ptr_epoch_us: wall clock in us since 1970-01-01 UTC
+   * @return: false if no anchor is available yet
+   */
+
+  bool b_success = false;
+  time_anchor obj_anchor;
+
+  portENTER_CRITICAL(&s_anchor_mux);
+  if (s_i_anchor_cnt > 0){
+    // walk backwards from the latest anchor
+    int i_idx = s_i_anchor_idx;
+    for (int i_step = 0; i_step < s_i_anchor_cnt; i_step++){
+      obj_anchor = s_arr_anchors[i_idx];
+      if (obj_anchor.iMonoUs <= i_mono_us){
+        break;
+      }
+      i_idx = (i_idx + TIMEBASE_ANCHOR_TABLE_SIZE - 1) % TIMEBASE_ANCHOR_TABLE_SIZE;
+    }
+    b_success = true;
+  }
+  portEXIT_CRITICAL(&s_anchor_mux);
+
+  if (b_success){
+    *ptr_epoch_us = obj_anchor.iEpochUs + (i_mono_us - obj_anchor.iMonoUs);
+  }
+  return b_success;
+}
+
+
+size_t timebaseFormat(int64_t i_mono_us, char * char_buf, size_t i_buf_size){
+  /**
+   * Format a monotonic time stamp as local time string. If the time is not synchronized yet, the time since boot is
+   * printed instead.
+   *
+   * @param i_mono_us: monotonic time in us since boot
+   * @param char_buf: destination buffer
+   * @param i_buf_size: size of the destination buffer
+   * @return: number of characters written
+   */
+
+  int64_t i_epoch_us;
+
+  if (timebaseMonoToEpochUs(i_mono_us, &i_epoch_us)){
+    struct tm obj_timeinfo = {};
+    time_t obj_time = (time_t)(i_epoch_us / 1000000LL);
+    localtime_r(&obj_time, &obj_timeinfo);
+    return strftime(char_buf, i_buf_size, "%c", &obj_timeinfo);
+  }
+
+  int i_ret = snprintf(char_buf, i_buf_size, "%lld.%06lld s after boot (not synchronized)",
+                       i_mono_us / 1000000LL, i_mono_us % 1000000LL);
+  return (i_ret < 0) ? 0 : (size_t)i_ret;
+}
+
+
+int timebaseGetAnchors(time_anchor * arr_anchors, int i_max_anchors){
+  /**
+   * Copy anchor table, oldest anchor first
+   *
+   * @param arr_anchors: destination array
+   * @param i_max_anchors: size of the destination array
+   * @return: number of copied anchors
+   */
+
+  int i_cnt;
+
+  portENTER_CRITICAL(&s_anchor_mux);
+  i_cnt = (s_i_anchor_cnt < i_max_anchors) ? s_i_anchor_cnt : i_max_anchors;
+  for (int i_step = 0; i_step < i_cnt; i_step++){
+    int i_idx = (s_i_anchor_idx - i_cnt + 1 + i_step + TIMEBASE_ANCHOR_TABLE_SIZE) % TIMEBASE_ANCHOR_TABLE_SIZE;
+    arr_anchors[i_step] = s_arr_anchors[i_idx];
+  }
+  portEXIT_CRITICAL(&s_anchor_mux);
+
+  return i_cnt;
+}
@@ -0,0 +1,32 @@
+/*********
+ *
+ * timebase
+ * Monotonic time base for measurement samples. Samples are stamped with the 64-bit esp_timer value, a sparse table of
+ * wall clock anchors is recorded whenever SNTP (re-)synchronizes, so monotonic time stamps can be converted lazily on
+ * export.
+ *
+*********/
+
+#ifndef TIMEBASE_h
+#define TIMEBASE_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TIMEBASE_ANCHOR_TABLE_SIZE 32 // number of stored wall clock anchors, oldest is overwritten
+
+// pair of monotonic time and wall clock time taken at the same moment
+struct time_anchor {
+  int64_t iMonoUs;  // esp_timer time in us since boot
+  int64_t iEpochUs; // wall clock in us since 1970-01-01 UTC
+};
+
+void timebaseInit();
+int64_t timebaseGetMonoUs();
+void timebaseAddAnchor();
+bool timebaseIsSynced();
+bool timebaseMonoToEpochUs(int64_t i_mono_us, int64_t * ptr_epoch_us);
+size_t timebaseFormat(int64_t i_mono_us, char * char_buf, size_t i_buf_size);
+int timebaseGetAnchors(time_anchor * arr_anchors, int i_max_anchors);
+
+#endif
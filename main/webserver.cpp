@@ -1,8 +1,11 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <sys/param.h>
 #include <sys/unistd.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <dirent.h>
 
 #include "esp_err.h"
@@ -11,6 +14,20 @@
 #include "esp_vfs.h"
 #include "esp_littlefs.h"
 #include "esp_http_server.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "lwip/sockets.h"
+
+#include "timebase.hpp"
+#include "metrics.hpp"
+#include "profiler.hpp"
+#include "autotune.hpp"
+#include "brew.hpp"
+#include "measurement.hpp"
+#include "scan.hpp"
+#include "fault.hpp"
+#include "telemetry.hpp"
+#include "assets.hpp"
 
 
 #define FILE_PATH_MAX (ESP_VFS_PATH_MAX + CONFIG_LITTLEFS_OBJ_NAME_LEN)
@@ -18,6 +35,46 @@
 #define MAX_FILE_SIZE_STR "200KB"
 
 #define SCRATCH_BUFSIZE  8192
+#define ADC_RAW_MAX_VALUES 1024  // raw conversions per response, fits into the scratch buffer
+
+/* Downloads read whole LittleFS blocks, which bypass the file cache and go
+ * from flash directly into the scratch buffer. A chunk must fit into the
+ * TCP send buffer, then the send returns as soon as lwIP has queued it and
+ * the next block is read while the previous one is still on the wire */
+#define LITTLEFS_BLOCK_SIZE 4096
+#define DOWNLOAD_CHUNK_SIZE MIN(SCRATCH_BUFSIZE, (CONFIG_LWIP_TCP_SND_BUF_DEFAULT >= LITTLEFS_BLOCK_SIZE) ?                 \
+                                (CONFIG_LWIP_TCP_SND_BUF_DEFAULT / LITTLEFS_BLOCK_SIZE * LITTLEFS_BLOCK_SIZE) :               \
+                                (CONFIG_LWIP_TCP_SND_BUF_DEFAULT / CONFIG_LITTLEFS_READ_SIZE * CONFIG_LITTLEFS_READ_SIZE))
+
+/* Uploads are written to a temporary file in whole blocks and renamed
+ * when complete */
+#define LITTLEFS_PARTITION_LABEL "littlefs"
+#define UPLOAD_TEMP_NAME "/.upload.tmp"
+#define UPLOAD_WRITE_SIZE (SCRATCH_BUFSIZE / LITTLEFS_BLOCK_SIZE * LITTLEFS_BLOCK_SIZE)
+#define UPLOAD_FS_RESERVE (4*LITTLEFS_BLOCK_SIZE)  // LittleFS metadata and copy-on-write blocks
+#define UPLOAD_LOG_PERIOD_US (2*1000000LL)         // progress log interval, the log goes to flash as well
+
+/* The JSON directory listing keeps the names and sizes of one directory,
+ * stat() of every entry walks the LittleFS directory again. Files appended
+ * by the logging tasks don't change the directory mtime, therefore the
+ * cache also expires after a short time */
+#define DIR_CACHE_MAX_ENTRIES 256
+#define DIR_CACHE_MAX_AGE_US (10*1000000LL)
+#define DIR_LIST_DEFAULT_LIMIT 100
+#define DIR_LIST_ENTRY_MAX_LEN (6*CONFIG_LITTLEFS_OBJ_NAME_LEN + 64)  // fully escaped name and the fields
+
+/* Connection tuning, the socket pool is sized from the free heap at start.
+ * lwIP needs 3 sockets for itself, the httpd control socket and the listener */
+#define HTTPD_SOCKETS_MIN 7
+#define HTTPD_SOCKETS_MAX (CONFIG_LWIP_MAX_SOCKETS - 3)
+#define HTTPD_SOCKET_HEAP_COST (12*1024)  // session, receive buffers and TCP control block per connection
+#define HTTPD_HEAP_RESERVE (64*1024)      // kept free for the controller, WiFi and TLS-less OTA
+#define HTTPD_STACK_SIZE 6144             // handlers format JSON with snprintf on the stack
+#define HTTPD_TIMEOUT_S 5                 // receive and send timeout of the short requests
+#define HTTPD_TRANSFER_TIMEOUT_S 30       // file up- and downloads over a weak WiFi link
+#define HTTPD_KEEPALIVE_IDLE_S 10         // TCP keep-alive detects dashboards which disappeared
+#define HTTPD_KEEPALIVE_INTERVAL_S 5
+#define HTTPD_KEEPALIVE_COUNT 3
 
 struct file_server_data {
     /* Base path of file storage */
@@ -29,34 +86,752 @@ struct file_server_data {
 
 static const char *TAG = "webserver";
 
-/* Handler to redirect incoming GET request for /index.html to /
- * This can be overridden by uploading file with same name */
-static esp_err_t index_html_get_handler(httpd_req_t *req)
+/* Request statistics per registered URI handler, exposed on /metrics */
+struct uri_stats {
+    const char *uri;
+    int timeout_s;          /* socket timeout while handling, 0 for the server default */
+    uint32_t requests;
+    uint32_t errors;
+    uint64_t latency_sum_us;
+};
+
+enum {
+    URI_STATS_TIMEBASE,
+    URI_STATS_METRICS,
+    URI_STATS_PROFILER,
+    URI_STATS_AUTOTUNE_STATUS,
+    URI_STATS_AUTOTUNE_CMD,
+    URI_STATS_SHOTS,
+    URI_STATS_ADC_RAW,
+    URI_STATS_SCAN,
+    URI_STATS_FAULTS,
+    URI_STATS_FAULTS_CMD,
+    URI_STATS_WS,
+    URI_STATS_DOWNLOAD,
+    URI_STATS_UPLOAD,
+    URI_STATS_DELETE,
+    URI_STATS_COUNT
+};
+
+static struct uri_stats s_uri_stats[URI_STATS_COUNT] = {
+    {"/timebase.json", 0, 0, 0, 0},
+    {"/metrics", 0, 0, 0, 0},
+    {"/profiler.json", 0, 0, 0, 0},
+    {"/autotune.json", 0, 0, 0, 0},
+    {"/autotune/*", 0, 0, 0, 0},
+    {"/shots.json", 0, 0, 0, 0},
+    {"/adc_raw.json", 0, 0, 0, 0},
+    {"/scan.json", 0, 0, 0, 0},
+    {"/faults.json", 0, 0, 0, 0},
+    {"/faults/*", 0, 0, 0, 0},
+    {"/ws", 0, 0, 0, 0},
+    {"/*", HTTPD_TRANSFER_TIMEOUT_S, 0, 0, 0},
+    {"/upload/*", HTTPD_TRANSFER_TIMEOUT_S, 0, 0, 0},
+    {"/delete/*", 0, 0, 0, 0},
+};
+
+static httpd_handle_t s_server = NULL;
+static int s_socket_limit = 0;
+
+/* Set the receive and send timeout of the socket of a request */
+static void set_request_timeout(httpd_req_t *req, int timeout_s)
 {
-    httpd_resp_set_status(req, "307 Temporary Redirect");
-    httpd_resp_set_hdr(req, "Location", "/");
-    httpd_resp_send(req, NULL, 0);  // Response body can be empty
-    return ESP_OK;
+    struct timeval timeout = { .tv_sec = timeout_s, .tv_usec = 0 };
+    int sockfd = httpd_req_to_sockfd(req);
+
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(sockfd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+/* Define a wrapper of a URI handler which counts requests and errors
+ * and accumulates the handling time. Handlers with an own timeout get
+ * it for the duration of the request, the socket stays open afterwards
+ * for the next request of the client */
+#define URI_STATS_HANDLER(handler, idx)                                 \
+static esp_err_t handler##_with_stats(httpd_req_t *req)                 \
+{                                                                       \
+    int64_t start = esp_timer_get_time();                               \
+    if (s_uri_stats[idx].timeout_s) {                                   \
+        set_request_timeout(req, s_uri_stats[idx].timeout_s);           \
+    }                                                                   \
+    esp_err_t ret = handler(req);                                       \
+    if (s_uri_stats[idx].timeout_s) {                                   \
+        set_request_timeout(req, HTTPD_TIMEOUT_S);                      \
+    }                                                                   \
+    s_uri_stats[idx].requests++;                                        \
+    s_uri_stats[idx].errors += (ret != ESP_OK);                         \
+    s_uri_stats[idx].latency_sum_us += esp_timer_get_time() - start;    \
+    return ret;                                                         \
 }
 
-/* Handler to respond with an icon file embedded in flash.
- * Browsers expect to GET website icon at URI /favicon.png.
- * This can be overridden by uploading file with same name */
-static esp_err_t favicon_get_handler(httpd_req_t *req)
+static void collect_uri_requests(const char *name)
 {
-    extern const unsigned char favicon_png_start[] asm("_binary_favicon_png_start");
-    extern const unsigned char favicon_png_end[]   asm("_binary_favicon_png_end");
-    const size_t favicon_png_size = (favicon_png_end - favicon_png_start);
-    httpd_resp_set_type(req, "image/x-icon");
-    httpd_resp_send(req, (const char *)favicon_png_start, favicon_png_size);
-    return ESP_OK;
+    char labels[48];
+    for (int i = 0; i < URI_STATS_COUNT; i++) {
+        snprintf(labels, sizeof(labels), "uri=\"%s\"", s_uri_stats[i].uri);
+        metricsWriteSample(name, labels, s_uri_stats[i].requests);
+    }
+}
+
+static void collect_uri_errors(const char *name)
+{
+    char labels[48];
+    for (int i = 0; i < URI_STATS_COUNT; i++) {
+        snprintf(labels, sizeof(labels), "uri=\"%s\"", s_uri_stats[i].uri);
+        metricsWriteSample(name, labels, s_uri_stats[i].errors);
+    }
+}
+
+static void collect_uri_latency(const char *name)
+{
+    char labels[48];
+    for (int i = 0; i < URI_STATS_COUNT; i++) {
+        snprintf(labels, sizeof(labels), "uri=\"%s\"", s_uri_stats[i].uri);
+        metricsWriteSample("coffee_http_request_duration_seconds_sum", labels, s_uri_stats[i].latency_sum_us / 1e6);
+        metricsWriteSample("coffee_http_request_duration_seconds_count", labels, s_uri_stats[i].requests);
+    }
+}
+
+static double get_open_sockets(void)
+{
+    size_t fds = HTTPD_SOCKETS_MAX;
+    int client_fds[HTTPD_SOCKETS_MAX];
+
+    if (!s_server || httpd_get_client_list(s_server, &fds, client_fds) != ESP_OK) {
+        return 0;
+    }
+    return fds;
+}
+
+static double get_socket_limit(void)
+{
+    return s_socket_limit;
+}
+
+/* Handler to respond with a file of the web interface bundle. The pages
+ * render in soft-AP mode without internet access and without files on
+ * LittleFS. Browsers revalidate with the ETag and get a 304 as long as
+ * the firmware is unchanged */
+static esp_err_t embedded_asset_send(httpd_req_t *req, const struct web_asset *asset)
+{
+    char etag[12];
+    char if_none_match[12];
+    char accept_encoding[128];
+
+    /* Only the compressed file is embedded, a client without gzip support
+     * can not decode it. A value longer than the buffer is cut but still
+     * searched, browsers list gzip first */
+    if (asset->bGzip) {
+        esp_err_t ret = httpd_req_get_hdr_value_str(req, "Accept-Encoding", accept_encoding,
+                                                    sizeof(accept_encoding));
+        if ((ret != ESP_OK && ret != ESP_ERR_HTTPD_RESULT_TRUNC) || strstr(accept_encoding, "gzip") == NULL) {
+            httpd_resp_set_status(req, "406 Not Acceptable");
+            httpd_resp_set_type(req, "text/plain");
+            return httpd_resp_sendstr(req, "This file is only available gzip encoded");
+        }
+        httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    }
+
+    snprintf(etag, sizeof(etag), "\"%08x\"", (unsigned)asset->iHash);
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match, sizeof(if_none_match)) == ESP_OK &&
+        strcmp(if_none_match, etag) == 0) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    httpd_resp_set_type(req, asset->strContentType);
+    if (asset->bGzip) {
+        httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    }
+    return httpd_resp_send(req, (const char *)asset->ptrData, asset->iSize);
+}
+
+/* Handler to respond with the wall clock anchors of the monotonic time base.
+ * Measurement time stamps are seconds since boot, clients convert them
+ * with the latest anchor which is not younger than the sample */
+static esp_err_t timebase_get_handler(httpd_req_t *req)
+{
+    time_anchor anchors[TIMEBASE_ANCHOR_TABLE_SIZE];
+    char *buf = ((struct file_server_data *)req->user_ctx)->scratch;
+
+    int count = timebaseGetAnchors(anchors, TIMEBASE_ANCHOR_TABLE_SIZE);
+    int len = snprintf(buf, SCRATCH_BUFSIZE, "{\"mono_us\":%lld,\"anchors\":[", timebaseGetMonoUs());
+
+    for (int i = 0; i < count; i++) {
+        /* Each anchor is a pair of [monotonic us, epoch us] */
+        len += snprintf(buf + len, SCRATCH_BUFSIZE - len, "%s[%lld,%lld]",
+                        (i > 0) ? "," : "", anchors[i].iMonoUs, anchors[i].iEpochUs);
+    }
+    len += snprintf(buf + len, SCRATCH_BUFSIZE - len, "]}");
+
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, buf, len);
+}
+
+/* Output of the metric renderer, each piece is sent as one chunk */
+struct metrics_stream {
+    httpd_req_t *req;
+    bool started;       /* status line is sent, errors can not be reported anymore */
+};
+
+static esp_err_t metrics_send_chunk(void *ctx, const char *data, size_t len)
+{
+    struct metrics_stream *stream = (struct metrics_stream *)ctx;
+
+    stream->started = true;
+    return httpd_resp_send_chunk(stream->req, data, len);
+}
+
+/* Handler to respond with all registered metrics in the
+ * Prometheus text exposition format */
+static esp_err_t metrics_get_handler(httpd_req_t *req)
+{
+    struct metrics_stream stream = {req, false};
+
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+    if (metricsRender(metrics_send_chunk, &stream) != ESP_OK) {
+        ESP_LOGE(TAG, "Rendering metrics failed");
+        if (!stream.started) {
+            return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Rendering metrics failed");
+        }
+        /* a partial page must not look complete: the unterminated chunked response is aborted with the socket */
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+/* Handler to respond with the task profiler report as JSON.
+ * Load values are arrays with one entry per averaging window */
+static esp_err_t profiler_get_handler(httpd_req_t *req)
+{
+    /* Report is too large for the httpd stack, handlers run in one task only */
+    static profiler_report report;
+    static const int windows_s[PROFILER_WINDOW_CNT] = PROFILER_WINDOWS_S;
+    char *buf = ((struct file_server_data *)req->user_ctx)->scratch;
+
+    profilerGetReport(&report);
+
+    int len = snprintf(buf, SCRATCH_BUFSIZE, "{\"time_us\":%lld,\"windows_s\":[%d,%d,%d],\"cores\":[",
+                       report.iTimeUs, windows_s[0], windows_s[1], windows_s[2]);
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        len += snprintf(buf + len, SCRATCH_BUFSIZE - len, "%s[%.1f,%.1f,%.1f]", (core > 0) ? "," : "",
+                        report.arrCoreLoad[core][0], report.arrCoreLoad[core][1], report.arrCoreLoad[core][2]);
+    }
+    len += snprintf(buf + len, SCRATCH_BUFSIZE - len, "],\"tasks\":[");
+
+    for (int i = 0; i < report.iTaskCnt; i++) {
+        profiler_task_info *task = &report.arrTasks[i];
+        len += snprintf(buf + len, SCRATCH_BUFSIZE - len,
+                        "%s{\"name\":\"%s\",\"num\":%u,\"state\":%u,\"prio\":%u,\"core\":%d,"
+                        "\"stack_free\":%u,\"cpu\":[%.1f,%.1f,%.1f],\"switches\":%.1f}",
+                        (i > 0) ? "," : "", task->strName, task->iTaskNumber, task->iState, task->iPriority,
+                        task->iCore, task->iStackFreeBytes, task->arrCpuPercent[0], task->arrCpuPercent[1],
+                        task->arrCpuPercent[2], task->fSwitchesPerSec);
+    }
+    len += snprintf(buf + len, SCRATCH_BUFSIZE - len, "]}");
+
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, buf, len);
+}
+
+/* Handler to respond with the state of the PID auto tuning
+ * experiment and its result as JSON */
+static esp_err_t autotune_get_handler(httpd_req_t *req)
+{
+    static const char *states[] = {"idle", "running", "done", "failed"};
+    static const char *errors[] = {"none", "aborted", "timeout", "overtemp", "no_oscillation"};
+    char *buf = ((struct file_server_data *)req->user_ctx)->scratch;
+    autotune_status status;
+
+    autotuneGetStatus(&status);
+
+    const char *rule = PIDAutoTune::getRuleName(status.iRule);
+    int len = snprintf(buf, SCRATCH_BUFSIZE,
+                       "{\"state\":\"%s\",\"error\":\"%s\",\"rule\":\"%s\",\"cycles\":%d,\"elapsed_s\":%.1f,"
+                       "\"ku\":%.3f,\"pu_s\":%.1f,\"amplitude\":%.3f,\"kp\":%.3f,\"tn_s\":%.1f,\"tv_s\":%.1f}",
+                       states[status.iState], errors[status.iError], rule ? rule : "", status.iCycles,
+                       status.fElapsedS, status.objResult.fUltimateGain, status.objResult.fUltimatePeriodS,
+                       status.objResult.fAmplitude, status.objResult.fPropFactor, status.objResult.fIntTimeS,
+                       status.objResult.fDifTimeS);
+
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, buf, len);
+}
+
+/* Handler to start (/autotune/start?rule=<name>) or abort
+ * (/autotune/abort) the PID auto tuning experiment */
+static esp_err_t autotune_post_handler(httpd_req_t *req)
+{
+    char query[48];
+    char rule[24];
+
+    if (strncmp(req->uri, "/autotune/abort", strlen("/autotune/abort")) == 0) {
+        autotuneRequestAbort();
+        return httpd_resp_sendstr(req, "Auto tuning aborted");
+    }
+
+    if (strncmp(req->uri, "/autotune/start", strlen("/autotune/start")) != 0) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unknown auto tuning command");
+        return ESP_FAIL;
+    }
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "rule", rule, sizeof(rule)) != ESP_OK) {
+        strlcpy(rule, PIDAutoTune::getRuleName(AUTOTUNE_RULE_ZN_PID), sizeof(rule));
+    }
+
+    esp_err_t ret = autotuneRequestStart(rule);
+    if (ret == ESP_ERR_INVALID_ARG) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown tuning rule");
+        return ESP_FAIL;
+    } else if (ret != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Auto tuning already running");
+        return ESP_FAIL;
+    }
+    return httpd_resp_sendstr(req, "Auto tuning started");
+}
+
+/* Handler to respond with the brew shot statistics and the
+ * temperature trace of the latest shot as JSON */
+static esp_err_t shots_get_handler(httpd_req_t *req)
+{
+    /* Report is too large for the httpd stack, handlers run in one task only */
+    static brew_report report;
+    char *buf = ((struct file_server_data *)req->user_ctx)->scratch;
+
+    brewGetReport(&report);
+
+    int len = snprintf(buf, SCRATCH_BUFSIZE, "{\"state\":%d,\"slope\":%.4f,\"feed_forward\":%.1f,\"count\":%u,\"shots\":[",
+                       report.iState, report.fSlope, report.fFeedForward, report.iShotCnt);
+    for (int i = 0; i < report.iHistoryCnt; i++) {
+        brew_shot *shot = &report.arrShots[i];
+        len += snprintf(buf + len, SCRATCH_BUFSIZE - len,
+                        "%s{\"num\":%u,\"start_s\":%.3f,\"trigger\":\"%s\",\"duration_s\":%.1f,\"start_temp\":%.2f,"
+                        "\"min_temp\":%.2f,\"dip\":%.2f,\"recovery_s\":%.1f,\"boost\":%.0f}",
+                        (i > 0) ? "," : "", shot->iShotNumber, shot->fStartS,
+                        shot->bSwitchTriggered ? "switch" : "slope", shot->fDurationS, shot->fStartTemp,
+                        shot->fMinTemp, shot->fDip, shot->fRecoveryS, shot->fBoostIntegral);
+    }
+    len += snprintf(buf + len, SCRATCH_BUFSIZE - len,
+                    "],\"trace\":{\"shot\":%u,\"interval_s\":%.1f,\"pre\":%d,\"values\":[",
+                    report.iTraceShot, report.fTraceIntervalS, report.iTracePreCnt);
+    for (int i = 0; i < report.iTraceCnt; i++) {
+        len += snprintf(buf + len, SCRATCH_BUFSIZE - len, "%s%.2f", (i > 0) ? "," : "", report.arrTrace[i]);
+    }
+    len += snprintf(buf + len, SCRATCH_BUFSIZE - len, "]}}");
+
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, buf, len);
+}
+
+/* Handler to respond with the raw high-rate conversions of the
+ * oversampling modes (/adc_raw.json?since=<seq>). Clients pass the
+ * "next" value of the previous response to get a gapless stream.
+ * Values from "range_since" on are in LSB of the PGA setting "range" */
+static esp_err_t adc_raw_get_handler(httpd_req_t *req)
+{
+    /* Values are too large for the httpd stack, handlers run in one task only */
+    static int16_t values[ADC_RAW_MAX_VALUES];
+    char *buf = ((struct file_server_data *)req->user_ctx)->scratch;
+    char query[32];
+    char since[12];
+    uint32_t seq = 0;
+    uint32_t first = 0;
+    meas_raw_info info;
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "since", since, sizeof(since)) == ESP_OK) {
+        seq = strtoul(since, NULL, 10);
+    }
+
+    measGetRawInfo(&info);
+    int count = measCopyRawSince(seq, values, ADC_RAW_MAX_VALUES, &first);
+
+    int len = snprintf(buf, SCRATCH_BUFSIZE, "{\"rate\":%.1f,\"first\":%u,\"next\":%u,\"lost\":%u,\"time_us\":%lld,"
+                       "\"range\":%u,\"range_since\":%u,\"values\":[",
+                       info.fRateSps, first, first + count, info.iLost, info.iLatestTimeUs, info.iRange, info.iRangeSeq);
+    for (int i = 0; i < count; i++) {
+        len += snprintf(buf + len, SCRATCH_BUFSIZE - len, "%s%d", (i > 0) ? "," : "", values[i]);
+    }
+    len += snprintf(buf + len, SCRATCH_BUFSIZE - len, "]}");
+
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, buf, len);
+}
+
+/* Handler to respond with the latest conversions of the auxiliary
+ * channel scan as JSON, the channel list is empty if the scan is off */
+static esp_err_t scan_get_handler(httpd_req_t *req)
+{
+    /* Report is too large for the httpd stack, handlers run in one task only */
+    static scan_report report;
+    char *buf = ((struct file_server_data *)req->user_ctx)->scratch;
+
+    scanGetReport(&report);
+
+    int len = snprintf(buf, SCRATCH_BUFSIZE, "{\"cycles\":%u,\"cycle_us\":%u,\"period_us\":%u,\"channels\":[",
+                       report.iCycleCnt, report.iCycleTimeUs, report.iCyclePeriodUs);
+    for (int i = 0; i < report.iChannelCnt; i++) {
+        ads1115_scan_result *result = &report.arrResults[i];
+        len += snprintf(buf + len, SCRATCH_BUFSIZE - len,
+                        "%s{\"name\":\"%s\",\"valid\":%s,\"raw\":%d,\"volt\":%.6f,\"time_us\":%lld,"
+                        "\"count\":%u,\"errors\":%u}",
+                        (i > 0) ? "," : "", report.arrNames[i], result->bValid ? "true" : "false", result->iRawValue,
+                        result->fVoltage, result->iTimeUs, result->iCount, result->iErrors);
+    }
+    len += snprintf(buf + len, SCRATCH_BUFSIZE - len, "]}");
+
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, buf, len);
+}
+
+/* Handler to respond with the safe-state action and the active
+ * and latched fault codes of the heater control as JSON */
+static esp_err_t faults_get_handler(httpd_req_t *req)
+{
+    char *buf = ((struct file_server_data *)req->user_ctx)->scratch;
+    fault_report report;
+
+    faultGetReport(&report);
+
+    int len = snprintf(buf, SCRATCH_BUFSIZE, "{\"action\":\"%s\",\"active\":%u,\"latched\":%u,\"hold_output\":%.3f,"
+                       "\"faults\":[", FaultManager::getActionName(report.iAction), report.iActiveMask,
+                       report.iLatchedMask, report.fHoldOutput);
+    for (int i = 0; i < FAULT_CNT; i++) {
+        fault_entry *entry = &report.arrEntries[i];
+        len += snprintf(buf + len, SCRATCH_BUFSIZE - len,
+                        "%s{\"code\":%d,\"name\":\"%s\",\"active\":%s,\"latched\":%s,\"count\":%u,"
+                        "\"first_s\":%.1f,\"last_s\":%.1f}",
+                        (i > 0) ? "," : "", i, FaultManager::getFaultName(i),
+                        (report.iActiveMask & FAULT_BIT(i)) ? "true" : "false",
+                        (report.iLatchedMask & FAULT_BIT(i)) ? "true" : "false", entry->iCount, entry->fFirstS,
+                        entry->fLastS);
+    }
+    len += snprintf(buf + len, SCRATCH_BUFSIZE - len, "]}");
+
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, buf, len);
+}
+
+/* Handler to acknowledge the latched faults (/faults/clear), this
+ * releases a heater switched off by a plausibility fault */
+static esp_err_t faults_post_handler(httpd_req_t *req)
+{
+    if (strncmp(req->uri, "/faults/clear", strlen("/faults/clear")) != 0) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unknown fault command");
+        return ESP_FAIL;
+    }
+    faultClear();
+    return httpd_resp_sendstr(req, "Faults cleared");
+}
+
+/* Handler of the WebSocket channel. The handshake subscribes the client
+ * to the sample broadcast, binary frames from the client are setpoint
+ * or gain commands which are answered with an acknowledge frame */
+static esp_err_t ws_handler(httpd_req_t *req)
+{
+    if (req->method == HTTP_GET) {
+        /* Handshake done, the client receives the next broadcast */
+        return ESP_OK;
+    }
+
+    uint8_t payload[sizeof(telemetry_command)];
+    httpd_ws_frame_t frame;
+    memset(&frame, 0, sizeof(frame));
+
+    /* Get the frame length first, commands are only a few bytes */
+    esp_err_t ret = httpd_ws_recv_frame(req, &frame, 0);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (frame.len > sizeof(payload)) {
+        ESP_LOGW(TAG, "WebSocket frame of %d bytes rejected", frame.len);
+        return ESP_FAIL;
+    }
+    if (frame.len > 0) {
+        frame.payload = payload;
+        ret = httpd_ws_recv_frame(req, &frame, frame.len);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    if (frame.type != HTTPD_WS_TYPE_BINARY) {
+        /* Text frames carry no commands */
+        return ESP_OK;
+    }
+
+    telemetry_ack ack;
+    ack.iType = TELEMETRY_FRAME_ACK;
+    ack.iCmd = (frame.len > 0) ? payload[0] : 0;
+    ack.iResult = (uint8_t)telemetryPostCommand(payload, frame.len);
+    ack.iReserved = 0;
+
+    httpd_ws_frame_t ack_frame;
+    memset(&ack_frame, 0, sizeof(ack_frame));
+    ack_frame.final = true;
+    ack_frame.type = HTTPD_WS_TYPE_BINARY;
+    ack_frame.payload = (uint8_t *)&ack;
+    ack_frame.len = sizeof(ack);
+    return httpd_ws_send_frame(req, &ack_frame);
+}
+
+/* Sample frame of the broadcast, encoded once for all clients */
+static uint8_t s_ws_frame[TELEMETRY_FRAME_MAX_LEN];
+static volatile bool s_ws_broadcast_queued = false;
+
+/* Send the new samples to all WebSocket clients, runs in the httpd
+ * task and is therefore serialized with the request handlers */
+static void ws_broadcast_work(void *arg)
+{
+    httpd_handle_t server = (httpd_handle_t)arg;
+    int fds[CONFIG_LWIP_MAX_SOCKETS];
+    size_t fd_count = CONFIG_LWIP_MAX_SOCKETS;
+    int ws_count = 0;
+
+    s_ws_broadcast_queued = false;
+    if (httpd_get_client_list(server, &fd_count, fds) != ESP_OK) {
+        return;
+    }
+    for (size_t i = 0; i < fd_count; i++) {
+        if (httpd_ws_get_fd_info(server, fds[i]) == HTTPD_WS_CLIENT_WEBSOCKET) {
+            fds[ws_count++] = fds[i];
+        }
+    }
+    if (ws_count == 0) {
+        /* Pending samples stay in the ring, a new client starts with them */
+        return;
+    }
+
+    int len = telemetryEncodeSamples(s_ws_frame, sizeof(s_ws_frame));
+    if (len == 0) {
+        return;
+    }
+
+    httpd_ws_frame_t frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.final = true;
+    frame.type = HTTPD_WS_TYPE_BINARY;
+    frame.payload = s_ws_frame;
+    frame.len = len;
+    for (int i = 0; i < ws_count; i++) {
+        httpd_ws_send_frame_async(server, fds[i], &frame);
+    }
+}
+
+/* Timer callback of the broadcast interval, hands the broadcast to the
+ * httpd task unless the previous one is still queued */
+static void ws_broadcast_timer_cb(void *arg)
+{
+    if (s_ws_broadcast_queued) {
+        return;
+    }
+    s_ws_broadcast_queued = true;
+    if (httpd_queue_work((httpd_handle_t)arg, ws_broadcast_work, arg) != ESP_OK) {
+        s_ws_broadcast_queued = false;
+    }
+}
+
+
+struct dir_cache_entry {
+    char name[CONFIG_LITTLEFS_OBJ_NAME_LEN + 1];
+    uint32_t size;
+    bool is_dir;
+};
+
+struct dir_cache {
+    char path[FILE_PATH_MAX];
+    time_t mtime;
+    uint32_t generation;
+    int64_t time_us;
+    int count;
+    struct dir_cache_entry entries[DIR_CACHE_MAX_ENTRIES];
+};
+
+static struct dir_cache s_dir_cache;
+static uint32_t s_fs_generation = 0;    /* changed by every upload and delete */
+
+/* Return the cached entries of a directory, read them again if the
+ * directory changed. NULL if it has more entries than the cache holds */
+static struct dir_cache *get_dir_cache(const char *dirpath)
+{
+    struct stat dir_stat;
+    struct stat entry_stat;
+    char entrypath[FILE_PATH_MAX];
+    const size_t dirpath_len = strlen(dirpath);
+    int64_t now = esp_timer_get_time();
+
+    if (stat(dirpath, &dir_stat) == -1) {
+        dir_stat.st_mtime = 0;
+    }
+    if (strcmp(s_dir_cache.path, dirpath) == 0 && s_dir_cache.mtime == dir_stat.st_mtime &&
+        s_dir_cache.generation == s_fs_generation && now - s_dir_cache.time_us < DIR_CACHE_MAX_AGE_US) {
+        return &s_dir_cache;
+    }
+
+    DIR *dir = opendir(dirpath);
+    if (!dir) {
+        return NULL;
+    }
+    strlcpy(entrypath, dirpath, sizeof(entrypath));
+    s_dir_cache.path[0] = '\0';
+    s_dir_cache.count = 0;
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (s_dir_cache.count == DIR_CACHE_MAX_ENTRIES) {
+            closedir(dir);
+            return NULL;
+        }
+        strlcpy(entrypath + dirpath_len, entry->d_name, sizeof(entrypath) - dirpath_len);
+        if (stat(entrypath, &entry_stat) == -1) {
+            continue;
+        }
+        struct dir_cache_entry *cached = &s_dir_cache.entries[s_dir_cache.count++];
+        strlcpy(cached->name, entry->d_name, sizeof(cached->name));
+        cached->size = entry_stat.st_size;
+        cached->is_dir = (entry->d_type == DT_DIR);
+    }
+    closedir(dir);
+
+    strlcpy(s_dir_cache.path, dirpath, sizeof(s_dir_cache.path));
+    s_dir_cache.mtime = dir_stat.st_mtime;
+    s_dir_cache.generation = s_fs_generation;
+    s_dir_cache.time_us = now;
+    return &s_dir_cache;
+}
+
+/* Append a file name as JSON string */
+static int json_escape_name(char *buf, size_t size, const char *name)
+{
+    size_t len = 0;
+
+    for (; *name && len + 7 < size; name++) {
+        unsigned char c = *name;
+        if (c == '"' || c == '\\') {
+            buf[len++] = '\\';
+            buf[len++] = c;
+        } else if (c < 0x20) {
+            len += snprintf(buf + len, size - len, "\\u%04x", c);
+        } else {
+            buf[len++] = c;
+        }
+    }
+    buf[len] = '\0';
+    return len;
+}
+
+/* Send the entries [offset, offset + limit) of a directory as JSON. The
+ * entries are collected in the scratch buffer and sent in large chunks */
+static esp_err_t http_resp_dir_json(httpd_req_t *req, const char *dirpath, const char *uripath)
+{
+    char query[48];
+    char param[12];
+    int offset = 0;
+    int limit = DIR_LIST_DEFAULT_LIMIT;
+    int total = 0;
+    char *buf = ((struct file_server_data *)req->user_ctx)->scratch;
+    int len = 0;
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        if (httpd_query_key_value(query, "offset", param, sizeof(param)) == ESP_OK) {
+            offset = MAX(atoi(param), 0);
+        }
+        if (httpd_query_key_value(query, "limit", param, sizeof(param)) == ESP_OK) {
+            limit = MAX(atoi(param), 0);
+        }
+    }
+    /* A page never holds more than a cached directory, and offset + limit must not overflow */
+    limit = MIN(limit, DIR_CACHE_MAX_ENTRIES);
+
+    struct dir_cache *cache = get_dir_cache(dirpath);
+    DIR *dir = NULL;
+    /* A cached directory has at most DIR_CACHE_MAX_ENTRIES, larger directories are paged through readdir() */
+    offset = MIN(offset, cache ? DIR_CACHE_MAX_ENTRIES : INT_MAX - DIR_CACHE_MAX_ENTRIES);
+    if (!cache) {
+        /* Too many entries for the cache, stat() only the requested page */
+        dir = opendir(dirpath);
+        if (!dir) {
+            ESP_LOGE(TAG, "Failed to stat dir : %s", dirpath);
+            /* Respond with 404 Not Found */
+            httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Directory does not exist");
+            return ESP_FAIL;
+        }
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    len = snprintf(buf, SCRATCH_BUFSIZE, "{\"path\":\"");
+    len += json_escape_name(buf + len, SCRATCH_BUFSIZE - len, uripath);
+    len += snprintf(buf + len, SCRATCH_BUFSIZE - len, "\",\"offset\":%d,\"entries\":[", offset);
+
+    char entrypath[FILE_PATH_MAX];
+    const size_t dirpath_len = strlen(dirpath);
+    struct stat entry_stat;
+    struct dirent *entry;
+    strlcpy(entrypath, dirpath, sizeof(entrypath));
+
+    for (int i = 0; ; i++) {
+        const char *name;
+        uint32_t size = 0;
+        bool is_dir;
+
+        if (cache) {
+            if (i == cache->count) {
+                break;
+            }
+            name = cache->entries[i].name;
+            size = cache->entries[i].size;
+            is_dir = cache->entries[i].is_dir;
+        } else {
+            if ((entry = readdir(dir)) == NULL) {
+                break;
+            }
+            name = entry->d_name;
+            is_dir = (entry->d_type == DT_DIR);
+        }
+        total++;
+        if (i < offset || i >= offset + limit) {
+            continue;
+        }
+        if (!cache) {
+            strlcpy(entrypath + dirpath_len, name, sizeof(entrypath) - dirpath_len);
+            if (stat(entrypath, &entry_stat) == 0) {
+                size = entry_stat.st_size;
+            }
+        }
+
+        if (SCRATCH_BUFSIZE - len < DIR_LIST_ENTRY_MAX_LEN) {
+            if (httpd_resp_send_chunk(req, buf, len) != ESP_OK) {
+                if (dir) {
+                    closedir(dir);
+                }
+                return ESP_FAIL;
+            }
+            len = 0;
+        }
+        len += snprintf(buf + len, SCRATCH_BUFSIZE - len, "%s{\"name\":\"", (i > offset) ? "," : "");
+        len += json_escape_name(buf + len, SCRATCH_BUFSIZE - len, name);
+        len += snprintf(buf + len, SCRATCH_BUFSIZE - len, "\",\"type\":\"%s\",\"size\":%u}",
+                        is_dir ? "directory" : "file", (unsigned)size);
+    }
+    if (dir) {
+        closedir(dir);
+    }
+
+    len += snprintf(buf + len, SCRATCH_BUFSIZE - len, "],\"total\":%d,\"cached\":%s}",
+                    total, cache ? "true" : "false");
+    httpd_resp_send_chunk(req, buf, len);
+
+    /* Send empty chunk to signal HTTP response completion */
+    return httpd_resp_send_chunk(req, NULL, 0);
 }
 
 /* Send HTTP response with a run-time generated html consisting of
  * a list of all files and folders under the requested path.
  * In case of SPIFFS this returns empty list when path is any
  * string other than '/', since SPIFFS doesn't support directories */
-static esp_err_t http_resp_dir_html(httpd_req_t *req, const char *dirpath)
+static esp_err_t http_resp_dir_html(httpd_req_t *req, const char *dirpath, const char *uripath)
 {
     char entrypath[FILE_PATH_MAX];
     char entrysize[16];
@@ -106,11 +881,10 @@ static esp_err_t http_resp_dir_html(httpd_req_t *req, const char *dirpath)
             continue;
         }
         sprintf(entrysize, "%ld", entry_stat.st_size);
-        ESP_LOGI(TAG, "Found %s : %s (%s bytes)", entrytype, entry->d_name, entrysize);
 
         /* Send chunk of HTML file containing table entries with file name and size */
         httpd_resp_sendstr_chunk(req, "<tr><td><a href=\"");
-        httpd_resp_sendstr_chunk(req, req->uri);
+        httpd_resp_sendstr_chunk(req, uripath);
         httpd_resp_sendstr_chunk(req, entry->d_name);
         if (entry->d_type == DT_DIR) {
             httpd_resp_sendstr_chunk(req, "/");
@@ -123,7 +897,7 @@ static esp_err_t http_resp_dir_html(httpd_req_t *req, const char *dirpath)
         httpd_resp_sendstr_chunk(req, entrysize);
         httpd_resp_sendstr_chunk(req, "</td><td>");
         httpd_resp_sendstr_chunk(req, "<form method=\"post\" action=\"/delete");
-        httpd_resp_sendstr_chunk(req, req->uri);
+        httpd_resp_sendstr_chunk(req, uripath);
         httpd_resp_sendstr_chunk(req, entry->d_name);
         httpd_resp_sendstr_chunk(req, "\"><button type=\"submit\">Delete</button></form>");
         httpd_resp_sendstr_chunk(req, "</td></tr>\n");
@@ -154,6 +928,8 @@ static esp_err_t set_content_type_from_file(httpd_req_t *req, const char *filena
         return httpd_resp_set_type(req, "image/jpeg");
     } else if (IS_FILE_EXT(filename, ".ico")) {
         return httpd_resp_set_type(req, "image/x-icon");
+    } else if (IS_FILE_EXT(filename, ".js")) {
+        return httpd_resp_set_type(req, "application/javascript");
     }
     /* This is a limited set only */
     /* For any other type always set as plain text */
@@ -194,7 +970,7 @@ static const char* get_path_from_uri(char *dest, const char *base_path, const ch
 static esp_err_t download_get_handler(httpd_req_t *req)
 {
     char filepath[FILE_PATH_MAX];
-    FILE *fd = NULL;
+    int fd = -1;
     struct stat file_stat;
 
     const char *filename = get_path_from_uri(filepath, ((struct file_server_data *)req->user_ctx)->base_path,
@@ -206,18 +982,29 @@ static esp_err_t download_get_handler(httpd_req_t *req)
         return ESP_FAIL;
     }
 
-    /* If name has trailing '/', respond with directory contents */
+    /* If name has trailing '/', respond with directory contents, as
+     * JSON for ?format=json. The root without format is the start page */
     if (filename[strlen(filename) - 1] == '/') {
-        return http_resp_dir_html(req, filepath);
+        char query[48];
+        char format[8] = "";
+        if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+            httpd_query_key_value(query, "format", format, sizeof(format));
+        }
+        if (strcmp(format, "json") == 0) {
+            return http_resp_dir_json(req, filepath, filename);
+        }
+        if (strcmp(filename, "/") != 0 || strcmp(format, "html") == 0 ||
+            strlcat(filepath, "index.html", sizeof(filepath)) >= sizeof(filepath)) {
+            return http_resp_dir_html(req, filepath, filename);
+        }
     }
 
     if (stat(filepath, &file_stat) == -1) {
         /* If file not present on LittleFS check if URI
-         * corresponds to one of the hardcoded paths */
-        if (strcmp(filename, "/index.html") == 0) {
-            return index_html_get_handler(req);
-        } else if (strcmp(filename, "/favicon.ico") == 0) {
-            return favicon_get_handler(req);
+         * corresponds to a file of the web interface bundle */
+        const struct web_asset *asset = assetsFind(filename, strlen(filename));
+        if (asset) {
+            return embedded_asset_send(req, asset);
         }
         ESP_LOGE(TAG, "Failed to stat file : %s", filepath);
         /* Respond with 404 Not Found */
@@ -225,8 +1012,8 @@ static esp_err_t download_get_handler(httpd_req_t *req)
         return ESP_FAIL;
     }
 
-    fd = fopen(filepath, "r");
-    if (!fd) {
+    fd = open(filepath, O_RDONLY);
+    if (fd < 0) {
         ESP_LOGE(TAG, "Failed to read existing file : %s", filepath);
         /* Respond with 500 Internal Server Error */
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to read existing file");
@@ -238,30 +1025,39 @@ static esp_err_t download_get_handler(httpd_req_t *req)
 
     /* Retrieve the pointer to scratch buffer for temporary storage */
     char *chunk = ((struct file_server_data *)req->user_ctx)->scratch;
-    size_t chunksize;
+    int64_t start = esp_timer_get_time();
+    ssize_t chunksize;
     do {
-        /* Read file in chunks into the scratch buffer */
-        chunksize = fread(chunk, 1, SCRATCH_BUFSIZE, fd);
+        /* Read the file block by block into the scratch buffer */
+        chunksize = read(fd, chunk, DOWNLOAD_CHUNK_SIZE);
 
         if (chunksize > 0) {
             /* Send the buffer contents as HTTP response chunk */
             if (httpd_resp_send_chunk(req, chunk, chunksize) != ESP_OK) {
-                fclose(fd);
+                close(fd);
                 ESP_LOGE(TAG, "File sending failed!");
                 /* Abort sending file */
                 httpd_resp_sendstr_chunk(req, NULL);
                 /* Respond with 500 Internal Server Error */
                 httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to send file");
-               return ESP_FAIL;
-           }
+                return ESP_FAIL;
+            }
         }
 
         /* Keep looping till the whole file is sent */
-    } while (chunksize != 0);
+    } while (chunksize > 0);
 
     /* Close file after sending complete */
-    fclose(fd);
-    ESP_LOGI(TAG, "File sending complete");
+    close(fd);
+    if (chunksize < 0) {
+        ESP_LOGE(TAG, "Failed to read file : %s", filepath);
+        /* No terminating chunk: on ESP_FAIL httpd closes the socket and the client sees an incomplete transfer
+         * instead of a well-formed truncated file */
+        return ESP_FAIL;
+    }
+    int64_t duration_us = MAX(esp_timer_get_time() - start, (int64_t)1);
+    ESP_LOGI(TAG, "File sending complete (%u KB/s)",
+             (unsigned)(file_stat.st_size * 1000000LL / 1024 / duration_us));
 
     /* Respond with an empty chunk to signal HTTP response completion */
     httpd_resp_send_chunk(req, NULL, 0);
@@ -273,8 +1069,10 @@ static esp_err_t download_get_handler(httpd_req_t *req)
 static esp_err_t upload_post_handler(httpd_req_t *req)
 {
     char filepath[FILE_PATH_MAX];
-    FILE *fd = NULL;
+    char temppath[ESP_VFS_PATH_MAX + sizeof(UPLOAD_TEMP_NAME)];
+    int fd = -1;
     struct stat file_stat;
+    size_t total_bytes = 0, used_bytes = 0;
 
     /* Skip leading "/upload" from URI to get filename */
     /* Note sizeof() counts NULL termination hence the -1 */
@@ -312,19 +1110,38 @@ static esp_err_t upload_post_handler(httpd_req_t *req)
         return ESP_FAIL;
     }
 
-    fd = fopen(filepath, "w");
-    if (!fd) {
-        ESP_LOGE(TAG, "Failed to create file : %s", filepath);
+    /* Remove a temporary file left by an interrupted upload before
+     * the free space is checked, it is overwritten anyway */
+    snprintf(temppath, sizeof(temppath), "%s" UPLOAD_TEMP_NAME,
+             ((struct file_server_data *)req->user_ctx)->base_path);
+    unlink(temppath);
+
+    /* The file has to fit into the free space of the file system,
+     * otherwise the upload would fill it and fail at the end */
+    if (esp_littlefs_info(LITTLEFS_PARTITION_LABEL, &total_bytes, &used_bytes) != ESP_OK ||
+        used_bytes + req->content_len + UPLOAD_FS_RESERVE > total_bytes) {
+        ESP_LOGE(TAG, "Not enough free space for %d bytes (%u of %u bytes used)",
+                 req->content_len, (unsigned)used_bytes, (unsigned)total_bytes);
+        /* Respond with 400 Bad Request */
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Not enough free space on storage");
+        return ESP_FAIL;
+    }
+
+    fd = open(temppath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        ESP_LOGE(TAG, "Failed to create file : %s", temppath);
         /* Respond with 500 Internal Server Error */
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to create file");
         return ESP_FAIL;
     }
 
-    ESP_LOGI(TAG, "Receiving file : %s...", filename);
+    ESP_LOGI(TAG, "Receiving file : %s (%d bytes)...", filename, req->content_len);
 
     /* Retrieve the pointer to scratch buffer for temporary storage */
     char *buf = ((struct file_server_data *)req->user_ctx)->scratch;
     int received;
+    int filled = 0;
+    int64_t log_time = esp_timer_get_time();
 
     /* Content length of the request gives
      * the size of the file being uploaded */
@@ -332,9 +1149,8 @@ static esp_err_t upload_post_handler(httpd_req_t *req)
 
     while (remaining > 0) {
 
-        ESP_LOGI(TAG, "Remaining size : %d", remaining);
         /* Receive the file part by part into a buffer */
-        if ((received = httpd_req_recv(req, buf, MIN(remaining, SCRATCH_BUFSIZE))) <= 0) {
+        if ((received = httpd_req_recv(req, buf + filled, MIN(remaining, UPLOAD_WRITE_SIZE - filled))) <= 0) {
             if (received == HTTPD_SOCK_ERR_TIMEOUT) {
                 /* Retry if timeout occurred */
                 continue;
@@ -342,8 +1158,8 @@ static esp_err_t upload_post_handler(httpd_req_t *req)
 
             /* In case of unrecoverable error,
              * close and delete the unfinished file*/
-            fclose(fd);
-            unlink(filepath);
+            close(fd);
+            unlink(temppath);
 
             ESP_LOGE(TAG, "File reception failed!");
             /* Respond with 500 Internal Server Error */
@@ -351,31 +1167,53 @@ static esp_err_t upload_post_handler(httpd_req_t *req)
             return ESP_FAIL;
         }
 
+        /* Keep track of remaining size of
+         * the file left to be uploaded */
+        remaining -= received;
+        filled += received;
+
+        /* Write whole blocks only, TCP segments are much smaller and
+         * every partial write would cost an extra program of the block */
+        if (filled < UPLOAD_WRITE_SIZE && remaining > 0) {
+            continue;
+        }
+
         /* Write buffer content to file on storage */
-        if (received && (received != fwrite(buf, 1, received, fd))) {
+        if (write(fd, buf, filled) != filled) {
             /* Couldn't write everything to file!
              * Storage may be full? */
-            fclose(fd);
-            unlink(filepath);
+            close(fd);
+            unlink(temppath);
 
             ESP_LOGE(TAG, "File write failed!");
             /* Respond with 500 Internal Server Error */
             httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to write file to storage");
             return ESP_FAIL;
         }
+        filled = 0;
 
-        /* Keep track of remaining size of
-         * the file left to be uploaded */
-        remaining -= received;
+        if (esp_timer_get_time() - log_time >= UPLOAD_LOG_PERIOD_US) {
+            log_time = esp_timer_get_time();
+            ESP_LOGI(TAG, "Remaining size : %d", remaining);
+        }
     }
 
-    /* Close file upon upload completion */
-    fclose(fd);
+    /* Close file upon upload completion, then give it its name. The
+     * rename is atomic, a reader never sees a partial file */
+    if (close(fd) != 0 || rename(temppath, filepath) != 0) {
+        unlink(temppath);
+
+        ESP_LOGE(TAG, "Failed to store file : %s", filepath);
+        /* Respond with 500 Internal Server Error */
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to write file to storage");
+        return ESP_FAIL;
+    }
+    s_fs_generation++;
     ESP_LOGI(TAG, "File reception complete");
 
     /* Redirect onto root to see the updated file list */
     httpd_resp_set_status(req, "303 See Other");
-    httpd_resp_set_hdr(req, "Location", "/");
+    httpd_resp_set_hdr(req, "Location", "/?format=html");
 #ifdef CONFIG_EXAMPLE_HTTPD_CONN_CLOSE_HEADER
     httpd_resp_set_hdr(req, "Connection", "close");
 #endif
@@ -383,7 +1221,6 @@ static esp_err_t upload_post_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
-
 /* Handler to delete a file from the server */
 static esp_err_t delete_post_handler(httpd_req_t *req)
 {
@@ -417,10 +1254,11 @@ static esp_err_t delete_post_handler(httpd_req_t *req)
     ESP_LOGI(TAG, "Deleting file : %s", filename);
     /* Delete file */
     unlink(filepath);
+    s_fs_generation++;
 
     /* Redirect onto root to see the updated file list */
     httpd_resp_set_status(req, "303 See Other");
-    httpd_resp_set_hdr(req, "Location", "/");
+    httpd_resp_set_hdr(req, "Location", "/?format=html");
 #ifdef CONFIG_EXAMPLE_HTTPD_CONN_CLOSE_HEADER
     httpd_resp_set_hdr(req, "Connection", "close");
 #endif
@@ -429,22 +1267,73 @@ static esp_err_t delete_post_handler(httpd_req_t *req)
 }
 
 
+URI_STATS_HANDLER(timebase_get_handler, URI_STATS_TIMEBASE)
+URI_STATS_HANDLER(metrics_get_handler, URI_STATS_METRICS)
+URI_STATS_HANDLER(profiler_get_handler, URI_STATS_PROFILER)
+URI_STATS_HANDLER(autotune_get_handler, URI_STATS_AUTOTUNE_STATUS)
+URI_STATS_HANDLER(autotune_post_handler, URI_STATS_AUTOTUNE_CMD)
+URI_STATS_HANDLER(shots_get_handler, URI_STATS_SHOTS)
+URI_STATS_HANDLER(adc_raw_get_handler, URI_STATS_ADC_RAW)
+URI_STATS_HANDLER(scan_get_handler, URI_STATS_SCAN)
+URI_STATS_HANDLER(faults_get_handler, URI_STATS_FAULTS)
+URI_STATS_HANDLER(faults_post_handler, URI_STATS_FAULTS_CMD)
+URI_STATS_HANDLER(ws_handler, URI_STATS_WS)
+URI_STATS_HANDLER(download_get_handler, URI_STATS_DOWNLOAD)
+URI_STATS_HANDLER(upload_post_handler, URI_STATS_UPLOAD)
+URI_STATS_HANDLER(delete_post_handler, URI_STATS_DELETE)
+
+/* Enable TCP keep-alive on a new client socket, so that the session of a
+ * browser which vanished without closing the connection is freed */
+static esp_err_t open_client_socket(httpd_handle_t hd, int sockfd)
+{
+    int enable = 1;
+    int idle = HTTPD_KEEPALIVE_IDLE_S;
+    int interval = HTTPD_KEEPALIVE_INTERVAL_S;
+    int count = HTTPD_KEEPALIVE_COUNT;
+
+    setsockopt(sockfd, SOL_SOCKET, SO_KEEPALIVE, &enable, sizeof(enable));
+    setsockopt(sockfd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+    setsockopt(sockfd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+    setsockopt(sockfd, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count));
+    return ESP_OK;
+}
+
+/* Adjust the default server configuration: a socket pool sized from the
+ * free heap, LRU purge of the oldest idle connection if the pool is full
+ * instead of refusing new clients, and keep-alive on all connections */
+static void tune_server_config(httpd_config_t *config)
+{
+    size_t free_heap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    int sockets = HTTPD_SOCKETS_MIN;
+
+    if (free_heap > HTTPD_HEAP_RESERVE) {
+        sockets = MAX(sockets, (int)((free_heap - HTTPD_HEAP_RESERVE) / HTTPD_SOCKET_HEAP_COST));
+    }
+    sockets = MIN(sockets, HTTPD_SOCKETS_MAX);
+
+    config->max_open_sockets = sockets;
+    config->backlog_conn = sockets;
+    config->lru_purge_enable = true;
+    config->stack_size = HTTPD_STACK_SIZE;
+    config->recv_wait_timeout = HTTPD_TIMEOUT_S;
+    config->send_wait_timeout = HTTPD_TIMEOUT_S;
+    config->open_fn = open_client_socket;
+
+    ESP_LOGI(TAG, "Server sockets: %d, free heap: %u", sockets, (unsigned)free_heap);
+}
+
 /* Function to start the file server */
 esp_err_t start_web_server(const char *base_path)
 {
+    /* Server data lives in static storage like all long-lived objects */
+    static struct file_server_data s_server_data;
     static struct file_server_data *server_data = NULL;
 
     if (server_data) {
         ESP_LOGE(TAG, "File server already started");
         return ESP_ERR_INVALID_STATE;
     }
-
-    /* Allocate memory for server data */
-    server_data = new file_server_data;
-    if (!server_data) {
-        ESP_LOGE(TAG, "Failed to allocate memory for server data");
-        return ESP_ERR_NO_MEM;
-    }
+    server_data = &s_server_data;
     strlcpy(server_data->base_path, base_path, sizeof(server_data->base_path));
 
     httpd_handle_t server = NULL;
@@ -454,18 +1343,143 @@ esp_err_t start_web_server(const char *base_path)
      * allow the same handler to respond to multiple different
      * target URIs which match the wildcard scheme */
     config.uri_match_fn = httpd_uri_match_wildcard;
+    /* Every registered handler has a statistics slot */
+    config.max_uri_handlers = URI_STATS_COUNT;
+    tune_server_config(&config);
 
     ESP_LOGI(TAG, "Starting HTTP Server on port: '%d'", config.server_port);
     if (httpd_start(&server, &config) != ESP_OK) {
         ESP_LOGE(TAG, "Failed to start file server!");
         return ESP_FAIL;
     }
+    s_server = server;
+    s_socket_limit = config.max_open_sockets;
+
+    /* URI handler for the time base anchors */
+    httpd_uri_t timebase_get = {
+        .uri       = "/timebase.json",
+        .method    = HTTP_GET,
+        .handler   = timebase_get_handler_with_stats,
+        .user_ctx  = server_data    // Pass server data as context
+    };
+    httpd_register_uri_handler(server, &timebase_get);
+
+    /* URI handler for the Prometheus metrics */
+    httpd_uri_t metrics_get = {
+        .uri       = "/metrics",
+        .method    = HTTP_GET,
+        .handler   = metrics_get_handler_with_stats,
+        .user_ctx  = server_data    // Pass server data as context
+    };
+    httpd_register_uri_handler(server, &metrics_get);
+
+    /* URI handler for the task profiler report */
+    httpd_uri_t profiler_get = {
+        .uri       = "/profiler.json",
+        .method    = HTTP_GET,
+        .handler   = profiler_get_handler_with_stats,
+        .user_ctx  = server_data    // Pass server data as context
+    };
+    httpd_register_uri_handler(server, &profiler_get);
+
+    /* URI handlers for the PID auto tuning */
+    httpd_uri_t autotune_get = {
+        .uri       = "/autotune.json",
+        .method    = HTTP_GET,
+        .handler   = autotune_get_handler_with_stats,
+        .user_ctx  = server_data    // Pass server data as context
+    };
+    httpd_register_uri_handler(server, &autotune_get);
+
+    httpd_uri_t autotune_post = {
+        .uri       = "/autotune/*", // Match /autotune/start?rule=<name> and /autotune/abort
+        .method    = HTTP_POST,
+        .handler   = autotune_post_handler_with_stats,
+        .user_ctx  = server_data    // Pass server data as context
+    };
+    httpd_register_uri_handler(server, &autotune_post);
+
+    /* URI handler for the brew shot statistics */
+    httpd_uri_t shots_get = {
+        .uri       = "/shots.json",
+        .method    = HTTP_GET,
+        .handler   = shots_get_handler_with_stats,
+        .user_ctx  = server_data    // Pass server data as context
+    };
+    httpd_register_uri_handler(server, &shots_get);
+
+    /* URI handler for the raw high-rate conversions */
+    httpd_uri_t adc_raw_get = {
+        .uri       = "/adc_raw.json",
+        .method    = HTTP_GET,
+        .handler   = adc_raw_get_handler_with_stats,
+        .user_ctx  = server_data    // Pass server data as context
+    };
+    httpd_register_uri_handler(server, &adc_raw_get);
+
+    /* URI handler for the auxiliary channel scan */
+    httpd_uri_t scan_get = {
+        .uri       = "/scan.json",
+        .method    = HTTP_GET,
+        .handler   = scan_get_handler_with_stats,
+        .user_ctx  = server_data    // Pass server data as context
+    };
+    httpd_register_uri_handler(server, &scan_get);
+
+    /* URI handlers for the fault codes of the heater control */
+    httpd_uri_t faults_get = {
+        .uri       = "/faults.json",
+        .method    = HTTP_GET,
+        .handler   = faults_get_handler_with_stats,
+        .user_ctx  = server_data    // Pass server data as context
+    };
+    httpd_register_uri_handler(server, &faults_get);
+
+    httpd_uri_t faults_post = {
+        .uri       = "/faults/*",   // Match /faults/clear
+        .method    = HTTP_POST,
+        .handler   = faults_post_handler_with_stats,
+        .user_ctx  = server_data    // Pass server data as context
+    };
+    httpd_register_uri_handler(server, &faults_post);
+
+    /* WebSocket channel of the binary telemetry and the commands */
+    httpd_uri_t ws = {
+        .uri          = "/ws",
+        .method       = HTTP_GET,
+        .handler      = ws_handler_with_stats,
+        .user_ctx     = server_data,    // Pass server data as context
+        .is_websocket = true
+    };
+    httpd_register_uri_handler(server, &ws);
+
+    const esp_timer_create_args_t ws_timer_args = {
+        .callback = ws_broadcast_timer_cb,
+        .arg      = server,
+        .name     = "ws_broadcast"
+    };
+    esp_timer_handle_t ws_timer;
+    if (esp_timer_create(&ws_timer_args, &ws_timer) != ESP_OK ||
+        esp_timer_start_periodic(ws_timer, TELEMETRY_PERIOD_MS * 1000) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start the WebSocket broadcast");
+    }
+
+    metricsRegisterFamily("coffee_http_requests_total", "HTTP requests per URI handler",
+                          METRIC_TYPE_COUNTER, collect_uri_requests);
+    metricsRegisterFamily("coffee_http_errors_total", "Failed HTTP requests per URI handler",
+                          METRIC_TYPE_COUNTER, collect_uri_errors);
+    metricsRegisterFamily("coffee_http_request_duration_seconds", "HTTP request handling time per URI handler",
+                          METRIC_TYPE_SUMMARY, collect_uri_latency);
+    metricsRegister("coffee_http_open_sockets", "Open client connections of the web server",
+                    METRIC_TYPE_GAUGE, get_open_sockets);
+    metricsRegister("coffee_http_socket_limit", "Client connections of the web server before the LRU purge",
+                    METRIC_TYPE_GAUGE, get_socket_limit);
 
     /* URI handler for getting uploaded files */
     httpd_uri_t file_download = {
         .uri       = "/*",  // Match all URIs of type /path/to/file
         .method    = HTTP_GET,
-        .handler   = download_get_handler,
+        .handler   = download_get_handler_with_stats,
         .user_ctx  = server_data    // Pass server data as context
     };
     httpd_register_uri_handler(server, &file_download);
@@ -474,7 +1488,7 @@ esp_err_t start_web_server(const char *base_path)
     httpd_uri_t file_upload = {
         .uri       = "/upload/*",   // Match all URIs of type /upload/path/to/file
         .method    = HTTP_POST,
-        .handler   = upload_post_handler,
+        .handler   = upload_post_handler_with_stats,
         .user_ctx  = server_data    // Pass server data as context
     };
     httpd_register_uri_handler(server, &file_upload);
@@ -483,7 +1497,7 @@ esp_err_t start_web_server(const char *base_path)
     httpd_uri_t file_delete = {
         .uri       = "/delete/*",   // Match all URIs of type /delete/path/to/file
         .method    = HTTP_POST,
-        .handler   = delete_post_handler,
+        .handler   = delete_post_handler_with_stats,
         .user_ctx  = server_data    // Pass server data as context
     };
     httpd_register_uri_handler(server, &file_delete);
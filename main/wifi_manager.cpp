@@ -0,0 +1,495 @@
+/*********
+ *
+ * wifi_manager
+ * Persistent WiFi connection manager, see wifi_manager.hpp
+ *
+*********/
+
+#include <string.h>
+#include "wifi_manager.hpp"
+#include "esp_log.h"
+#include "esp_wifi.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+
+// event bits set by the event handler
+#define WIFI_CONNECTED_BIT BIT0     // state bit: station has an IP address
+#define WIFI_EVT_START_BIT BIT1     // event bit: station interface started
+#define WIFI_EVT_GOT_IP_BIT BIT2    // event bit: station got an IP address
+#define WIFI_EVT_DISCONN_BIT BIT3   // event bit: station lost the connection or an attempt failed
+
+#define WIFI_BACKOFF_BASE_MS 500      // backoff after the first failed attempt
+#define WIFI_BACKOFF_MAX_MS 60000     // upper limit of the backoff
+#define WIFI_CONNECT_TIMEOUT_MS 15000 // abort a connection attempt which neither succeeds nor fails
+#define WIFI_AP_FALLBACK_ATTEMPTS 3   // failed attempts until the soft AP is started
+
+#define WIFI_AP_SSID "CoffeeCtrl"
+#define WIFI_AP_CHANNEL 10
+#define WIFI_AP_MAX_CONN 5
+
+#define WIFI_TASK_STACK_SIZE 3072
+#define WIFI_TASK_PRIORITY 3
+
+static const char * TAG_WIFI = "Wifi";
+
+static EventGroupHandle_t s_wifi_event_group = NULL;
+static wifi_config_t s_wifi_sta_config;
+static bool s_b_sta_configured = false;
+static bool s_b_ap_active = false;
+
+// cached access point of the last successful connection, used for fast reconnect
+static bool s_b_ap_cached = false;
+static uint8_t s_arr_cached_bssid[6];
+static uint8_t s_i_cached_channel = 0;
+
+static volatile uint8_t s_i_disconnect_reason = 0;
+
+static wifi_stats s_wifi_stats;
+static portMUX_TYPE s_wifi_stats_mux = portMUX_INITIALIZER_UNLOCKED;
+
+
+static void wifi_event_handler(void * arg, esp_event_base_t event_base, int32_t event_id, void * event_data){
+  /**
+   * Event handler of the WiFi driver. Only translates events to event bits, the connection handling itself is done
+   * in wifiManagerTask.
+   */
+  if (event_base == WIFI_EVENT){
+    if (event_id == WIFI_EVENT_STA_START){
+      xEventGroupSetBits(s_wifi_event_group, WIFI_EVT_START_BIT);
+    } else if (event_id == WIFI_EVENT_STA_DISCONNECTED){
+      wifi_event_sta_disconnected_t * event = (wifi_event_sta_disconnected_t *) event_data;
+      s_i_disconnect_reason = event->reason;
+      xEventGroupClearBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
+      xEventGroupSetBits(s_wifi_event_group, WIFI_EVT_DISCONN_BIT);
+    } else if (event_id == WIFI_EVENT_AP_STACONNECTED) {
+      wifi_event_ap_staconnected_t * event = (wifi_event_ap_staconnected_t *) event_data;
+      ESP_LOGI(TAG_WIFI, "station " MACSTR " join, AID=%d", MAC2STR(event->mac), event->aid);
+    } else if (event_id == WIFI_EVENT_AP_STADISCONNECTED) {
+      wifi_event_ap_stadisconnected_t * event = (wifi_event_ap_stadisconnected_t *) event_data;
+      ESP_LOGI(TAG_WIFI, "station " MACSTR " leave, AID=%d", MAC2STR(event->mac), event->aid);
+    }
+  } else if (event_base == IP_EVENT) {
+    if (event_id == IP_EVENT_STA_GOT_IP){
+      ip_event_got_ip_t * event = (ip_event_got_ip_t *) event_data;
+      ESP_LOGI(TAG_WIFI, "Device got IP address: " IPSTR, IP2STR(&event->ip_info.ip));
+      xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT | WIFI_EVT_GOT_IP_BIT);
+    }
+  }
+}
+
+
+static esp_err_t setSoftAp(bool b_active){
+  /**
+   * Start or stop the soft AP fallback. The station interface keeps running (AP+STA), so the station can retry in the
+   * background while a client is connected to the soft AP. On an error the state is kept, the next call retries.
+   *
+   * @param b_active: true to start the soft AP, false to stop it
+   * @return: error of the WiFi driver
+   */
+
+  esp_err_t i_err;
+
+  if (b_active == s_b_ap_active){
+    return ESP_OK;
+  }
+
+  if (b_active){
+    wifi_config_t wifi_config;
+    memset(&wifi_config, 0, sizeof(wifi_config));
+    strcpy((char*)wifi_config.ap.ssid, WIFI_AP_SSID);
+    wifi_config.ap.ssid_len = strlen(WIFI_AP_SSID);
+    wifi_config.ap.channel = WIFI_AP_CHANNEL;
+    wifi_config.ap.max_connection = WIFI_AP_MAX_CONN;
+    wifi_config.ap.authmode = WIFI_AUTH_OPEN;
+
+    i_err = esp_wifi_set_mode(s_b_sta_configured ? WIFI_MODE_APSTA : WIFI_MODE_AP);
+    if (i_err == ESP_OK){
+      i_err = esp_wifi_set_config(WIFI_IF_AP, &wifi_config);
+    }
+    if (i_err != ESP_OK){
+      ESP_LOGE(TAG_WIFI, "Soft AP %s could not be started: %s", WIFI_AP_SSID, esp_err_to_name(i_err));
+      // back to the station only, the AP interface is configured completely on the next try
+      esp_wifi_set_mode(s_b_sta_configured ? WIFI_MODE_STA : WIFI_MODE_NULL);
+      return i_err;
+    }
+    ESP_LOGI(TAG_WIFI, "Soft AP %s started.", WIFI_AP_SSID);
+  } else {
+    i_err = esp_wifi_set_mode(WIFI_MODE_STA);
+    if (i_err != ESP_OK){
+      ESP_LOGE(TAG_WIFI, "Soft AP %s could not be stopped: %s", WIFI_AP_SSID, esp_err_to_name(i_err));
+      return i_err;
+    }
+    ESP_LOGI(TAG_WIFI, "Soft AP %s stopped.", WIFI_AP_SSID);
+  }
+
+  s_b_ap_active = b_active;
+  portENTER_CRITICAL(&s_wifi_stats_mux);
+  s_wifi_stats.bApActive = b_active;
+  portEXIT_CRITICAL(&s_wifi_stats_mux);
+  return ESP_OK;
+}
+
+
+static esp_err_t startConnectAttempt(bool b_fast){
+  /**
+   * Start a connection attempt of the station interface.
+   *
+   * @param b_fast: use cached BSSID and channel of the last connection, no full channel scan
+   * @return: error of the WiFi driver, the attempt has failed then
+   */
+
+  wifi_config_t wifi_config = s_wifi_sta_config;
+  esp_err_t i_err;
+
+  if (b_fast && s_b_ap_cached){
+    wifi_config.sta.bssid_set = true;
+    memcpy(wifi_config.sta.bssid, s_arr_cached_bssid, sizeof(s_arr_cached_bssid));
+    wifi_config.sta.channel = s_i_cached_channel;
+    wifi_config.sta.scan_method = WIFI_FAST_SCAN;
+  } else {
+    wifi_config.sta.bssid_set = false;
+    wifi_config.sta.channel = 0;
+    wifi_config.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+  }
+
+  portENTER_CRITICAL(&s_wifi_stats_mux);
+  s_wifi_stats.iConnectAttempts++;
+  s_wifi_stats.iState = WIFI_STATE_CONNECTING;
+  portEXIT_CRITICAL(&s_wifi_stats_mux);
+
+  i_err = esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+  if (i_err != ESP_OK){
+    ESP_LOGE(TAG_WIFI, "Station configuration failed: %s", esp_err_to_name(i_err));
+    return i_err;
+  }
+  i_err = esp_wifi_connect();
+  if (i_err != ESP_OK){
+    ESP_LOGE(TAG_WIFI, "Connection attempt could not be started: %s", esp_err_to_name(i_err));
+  }
+  return i_err;
+}
+
+
+static uint32_t getBackoffTime(int i_attempt){
+  /**
+   * Calculate exponential backoff time with jitter. Half of the backoff time is fixed, the other half is random, so
+   * several devices do not hammer a rebooting router at the same time.
+   *
+   * @param i_attempt: number of failed attempts in a row (>=1)
+   * @return: backoff time in ms
+   */
+
+  int i_shift = (i_attempt > 16) ? 16 : (i_attempt - 1);
+  uint32_t i_backoff_ms = (uint32_t)WIFI_BACKOFF_BASE_MS << i_shift;
+
+  if (i_backoff_ms > WIFI_BACKOFF_MAX_MS){
+    i_backoff_ms = WIFI_BACKOFF_MAX_MS;
+  }
+
+  return i_backoff_ms / 2 + esp_random() % (i_backoff_ms / 2 + 1);
+}
+
+
+static void sampleRssi(){
+  /**
+   * Store current RSSI of the station interface to the history ring buffer
+   */
+
+  wifi_ap_record_t ap;
+  if (esp_wifi_sta_get_ap_info(&ap) != ESP_OK){
+    return;
+  }
+
+  portENTER_CRITICAL(&s_wifi_stats_mux);
+  s_wifi_stats.iRssiHistoryIdx = (s_wifi_stats.iRssiHistoryIdx + 1) % WIFI_RSSI_HISTORY_SIZE;
+  s_wifi_stats.arrRssiHistory[s_wifi_stats.iRssiHistoryIdx] = ap.rssi;
+  if (s_wifi_stats.iRssiHistoryCnt < WIFI_RSSI_HISTORY_SIZE){
+    s_wifi_stats.iRssiHistoryCnt++;
+  }
+  portEXIT_CRITICAL(&s_wifi_stats_mux);
+}
+
+
+static void onConnected(int64_t i_time_to_ip_us){
+  /**
+   * Bookkeeping after the station got an IP address: cache access point for fast reconnect and report link quality.
+   *
+   * @param i_time_to_ip_us: time from link loss (or start) until IP address
+   */
+
+  wifi_ap_record_t ap;
+
+  if (esp_wifi_sta_get_ap_info(&ap) == ESP_OK){
+    memcpy(s_arr_cached_bssid, ap.bssid, sizeof(s_arr_cached_bssid));
+    s_i_cached_channel = ap.primary;
+    s_b_ap_cached = true;
+
+    int i_db_perc = 0;
+    if (ap.rssi >= -50) {
+      i_db_perc = 100;
+    } else if (ap.rssi <= -100) {
+      i_db_perc = 0;
+    } else {
+      i_db_perc = 2 * (ap.rssi + 100);
+    }
+    ESP_LOGI(TAG_WIFI, "Connected on channel %d, signal strength: %d dB -> %d %%, time to IP: %lld ms",
+             ap.primary, ap.rssi, i_db_perc, i_time_to_ip_us / 1000);
+  }
+
+  portENTER_CRITICAL(&s_wifi_stats_mux);
+  s_wifi_stats.iState = WIFI_STATE_CONNECTED;
+  s_wifi_stats.iLastTimeToIpUs = i_time_to_ip_us;
+  portEXIT_CRITICAL(&s_wifi_stats_mux);
+
+  sampleRssi();
+}
+
+
+static void wifiManagerTask(void * ptr_params){
+  /**
+   * Connection state machine of the station interface. Never gives up: after a lost connection a fast reconnect on
+   * the cached access point is tried first, afterwards full scans are done with exponential backoff. After
+   * WIFI_AP_FALLBACK_ATTEMPTS failed attempts the soft AP is started in parallel and stopped again as soon as the
+   * station is connected.
+   */
+
+  int i_state = WIFI_STATE_IDLE;
+  int i_failed_attempts = 0;
+  bool b_fast_attempt = false;
+  int64_t i_link_lost_us = esp_timer_get_time();
+  int64_t i_attempt_start_us = 0;
+  int64_t i_next_attempt_us = 0;
+  int64_t i_next_rssi_us = 0;
+  TickType_t i_wait_ticks = portMAX_DELAY;
+
+  for (;;){
+    EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group,
+                                           WIFI_EVT_START_BIT | WIFI_EVT_GOT_IP_BIT | WIFI_EVT_DISCONN_BIT,
+                                           pdTRUE, pdFALSE, i_wait_ticks);
+    int64_t i_now_us = esp_timer_get_time();
+    bool b_attempt_failed = false;
+
+    if (bits & WIFI_EVT_START_BIT){
+      i_state = WIFI_STATE_CONNECTING;
+      i_attempt_start_us = i_now_us;
+      b_fast_attempt = false;
+      b_attempt_failed = (startConnectAttempt(false) != ESP_OK);
+    }
+
+    if (bits & WIFI_EVT_DISCONN_BIT){
+      if (i_state == WIFI_STATE_CONNECTED){
+        // connection lost, try the known access point immediately
+        ESP_LOGW(TAG_WIFI, "Connection lost (reason %d), reconnecting.", s_i_disconnect_reason);
+        portENTER_CRITICAL(&s_wifi_stats_mux);
+        s_wifi_stats.iReconnectCount++;
+        s_wifi_stats.iLastDisconnectReason = s_i_disconnect_reason;
+        portEXIT_CRITICAL(&s_wifi_stats_mux);
+
+        i_link_lost_us = i_now_us;
+        i_failed_attempts = 0;
+        i_state = WIFI_STATE_CONNECTING;
+        i_attempt_start_us = i_now_us;
+        b_fast_attempt = s_b_ap_cached;
+        b_attempt_failed = (startConnectAttempt(b_fast_attempt) != ESP_OK);
+      } else if (i_state == WIFI_STATE_CONNECTING){
+        ESP_LOGI(TAG_WIFI, "connect to AP fail (reason %d).", s_i_disconnect_reason);
+        portENTER_CRITICAL(&s_wifi_stats_mux);
+        s_wifi_stats.iLastDisconnectReason = s_i_disconnect_reason;
+        portEXIT_CRITICAL(&s_wifi_stats_mux);
+        b_attempt_failed = true;
+      }
+    }
+
+    if ((bits & WIFI_EVT_GOT_IP_BIT) && (xEventGroupGetBits(s_wifi_event_group) & WIFI_CONNECTED_BIT)){
+      if (i_state != WIFI_STATE_CONNECTED){
+        i_state = WIFI_STATE_CONNECTED;
+        i_failed_attempts = 0;
+        onConnected(i_now_us - i_link_lost_us);
+        setSoftAp(false);
+        i_next_rssi_us = i_now_us + (int64_t)WIFI_RSSI_SAMPLE_PERIOD_MS * 1000;
+      }
+    }
+
+    // time triggered actions
+    if (i_state == WIFI_STATE_BACKOFF && i_now_us >= i_next_attempt_us){
+      i_state = WIFI_STATE_CONNECTING;
+      i_attempt_start_us = i_now_us;
+      b_attempt_failed = (startConnectAttempt(false) != ESP_OK);
+    } else if (i_state == WIFI_STATE_CONNECTING && !b_attempt_failed &&
+               (i_now_us - i_attempt_start_us) > (int64_t)WIFI_CONNECT_TIMEOUT_MS * 1000){
+      // abort hanging attempt, it counts as failed attempt itself. The disconnect event of the abort arrives in
+      // backoff and is ignored there.
+      ESP_LOGW(TAG_WIFI, "connect to AP timed out after %d ms.", WIFI_CONNECT_TIMEOUT_MS);
+      esp_wifi_disconnect();
+      b_attempt_failed = true;
+    } else if (i_state == WIFI_STATE_CONNECTED && i_now_us >= i_next_rssi_us){
+      sampleRssi();
+      i_next_rssi_us = i_now_us + (int64_t)WIFI_RSSI_SAMPLE_PERIOD_MS * 1000;
+    }
+
+    if (b_attempt_failed){
+      // wait before the next attempt
+      i_failed_attempts++;
+      if (b_fast_attempt){
+        // access point is not reachable on the cached channel anymore, scan all channels next time
+        s_b_ap_cached = false;
+        b_fast_attempt = false;
+      }
+      if (i_failed_attempts >= WIFI_AP_FALLBACK_ATTEMPTS){
+        setSoftAp(true);
+      }
+
+      uint32_t i_backoff_ms = getBackoffTime(i_failed_attempts);
+      ESP_LOGI(TAG_WIFI, "retry in %u ms.", i_backoff_ms);
+
+      i_state = WIFI_STATE_BACKOFF;
+      i_next_attempt_us = i_now_us + (int64_t)i_backoff_ms * 1000;
+      portENTER_CRITICAL(&s_wifi_stats_mux);
+      s_wifi_stats.iState = WIFI_STATE_BACKOFF;
+      portEXIT_CRITICAL(&s_wifi_stats_mux);
+    }
+
+    // sleep until the next event or the next time triggered action
+    int64_t i_wait_us;
+    if (i_state == WIFI_STATE_BACKOFF){
+      i_wait_us = i_next_attempt_us - i_now_us;
+    } else if (i_state == WIFI_STATE_CONNECTING){
+      i_wait_us = i_attempt_start_us + (int64_t)WIFI_CONNECT_TIMEOUT_MS * 1000 - i_now_us;
+    } else if (i_state == WIFI_STATE_CONNECTED){
+      i_wait_us = i_next_rssi_us - i_now_us;
+    } else {
+      i_wait_us = -1;
+    }
+
+    if (i_wait_us < 0){
+      i_wait_ticks = (i_state == WIFI_STATE_IDLE) ? portMAX_DELAY : 1;
+    } else {
+      i_wait_ticks = pdMS_TO_TICKS(i_wait_us / 1000) + 1;
+    }
+  }
+}
+
+
+esp_err_t wifiManagerStart(const char * str_ssid, const char * str_password){
+  /**
+   * Initialize WiFi and start the connection manager task. The function does not block, use
+   * wifiManagerWaitConnected() to wait for the connection. If no SSID is given only the soft AP is started.
+   *
+   * @param str_ssid: SSID of the access point
+   * @param str_password: password of the access point
+   * @return: ESP_OK if WiFi could be started
+   */
+
+  if (s_wifi_event_group){
+    ESP_LOGE(TAG_WIFI, "WiFi manager already started");
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  memset(&s_wifi_stats, 0, sizeof(s_wifi_stats));
+  s_wifi_stats.iLastTimeToIpUs = -1;
+  s_wifi_stats.iRssiHistoryIdx = -1;
+
+  s_wifi_event_group = xEventGroupCreate();
+
+  ESP_ERROR_CHECK(esp_netif_init());
+  ESP_ERROR_CHECK(esp_event_loop_create_default());
+  esp_netif_create_default_wifi_sta();
+  esp_netif_create_default_wifi_ap();
+
+  wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+  ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+
+  esp_event_handler_instance_t instance_any_id;
+  esp_event_handler_instance_t instance_got_ip;
+  ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &wifi_event_handler, NULL, &instance_any_id));
+  ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &wifi_event_handler, NULL, &instance_got_ip));
+
+  // initialize wifi_config with zeros
+  memset(&s_wifi_sta_config, 0, sizeof(s_wifi_sta_config));
+  strlcpy((char*)s_wifi_sta_config.sta.ssid, str_ssid, sizeof(s_wifi_sta_config.sta.ssid));
+  strlcpy((char*)s_wifi_sta_config.sta.password, str_password, sizeof(s_wifi_sta_config.sta.password));
+  s_wifi_sta_config.sta.threshold.authmode = WIFI_AUTH_WPA2_WPA3_PSK;
+  s_wifi_sta_config.sta.sort_method = WIFI_CONNECT_AP_BY_SIGNAL;
+  s_b_sta_configured = (strlen(str_ssid) > 0);
+
+  if (s_b_sta_configured){
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &s_wifi_sta_config));
+  } else {
+    ESP_LOGW(TAG_WIFI, "No SSID configured.");
+    setSoftAp(true);
+  }
+
+  if (xTaskCreate(wifiManagerTask, "wifi_manager", WIFI_TASK_STACK_SIZE, NULL, WIFI_TASK_PRIORITY, NULL) != pdPASS){
+    ESP_LOGE(TAG_WIFI, "Failed to create WiFi manager task");
+    return ESP_FAIL;
+  }
+
+  ESP_ERROR_CHECK(esp_wifi_start());
+  return ESP_OK;
+}
+
+
+bool wifiManagerWaitConnected(uint32_t i_timeout_ms){
+  /**
+   * Wait until the station is connected. The connection manager keeps retrying in background after a timeout.
+   *
+   * @param i_timeout_ms: maximum waiting time in ms
+   * @return: true if the station is connected
+   */
+
+  if (!s_wifi_event_group || !s_b_sta_configured){
+    return false;
+  }
+
+  EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group, WIFI_CONNECTED_BIT, pdFALSE, pdFALSE,
+                                         pdMS_TO_TICKS(i_timeout_ms));
+  return (bits & WIFI_CONNECTED_BIT) != 0;
+}
+
+
+bool wifiManagerIsConnected(){
+  /**
+   * @return: true if the station has an IP address
+   */
+
+  if (!s_wifi_event_group){
+    return false;
+  }
+  return (xEventGroupGetBits(s_wifi_event_group) & WIFI_CONNECTED_BIT) != 0;
+}
+
+
+int8_t wifiManagerGetRssi(){
+  /**
+   * @return: latest RSSI sample in dBm, 0 if no sample is available
+   */
+
+  int8_t i_rssi = 0;
+
+  portENTER_CRITICAL(&s_wifi_stats_mux);
+  if (s_wifi_stats.iRssiHistoryCnt > 0){
+    i_rssi = s_wifi_stats.arrRssiHistory[s_wifi_stats.iRssiHistoryIdx];
+  }
+  portEXIT_CRITICAL(&s_wifi_stats_mux);
+
+  return i_rssi;
+}
+
+
+void wifiManagerGetStats(wifi_stats * ptr_stats){
+  /**
+   * Copy connection quality metrics
+   *
+   * @param ptr_stats: destination of the copy
+   */
+
+  portENTER_CRITICAL(&s_wifi_stats_mux);
+  *ptr_stats = s_wifi_stats;
+  portEXIT_CRITICAL(&s_wifi_stats_mux);
+}
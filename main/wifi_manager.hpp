@@ -0,0 +1,45 @@
+/*********
+ *
+ * wifi_manager
+ * Persistent WiFi connection manager. A background task keeps the station connected with exponential backoff
+ * and jitter, tries a fast reconnect on the cached BSSID/channel first and keeps the soft AP "CoffeeCtrl" up
+ * (AP+STA) while the station is retrying.
+ *
+*********/
+
+#ifndef WIFI_MANAGER_h
+#define WIFI_MANAGER_h
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#define WIFI_RSSI_HISTORY_SIZE 32 // number of stored RSSI samples
+#define WIFI_RSSI_SAMPLE_PERIOD_MS 10000 // sample period of the RSSI history
+
+enum eWifiState{
+  WIFI_STATE_IDLE,        // no station configured, only soft AP is running
+  WIFI_STATE_CONNECTING,  // connection attempt ongoing
+  WIFI_STATE_CONNECTED,   // station got an IP address
+  WIFI_STATE_BACKOFF      // waiting for the next connection attempt
+};
+
+// connection quality metrics of the station interface
+struct wifi_stats {
+  int iState;                                     // actual state, see eWifiState
+  bool bApActive;                                 // soft AP fallback is running
+  uint32_t iReconnectCount;                       // number of lost connections since boot
+  uint32_t iConnectAttempts;                      // total number of connection attempts since boot
+  uint8_t iLastDisconnectReason;                  // wifi_err_reason_t of the last disconnect
+  int64_t iLastTimeToIpUs;                        // time from link loss (or start) until IP in us, -1 if never connected
+  int8_t arrRssiHistory[WIFI_RSSI_HISTORY_SIZE];  // RSSI ring buffer in dBm
+  int iRssiHistoryCnt;                            // number of valid entries in arrRssiHistory
+  int iRssiHistoryIdx;                            // index of the latest entry in arrRssiHistory
+};
+
+esp_err_t wifiManagerStart(const char * str_ssid, const char * str_password);
+bool wifiManagerWaitConnected(uint32_t i_timeout_ms);
+bool wifiManagerIsConnected();
+int8_t wifiManagerGetRssi();
+void wifiManagerGetStats(wifi_stats * ptr_stats);
+
+#endif
@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+"""
+gen_web_assets
+Generate the C++ source of the web interface bundle which is linked into the app image. Every file is stored gzip
+compressed if that makes it smaller, the index is a minimal perfect hash (hash and displace) from URI to asset, the
+lookup is implemented in main/assets.cpp with the same hash function.
+
+usage: gen_web_assets.py --output <file.cpp> [--alias <uri>=<uri>] <file> [<file> ...]
+"""
+
+import argparse
+import gzip
+import os
+import sys
+
+CONTENT_TYPES = {
+    ".html": "text/html",
+    ".css": "text/css",
+    ".js": "application/javascript",
+    ".json": "application/json",
+    ".png": "image/png",
+    ".ico": "image/x-icon",
+    ".svg": "image/svg+xml",
+}
+
+MAX_SEED = 0xFFFF
+
+
+def fnv1a(seed, data):
+    """32 bit FNV-1a with the seed mixed into the offset basis, same as assetsHash() of the firmware"""
+    value = (0x811C9DC5 ^ seed) & 0xFFFFFFFF
+    for byte in data:
+        value ^= byte
+        value = (value * 0x01000193) & 0xFFFFFFFF
+    return value
+
+
+def build_perfect_hash(keys):
+    """
+    Find a displacement seed per bucket so that every key lands in its own slot
+
+    @return: list of seeds per bucket, list of slot per key
+    """
+    count = len(keys)
+    bucket_count = max(1, (count + 1) // 2)
+    buckets = [[] for _ in range(bucket_count)]
+    for idx, key in enumerate(keys):
+        buckets[fnv1a(0, key) % bucket_count].append(idx)
+
+    seeds = [0] * bucket_count
+    slots = [None] * count
+    used = set()
+    # large buckets first, they are the hardest to place
+    for bucket_idx in sorted(range(bucket_count), key=lambda i: -len(buckets[i])):
+        members = buckets[bucket_idx]
+        if not members:
+            continue
+        for seed in range(1, MAX_SEED + 1):
+            candidate = [fnv1a(seed, keys[idx]) % count for idx in members]
+            if len(set(candidate)) == len(candidate) and not used.intersection(candidate):
+                break
+        else:
+            sys.exit("gen_web_assets: no perfect hash found")
+        seeds[bucket_idx] = seed
+        for idx, slot in zip(members, candidate):
+            slots[idx] = slot
+            used.add(slot)
+
+    return seeds, slots
+
+
+def c_bytes(data):
+    lines = []
+    for pos in range(0, len(data), 16):
+        lines.append("    " + ", ".join("0x%02x" % byte for byte in data[pos:pos + 16]) + ",")
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="generate the embedded web interface bundle")
+    parser.add_argument("--output", required=True)
+    parser.add_argument("--alias", action="append", default=[], help="additional URI of an asset, <uri>=<uri>")
+    parser.add_argument("files", nargs="+")
+    args = parser.parse_args()
+
+    blobs = []      # (name, data, gzipped)
+    assets = []     # (uri, content type, blob index)
+    for path in sorted(args.files, key=os.path.basename):
+        name = os.path.basename(path)
+        with open(path, "rb") as obj_file:
+            raw = obj_file.read()
+        packed = gzip.compress(raw, compresslevel=9, mtime=0)
+        gzipped = len(packed) < len(raw)
+        blobs.append((name, packed if gzipped else raw, gzipped))
+        content_type = CONTENT_TYPES.get(os.path.splitext(name)[1].lower(), "text/plain")
+        assets.append(("/" + name, content_type, len(blobs) - 1))
+
+    for alias in args.alias:
+        uri, target = alias.split("=", 1)
+        match = [asset for asset in assets if asset[0] == target]
+        if not match:
+            sys.exit("gen_web_assets: alias target %s not found" % target)
+        assets.append((uri, match[0][1], match[0][2]))
+
+    keys = [asset[0].encode() for asset in assets]
+    if len(set(keys)) != len(keys):
+        sys.exit("gen_web_assets: duplicate URI")
+    seeds, slots = build_perfect_hash(keys)
+    table = [None] * len(assets)
+    for asset, slot in zip(assets, slots):
+        table[slot] = asset
+
+    out = ["// generated by tools/gen_web_assets.py, do not edit", "", '#include "assets.hpp"', ""]
+    for idx, (name, data, gzipped) in enumerate(blobs):
+        out.append("// %s, %d bytes%s" % (name, len(data), " gzip" if gzipped else ""))
+        out.append("static const uint8_t s_arr_blob_%d[] = {" % idx)
+        out.append(c_bytes(data))
+        out.append("};")
+        out.append("")
+
+    out.append("extern const web_asset arrWebAssets[] = {")
+    for uri, content_type, blob_idx in table:
+        name, data, gzipped = blobs[blob_idx]
+        out.append('  {"%s", "%s", s_arr_blob_%d, %d, %s, 0x%08xU},'
+                   % (uri, content_type, blob_idx, len(data), "true" if gzipped else "false", fnv1a(0, data)))
+    out.append("};")
+    out.append("extern const int iWebAssetCount = %d;" % len(table))
+    out.append("")
+    out.append("extern const uint16_t arrWebAssetSeeds[] = {%s};" % ", ".join(str(seed) for seed in seeds))
+    out.append("extern const int iWebAssetBuckets = %d;" % len(seeds))
+    out.append("")
+
+    content = "\n".join(out)
+    # an unchanged output is only touched: it has to be newer than the inputs, else the build reruns the generator
+    if os.path.exists(args.output):
+        with open(args.output) as obj_file:
+            if obj_file.read() == content:
+                os.utime(args.output)
+                return
+    with open(args.output, "w") as obj_file:
+        obj_file.write(content)
+
+
+if __name__ == "__main__":
+    main()